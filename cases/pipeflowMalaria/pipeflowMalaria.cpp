@@ -58,12 +58,7 @@ int main(int argc, char *argv[]) {
   param::lbm_pipe_parameters((*cfg),flagMatrix);
   param::printParameters();
 
-  hemocell.lattice = new MultiBlockLattice3D<T, DESCRIPTOR>(
-            voxelizedDomain->getMultiBlockManagement(),
-            defaultMultiBlockPolicy3D().getBlockCommunicator(),
-            defaultMultiBlockPolicy3D().getCombinedStatistics(),
-            defaultMultiBlockPolicy3D().getMultiCellAccess<T, DESCRIPTOR>(),
-            new GuoExternalForceBGKdynamics<T, DESCRIPTOR>(1.0/param::tau));
+  hemocell.initializeLattice(flagMatrix->getMultiBlockManagement(), flagMatrix);
 
   defineDynamics(*hemocell.lattice, *flagMatrix, (*hemocell.lattice).getBoundingBox(), new BounceBack<T, DESCRIPTOR>(1.), 0);
 
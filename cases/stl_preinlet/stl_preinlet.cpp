@@ -69,7 +69,7 @@ int main(int argc, char *argv[]) {
   hemocell.preInlet->preInletFromSlice(Direction::Xpos,slice);
 
   hlog << "(PipeFlow) (Fluid) Initializing Palabos Fluid Field" << endl;
-  hemocell.initializeLattice(voxelizedDomain->getMultiBlockManagement());
+  hemocell.initializeLattice(flagMatrix->getMultiBlockManagement(), flagMatrix);
 
   if (!hemocell.partOfpreInlet) {
     hemocell.lattice->periodicity().toggleAll(false);
@@ -67,7 +67,7 @@ int main(int argc, char* argv[])
 			defaultMultiBlockPolicy3D().getBlockCommunicator(),
 			defaultMultiBlockPolicy3D().getCombinedStatistics(),
 			defaultMultiBlockPolicy3D().getMultiCellAccess<T, DESCRIPTOR>(),
-			new GuoExternalForceBGKdynamics<T, DESCRIPTOR>(1.0/param::tau));
+			new InteriorViscosityBGKdynamics<T, DESCRIPTOR>(1.0/param::tau));
 
 
 	hemocell.lattice->toggleInternalStatistics(false);
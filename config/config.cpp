@@ -182,6 +182,51 @@ void loadGlobalConfigValues(hemo::Config * cfg) {
   try {
    global.enableCEPACfield = (*cfg)["parameters"]["enableCEPACfield"].read<int>();
   } catch(std::invalid_argument & e) {}
+  try {
+   if ((*cfg)["domain"]["particleEnvelope"].read<std::string>() == "auto") {
+     global.automaticParticleEnvelope = true;
+   } else {
+     global.particleEnvelope = (*cfg)["domain"]["particleEnvelope"].read<int>();
+   }
+  } catch(std::invalid_argument & e) {}
+  try {
+   global.enableCellMechanicsOwnership = (*cfg)["parameters"]["cellMechanicsOwnership"].read<int>();
+  } catch(std::invalid_argument & e) {}
+  try {
+   global.enableSharedMemoryExchange = (*cfg)["parameters"]["sharedMemoryExchange"].read<int>();
+  } catch(std::invalid_argument & e) {}
+  try {
+   std::string layout = (*cfg)["parameters"]["hdf5Output"].read<std::string>();
+   if (layout == "single") {
+     global.hdf5OutputLayout = Hdf5OutputLayout::SingleFile;
+   } else if (layout == "timeseries") {
+     global.hdf5OutputLayout = Hdf5OutputLayout::TimeSeries;
+   } else if (layout != "blocks") {
+     hlog << "(Hemocell) (Config) Error unknown hdf5Output \"" << layout << "\", use \"blocks\", \"single\" or \"timeseries\"" << std::endl;
+     exit(1);
+   }
+  } catch(std::invalid_argument & e) {}
+  try {
+   global.enableAsyncOutput = (*cfg)["parameters"]["asyncOutput"].read<int>();
+  } catch(std::invalid_argument & e) {}
+  try {
+   global.staticOutput = (*cfg)["parameters"]["staticOutput"].read<int>();
+  } catch(std::invalid_argument & e) {}
+  try {
+   std::string format = (*cfg)["parameters"]["cellInfoOutput"].read<std::string>();
+   if (format != "csv" && format != "hdf5" && format != "both" && format != "none") {
+     hlog << "(Hemocell) (Config) Error unknown cellInfoOutput \"" << format << "\", use \"csv\", \"hdf5\", \"both\" or \"none\"" << std::endl;
+     exit(1);
+   }
+   global.cellInfoCsv = format == "csv" || format == "both";
+   global.cellInfoHdf5 = format == "hdf5" || format == "both";
+  } catch(std::invalid_argument & e) {}
+  try {
+   global.cellConstantsCache = (*cfg)["parameters"]["cellConstantsCache"].read<std::string>();
+  } catch(std::invalid_argument & e) {}
+  try {
+   global.flagMatrixCache = (*cfg)["parameters"]["flagMatrixCache"].read<std::string>();
+  } catch(std::invalid_argument & e) {}
   try {
    global.enableSolidifyMechanics = (*cfg)["parameters"]["enableSolidifyMechanics"].read<int>();
 #ifndef SOLIDIFY_MECHANICS
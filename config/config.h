@@ -76,6 +76,9 @@ namespace hemo {
 
 void loadDirectories(hemo::Config * cfg, bool edit_out_dir = true);
 
+/// Layout of the HDF5 output, see parameters/hdf5Output
+enum class Hdf5OutputLayout { Blocks, SingleFile, TimeSeries };
+
 struct ConfigValues {
   bool hemoCellInitialized = false; // Keep track since two hemocells cannot run at the same time, because of static variables
   bool cellsDeletedInfo = false;
@@ -85,9 +88,33 @@ struct ConfigValues {
   bool enableSolidifyMechanics = false;
 
   bool enableInteriorViscosity = false;
+
+  bool enableCellMechanicsOwnership = false;
+
+  bool enableSharedMemoryExchange = true;
+
+  Hdf5OutputLayout hdf5OutputLayout = Hdf5OutputLayout::Blocks;
+
+  bool enableAsyncOutput = false;
+
+  bool staticOutput = false;
+
+  // Formats of the per-cell table written with the output, see parameters/cellInfoOutput
+  bool cellInfoCsv = true;
+  bool cellInfoHdf5 = false;
+
+  // Particle envelope width [lu], provisional when <particleEnvelope> is "auto"
+  int particleEnvelope = 25;
+  bool automaticParticleEnvelope = false;
   
   std::string checkpointDirectory = "./checkpoint/";
 
+  // Directory of the cell constants cache, see parameters/cellConstantsCache. Empty disables it
+  std::string cellConstantsCache;
+
+  // Directory of the flag matrix cache of getFlagMatrixFromSTL, see parameters/flagMatrixCache. Empty disables it
+  std::string flagMatrixCache;
+
   Profiler statistics = Profiler("HemoCell");
 };
 
@@ -74,6 +74,15 @@ FORCE_LIMIT sets the allowed maximal force coming from the constitutive model (i
 #define FORCE_LIMIT 50.0 
 #endif
 
+/*
+Deformation allowed for when the particle envelope is computed automatically
+(<particleEnvelope>auto</particleEnvelope>), as a factor on the largest extent
+of the undeformed cells.
+*/
+#ifndef PARTICLE_ENVELOPE_DEFORMATION
+#define PARTICLE_ENVELOPE_DEFORMATION 1.25
+#endif
+
 /*
  * Used for defining the shape of the cells through constructMeshElement function
  */
@@ -29,12 +29,17 @@ along with this program.  If not, see <http://www.gnu.org/licenses/>.
 #include <mpi.h>
 
 #include "readPositionsBloodCells.h"
+#include "AsyncHdf5IO.h"
+#include "Hdf5Compression.h"
 #include "hemoCellFunctional.h"
 #include "hemoCellParticle.h"
 #include "hemoCellField.h"
 #include "ParticleHdf5IO.h"
 #include "FluidHdf5IO.h"
 #include "writeCellInfoCSV.h"
+#include "writeCellInfoHDF5.h"
+#include "suspensionAnalysis.h"
+#include "fluidAverage.h"
 #include "genericFunctions.h"
 
 #include "palabos3D.h"
@@ -42,6 +47,7 @@ along with this program.  If not, see <http://www.gnu.org/licenses/>.
 #include "preInlet.h"
 #include "bindingField.h"
 #include "interiorViscosity.h"
+#include "fluidDecomposition.h"
 
 using namespace hemo;
 
@@ -87,6 +93,23 @@ HemoCell::HemoCell(char * configFileName, int argc, char * argv[], HemoCell::MPI
     loadDirectories(cfg);
   }
   loadGlobalConfigValues(cfg);
+  loadHdf5Compression(cfg);
+  if (global.hdf5OutputLayout != Hdf5OutputLayout::Blocks && !singleFileHdf5Supported()) {
+    hlog << "(HemoCell) (Config) WARNING: hdf5Output \"single\" and \"timeseries\" require HDF5 with MPI-IO support, writing one file per atomic block instead" << endl;
+    global.hdf5OutputLayout = Hdf5OutputLayout::Blocks;
+  }
+  if (global.enableAsyncOutput && global.hdf5OutputLayout != Hdf5OutputLayout::Blocks) {
+    hlog << "(HemoCell) (Config) WARNING: asyncOutput only applies to hdf5Output \"blocks\", shared files are written collectively in the time loop" << endl;
+    global.enableAsyncOutput = false;
+  }
+  if (global.enableAsyncOutput && !AsyncHdf5Writer::supported()) {
+    hlog << "(HemoCell) (Config) WARNING: asyncOutput requires a thread-safe HDF5 library, writing the output synchronously instead" << endl;
+    global.enableAsyncOutput = false;
+  }
+  if (global.enableAsyncOutput) {
+    asyncOutput = new AsyncHdf5Writer();
+  }
+  analysis = SuspensionAnalysis::fromConfig(*cfg);
   printHeader();
   
   //Start statistics
@@ -95,6 +118,15 @@ HemoCell::HemoCell(char * configFileName, int argc, char * argv[], HemoCell::MPI
 }
 
 HemoCell::~HemoCell() {
+  if (asyncOutput) {
+    delete asyncOutput; //Finishes the output still in flight
+  }
+  if (analysis) {
+    delete analysis;
+  }
+  if (fluidAverage) {
+    delete fluidAverage;
+  }
   if (cellfields) {
     delete cellfields;
   }
@@ -136,7 +168,7 @@ void HemoCell::initializeCellfield() {
   if (!domain_lattice) {
     domain_lattice = lattice;
   }
-  cellfields = new HemoCellFields(*lattice,(*cfg)["domain"]["particleEnvelope"].read<int>(),*this);
+  cellfields = new HemoCellFields(*lattice,global.particleEnvelope,*this);
 
   //Set envelope of fluid to 1 again, while maintaining outer one for correct force distribution
   lattice->getMultiBlockManagement().changeEnvelopeWidth(1);
@@ -158,12 +190,55 @@ void HemoCell::setFluidOutputs(vector<int> outputs) {
   cellfields->desiredFluidOutputVariables = outputs_c;
 }
 
+void HemoCell::setFluidAverages(vector<int> variables, unsigned int interval, unsigned int window) {
+  if (!cellfields) {
+    pcerr << "(HemoCell) (FluidAverage) setFluidAverages is called before initializeCellfield, exiting" << endl;
+    exit(1);
+  }
+  hlog << "(HemoCell) (FluidAverage) Sampling fluid statistics every " << interval << " iterations, written every " << window << " iterations" << endl;
+  if (fluidAverage) {
+    delete fluidAverage;
+  }
+  fluidAverage = new FluidAverage(*cellfields,variables,interval,window);
+}
+
 void HemoCell::setCEPACOutputs(vector<int> outputs) {
   hlog << "(HemoCell) (Fluid) Setting CEPAC output variables for fluid field" << endl;
   vector<int> outputs_c = outputs;
   cellfields->desiredCEPACfieldOutputVariables = outputs_c;
 }
 
+void HemoCell::addOutputRegion(Box3D region) {
+  hlog << "(HemoCell) (Output) Restricting output to region x " << region.x0 << "-" << region.x1 << " y " << region.y0 << "-" << region.y1 << " z " << region.z0 << "-" << region.z1 << " [lu]" << endl;
+  cellfields->outputRegions.push_back(region);
+}
+
+void HemoCell::addOutputRegion(hemo::Array<T,3> lower, hemo::Array<T,3> upper) {
+  addOutputRegion(Box3D(plint(std::floor(lower[0]/param::dx)), plint(std::ceil(upper[0]/param::dx)),
+                        plint(std::floor(lower[1]/param::dx)), plint(std::ceil(upper[1]/param::dx)),
+                        plint(std::floor(lower[2]/param::dx)), plint(std::ceil(upper[2]/param::dx))));
+}
+
+void HemoCell::setFluidOutputStride(unsigned int stride, bool average) {
+  if (stride == 0) {
+    pcerr << "(HemoCell) (Output) the fluid output stride must be at least 1" << endl;
+    exit(1);
+  }
+  hlog << "(HemoCell) (Output) Writing " << (average ? "the average of every " : "every ") << stride << (average ? "^3 fluid nodes" : "th fluid node") << endl;
+  cellfields->fluidOutputStride = stride;
+  cellfields->fluidOutputAverage = average && stride > 1;
+}
+
+void HemoCell::setOutputInterval(string name, unsigned int interval) {
+  hlog << "(HemoCell) (CellField) Writing " << name << " cells every " << interval << " outputs" << endl;
+  (*cellfields)[name]->outputInterval = interval > 0 ? interval : 1;
+}
+
+void HemoCell::setOutputCellSelection(string name, std::function<bool(hemo::Array<T,3> const &)> selection) {
+  hlog << "(HemoCell) (CellField) Setting output cell selection for " << name << " cells" << endl;
+  (*cellfields)[name]->outputCellSelection = selection;
+}
+
 
 void HemoCell::setSystemPeriodicity(unsigned int axis, bool bePeriodic) {
   if (lattice == 0) {
@@ -191,6 +266,9 @@ void HemoCell::setSystemPeriodicityLimit(unsigned int axis, int limit) {
 void HemoCell::loadParticles() {
   hlog << "(HemoCell) (CellField) Loading particle positions "  << endl;
   loadParticlesIsCalled = true;
+  if (global.automaticParticleEnvelope) {
+    cellfields->applyMinimalParticleEnvelope();
+  }
   readPositionsBloodCellField3D(*cellfields, param::dx, *cfg);
   cellfields->syncEnvelopes();
   cellfields->deleteIncompleteCells(false);
@@ -198,6 +276,9 @@ void HemoCell::loadParticles() {
 
 void HemoCell::loadCheckPoint() {
   hlog << "(HemoCell) (Saving Functions) Loading Checkpoint"  << endl;
+  if (global.automaticParticleEnvelope) {
+    cellfields->applyMinimalParticleEnvelope();
+  }
   cellfields->load(documentXML, iter, cfg);
   if (global.enableSolidifyMechanics) {
     bindingFieldHelper::restore(*cellfields);
@@ -205,6 +286,12 @@ void HemoCell::loadCheckPoint() {
   if (global.enableInteriorViscosity) {
     InteriorViscosityHelper::restore(*cellfields);
   }
+  if (fluidAverage) {
+    fluidAverage->restore();
+  }
+  if (analysis) {
+    analysis->restart(*this,iter);
+  }
 }
 
 void HemoCell::saveCheckPoint() {
@@ -216,6 +303,9 @@ void HemoCell::saveCheckPoint() {
   if (global.enableInteriorViscosity) {
     InteriorViscosityHelper::get(*cellfields).checkpoint();
   }
+  if (fluidAverage) {
+    fluidAverage->checkpoint();
+  }
 }
 
 void HemoCell::writeOutput() {
@@ -260,12 +350,25 @@ void HemoCell::writeOutput() {
   // Creating a new directory per save
   if (global::mpi().isMainProcessor()) {
     string folder = global::directories().getOutputDir() + "/hdf5/" + zeroPadNumber(iter) ;
-    mkpath(folder.c_str(), 0777);
+    if (global.hdf5OutputLayout != Hdf5OutputLayout::TimeSeries) { //Appended to hdf5/<identifier>.h5 instead
+      mkpath(folder.c_str(), 0777);
+    }
     folder = global::directories().getOutputDir() + "/csv" ;
     mkpath(folder.c_str(), 0777);
+    if (global.staticOutput && staticOutputAt < 0) {
+      folder = global::directories().getOutputDir() + "/hdf5/static" ;
+      mkpath(folder.c_str(), 0777);
+    }
   }
   global::mpi().barrier();
 
+  // Topology and boundary do not change until the blocks are restructured
+  if (global.staticOutput && staticOutputAt < 0) {
+    staticOutputAt = iter;
+    writeCellTopology_HDF5(*cellfields);
+    writeStaticFluidField_HDF5(*cellfields,param::dx,param::dt,iter);
+  }
+
 
 
   
@@ -276,9 +379,24 @@ void HemoCell::writeOutput() {
   if (global.enableCEPACfield) {
     writeCEPACField_HDF5(*cellfields,param::dx,param::dt,iter);
   }
-  writeCellInfo_CSV(*this);
+  if (global.cellInfoCsv) {
+    writeCellInfo_CSV(*this);
+  }
+  if (global.cellInfoHdf5) {
+    writeCellInfo_HDF5(*this);
+  }
   global.statistics.getCurrent().stop();
 
+  // Hand the snapshot to the I/O thread, waits when the previous output is still being written
+  if (asyncOutput) {
+    global.statistics.getCurrent()["waitForOutput"].start();
+    double waited = asyncOutput->submit();
+    global.statistics.getCurrent().stop();
+    if (waited > 0.) {
+      hlogfile << "(HemoCell) (Output) waited " << waited << " s for the output of the previous timestep to be written" << endl;
+    }
+  }
+
   // Repoint surfaceparticle forces for speed
   cellfields->unify_force_vectors();
   cellfields->syncEnvelopes();
@@ -292,6 +410,9 @@ void HemoCell::checkExitSignals() {
   }
   if (interrupted == 1) {
     cout << endl << "Caught Signal, saving work and quitting!" << endl << std::flush;
+    if (asyncOutput) {
+      asyncOutput->wait();
+    }
     exit(1);
   }
 }
@@ -334,7 +455,7 @@ void HemoCell::iterate() {
   if(global.enableSolidifyMechanics && !(iter%cellfields->solidifyTimescale)) {
     global.statistics.getCurrent()["solidifyCells"].start();
     cellfields->prepareSolidification();
-    cellfields->syncEnvelopes();
+    // The new binding sites and solidified cells reach the neighbours with the next envelope exchange
     cellfields->solidifyCells();
     global.statistics.getCurrent().stop();
   }
@@ -364,6 +485,11 @@ void HemoCell::iterate() {
     cellfields->deleteNonLocalParticles(3);
   }
 
+  //Sampled before the forces are reset, as the state after this iteration
+  if (fluidAverage && (iter+1) % fluidAverage->interval == 0) {
+    fluidAverage->update();
+  }
+
   global.statistics.getCurrent()["setExternalVector"].start();
   // Reset Forces on the lattice, TODO do own efficient implementation
   setExternalVector(*lattice, (*lattice).getBoundingBox(),
@@ -373,6 +499,13 @@ void HemoCell::iterate() {
   
   iter++;
   global.statistics.getCurrent().stop();
+
+  if (analysis && iter % analysis->interval == 0) {
+    analysis->run(*this);
+  }
+  if (fluidAverage && iter % fluidAverage->window == 0) {
+    fluidAverage->write(iter);
+  }
 }
 
 T HemoCell::calculateFractionalLoadImbalance() {
@@ -418,6 +551,10 @@ void HemoCell::setInitialMinimumDistanceFromSolid(string name, T distance) {
 }
 
 void HemoCell::setRepulsion(T repulsionConstant, T repulsionCutoff) {
+  if (cellfields->particleEnvelopeApplied) {
+    hlog << "(HemoCell) (Repulsion) Error, setRepulsion() must be called before loadParticles()/loadCheckPoint() with an automatic particle envelope, the envelope would not cover the cutoff" << endl;
+    exit(1);
+  }
   hlog << "(HemoCell) (Repulsion) Setting repulsion constant to " << repulsionConstant << ". repulsionCutoff to" << repulsionCutoff << " µm" << endl;
   hlogfile << "(HemoCell) (Repulsion) Enabling repulsion." << endl;
   cellfields->repulsionConstant = repulsionConstant;
@@ -426,6 +563,10 @@ void HemoCell::setRepulsion(T repulsionConstant, T repulsionCutoff) {
 }
 
 void HemoCell::enableBoundaryParticles(T boundaryRepulsionConstant, T boundaryRepulsionCutoff, unsigned int timestep) {
+  if (cellfields->particleEnvelopeApplied) {
+    hlog << "(HemoCell) (Repulsion) Error, enableBoundaryParticles() must be called before loadParticles()/loadCheckPoint() with an automatic particle envelope, the envelope would not cover the cutoff" << endl;
+    exit(1);
+  }
   cellfields->populateBoundaryParticles();
   hlog << "(HemoCell) (Repulsion) Setting boundary repulsion constant to " << boundaryRepulsionConstant << ". boundary repulsionCutoff to" << boundaryRepulsionCutoff << " µm" << endl;
   hlogfile << "(HemoCell) (Repulsion) Enabling boundary repulsion" << endl;
@@ -435,11 +576,46 @@ void HemoCell::enableBoundaryParticles(T boundaryRepulsionConstant, T boundaryRe
   boundaryRepulsionEnabled = true;
 }
 
-void HemoCell::initializeLattice(MultiBlockManagement3D const & management) {
+/// Background dynamics of the fluid. With interior viscosity the relaxation time is read from a per-node tau class field
+static Dynamics<T,DESCRIPTOR> * newFluidDynamics() {
+#ifdef INTERIOR_VISCOSITY
+  return new InteriorViscosityBGKdynamics<T, DESCRIPTOR>(1.0/param::tau);
+#else
+  return new GuoExternalForceBGKdynamics<T, DESCRIPTOR>(1.0/param::tau);
+#endif
+}
+
+void HemoCell::initializeLattice(MultiBlockManagement3D const & management, MultiScalarField3D<int> * flagMatrix) {
   if (lattice) {
     delete lattice;
   }
 
+  if (!preInlet && flagMatrix) {
+    map<plint,plint> partToMpi;
+    for (int i = 0 ; i < global::mpi().getSize() ; i++) {
+      partToMpi[i] = i;
+    }
+    try {
+      SparseBlockStructure3D sb = createRegularDistribution3D(management.getBoundingBox(),
+                                                             (*cfg)["domain"]["mABx"].read<int>(),
+                                                             (*cfg)["domain"]["mABy"].read<int>(),
+                                                             (*cfg)["domain"]["mABz"].read<int>());
+      hlog << "(HemoCell) Domain management overwritten from config file." << endl;
+      domain_lattice_management = createFluidDomainManagement(sb,management,*flagMatrix,partToMpi);
+    }
+    catch (const std::invalid_argument& e) {
+      domain_lattice_management = createFluidDomainManagement(management.getSparseBlockStructure(),management,*flagMatrix,partToMpi);
+    }
+
+    lattice = new MultiBlockLattice3D<T,DESCRIPTOR>(*domain_lattice_management,
+          defaultMultiBlockPolicy3D().getBlockCommunicator(),
+          defaultMultiBlockPolicy3D().getCombinedStatistics(),
+          defaultMultiBlockPolicy3D().getMultiCellAccess<T, DESCRIPTOR>(),
+          newFluidDynamics());
+    domain_lattice = lattice;
+    return;
+  }
+
   if (!preInlet) {
   
     try {
@@ -456,7 +632,7 @@ void HemoCell::initializeLattice(MultiBlockManagement3D const & management) {
             defaultMultiBlockPolicy3D().getBlockCommunicator(),
             defaultMultiBlockPolicy3D().getCombinedStatistics(),
             defaultMultiBlockPolicy3D().getMultiCellAccess<T, DESCRIPTOR>(),
-            new GuoExternalForceBGKdynamics<T, DESCRIPTOR>(1.0/param::tau));
+            newFluidDynamics());
 
     }
     catch (const std::invalid_argument& e) {
@@ -466,7 +642,7 @@ void HemoCell::initializeLattice(MultiBlockManagement3D const & management) {
             defaultMultiBlockPolicy3D().getBlockCommunicator(),
             defaultMultiBlockPolicy3D().getCombinedStatistics(),
             defaultMultiBlockPolicy3D().getMultiCellAccess<T, DESCRIPTOR>(),
-            new GuoExternalForceBGKdynamics<T, DESCRIPTOR>(1.0/param::tau));
+            newFluidDynamics());
     }
 
     domain_lattice = lattice;
@@ -541,26 +717,34 @@ void HemoCell::initializeLattice(MultiBlockManagement3D const & management) {
                                                            (*cfg)["domain"]["mABy"].read<int>(),
                                                            (*cfg)["domain"]["mABz"].read<int>());
     hlog << "(HemoCell) Domain management overwritten from config file." << endl;
-    ExplicitThreadAttribution * eta = new ExplicitThreadAttribution(BlockToMpi);
-    domain_lattice_management = new MultiBlockManagement3D(sb,eta,management.getEnvelopeWidth(),management.getRefinementLevel());
+    if (flagMatrix) {
+      domain_lattice_management = createFluidDomainManagement(sb,management,*flagMatrix,BlockToMpi);
+    } else {
+      ExplicitThreadAttribution * eta = new ExplicitThreadAttribution(BlockToMpi);
+      domain_lattice_management = new MultiBlockManagement3D(sb,eta,management.getEnvelopeWidth(),management.getRefinementLevel());
+    }
   }
   catch (const std::invalid_argument& e) { // If nonexistent, fall back to the default distribution
     hlog << "(HemoCell) Using default sparse domain management." << endl;
     SparseBlockStructure3D sb = createRegularDistribution3D(management.getBoundingBox(),nProcs);
-    ExplicitThreadAttribution * eta = new ExplicitThreadAttribution(BlockToMpi);
-    domain_lattice_management = new MultiBlockManagement3D(sb,eta,management.getEnvelopeWidth(),management.getRefinementLevel());
+    if (flagMatrix) {
+      domain_lattice_management = createFluidDomainManagement(sb,management,*flagMatrix,BlockToMpi);
+    } else {
+      ExplicitThreadAttribution * eta = new ExplicitThreadAttribution(BlockToMpi);
+      domain_lattice_management = new MultiBlockManagement3D(sb,eta,management.getEnvelopeWidth(),management.getRefinementLevel());
+    }
   }
 
   preinlet_lattice = new MultiBlockLattice3D<T,DESCRIPTOR>(*preinlet_lattice_management,
             defaultMultiBlockPolicy3D().getBlockCommunicator(),
             defaultMultiBlockPolicy3D().getCombinedStatistics(),
             defaultMultiBlockPolicy3D().getMultiCellAccess<T, DESCRIPTOR>(),
-            new GuoExternalForceBGKdynamics<T, DESCRIPTOR>(1.0/param::tau));
+            newFluidDynamics());
   domain_lattice = new MultiBlockLattice3D<T,DESCRIPTOR>(*domain_lattice_management,
             defaultMultiBlockPolicy3D().getBlockCommunicator(),
             defaultMultiBlockPolicy3D().getCombinedStatistics(),
             defaultMultiBlockPolicy3D().getMultiCellAccess<T, DESCRIPTOR>(),
-            new GuoExternalForceBGKdynamics<T, DESCRIPTOR>(1.0/param::tau));
+            newFluidDynamics());
   
   if (!partOfpreInlet) {
     lattice = domain_lattice;
@@ -570,16 +754,34 @@ void HemoCell::initializeLattice(MultiBlockManagement3D const & management) {
   }
 }
 
-#ifdef HEMO_PARMETIS
+MultiBlockManagement3D * HemoCell::createFluidDomainManagement(SparseBlockStructure3D const & candidates,
+                                                               MultiBlockManagement3D const & management,
+                                                               MultiScalarField3D<int> & flagMatrix,
+                                                               map<plint,plint> & partToMpi) {
+  hlog << "(HemoCell) Removing solid atomic blocks and distributing the rest by fluid nodes" << endl;
+  //Do not split below half the particle envelope, the particle communication would explode
+  plint minBlockSize = std::max((plint)global.particleEnvelope/2, 2*management.getEnvelopeWidth());
+
+  map<plint,plint> blockToPart;
+  SparseBlockStructure3D sb = fluidWeightedDecomposition(flagMatrix, candidates, partToMpi.size(), minBlockSize, blockToPart);
+
+  map<plint,plint> blockToMpi;
+  for (auto const & pair : blockToPart) {
+    blockToMpi[pair.first] = partToMpi[pair.second];
+  }
+  ExplicitThreadAttribution * eta = new ExplicitThreadAttribution(blockToMpi);
+  return new MultiBlockManagement3D(sb,eta,management.getEnvelopeWidth(),management.getRefinementLevel());
+}
+
 void HemoCell::doLoadBalance() {
 	pcout << "(HemoCell) (LoadBalancer) Balancing Atomic Block over mpi processes" << endl;
   loadBalancer->doLoadBalance();
 }
-#endif
 
 void HemoCell::doRestructure(bool checkpoint_avail) {
   hlog << "(HemoCell) (LoadBalancer) Restructuring Atomic Blocks on processors" << endl;
   loadBalancer->restructureBlocks(checkpoint_avail);
+  staticOutputAt = -1; //The static fluid files belong to the old blocks
 }
 
 void HemoCell::sanityCheck() {
@@ -589,11 +791,12 @@ void HemoCell::sanityCheck() {
     hlog << "(HemoCell) (SanityCheck) WARNING: Fluid dx is not 5e-7 but " << param::dx << " This is unvalidated!" << endl;
   }
 
-  int env_min_width = (12e-6 /param::dx)+1;
+  int env_min_width = cellfields->minimalParticleEnvelope();
   int env_width = cellfields->immersedParticles->getMultiBlockManagement().getEnvelopeWidth();
   if (env_width < env_min_width) {
     hlog << "(HemoCell) (SanityCheck) WARNING: Envelope width is very small: " << env_width << " (" << env_width*param::dx << "µm) Instead of "  << env_min_width << "!" << endl;
-
+  } else if (env_width > 1.5*env_min_width) {
+    hlog << "(HemoCell) (SanityCheck) Envelope width " << env_width << " is larger than the required " << env_min_width << ", consider <particleEnvelope>auto</particleEnvelope> to reduce communication" << endl;
   }
   
   // Material sanity
@@ -641,6 +844,10 @@ void HemoCell::sanityCheck() {
       hlog << "(HemoCell) WARNING: Interior viscosity timescale is 1, did you forget to call hemocell->setInteriorViscosityTimescaleSeparation()?" << endl;
     }
   }
+
+  if (global.enableCellMechanicsOwnership && global.enableInteriorViscosity) {
+    hlog << "(HemoCell) WARNING: Single owner cell mechanics is not supported with interior viscosity, every block calculates its own cells instead" << endl;
+  }
     
   //Parameter Sanity
 #ifdef FORCE_LIMIT
@@ -104,9 +104,6 @@ HemoCellField::HemoCellField(HemoCellFields& cellFields_, string & name_, unsign
      if (doInteriorViscosity) {
 #ifdef INTERIOR_VISCOSITY
        hlog << "(HemoCell) (AddCellType) ("<< name << ") Enabling interior viscosity" << endl;
-       double omegaInt = 1.0/interiorViscosityTau;
-      innerViscosityDynamics = cellFields.lattice->getBackgroundDynamics().clone();
-      innerViscosityDynamics->setOmega(omegaInt);
       global.enableInteriorViscosity = true;
 #else
       hlog << "(HemoCell) (AddCellType) (" << name << ") Cannot enable interior viscosity when INTERIOR_VISCOSITY is not defined at compile time" << endl;
@@ -117,9 +114,6 @@ HemoCellField::HemoCellField(HemoCellFields& cellFields_, string & name_, unsign
  } catch (std::invalid_argument & e) {}
 }
 HemoCellField::~HemoCellField() {
-  if (innerViscosityDynamics) {
-    delete innerViscosityDynamics;
-  }
   if (mechanics) {
     delete mechanics;
   }
@@ -146,6 +140,27 @@ void HemoCellField::setOutputVariables(const vector<int> & outputs) { desiredOut
          }
   }
 
+bool HemoCellField::hasOutputCellSelection() {
+  return outputCellSelection || cellFields.outputRegions.size();
+}
+
+bool HemoCellField::isOutputCell(hemo::Array<T,3> const & centroid) {
+  if (outputCellSelection) {
+    return outputCellSelection(centroid);
+  }
+  if (cellFields.outputRegions.empty()) {
+    return true;
+  }
+  for (plb::Box3D const & region : cellFields.outputRegions) {
+    if (centroid[0] >= region.x0 && centroid[0] <= region.x1 &&
+        centroid[1] >= region.y0 && centroid[1] <= region.y1 &&
+        centroid[2] >= region.z0 && centroid[2] <= region.z1) {
+      return true;
+    }
+  }
+  return false;
+}
+
 hemo::Array<T,6> HemoCellField::getOriginalBoundingBox() {
   hemo::Array<T,6> bb;
   bb[0] = bb[1] = meshElement->getVertex(0)[0];
@@ -34,6 +34,8 @@ class HemoCellField;
 #include "hemoCellFields.h"
 #include "hemoCellParticle.h"
 
+#include <functional>
+
 #include "multiBlock/multiBlockLattice3D.hh"
 #include "particles/multiParticleField3D.hh"
 
@@ -71,6 +73,18 @@ class HemoCellField{
   std::string getIdentifier();
   plb::MultiParticleField3D<HemoCellParticleField> * getParticleArg();
   void setOutputVariables(const vector<int> &);
+  /// Written only at every outputInterval-th output (HemoCell::setOutputInterval)
+  unsigned int outputInterval = 1;
+  /// Number of outputs so far, counts the outputs where this celltype is skipped too
+  unsigned int outputCount = 0;
+  /// Advances outputCount, true when this output is one of every outputInterval
+  bool nextOutputIsWritten() { return outputCount++ % outputInterval == 0; }
+  /// Selects the cells that are written by their centroid [lu] (HemoCell::setOutputCellSelection)
+  std::function<bool(hemo::Array<T,3> const &)> outputCellSelection;
+  /// True when the cell with this centroid [lu] is written, by default the cells in the output regions
+  bool isOutputCell(hemo::Array<T,3> const & centroid);
+  /// True when not all cells are written, so isOutputCell() has to be asked
+  bool hasOutputCellSelection();
   CellMechanics * mechanics = 0;
   void statistics();
   /* position is in micrometers, so we still have to convert it*/
@@ -80,7 +94,6 @@ class HemoCellField{
   bool doSolidifyMechanics = false;
   bool doInteriorViscosity = false;
   T interiorViscosityTau = 1.0;
-  plb::Dynamics<T,DESCRIPTOR> * innerViscosityDynamics = 0;
 };
 }
 
@@ -65,6 +65,12 @@ HemoCellFields::~HemoCellFields() {
   if (large_communicator) {
     delete large_communicator;
   }  
+  if (small_communicator) {
+    delete small_communicator;
+  }
+  if (nodeExchange) {
+    delete nodeExchange;
+  }
 }
 
 void HemoCellFields::createParticleField(SparseBlockStructure3D* sbStructure, ThreadAttribution * tAttribution) {
@@ -110,6 +116,48 @@ void HemoCellFields::createParticleField(SparseBlockStructure3D* sbStructure, Th
   InitAfterLoadCheckpoint();
 }
 
+unsigned int HemoCellFields::minimalParticleEnvelope() {
+  // A cell with a single vertex in the bulk must be complete in the envelope,
+  // and every vertex within reach of the bulk (IBM kernel, repulsion) too
+  T required = 0.;
+  for (HemoCellField * field : cellFields) {
+    T fieldRequired;
+    try {
+      fieldRequired = (*field->materialCfg)["MaterialModel"]["particleEnvelope"].read<T>();
+    } catch (std::invalid_argument & e) {
+      hemo::Array<T,6> bb = field->getOriginalBoundingBox();
+      T extent = std::max(bb[1]-bb[0],std::max(bb[3]-bb[2],bb[5]-bb[4]));
+      fieldRequired = extent*PARTICLE_ENVELOPE_DEFORMATION;
+    }
+    hlogfile << "(HemoCell) (HemoCellFields) (Envelope) " << field->name << " requires " << fieldRequired << " [lu]" << endl;
+    required = std::max(required,fieldRequired);
+  }
+  const T kernelSupport = 2.0; // widest kernel (phi4)
+  required += std::max(kernelSupport,std::max(repulsionCutoff,boundaryRepulsionCutoff)) + 1.0;
+  return std::ceil(required);
+}
+
+void HemoCellFields::applyMinimalParticleEnvelope() {
+  unsigned int minimal = minimalParticleEnvelope();
+  hlog << "(HemoCell) (HemoCellFields) Automatic particle envelope: " << minimal << " [lu] (" << minimal*param::dx*1e6 << " µm)" << endl;
+  particleEnvelopeApplied = true;
+  if (minimal == envelopeSize) {
+    return;
+  }
+  envelopeSize = minimal;
+  if (preinlet_immersedParticles) {
+    delete preinlet_immersedParticles;
+    preinlet_immersedParticles = 0;
+  }
+  delete domain_immersedParticles;
+  domain_immersedParticles = 0;
+  createParticleField();
+  //enableBoundaryParticles() may have filled the old field already
+  if (boundaryParticlesPopulated) {
+    populateBoundaryParticles();
+  }
+}
+
 void HemoCellFields::createCEPACfield() {
   SparseBlockStructure3D* sbStructure = lattice->getSparseBlockStructure().clone();
   ThreadAttribution * tAttribution = lattice->getMultiBlockManagement().getThreadAttribution().clone();
@@ -365,9 +413,15 @@ void HemoCellFields::calculateCommunicationStructure() {
   ParallelBlockCommunicator3D * communicator = dynamic_cast<ParallelBlockCommunicator3D const *>(&immersedParticles->getBlockCommunicator())->clone();
   communicator->duplicateOverlaps(management_temp,immersedParticles->periodicity());
   large_communicator = new CommunicationStructure3D(*communicator->communication);
+  if (global.enableSharedMemoryExchange && !nodeExchange) {
+    nodeExchange = new NodeSharedExchange();
+  }
   immersedParticles->getMultiBlockManagement().changeEnvelopeWidth(3);
   immersedParticles->signalPeriodicity();
   immersedParticles->getBlockCommunicator().duplicateOverlaps(*immersedParticles,modif::hemocell_no_comm);
+  MultiBlockManagement3D management_small(immersedParticles->getMultiBlockManagement());
+  communicator->duplicateOverlaps(management_small,immersedParticles->periodicity());
+  small_communicator = new CommunicationStructure3D(*communicator->communication);
   delete communicator;
 }
 
@@ -384,18 +438,33 @@ void HemoCellFields::syncEnvelopes() {
     pf.removeParticles_inverse(pf.localDomain);
   }
   immersedParticles->getBlockCommunicator().duplicateOverlaps(*immersedParticles,modif::hemocell);
+
+  // Solidification since the last exchange travels with the cell requests of the large envelope
+  vector<int> solidification;
+  if (global.enableSolidifyMechanics) {
+    collectSolidification(solidification);
+  }
   
   if (large_communicator) {
   
     CommunicationStructure3D * comms = large_communicator;
-    std::set<int> recv_procs, send_procs;
+    // Processes on the same node are served through shared memory, the rest through messages
+    std::set<int> recv_procs, send_procs, node_recv_procs, node_send_procs;
     std::map<int,vector<CommunicationInfo3D const *>> recv_infos, send_infos;
     for (CommunicationInfo3D const& info : comms->sendPackage) {
-      send_procs.insert(info.toProcessId);
+      if (nodeExchange && nodeExchange->onNode(info.toProcessId)) {
+        node_send_procs.insert(info.toProcessId);
+      } else {
+        send_procs.insert(info.toProcessId);
+      }
       send_infos[info.toProcessId].push_back(&info);
     }
     for (CommunicationInfo3D const& info : comms->recvPackage) {
-      recv_procs.insert(info.fromProcessId);
+      if (nodeExchange && nodeExchange->onNode(info.fromProcessId)) {
+        node_recv_procs.insert(info.fromProcessId);
+      } else {
+        recv_procs.insert(info.fromProcessId);
+      }
       recv_infos[info.fromProcessId].push_back(&info);
     }
 
@@ -406,54 +475,49 @@ void HemoCellFields::syncEnvelopes() {
         locals.insert(particle.sv.cellId);
       }
     }
-    vector<int> locals_v;
-    locals_v.insert(locals_v.end(),locals.begin(),locals.end());
+    // Request: [cells, ids ..., section size, solidification section ...]
+    vector<int> request;
+    request.push_back(locals.size());
+    request.insert(request.end(),locals.begin(),locals.end());
+    request.push_back(solidification.size());
+    request.insert(request.end(),solidification.begin(),solidification.end());
          
     vector<int> recv_procs_v;
     recv_procs_v.insert(recv_procs_v.end(),recv_procs.begin(),recv_procs.end());
     vector<MPI_Request> reqs(recv_procs.size());
 
     for (unsigned int i = 0 ; i < recv_procs_v.size() ; i ++) {
-      MPI_Isend(&locals_v[0],locals_v.size(),MPI_INT,recv_procs_v[i],24,MPI_COMM_WORLD,&reqs[i]);
+      MPI_Isend(&request[0],request.size(),MPI_INT,recv_procs_v[i],24,MPI_COMM_WORLD,&reqs[i]);
     }
+
     sendBuffers.resize(send_procs.size());
+    vector<HemoCellParticle::serializeValues_t const *> particles;
     for (unsigned int i = 0 ; i < send_procs.size() ; i ++) {
       MPI_Status status;
       MPI_Probe(MPI_ANY_SOURCE,24,MPI_COMM_WORLD,&status);
       int count;
       MPI_Get_count(&status,MPI_INT,&count);
-      vector<int> requested_ids(count);
+      vector<int> requested(count);
       vector<NoInitChar> & sendBuffer = sendBuffers[i];
-      sendBuffer.clear();
-      int offset = 0 ;
-      MPI_Recv(&requested_ids[0],count,MPI_INT,status.MPI_SOURCE,24,MPI_COMM_WORLD,MPI_STATUS_IGNORE);
-      for (CommunicationInfo3D const * info : send_infos[status.MPI_SOURCE] ) {
-        HemoCellParticleField & pf = immersedParticles->getComponent(info->fromBlockId);
-        int offset_p = pf.getDataTransfer().getOffset(info->absoluteOffset);
-        const map<int,vector<int>> & ppc = pf.get_particles_per_cell();
-        
-        for (int id : requested_ids) {
-          if (((offset_p < 0) && (id > INT_MAX+offset_p)) ||
-              ((offset_p > 0) && (id < INT_MIN+offset_p))) {
-            cout << "(HemoCellFields syncEnvelopes) Almost invoking overflow in periodic particle communication, resetting ID to base ID instead, this will most likely delete the particle" << endl;
-            id = base_cell_id(id);
-          } else {
-            id = id - offset_p;
-          }
-          if (ppc.find(id) == ppc.end()) { continue; }
-          for (int pid : ppc.at(id)) {
-            if (pid <= -1) { continue; }
-            if (pid >= (int) pf.particles.size()) { continue; }
-            sendBuffer.resize(sendBuffer.size()+sizeof(HemoCellParticle::serializeValues_t));
-            *((HemoCellParticle::serializeValues_t*)&sendBuffer[offset]) = pf.particles[pid].sv;
-            offset += sizeof(HemoCellParticle::serializeValues_t);
-          }         
-        }
+      MPI_Recv(&requested[0],count,MPI_INT,status.MPI_SOURCE,24,MPI_COMM_WORLD,MPI_STATUS_IGNORE);
+      collectEnvelopeParticles(&requested[1],requested[0],send_infos[status.MPI_SOURCE],particles);
+      int const * section = &requested[1+requested[0]];
+      solidification.insert(solidification.end(),section+1,section+1+section[0]);
+      sendBuffer.resize(particles.size()*sizeof(HemoCellParticle::serializeValues_t));
+      HemoCellParticle::serializeValues_t * records = (HemoCellParticle::serializeValues_t *)sendBuffer.data();
+      for (unsigned int p = 0 ; p < particles.size() ; p++) {
+        records[p] = *particles[p];
       }
       reqs.emplace_back();
       MPI_Isend(sendBuffer.data(),sendBuffer.size(),MPI_CHAR,status.MPI_SOURCE,42,MPI_COMM_WORLD,&reqs.back());
     }
 
+    // All outgoing buffers are filled and only non-blocking sends are outstanding,
+    // so the node can synchronize and receive here without deadlocking
+    if (nodeExchange) {
+      syncNodeEnvelopes(request,node_send_procs,node_recv_procs,send_infos,recv_infos,solidification);
+    }
+
     vector<MPI_Request> recv_reqs(recv_procs.size());
     recvBuffers.resize(recv_procs.size());
     for (unsigned int i = 0 ; i < recv_procs.size() ; i ++) {
@@ -482,6 +546,10 @@ void HemoCellFields::syncEnvelopes() {
     }
 
     MPI_Waitall(reqs.size(),reqs.data(),MPI_STATUSES_IGNORE);
+    // The neighbours have our solidification now, without the large envelope it waits for the next exchange
+    if (global.enableSolidifyMechanics) {
+      clearSolidification();
+    }
     
     // 3. Local copies which require no communication.
     for (unsigned iSendRecv=0; iSendRecv<comms->sendRecvPackage.size(); ++iSendRecv) {
@@ -495,9 +563,168 @@ void HemoCellFields::syncEnvelopes() {
     }
     
   }
+
+  if (!solidification.empty()) {
+    applySolidification(solidification);
+  }
   global.statistics.getCurrent().stop();
 }
 
+void HemoCellFields::collectSolidification(vector<int> & section) {
+  section.push_back(0);
+  for (plint lbid : immersedParticles->getLocalInfo().getBlocks() ) {
+    HemoCellParticleField & pf = immersedParticles->getComponent(lbid);
+    for (const Dot3D & site : pf.solidifiedSites) {
+      section.insert(section.end(),{(int)site.x,(int)site.y,(int)site.z});
+    }
+    section[0] += pf.solidifiedSites.size();
+  }
+  const int cells = section.size();
+  section.push_back(0);
+  for (plint lbid : immersedParticles->getLocalInfo().getBlocks() ) {
+    HemoCellParticleField & pf = immersedParticles->getComponent(lbid);
+    section.insert(section.end(),pf.solidifiedCells.begin(),pf.solidifiedCells.end());
+    section[cells] += pf.solidifiedCells.size();
+  }
+  if (!section[0] && !section[cells]) {
+    section.clear();
+  }
+}
+
+void HemoCellFields::clearSolidification() {
+  for (plint lbid : immersedParticles->getLocalInfo().getBlocks() ) {
+    HemoCellParticleField & pf = immersedParticles->getComponent(lbid);
+    pf.solidifiedSites.clear();
+    pf.solidifiedCells.clear();
+  }
+}
+
+void HemoCellFields::applySolidification(vector<int> const & sections) {
+  const Box3D domain = immersedParticles->getBoundingBox();
+  const plint extent[3] = {domain.getNx(), domain.getNy(), domain.getNz()};
+
+  for (plint lbid : immersedParticles->getLocalInfo().getBlocks() ) {
+    HemoCellParticleField & pf = immersedParticles->getComponent(lbid);
+    BlockLattice3D<T,DESCRIPTOR> & fluid = *pf.atomicLattice;
+    const Dot3D location = fluid.getLocation();
+    const plint size[3] = {fluid.getNx(), fluid.getNy(), fluid.getNz()};
+    set<int> cells;
+
+    for (unsigned int pos = 0 ; pos < sections.size() ; ) {
+      const int sites = sections[pos++];
+      for (int s = 0 ; s < sites ; s++, pos += 3) {
+        plint node[3] = {sections[pos]-location.x, sections[pos+1]-location.y, sections[pos+2]-location.z};
+        bool inside = true;
+        for (int d = 0 ; d < 3 ; d++) {
+          // Periodic images of the site
+          if (immersedParticles->periodicity().get(d)) {
+            if (node[d] < 0 && node[d] + extent[d] < size[d]) { node[d] += extent[d]; }
+            else if (node[d] >= size[d] && node[d] - extent[d] >= 0) { node[d] -= extent[d]; }
+          }
+          inside = inside && node[d] >= 0 && node[d] < size[d];
+        }
+        if (!inside) { continue; }
+        if (!fluid.get(node[0],node[1],node[2]).getDynamics().isBoundary()) {
+          defineDynamics(fluid,node[0],node[1],node[2],new BounceBack<T,DESCRIPTOR>(1.));
+          bindingFieldHelper::get(*this).add(pf, {node[0],node[1],node[2]});
+        }
+      }
+      const int ncells = sections[pos++];
+      cells.insert(sections.begin()+pos,sections.begin()+pos+ncells);
+      pos += ncells;
+    }
+
+    if (cells.empty()) { continue; }
+    for (HemoCellParticle & particle : pf.particles) {
+      if (cells.count(base_cell_id(particle.sv.cellId))) {
+        particle.tag = 1;
+      }
+    }
+    pf.removeParticles(1);
+  }
+}
+
+void HemoCellFields::collectEnvelopeParticles(int const * requested_ids, int count, vector<CommunicationInfo3D const *> const & infos,
+                                              vector<HemoCellParticle::serializeValues_t const *> & particles) {
+  particles.clear();
+  for (CommunicationInfo3D const * info : infos) {
+    HemoCellParticleField & pf = immersedParticles->getComponent(info->fromBlockId);
+    int offset_p = pf.getDataTransfer().getOffset(info->absoluteOffset);
+    const map<int,vector<int>> & ppc = pf.get_particles_per_cell();
+
+    for (int i = 0 ; i < count ; i++) {
+      int id = requested_ids[i];
+      if (((offset_p < 0) && (id > INT_MAX+offset_p)) ||
+          ((offset_p > 0) && (id < INT_MIN+offset_p))) {
+        cout << "(HemoCellFields syncEnvelopes) Almost invoking overflow in periodic particle communication, resetting ID to base ID instead, this will most likely delete the particle" << endl;
+        id = base_cell_id(id);
+      } else {
+        id = id - offset_p;
+      }
+      if (ppc.find(id) == ppc.end()) { continue; }
+      for (int pid : ppc.at(id)) {
+        if (pid <= -1) { continue; }
+        if (pid >= (int) pf.particles.size()) { continue; }
+        particles.push_back(&pf.particles[pid].sv);
+      }
+    }
+  }
+}
+
+void HemoCellFields::syncNodeEnvelopes(vector<int> const & request, std::set<int> const & send_procs, std::set<int> const & recv_procs,
+                                       std::map<int,vector<CommunicationInfo3D const *>> & send_infos,
+                                       std::map<int,vector<CommunicationInfo3D const *>> & recv_infos,
+                                       vector<int> & solidification) {
+  typedef HemoCellParticle::serializeValues_t record_t;
+  const int nodeSize = nodeExchange->nodeSize();
+  const int myNodeRank = nodeExchange->nodeRank(global::mpi().getRank());
+
+  // 1. Publish the request (the cells we hold and our solidification), the processes we receive from select their envelope particles with it
+  nodeExchange->reserve(sizeof(int)*request.size());
+  int * published = (int *)nodeExchange->local();
+  std::copy(request.begin(),request.end(),published);
+  nodeExchange->fence();
+
+  map<int,vector<record_t const *>> particles;
+  size_t nrecords = 0;
+  for (int proc : send_procs) {
+    int const * requested = (int const *)nodeExchange->segment(proc);
+    collectEnvelopeParticles(requested+1,requested[0],send_infos[proc],particles[proc]);
+    nrecords += particles[proc].size();
+    int const * section = requested+1+requested[0];
+    solidification.insert(solidification.end(),section+1,section+1+section[0]);
+  }
+
+  // 2. Write the records for every process on the node behind a table of (offset, count)
+  //    The reserve also guarantees that everyone is done reading the published cells
+  const size_t tableSize = (((sizeof(uint64_t)*2*nodeSize)+63)/64)*64;
+  nodeExchange->reserve(tableSize + nrecords*sizeof(record_t));
+  uint64_t * table = (uint64_t *)nodeExchange->local();
+  std::fill(table,table+2*nodeSize,0);
+  record_t * records = (record_t *)(nodeExchange->local()+tableSize);
+  uint64_t offset = 0;
+  for (auto const & pair : particles) {
+    const int dest = nodeExchange->nodeRank(pair.first);
+    table[2*dest] = offset;
+    table[2*dest+1] = pair.second.size();
+    for (record_t const * particle : pair.second) {
+      records[offset++] = *particle;
+    }
+  }
+  nodeExchange->fence();
+
+  // 3. Read our part directly from the segments of the sending processes
+  for (int proc : recv_procs) {
+    uint64_t const * procTable = (uint64_t const *)nodeExchange->segment(proc);
+    record_t const * procRecords = (record_t const *)(nodeExchange->segment(proc)+tableSize);
+    for (CommunicationInfo3D const * info : recv_infos[proc]) {
+      HemoCellParticleField& toBlock = immersedParticles->getComponent(info->toBlockId);
+      toBlock.getDataTransfer().receive(procRecords+procTable[2*myNodeRank],procTable[2*myNodeRank+1],info->absoluteOffset);
+    }
+  }
+  // The next reserve() waits until all processes on the node are done reading
+}
+
 void HemoCellFields::HemoAdvanceParticles::processGenericBlocks(Box3D domain, std::vector<AtomicBlock3D*> blocks) {
     dynamic_cast<HemoCellParticleField*>(blocks[0])->advanceParticles();
 }
@@ -536,6 +763,182 @@ void HemoCellFields::applyConstitutiveModel(bool forced) {
   fnct->forced = forced;
   applyProcessingFunctional(fnct,immersedParticles->getBoundingBox(),wrapper);
 
+  if (!forced && singleOwnerMechanics()) {
+    reduceOwnedForces();
+  }
+
+  global.statistics.getCurrent().stop();
+}
+
+bool HemoCellFields::singleOwnerMechanics() const {
+  //Interior viscosity needs the normal directions on every copy of a cell
+  return global.enableCellMechanicsOwnership && !global.enableInteriorViscosity && large_communicator;
+}
+
+namespace {
+struct OwnedForce {
+  plint blockId;
+  int cellId;
+  int vertexId;
+  hemo::Array<T,3> force;
+};
+
+struct EnvelopeSource {
+  plint blockId;
+  int proc;
+  Dot3D offset;
+  Box3D bulk;
+};
+}
+
+namespace {
+template<class Apply>
+void exchangeForces(map<int,vector<OwnedForce>> & forces, const set<int> & send_procs,
+                    const set<int> & recv_procs, int tag, Apply apply) {
+  const int rank = global::mpi().getRank();
+  vector<MPI_Request> reqs;
+  reqs.reserve(send_procs.size());
+  for (int proc : send_procs) {
+    vector<OwnedForce> & buffer = forces[proc];
+    reqs.emplace_back();
+    MPI_Isend(buffer.data(),buffer.size()*sizeof(OwnedForce),MPI_BYTE,proc,tag,MPI_COMM_WORLD,&reqs.back());
+  }
+  apply(forces[rank].data(),forces[rank].size());
+
+  vector<OwnedForce> recvBuffer;
+  for (unsigned int i = 0 ; i < recv_procs.size() ; i++) {
+    MPI_Status status;
+    MPI_Probe(MPI_ANY_SOURCE,tag,MPI_COMM_WORLD,&status);
+    int count;
+    MPI_Get_count(&status,MPI_BYTE,&count);
+    recvBuffer.resize(count/sizeof(OwnedForce));
+    MPI_Recv(recvBuffer.data(),count,MPI_BYTE,status.MPI_SOURCE,tag,MPI_COMM_WORLD,MPI_STATUS_IGNORE);
+    apply(recvBuffer.data(),recvBuffer.size());
+  }
+  MPI_Waitall(reqs.size(),reqs.data(),MPI_STATUSES_IGNORE);
+}
+}
+
+void HemoCellFields::reduceOwnedForces() {
+  global.statistics.getCurrent()["reduceOwnedForces"].start();
+
+  CommunicationStructure3D * comms = large_communicator;
+  SparseBlockStructure3D const & sbs = immersedParticles->getMultiBlockManagement().getSparseBlockStructure();
+  const int rank = global::mpi().getRank();
+
+  //The blocks that (can) own the particles in the envelope of each local block
+  map<plint,vector<EnvelopeSource>> sources;
+  set<int> send_procs, recv_procs;
+  for (CommunicationInfo3D const& info : comms->recvPackage) {
+    EnvelopeSource source = {info.fromBlockId, (int)info.fromProcessId, info.absoluteOffset, Box3D()};
+    sbs.getBulk(info.fromBlockId, source.bulk);
+    sources[info.toBlockId].push_back(source);
+    send_procs.insert(info.fromProcessId);
+  }
+  for (CommunicationInfo3D const& info : comms->sendRecvPackage) {
+    EnvelopeSource source = {info.fromBlockId, rank, info.absoluteOffset, Box3D()};
+    sbs.getBulk(info.fromBlockId, source.bulk);
+    sources[info.toBlockId].push_back(source);
+  }
+  for (CommunicationInfo3D const& info : comms->sendPackage) {
+    recv_procs.insert(info.toProcessId);
+  }
+
+  map<int,vector<OwnedForce>> forces;
+  for (plint lbid : immersedParticles->getLocalInfo().getBlocks() ) {
+    HemoCellParticleField & pf = immersedParticles->getComponent(lbid);
+    const map<int,vector<int>> & ppc = pf.get_particles_per_cell();
+    for (int cid : pf.ownedCells) {
+      for (int pid : ppc.at(cid)) {
+        const HemoCellParticle & particle = pf.particles[pid];
+        if (pf.isContainedABS(particle.sv.position, pf.localDomain)) { continue; }
+        for (const EnvelopeSource & source : sources[lbid]) {
+          const hemo::Array<T,3> pos = {particle.sv.position[0] - source.offset.x,
+                                        particle.sv.position[1] - source.offset.y,
+                                        particle.sv.position[2] - source.offset.z};
+          if (!((pos[0] > source.bulk.x0-0.5) && (pos[0] <= source.bulk.x1+0.5) &&
+                (pos[1] > source.bulk.y0-0.5) && (pos[1] <= source.bulk.y1+0.5) &&
+                (pos[2] > source.bulk.z0-0.5) && (pos[2] <= source.bulk.z1+0.5))) {
+            continue;
+          }
+          OwnedForce entry = {source.blockId,
+                              cid - (int)pf.getDataTransfer().getOffset(source.offset),
+                              particle.sv.vertexId,
+                              particle.sv.force};
+          forces[source.proc].push_back(entry);
+          break;
+        }
+      }
+    }
+  }
+
+  auto addForces = [this](const OwnedForce * entries, unsigned int n) {
+    for (unsigned int i = 0 ; i < n ; i++) {
+      HemoCellParticleField & pf = immersedParticles->getComponent(entries[i].blockId);
+      const map<int,vector<int>> & ppc = pf.get_particles_per_cell();
+      auto cell = ppc.find(entries[i].cellId);
+      if (cell == ppc.end()) { continue; }
+      const int pid = cell->second[entries[i].vertexId];
+      if (pid < 0) { continue; }
+      pf.particles[pid].sv.force += entries[i].force;
+    }
+  };
+
+  exchangeForces(forces,send_procs,recv_procs,44,addForces);
+
+  //Local vertices are complete now, copy only their forces to the (kernel
+  //width) envelopes of the neighbouring blocks
+  comms = small_communicator;
+  const plint envelopeWidth = immersedParticles->getMultiBlockManagement().getEnvelopeWidth();
+  map<int,vector<OwnedForce>> envelopeForces;
+  set<int> envelope_send_procs, envelope_recv_procs;
+  auto collectEnvelope = [&](CommunicationInfo3D const& info, int proc) {
+    HemoCellParticleField & pf = immersedParticles->getComponent(info.fromBlockId);
+    Box3D target;
+    sbs.getBulk(info.toBlockId, target);
+    target = target.enlarge(envelopeWidth);
+    const int cellOffset = (int)pf.getDataTransfer().getOffset(info.absoluteOffset);
+    for (const HemoCellParticle & particle : pf.particles) {
+      if (!pf.isContainedABS(particle.sv.position, pf.localDomain)) { continue; }
+      const hemo::Array<T,3> pos = {particle.sv.position[0] + info.absoluteOffset.x,
+                                    particle.sv.position[1] + info.absoluteOffset.y,
+                                    particle.sv.position[2] + info.absoluteOffset.z};
+      if (!((pos[0] > target.x0-0.5) && (pos[0] <= target.x1+0.5) &&
+            (pos[1] > target.y0-0.5) && (pos[1] <= target.y1+0.5) &&
+            (pos[2] > target.z0-0.5) && (pos[2] <= target.z1+0.5))) {
+        continue;
+      }
+      OwnedForce entry = {info.toBlockId,
+                          (int)particle.sv.cellId + cellOffset,
+                          particle.sv.vertexId,
+                          particle.sv.force};
+      envelopeForces[proc].push_back(entry);
+    }
+  };
+  for (CommunicationInfo3D const& info : comms->sendPackage) {
+    collectEnvelope(info, info.toProcessId);
+    envelope_send_procs.insert(info.toProcessId);
+  }
+  for (CommunicationInfo3D const& info : comms->sendRecvPackage) {
+    collectEnvelope(info, rank);
+  }
+  for (CommunicationInfo3D const& info : comms->recvPackage) {
+    envelope_recv_procs.insert(info.fromProcessId);
+  }
+
+  auto setForces = [this](const OwnedForce * entries, unsigned int n) {
+    for (unsigned int i = 0 ; i < n ; i++) {
+      HemoCellParticleField & pf = immersedParticles->getComponent(entries[i].blockId);
+      const map<int,vector<int>> & ppc = pf.get_particles_per_cell();
+      auto cell = ppc.find(entries[i].cellId);
+      if (cell == ppc.end()) { continue; }
+      const int pid = cell->second[entries[i].vertexId];
+      if (pid < 0) { continue; }
+      pf.particles[pid].sv.force = entries[i].force;
+    }
+  };
+  exchangeForces(envelopeForces,envelope_send_procs,envelope_recv_procs,45,setForces);
+
   global.statistics.getCurrent().stop();
 }
 
@@ -588,6 +991,7 @@ void HemoCellFields::populateBoundaryParticles() {
     wrapper.push_back(immersedParticles);
     HemoPopulateBoundaryParticles * fnct = new HemoPopulateBoundaryParticles();
     applyProcessingFunctional(fnct,immersedParticles->getBoundingBox(),wrapper);
+    boundaryParticlesPopulated = true;
 }
 
 void HemoCellFields::HemoPopulateBindingSites::processGenericBlocks(Box3D domain, std::vector<AtomicBlock3D*> blocks) {
@@ -627,6 +1031,11 @@ void HemoCellFields::HemoSeperateForceVectors::processGenericBlocks(Box3D domain
 void HemoCellFields::separate_force_vectors() {
   global.statistics.getCurrent()["separateForceVectors"].start();
 
+  //Also save the total force, therefore recalculate in advance. With single
+  //owner mechanics this includes the reduction of the forces calculated on
+  //other blocks, so sv.force is complete before it is separated
+  applyConstitutiveModel();
+
   vector<MultiBlock3D*> wrapper;
   wrapper.push_back(immersedParticles);
   applyProcessingFunctional(new HemoSeperateForceVectors(),immersedParticles->getBoundingBox(),wrapper);
@@ -32,6 +32,7 @@ class HemoCellFields;
 #include "hemoCellField.h"
 #include "hemoCellParticle.h"
 #include "config.h"
+#include "nodeSharedExchange.h"
 #include <unistd.h>
 
 #include "latticeBoltzmann/advectionDiffusionLattices.hh"
@@ -63,6 +64,15 @@ public:
   void createParticleField(plb::SparseBlockStructure3D* sbStructure_ = 0, plb::ThreadAttribution * tAttribution_ = 0);
   
   void createCEPACfield();
+
+  ///Smallest particle envelope (lbm units) that holds every cell type, see <particleEnvelope>auto</particleEnvelope>
+  unsigned int minimalParticleEnvelope();
+
+  ///Recreate the (still empty) particle field with the minimal particle envelope,
+  ///the repulsion settings must be final when this is called
+  void applyMinimalParticleEnvelope();
+  ///Set once applyMinimalParticleEnvelope() fixed the envelope width
+  bool particleEnvelopeApplied = false;
   
   ///Used to set variables inside the celltypes for correct access, called through createParticleField
   void InitAfterLoadCheckpoint();
@@ -131,6 +141,12 @@ public:
   
   /// Apply the material model of the cells to the particles, updating their force
   void applyConstitutiveModel(bool forced = false);
+
+  /// Whether every cell is only calculated by the block holding its first vertex (see parameters/cellMechanicsOwnership)
+  bool singleOwnerMechanics() const;
+
+  /// Send the forces on envelope vertices of owned cells back to the block they are local on, then update the envelopes
+  void reduceOwnedForces();
   
   /// Sync the particle envelopes between domains
   void syncEnvelopes();
@@ -165,12 +181,20 @@ public:
   vector<int> desiredFluidOutputVariables;
   
   vector<int> desiredCEPACfieldOutputVariables;
+  ///Boxes [lu] the output is restricted to, everything when empty (HemoCell::addOutputRegion)
+  vector<plb::Box3D> outputRegions;
+  ///Only every fluidOutputStride-th fluid node is written in each direction (HemoCell::setFluidOutputStride)
+  unsigned int fluidOutputStride = 1;
+  ///Write the average of the stride^3 nodes instead of one node
+  bool fluidOutputAverage = false;
   ///Reference to parent
   HemoCell & hemocell;
   ///Vector containing the cellTypes
   vector<HemoCellField *> cellFields;
   ///The envelopeSize for the particles
   pluint envelopeSize;
+  ///Boundary particles are repopulated when the particle field is recreated
+  bool boundaryParticlesPopulated = false;
   /// palabos field storing the particles
   plb::MultiParticleField3D<HemoCellParticleField> * immersedParticles = 0;
   /// seperate preinlet and domain pointers whenever necessary
@@ -209,6 +233,21 @@ public:
   
 private:
   vector<vector<NoInitChar>> sendBuffers, recvBuffers;
+
+  /// Particle records of our blocks in the envelope of a process that requested the cells requested_ids
+  void collectEnvelopeParticles(int const * requested_ids, int count, vector<plb::CommunicationInfo3D const *> const & infos,
+                                vector<HemoCellParticle::serializeValues_t const *> & particles);
+  /// Exchange the large envelope with the processes on this node through shared memory
+  void syncNodeEnvelopes(vector<int> const & request, std::set<int> const & send_procs, std::set<int> const & recv_procs,
+                         std::map<int,vector<plb::CommunicationInfo3D const *>> & send_infos,
+                         std::map<int,vector<plb::CommunicationInfo3D const *>> & recv_infos,
+                         vector<int> & solidification);
+  /// Binding sites and cells solidified on our blocks since the last exchange as [sites, x,y,z ..., cells, ids ...]
+  void collectSolidification(vector<int> & section);
+  /// Forget the collected solidification once it was sent to the neighbours
+  void clearSolidification();
+  /// Add the binding sites of sections that fall on our blocks and remove the particles of their solidified cells
+  void applySolidification(vector<int> const & sections);
 public:
   
   /**
@@ -222,6 +261,10 @@ public:
    unsigned int max_neighbours = 0;
    
    plb::CommunicationStructure3D * large_communicator = 0;
+   /// Communication structure of the (kernel width) particle envelope, used to send forces only
+   plb::CommunicationStructure3D * small_communicator = 0;
+   /// Shared memory window for the envelope exchange within a node, see parameters/sharedMemoryExchange
+   NodeSharedExchange * nodeExchange = 0;
    plb::ParallelBlockCommunicator3D envelope_communicator;
    
    void calculateCommunicationStructure();
@@ -61,27 +61,10 @@ class HemoCellGatheringFunctional : public plb::BoxProcessingFunctional3D {
         int ID;
         GatherType g;
     };
-public:
-    //Numblocks should be larger than the maximum number of blocks per process
-    //The total can be retrieved from Multiblock.getManagment.getsparseblock.getnumblocks
-    HemoCellGatheringFunctional(std::map<int,GatherType> & gatherValues_) : 
-      gatherValues(gatherValues_) {}
-    void getModificationPattern(std::vector<bool>& isWritten) const {
-        for (pluint i = 0; i < isWritten.size(); i++) {
-            isWritten[i] = false;       
-        }
-    }
-    plb::BlockDomain::DomainT appliesTo() const { return plb::BlockDomain::bulk; }
-    void getTypeOfModification(std::vector<plb::modif::ModifT>& modified) const {
-        for (pluint i = 0; i < modified.size(); i++) {
-            modified[i] = plb::modif::nothing;       
-        }
-        
-    }
-    static void gather(std::map<int,GatherType> & gatherValues) {
+    /// Number of entries followed by the (ID, value) pairs
+    static std::vector<unsigned char> pack(std::map<int,GatherType> const & gatherValues) {
         int be = 0;
-        int sendsize = sizeof(int) + sizeof(IDandGatherType)*gatherValues.size();
-        std::vector<unsigned char> sendbuffer(sendsize);
+        std::vector<unsigned char> sendbuffer(sizeof(int) + sizeof(IDandGatherType)*gatherValues.size());
 
         byteint local_number;
         local_number.i = gatherValues.size();
@@ -96,24 +79,22 @@ public:
             *((IDandGatherType*)&sendbuffer[be]) = bg;
             be+=sizeof(IDandGatherType);
         }
-        
-        std::vector<int> sendcounts(plb::global::mpi().getSize());
-        MPI_Allgather(&sendsize,sizeof(int),MPI_BYTE,&sendcounts[0],sizeof(int),MPI_BYTE,MPI_COMM_WORLD);
-              
+        return sendbuffer;
+    }
+    /// Displacements of the received buffers, returns the total receive size
+    static int receiveLayout(std::vector<int> const & sendcounts, std::vector<int> & displacements) {
         int receivesize = 0;
-        std::vector<int> displacements(1,0);
-        for (int & size : sendcounts) {
+        displacements.assign(1,0);
+        for (int size : sendcounts) {
           receivesize += size;
           displacements.push_back(displacements.back() + size);
         }
         displacements.pop_back();
-        std::vector<unsigned char> receivebuffer(receivesize);        
-        
-        MPI_Allgatherv(&sendbuffer[0],sendsize,MPI_BYTE,&receivebuffer[0],&sendcounts[0],&displacements[0],MPI_BYTE,MPI_COMM_WORLD);
-        be = 0;
-        
-        for (int j = 0 ; j < plb::global::mpi().getSize() ; j++) {
-            be = displacements[j];
+        return receivesize;
+    }
+    static void unpack(std::vector<unsigned char> const & receivebuffer, std::vector<int> const & displacements, std::map<int,GatherType> & gatherValues) {
+        byteint local_number;
+        for (int be : displacements) {
             for (unsigned int i = 0; i < sizeof(int) ; i++) {
                 local_number.b[i] = receivebuffer[be];
                 be++;
@@ -125,7 +106,62 @@ public:
                 gatherValues[bg.ID] = bg.g;
             }
         }
+    }
+public:
+    //Numblocks should be larger than the maximum number of blocks per process
+    //The total can be retrieved from Multiblock.getManagment.getsparseblock.getnumblocks
+    HemoCellGatheringFunctional(std::map<int,GatherType> & gatherValues_) : 
+      gatherValues(gatherValues_) {}
+    void getModificationPattern(std::vector<bool>& isWritten) const {
+        for (pluint i = 0; i < isWritten.size(); i++) {
+            isWritten[i] = false;       
+        }
+    }
+    plb::BlockDomain::DomainT appliesTo() const { return plb::BlockDomain::bulk; }
+    void getTypeOfModification(std::vector<plb::modif::ModifT>& modified) const {
+        for (pluint i = 0; i < modified.size(); i++) {
+            modified[i] = plb::modif::nothing;       
+        }
+        
+    }
+    /// All entries of every process end up in gatherValues on every process
+    static void gather(std::map<int,GatherType> & gatherValues) {
+        std::vector<unsigned char> sendbuffer = pack(gatherValues);
+        int sendsize = sendbuffer.size();
+        
+        std::vector<int> sendcounts(plb::global::mpi().getSize());
+        MPI_Allgather(&sendsize,sizeof(int),MPI_BYTE,&sendcounts[0],sizeof(int),MPI_BYTE,MPI_COMM_WORLD);
+              
+        std::vector<int> displacements;
+        std::vector<unsigned char> receivebuffer(receiveLayout(sendcounts,displacements));
         
+        MPI_Allgatherv(&sendbuffer[0],sendsize,MPI_BYTE,&receivebuffer[0],&sendcounts[0],&displacements[0],MPI_BYTE,MPI_COMM_WORLD);
+        unpack(receivebuffer,displacements,gatherValues);
+    }
+
+    /**
+     * All entries of every process end up in gatherValues on root only, the
+     * other processes keep their own entries. Use this when only one process
+     * writes the result, it sends every entry once instead of to every process.
+     */
+    static void gatherToRoot(std::map<int,GatherType> & gatherValues, int root = 0) {
+        std::vector<unsigned char> sendbuffer = pack(gatherValues);
+        int sendsize = sendbuffer.size();
+        const bool isRoot = plb::global::mpi().getRank() == root;
+
+        std::vector<int> sendcounts(isRoot ? plb::global::mpi().getSize() : 1);
+        MPI_Gather(&sendsize,sizeof(int),MPI_BYTE,&sendcounts[0],sizeof(int),MPI_BYTE,root,MPI_COMM_WORLD);
+
+        std::vector<int> displacements(1,0);
+        std::vector<unsigned char> receivebuffer(1);
+        if (isRoot) {
+          receivebuffer.resize(receiveLayout(sendcounts,displacements));
+        }
+
+        MPI_Gatherv(&sendbuffer[0],sendsize,MPI_BYTE,&receivebuffer[0],&sendcounts[0],&displacements[0],MPI_BYTE,root,MPI_COMM_WORLD);
+        if (isRoot) {
+          unpack(receivebuffer,displacements,gatherValues);
+        }
     }
         
     //This map should be set in the processingGenericBlocks function and is local to the mpi processor;
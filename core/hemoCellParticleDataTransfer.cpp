@@ -266,6 +266,32 @@ void HemoCellParticleDataTransfer::receivePreInlet(char *buffer, unsigned int si
   global.statistics.getCurrent().stop();
 }
 
+void HemoCellParticleDataTransfer::receive(HemoCellParticle::serializeValues_t const *particles, unsigned int count, Dot3D absoluteOffset)
+{
+  global.statistics.getCurrent()["MpiReceive"].start();
+
+  int offset = getOffset(absoluteOffset);
+  hemo::Array<T, 3> realAbsoluteOffset({(T)absoluteOffset.x, (T)absoluteOffset.y, (T)absoluteOffset.z});
+  for (unsigned int i = 0; i < count; i++)
+  {
+    HemoCellParticle::serializeValues_t newParticle = particles[i];
+    newParticle.position += realAbsoluteOffset;
+    //Check for overflows
+    if (((offset < 0) && (newParticle.cellId < INT_MIN - offset)) ||
+        ((offset > 0) && (newParticle.cellId > INT_MAX - offset)))
+    {
+      cout << "(HemoCellParticleDataTransfer) Almost invoking overflow in periodic particle communication, resetting ID to base ID instead, this will most likely delete the particle" << endl;
+      newParticle.cellId = particleField->cellFields->base_cell_id(newParticle.cellId);
+    }
+    else
+    {
+      newParticle.cellId += offset;
+    }
+    particleField->addParticle(newParticle);
+  }
+  global.statistics.getCurrent().stop();
+}
+
 void HemoCellParticleDataTransfer::receive(char *buffer, unsigned int size, modif::ModifT kind, Dot3D absoluteOffset)
 {
   if (absoluteOffset.x == 0 && absoluteOffset.y == 0 && absoluteOffset.z == 0)
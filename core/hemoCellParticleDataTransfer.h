@@ -47,6 +47,8 @@ public:
     void receive(char *, unsigned int size, modif::ModifT);
     void receive(char *, unsigned int size, modif::ModifT, Dot3D absoluteOffset);
     void receivePreInlet(char *, unsigned int size, modif::ModifT, Dot3D absoluteOffset);
+    // Records are read in place and not modified, used for buffers shared with other processes
+    void receive(HemoCellParticle::serializeValues_t const *, unsigned int count, Dot3D absoluteOffset);
 
     virtual void receive(Box3D domain, std::vector<NoInitChar> const& buffer);
     virtual void receive(Box3D domain, std::vector<NoInitChar> const& buffer, Dot3D absoluteOffset);
@@ -24,7 +24,7 @@ along with this program.  If not, see <http://www.gnu.org/licenses/>.
 
 #include "hemoCellParticleField.h"
 #include "hemocell.h"
-#include "octree.h"
+#include "scanlineVoxelizer.h"
 #include "mollerTrumbore.h"
 #include "bindingField.h"
 #include "interiorViscosity.h"
@@ -42,7 +42,6 @@ HemoCellParticleField::HemoCellParticleField(plint nx, plint ny, plint nz)
     boundingBox = Box3D(0,this->getNx()-1, 0, this->getNy()-1, 0, this->getNz()-1);
     dataTransfer = &particleDataTransfer;
     particleDataTransfer.setBlock(*this);
-    AddOutputMap(); 
 }
 
 HemoCellParticleField::HemoCellParticleField(HemoCellParticleField const& rhs)
@@ -58,7 +57,6 @@ HemoCellParticleField::HemoCellParticleField(HemoCellParticleField const& rhs)
     lpc_up_to_date = false;
     ppt_up_to_date = false;
     pg_up_to_date = false;
-    AddOutputMap();
 }
 
 HemoCellParticleField::~HemoCellParticleField()
@@ -72,15 +70,6 @@ HemoCellParticleField::~HemoCellParticleField()
     delete[] particle_grid_size;
     particle_grid_size = 0;
   }
-  
-  // Sanitize for MultiBlockLattice destructor (releasememory). It can't handle releasing non-background dynamics that are not singular
-  if (global.enableInteriorViscosity) {
-    for (const Dot3D & internalPoint : internalPoints ) {
-      atomicLattice->get(internalPoint.x,internalPoint.y,internalPoint.z);
-      atomicLattice->get(internalPoint.x,internalPoint.y,internalPoint.z).attributeDynamics(&atomicLattice->getBackgroundDynamics());
-    }
-    InteriorViscosityHelper::get(*cellFields).empty(*this);
-  }
 }
 
 HemoCellParticleField& HemoCellParticleField::operator=(HemoCellParticleField const& rhs){
@@ -585,12 +574,19 @@ void HemoCellParticleField::advanceParticles() {
   
   lpc_up_to_date = false;
   pg_up_to_date = false;
+  //The positions are those of the next iteration now
+  positionsIteration = cellFields->hemocell.iter + 1;
 }
 
-void HemoCellParticleField::separateForceVectors() {
-  //Also save the total force, therfore recalculate in advance
-  applyConstitutiveModel();
+const CellState * HemoCellParticleField::freshCellState(int cid) const {
+  if (positionsIteration != cellFields->hemocell.iter) { return 0; }
+  map<int,CellState>::const_iterator it = cellState.find(cid);
+  if (it == cellState.end() || it->second.iteration != positionsIteration) { return 0; }
+  return &it->second;
+}
 
+void HemoCellParticleField::separateForceVectors() {
+  //The total force is recalculated in advance by HemoCellFields::separate_force_vectors()
   for (HemoCellParticle & sparticle : particles) {
     //Save Total Force
     sparticle.force_total = sparticle.sv.force + sparticle.sv.force_repulsion;
@@ -650,6 +646,29 @@ void HemoCellParticleField::applyConstitutiveModel(bool forced) {
     lpc[cid]=true;
     no_add_lpc:;
   }
+
+  //Every earlier entry belongs to positions that have been advanced since
+  cellState.clear();
+
+  //With single owner mechanics only the block holding the first vertex
+  //calculates a cell, the other blocks receive the forces afterwards
+  const bool singleOwner = !forced && cellFields->singleOwnerMechanics();
+  ownedCells.clear();
+  if (singleOwner) {
+    for (auto it = lpc.begin() ; it != lpc.end() ; ) {
+      if (isContainedABS((*ppc_new)[it->first][0]->sv.position, localDomain)) {
+        ++it;
+      } else {
+        it = lpc.erase(it);
+      }
+    }
+    for (const auto & pair : particles_per_cell) {
+      if (pair.second[0] != -1 && !lpc.count(pair.first) &&
+          isContainedABS(particles[pair.second[0]].sv.position, localDomain)) {
+        hlogfile << "(HemoCellParticleField) (Warning) Cell " << pair.first << " is owned by atomic block " << atomicBlockId << " but is not complete there, increase the particle envelope" << endl;
+      }
+    }
+  }
   
   for (pluint ctype = 0; ctype < (*cellFields).size(); ctype++) {
     if ((*cellFields).hemocell.iter % (*cellFields)[ctype]->timescale == 0 || forced) {
@@ -666,7 +685,18 @@ void HemoCellParticleField::applyConstitutiveModel(bool forced) {
           }
         }
       }
-      (*cellFields)[ctype]->mechanics->ParticleMechanics(*ppc_new,lpc,ctype);
+      CellMechanics * mechanics = (*cellFields)[ctype]->mechanics;
+      mechanics->cellState = &cellState;
+      mechanics->cellStateIteration = positionsIteration;
+      mechanics->ParticleMechanics(*ppc_new,lpc,ctype);
+      mechanics->cellState = 0;
+      if (singleOwner) {
+        for (const auto & pair : lpc) {
+          if ((*ppc_new)[pair.first][0]->sv.celltype == ctype) {
+            ownedCells.push_back(pair.first);
+          }
+        }
+      }
     }
   }
   
@@ -760,13 +790,11 @@ void HemoCellParticleField::internalGridPointsMembrane(Box3D domain) {
         InteriorViscosityHelper::get(*cellFields).add(*this, {particle.kernelCoordinates[i][0],
                 particle.kernelCoordinates[i][1],
                 particle.kernelCoordinates[i][2]},
-                (*cellFields)[particle.sv.celltype]->interiorViscosityTau);
-        particle.kernelLocations[i]->attributeDynamics((*cellFields)[particle.sv.celltype]->innerViscosityDynamics);
+                particle.sv.celltype);
       } else {  // Node is outside
         InteriorViscosityHelper::get(*cellFields).remove(*this, {particle.kernelCoordinates[i][0],
                                                                 particle.kernelCoordinates[i][1],
                                                                 particle.kernelCoordinates[i][2]});
-        particle.kernelLocations[i]->attributeDynamics(&atomicLattice->getBackgroundDynamics());
       }
     }
   }
@@ -776,12 +804,15 @@ void HemoCellParticleField::internalGridPointsMembrane(Box3D domain) {
 // sure that there are no higher viscosity grid points left after substantial movement
 void HemoCellParticleField::findInternalParticleGridPoints(Box3D domain) {
   // Reset all the lattice points to the orignal relaxation parameter
-  for (const Dot3D & internalPoint : internalPoints ) {
-    atomicLattice->get(internalPoint.x,internalPoint.y,internalPoint.z);
-    atomicLattice->get(internalPoint.x,internalPoint.y,internalPoint.z).attributeDynamics(&atomicLattice->getBackgroundDynamics());
-  }
   InteriorViscosityHelper::get(*cellFields).empty(*this);
-  
+
+  // Global extent of this block, the voxelizer works in lattice coordinates
+  const Dot3D location = atomicLattice->getLocation();
+  const Box3D block(location.x, location.x + atomicLattice->getNx() - 1,
+                    location.y, location.y + atomicLattice->getNy() - 1,
+                    location.z, location.z + atomicLattice->getNz() - 1);
+  hemo::ScanlineVoxelizer voxelizer;
+
   for (const auto & pair : get_lpc()) { // Go over each cell?
     const int & cid = pair.first;
     const vector<int> & cell = get_particles_per_cell().at(cid);
@@ -792,17 +823,14 @@ void HemoCellParticleField::findInternalParticleGridPoints(Box3D domain) {
     if (!(*cellFields)[ctype]->doInteriorViscosity) {
       continue;
     }
-    
-    hemo::OctreeStructCell octCell(3, 1, 30,
-                                  (*cellFields)[ctype]->mechanics->cellConstants.triangle_list,
-                                  particles, cell);
-
-    std::set<Array<plint,3>> innerNodes;
-    octCell.findInnerNodes(atomicLattice,particles,cell,innerNodes);
-    for (const Array<plint,3> & node : innerNodes) {
-      InteriorViscosityHelper::get(*cellFields).add(*this, {node[0],node[1],node[2]},(*cellFields)[ctype]->interiorViscosityTau );
-      atomicLattice->get(node[0],node[1],node[2]).attributeDynamics((*cellFields)[ctype]->innerViscosityDynamics);
-    }
+
+    voxelizer.forEachInnerNode(cell.size(), (*cellFields)[ctype]->mechanics->cellConstants.triangle_list,
+                               [&](plint i) -> const hemo::Array<T,3> & { return particles[cell[i]].sv.position; },
+                               block,
+                               [&](plint x, plint y, plint z) {
+      x -= location.x; y -= location.y; z -= location.z;
+      InteriorViscosityHelper::get(*cellFields).add(*this, {x,y,z}, ctype);
+    });
   }
 }
 #else
@@ -951,7 +979,7 @@ end_inner_loop:;
 T HemoCellParticleField::eigenValueFromCell(plb::Cell<T,DESCRIPTOR> & cell) {
     plb::Array<T,SymmetricTensor<T,DESCRIPTOR>::n> element;
     cell.computePiNeq(element);
-    T omega     = cell.getDynamics().getOmega();
+    T omega     = cellOmega(cell);
     T rhoBar    = cell.getDynamics().computeRhoBar(cell);
     T prefactor = - omega * DESCRIPTOR<T>::invCs2 *
                  DESCRIPTOR<T>::invRho(rhoBar) / (T)2;
@@ -1020,48 +1048,57 @@ void HemoCellParticleField::solidifyCells() {
 
   // Remove any to be removed particles (tagged with `tag == 1`).
   removeParticles(1);
-  if(!pg_up_to_date) {
-    update_pg();
+  if (!bindingSites.count()) {
+    return;
+  }
+
+  // Thresholds of the cell types that solidify
+  vector<T> distanceThreshold(cellFields->size()), shearThreshold(cellFields->size());
+  for (unsigned int ctype = 0; ctype < cellFields->size(); ctype++) {
+    if ((*cellFields)[ctype]->doSolidifyMechanics) {
+      distanceThreshold[ctype] = (*cellFields)[ctype]->mechanics->cfg["MaterialModel"]["distanceThreshold"].read<T>();
+      shearThreshold[ctype] = (*cellFields)[ctype]->mechanics->cfg["MaterialModel"]["shearThreshold"].read<T>();
+    }
   }
 
-  // Detect particles to be solidified by looping over a block of 3x3 LBM cells
-  // around each binding site. When a cell statisfies both:
+  // Detect particles to be solidified by looking up the binding sites in the
+  // block of 3x3 LBM cells around the node of each particle. When a particle
+  // statisfies both:
   // - close enough in space to a binding site,
-  // - shows a minimum tresca stress,
+  // - shows a minimum tresca stress at its node,
   // the particle is labelled to be solified.
-  for (const Dot3D & b_particle : bindingSites) {
-    for (int x = b_particle.x-1; x <= b_particle.x+1; x++) {
-      if (x < 0 || x > this->atomicLattice->getNx()-1) {
-        continue;
-      }
-
-      for (int y = b_particle.y-1; y <= b_particle.y+1; y++) {
-        if (y < 0 || y > this->atomicLattice->getNy()-1) {
-          continue;
-        }
-
-        for (int z = b_particle.z-1; z <= b_particle.z+1; z++) {
-          if (z < 0 || z > this->atomicLattice->getNz()-1) {
-            continue;
-          }
-
-          const int & index = grid_index(x,y,z);
+  const Dot3D & location = this->atomicLattice->getLocation();
+  for (HemoCellParticle & lParticle : particles) {
+    const pluint ctype = lParticle.sv.celltype;
+    if (!(*cellFields)[ctype]->doSolidifyMechanics || lParticle.sv.solidify) { continue; }
+
+    // Same node as the particle grid
+    const hemo::Array<T,3> & position = lParticle.sv.position;
+    const int x = position[0]-location.x+0.5;
+    const int y = position[1]-location.y+0.5;
+    const int z = position[2]-location.z+0.5;
+    if (x < 0 || x >= this->atomicLattice->getNx() ||
+        y < 0 || y >= this->atomicLattice->getNy() ||
+        z < 0 || z >= this->atomicLattice->getNz()) {
+      continue;
+    }
 
-          for (unsigned int i = 0; i < particle_grid_size[index]; i++) {
-            HemoCellParticle & lParticle = particles[particle_grid[index][i]];
-            const hemo::Array<T,3> dv = lParticle.sv.position - (b_particle + this->atomicLattice->getLocation());
-            const T distance = sqrt(dv[0]*dv[0]+dv[1]*dv[1]+dv[2]*dv[2]);
-            T tresca = eigenValueFromCell(this->atomicLattice->get(x,y,z));
-
-            // FIXME: both user-defined constants could be extracted outside the loop.
-            if ((distance <= (*cellFields)[lParticle.sv.celltype]->mechanics->cfg["MaterialModel"]["distanceThreshold"].read<T>())
-                    && (abs(tresca/1e-7) > (*cellFields)[lParticle.sv.celltype]->mechanics->cfg["MaterialModel"]["shearThreshold"].read<T>()) ) {
-              lParticle.sv.solidify = true;
-            }
-          }
+    bool nearBindingSite = false;
+    for (int bx = x-1; bx <= x+1 && !nearBindingSite; bx++) {
+      for (int by = y-1; by <= y+1 && !nearBindingSite; by++) {
+        for (int bz = z-1; bz <= z+1 && !nearBindingSite; bz++) {
+          if (!bindingSites.testInside(bx,by,bz)) { continue; }
+          const hemo::Array<T,3> dv = (position - location) - hemo::Array<T,3>({T(bx),T(by),T(bz)});
+          nearBindingSite = sqrt(dv[0]*dv[0]+dv[1]*dv[1]+dv[2]*dv[2]) <= distanceThreshold[ctype];
         }
       }
     }
+    if (!nearBindingSite) { continue; }
+
+    const T tresca = eigenValueFromCell(this->atomicLattice->get(x,y,z));
+    if (abs(tresca/1e-7) > shearThreshold[ctype]) {
+      lParticle.sv.solidify = true;
+    }
   }
 #else
   hlog << "(HemoCellParticleField) SolidifyCells called but SOLIDIFY_MECHANICS not enabled" << endl;
@@ -31,11 +31,24 @@ namespace hemo {
 #include "hemoCellFields.h"
 #include "hemoCellParticleDataTransfer.h"
 #include "hemoCellParticle.h"
+#include "bindingSiteMask.h"
 
 #include "atomicBlock/blockLattice3D.hh"
 
 namespace hemo {
 using namespace std;
+
+/// Values of a cell published by its mechanics model, see CellMechanics::publishCellState()
+struct CellState {
+  T volume = 0;
+  T area = 0;
+  hemo::Array<T,3> position = {0.,0.,0.};
+  hemo::Array<T,3> velocity = {0.,0.,0.};
+  hemo::Array<T,6> bbox = {0.,0.,0.,0.,0.,0.};
+  /// Iteration of the particle positions these values belong to
+  plint iteration = -1;
+};
+
 class HemoCellParticleField : public plb::AtomicBlock3D {
 public:
     HemoCellParticleField(plint nx, plint ny, plint nz);
@@ -104,29 +117,28 @@ public:
     plb::Box3D & getBoundingBox() {
       return boundingBox;
     }
-    //Ugly output functions:
-    void outputPositions(plb::Box3D,vector<vector<T>>&, pluint, std::string&); 
-    void outputVelocities(plb::Box3D,vector<vector<T>>&, pluint, std::string&); 
-    void outputForces   (plb::Box3D,vector<vector<T>>&, pluint, std::string&);
-    void outputForceVolume   (plb::Box3D,vector<vector<T>>&, pluint, std::string&);
-    void outputForceArea   (plb::Box3D,vector<vector<T>>&, pluint, std::string&);
-    void outputForceBending   (plb::Box3D,vector<vector<T>>&, pluint, std::string&);
-    void outputForceLink   (plb::Box3D,vector<vector<T>>&, pluint, std::string&);
-    void outputForceVisc    (plb::Box3D,vector<vector<T>>&, pluint, std::string&);
-    void outputForceRepulsion  (plb::Box3D,vector<vector<T>>&, pluint, std::string&);
-    
-    void outputTriangles   (plb::Box3D,vector<vector<plint>>&, pluint, std::string&);
-    void outputInnerLinks   (plb::Box3D,vector<vector<plint>>&, pluint, std::string&);
-    
-    void outputVertexId    (plb::Box3D,vector<vector<T>>&, pluint, std::string&);
-    void outputCellId    (plb::Box3D,vector<vector<T>>&, pluint, std::string&);
-    void outputForceInnerLink   (plb::Box3D,vector<vector<T>>&, pluint, std::string&);
-    void outputResTime   (plb::Box3D,vector<vector<T>>&, pluint, std::string&);
-
-
-    void AddOutputMap();
-    map<int,void (HemoCellParticleField::*)(plb::Box3D,vector<vector<T>>&,pluint,std::string&)> outputFunctionMap;
-    void passthroughpass(int,plb::Box3D,vector<vector<T>>&,pluint,std::string&);
+    //Output functions, these write straight into contiguous buffers:
+    /// Name and number of values per particle of a particle output variable, false if it is none
+    static bool particleOutputVariable(int variable, std::string & name, unsigned int & columns);
+    /// Delete incomplete cells of ctype, select the cells that are written (HemoCellField::isOutputCell())
+    /// and return the number of particles (and cells) the extract functions below write
+    plint countOutputParticles(pluint ctype, plint * nCells = 0);
+    /// Write the variables of all particles of the selected cells in one pass over the particles,
+    /// buffers[i] holds countOutputParticles() rows of the columns of variables[i]
+    template<typename O>
+    void extractOutput(pluint ctype, vector<int> const & variables, vector<O*> const & buffers);
+    /// Connectivity of the cells of ctype, indices into the rows of extractOutput() plus base
+    template<typename I>
+    void extractTriangles(pluint ctype, I * output, I base = 0);
+    template<typename I>
+    void extractInnerLinks(pluint ctype, I * output, I base = 0);
+    /// Cell id and first row (plus base) of every cell of ctype, the connectivity follows from the template of the cell type.
+    /// Returns base plus the number of rows, which must match the rows of extractOutput()
+    template<typename I>
+    I extractCellOffsets(pluint ctype, I * ids, I * offsets, I base = 0);
+private:
+    /// Cell ids selected by the last countOutputParticles()
+    vector<int> outputCells;
 
 public:
     virtual HemoCellParticleDataTransfer& getDataTransfer();
@@ -149,6 +161,14 @@ public:
     vector<HemoCellParticle> particles;
     plb::Box3D boundingBox; 
     int nFluidCells = 0;
+    ///Cells calculated by this block in the last single owner applyConstitutiveModel
+    vector<int> ownedCells;
+    ///Volume, area, centroid, velocity and bounding box of the cells calculated in the last applyConstitutiveModel
+    map<int,CellState> cellState;
+    ///Iteration the particle positions belong to, set when they are advanced (-1 until then)
+    plint positionsIteration = -1;
+    ///The published state of cell cid when it belongs to the current positions, 0 otherwise
+    const CellState * freshCellState(int cid) const;
     
 private:
   bool lpc_up_to_date = false;
@@ -188,8 +208,7 @@ public:
   const map<int,vector<int>> & get_preinlet_particles_per_cell();
   const map<int,bool> & get_lpc();
   
-  set<plb::Dot3D> internalPoints; // Store found interior points
-  plb::ScalarField3D<T> * interiorViscosityField = 0;
+  plb::ScalarField3D<unsigned char> * interiorViscosityField = 0; // Tau class per node, nonzero inside a cell
   
     
     //vector<vector<vector<vector<HemoCellParticle*>>>> particle_grid; //maybe better to make custom data structure, But that would be slower
@@ -202,8 +221,11 @@ public:
     plb::Box3D localDomain;
     
     //These should be edited through the helper/solidifyField.h functions
-    std::set<plb::Dot3D> bindingSites;
-    plb::ScalarField3D<bool> * bindingField = 0;
+    BindingSiteMask bindingSites;
+    /// Solidified here since the last envelope exchange, which passes them on to the neighbours (global node coordinates, base cell ids).
+    /// The neighbours see them one exchange late: solidifyCells() runs after the envelopes of the iteration were synchronized
+    vector<plb::Dot3D> solidifiedSites;
+    vector<int> solidifiedCells;
 };
 
 }
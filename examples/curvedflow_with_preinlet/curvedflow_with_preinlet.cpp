@@ -83,7 +83,7 @@ int main (int argc, char * argv[]) {
   hemocell.preInlet->preInletFromSlice(Direction::Xpos,slice);
 
   hlog << "(Stl preinlet) (Fluid) Initializing Palabos Fluid Field" << endl;
-  hemocell.initializeLattice(voxelizedDomain->getMultiBlockManagement());
+  hemocell.initializeLattice(flagMatrix->getMultiBlockManagement(), flagMatrix);
 
     if (!hemocell.partOfpreInlet) {
       hemocell.lattice->periodicity().toggleAll(false);
@@ -55,17 +55,12 @@ int main(int argc, char *argv[]) {
                        (*cfg)["domain"]["refDir"].read<int>(),
                        voxelizedDomain, flagMatrix,
                        (*cfg)["domain"]["blockSize"].read<int>(),
-                       (*cfg)["domain"]["particleEnvelope"].read<int>());
+                       hemo::global.particleEnvelope);
 
   param::lbm_pipe_parameters((*cfg),flagMatrix.get());
   param::printParameters();
 
-  hemocell.lattice = new MultiBlockLattice3D<T, DESCRIPTOR>(
-            voxelizedDomain.get()->getMultiBlockManagement(),
-            defaultMultiBlockPolicy3D().getBlockCommunicator(),
-            defaultMultiBlockPolicy3D().getCombinedStatistics(),
-            defaultMultiBlockPolicy3D().getMultiCellAccess<T, DESCRIPTOR>(),
-            new GuoExternalForceBGKdynamics<T, DESCRIPTOR>(1.0/param::tau));
+  hemocell.initializeLattice(flagMatrix->getMultiBlockManagement(), flagMatrix.get());
 
   defineDynamics(*hemocell.lattice, *flagMatrix.get(), (*hemocell.lattice).getBoundingBox(), new BounceBack<T, DESCRIPTOR>(1.), 0);
 
@@ -35,8 +35,16 @@ namespace hemo {
       exit(1);
     }
     
+    //Every particleField keeps the binding sites of its atomic block as a bitmask
+    for (const plint & bId : cellFields.domain_immersedParticles->getLocalInfo().getBlocks()) {
+      HemoCellParticleField & pf = cellFields.domain_immersedParticles->getComponent(bId);
+      pf.bindingSites.resize(pf.atomicLattice->getNx(),pf.atomicLattice->getNy(),pf.atomicLattice->getNz());
+    }
+  }
+
+  plb::MultiScalarField3D<bool> * bindingFieldHelper::createCheckpointField() {
     //Create bindingfield with same properties as fluid field underlying the particleField.
-    multiBindingField = new plb::MultiScalarField3D<bool>(
+    plb::MultiScalarField3D<bool> * multiBindingField = new plb::MultiScalarField3D<bool>(
               MultiBlockManagement3D (
                 *cellFields.hemocell.domain_lattice->getSparseBlockStructure().clone(),
                 cellFields.hemocell.domain_lattice->getMultiBlockManagement().getThreadAttribution().clone(),
@@ -51,17 +59,10 @@ namespace hemo {
     multiBindingField->periodicity().toggle(2,cellFields.hemocell.domain_lattice->periodicity().get(2));
 
     multiBindingField->initialize();
-    //Make sure each particleField has access to its local scalarField
-    for (const plint & bId : multiBindingField->getLocalInfo().getBlocks()) {
-      HemoCellParticleField & pf = cellFields.domain_immersedParticles->getComponent(bId);
-      pf.bindingField = &multiBindingField->getComponent(bId);
-    }
-    
+    return multiBindingField;
   }
   
-  bindingFieldHelper::~bindingFieldHelper() {
-    delete multiBindingField;
-  }
+  bindingFieldHelper::~bindingFieldHelper() {}
     
   void bindingFieldHelper::checkpoint() {
     if (!global.enableSolidifyMechanics) { 
@@ -77,7 +78,14 @@ namespace hemo {
         renameFileToDotOld(outDir + "bindingSites.plb");
     }
   
+    plb::MultiScalarField3D<bool> * multiBindingField = createCheckpointField();
+    for (const plint & bId : multiBindingField->getLocalInfo().getBlocks()) {
+      const HemoCellParticleField & pf = cellFields.domain_immersedParticles->getComponent(bId);
+      ScalarField3D<bool> & bf = multiBindingField->getComponent(bId);
+      pf.bindingSites.forEach([&](plint x, plint y, plint z) { bf.get(x,y,z) = true; });
+    }
     plb::parallelIO::save(*multiBindingField, outDir + "bindingSites", true);
+    delete multiBindingField;
   
   }
   
@@ -95,47 +103,37 @@ namespace hemo {
       exit(1);
     }
     
-    plb::parallelIO::load(outDir + "bindingSites",*get(cellFields).multiBindingField,true);
-    get(cellFields).refillBindingSites();
+    bindingFieldHelper & helper = get(cellFields);
+    plb::MultiScalarField3D<bool> * multiBindingField = helper.createCheckpointField();
+    plb::parallelIO::load(outDir + "bindingSites",*multiBindingField,true);
+    for (const plint & bId : multiBindingField->getLocalInfo().getBlocks()) {
+      HemoCellParticleField & pf = cellFields.domain_immersedParticles->getComponent(bId);
+      ScalarField3D<bool> & bf = multiBindingField->getComponent(bId);
+      Box3D domain = bf.getBoundingBox();
+      pf.bindingSites.clear();
+      for (int x = domain.x0; x <= domain.x1 ; x++) {
+        for (int y = domain.y0; y <= domain.y1; y++) {
+          for (int z = domain.z0; z <= domain.z1; z++) {
+            if(bf.get(x,y,z)) {
+              pf.bindingSites.set(x,y,z);
+            }
+          }
+        }
+      }
+    }
+    delete multiBindingField;
   }  
   
-  void bindingFieldHelper::add(HemoCellParticleField & pf, const Dot3D & bindingSite) {
-      pf.bindingSites.insert(bindingSite);
-      pf.bindingField->get(bindingSite.x,bindingSite.y,bindingSite.z) = true;
-  }
-  
   void bindingFieldHelper::add(HemoCellParticleField & pf, const vector<Dot3D> & bindingSites) {
     for (const Dot3D & bindingSite : bindingSites) {
       add(pf,bindingSite);
     }
   }
   
-  void bindingFieldHelper::remove(HemoCellParticleField & pf, const Dot3D & bindingSite) {
-    pf.bindingSites.erase(bindingSite);
-    pf.bindingField->get(bindingSite.x,bindingSite.y,bindingSite.z) = false;
-  }
-  
   void bindingFieldHelper::remove(HemoCellParticleField & pf, const vector<Dot3D> & bindingSites) {
     for (const Dot3D & bindingSite: bindingSites) {
       remove(pf,bindingSite);
     }
   } 
   
-  void bindingFieldHelper::refillBindingSites() {
-    for (const plint & bId : cellFields.domain_immersedParticles->getLocalInfo().getBlocks()) {
-      HemoCellParticleField & pf = cellFields.domain_immersedParticles->getComponent(bId);
-      ScalarField3D<bool> & bf = *pf.bindingField;
-      Box3D domain = bf.getBoundingBox();
-      for (int x = domain.x0; x <= domain.x1 ; x++) {
-        for (int y = domain.y0; y <= domain.y1; y++) {
-          for (int z = domain.z0; z <= domain.z1; z++) {
-            if(bf.get(x,y,z)) {
-              pf.bindingSites.insert({x,y,z});
-            }
-          }
-        }
-      }
-    }
-  }
-
 }
\ No newline at end of file
@@ -39,19 +39,23 @@ namespace hemo {
     static void restore(HemoCellFields & cellFields);
     
     //Called within functional, from particlefield
-    void add(HemoCellParticleField & pf, const Dot3D & bindingSite);
+    void add(HemoCellParticleField & pf, const Dot3D & bindingSite) {
+      pf.bindingSites.set(bindingSite.x,bindingSite.y,bindingSite.z);
+    }
     void add(HemoCellParticleField & pf, const vector<Dot3D> & bindingSites);
-    void remove(HemoCellParticleField & pf, const Dot3D & bindingSite);
+    void remove(HemoCellParticleField & pf, const Dot3D & bindingSite) {
+      pf.bindingSites.reset(bindingSite.x,bindingSite.y,bindingSite.z);
+    }
     void remove(HemoCellParticleField & pf, const vector<Dot3D> & bindingSites);
     
   private:
     HemoCellFields & cellFields;
-    plb::MultiScalarField3D<bool> * multiBindingField = 0;
     
     bindingFieldHelper(HemoCellFields * cellFields);
     ~bindingFieldHelper();
     
-    void refillBindingSites();
+    /// Field with the layout of the fluid, only used to checkpoint the binding sites
+    plb::MultiScalarField3D<bool> * createCheckpointField();
     
     //Singleton Behaviour
   public:
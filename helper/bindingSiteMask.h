@@ -0,0 +1,128 @@
+/*
+This file is part of the HemoCell library
+
+HemoCell is developed and maintained by the Computational Science Lab 
+in the University of Amsterdam. Any questions or remarks regarding this library 
+can be sent to: info@hemocell.eu
+
+When using the HemoCell library in scientific work please cite the
+corresponding paper: https://doi.org/10.3389/fphys.2017.00563
+
+The HemoCell library is free software: you can redistribute it and/or
+modify it under the terms of the GNU Affero General Public License as
+published by the Free Software Foundation, either version 3 of the
+License, or (at your option) any later version.
+
+The library is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU Affero General Public License for more details.
+
+You should have received a copy of the GNU Affero General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+#ifndef HEMO_BINDING_SITE_MASK_H
+#define HEMO_BINDING_SITE_MASK_H
+
+#include <cstdint>
+#include <vector>
+
+#include "constant_defaults.h"
+
+namespace hemo {
+  /**
+   * One bit per lattice node of an atomic block, packed in 4x4x4 tiles of one
+   * 64 bit word each. The nonzero words are kept in an active tile list, so
+   * visiting all set nodes costs the number of occupied tiles, not the block
+   * size. Coordinates are local to the block.
+   */
+  class BindingSiteMask {
+  public:
+    void resize(plint nx_, plint ny_, plint nz_) {
+      nx = nx_; ny = ny_; nz = nz_;
+      tny = (ny+3)/4; tnz = (nz+3)/4;
+      words.assign(((nx+3)/4)*tny*tnz,0);
+      activePosition.assign(words.size(),-1);
+      active.clear();
+      sites = 0;
+    }
+
+    bool test(plint x, plint y, plint z) const {
+      return words[word(x,y,z)] & bit(x,y,z);
+    }
+
+    /// Bounds checked test, false outside of the block
+    bool testInside(plint x, plint y, plint z) const {
+      if (x < 0 || y < 0 || z < 0 || x >= nx || y >= ny || z >= nz) { return false; }
+      return test(x,y,z);
+    }
+
+    void set(plint x, plint y, plint z) {
+      const plint w = word(x,y,z);
+      const uint64_t b = bit(x,y,z);
+      if (words[w] & b) { return; }
+      if (!words[w]) {
+        activePosition[w] = active.size();
+        active.push_back(w);
+      }
+      words[w] |= b;
+      sites++;
+    }
+
+    void reset(plint x, plint y, plint z) {
+      const plint w = word(x,y,z);
+      const uint64_t b = bit(x,y,z);
+      if (!(words[w] & b)) { return; }
+      words[w] &= ~b;
+      sites--;
+      if (!words[w]) {
+        //Swap the last active tile into the freed position
+        active[activePosition[w]] = active.back();
+        activePosition[active.back()] = activePosition[w];
+        active.pop_back();
+        activePosition[w] = -1;
+      }
+    }
+
+    void clear() {
+      for (const plint & w : active) {
+        words[w] = 0;
+        activePosition[w] = -1;
+      }
+      active.clear();
+      sites = 0;
+    }
+
+    /// Number of set nodes
+    plint count() const { return sites; }
+
+    /// Call f(x,y,z) for every set node
+    template<class F>
+    void forEach(F f) const {
+      for (const plint & w : active) {
+        const plint tz = w%tnz, ty = (w/tnz)%tny, tx = w/(tnz*tny);
+        uint64_t bits = words[w];
+        while (bits) {
+          const int b = __builtin_ctzll(bits);
+          bits &= bits - 1;
+          f(4*tx + (b >> 4), 4*ty + ((b >> 2) & 3), 4*tz + (b & 3));
+        }
+      }
+    }
+
+  private:
+    plint nx = 0, ny = 0, nz = 0, tny = 0, tnz = 0;
+    std::vector<uint64_t> words;
+    std::vector<plint> active;
+    std::vector<plint> activePosition;
+    plint sites = 0;
+
+    plint word(plint x, plint y, plint z) const {
+      return ((x >> 2)*tny + (y >> 2))*tnz + (z >> 2);
+    }
+    static uint64_t bit(plint x, plint y, plint z) {
+      return uint64_t(1) << (((x & 3) << 4) | ((y & 3) << 2) | (z & 3));
+    }
+  };
+}
+#endif
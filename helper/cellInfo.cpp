@@ -42,6 +42,11 @@ void CellInformationFunctionals::CellVolume::processGenericBlocks(Box3D domain,
   for (const auto & pair : pf->get_lpc()) {
     T volume = 0.;
     const int & cid = pair.first;
+    //Published by the mechanics for the current positions
+    if (const CellState * state = pf->freshCellState(cid)) {
+      info_per_cell[cid].volume = state->volume;
+      continue;
+    }
     const vector<int> & cell = pf->get_particles_per_cell().at(cid);
     const pluint ctype = pf->particles[cell[0]].sv.celltype;
     for (hemo::Array<plint,3> triangle : (*hemocell->cellfields)[ctype]->mechanics->cellConstants.triangle_list) {
@@ -67,6 +72,10 @@ void CellInformationFunctionals::CellArea::processGenericBlocks(Box3D domain, st
   for (const auto & pair : pf->get_lpc()) {
     T total_area = 0.;
     const int & cid = pair.first;
+    if (const CellState * state = pf->freshCellState(cid)) {
+      info_per_cell[cid].area = state->area;
+      continue;
+    }
     const vector<int> & cell = pf->get_particles_per_cell().at(cid);
     const pluint ctype = pf->particles[cell[0]].sv.celltype;
     for (hemo::Array<plint,3> triangle : (*hemocell->cellfields)[ctype]->mechanics->cellConstants.triangle_list) {
@@ -103,20 +112,16 @@ void CellInformationFunctionals::CellPosition::processGenericBlocks(Box3D domain
 void CellInformationFunctionals::CellStretch::processGenericBlocks(Box3D domain, std::vector<AtomicBlock3D*> blocks) {
   HemoCellParticleField* pf = dynamic_cast<HemoCellParticleField*>(blocks[0]);
   
+  vector<hemo::Array<T,3>> vertices;
   for (const auto & pair : pf->get_lpc()) {
-    T max_stretch = 0.;
     const int & cid = pair.first;
     const vector<int> & cell = pf->get_particles_per_cell().at(cid);
-    for (unsigned int i = 0 ; i < cell.size() - 1 ; i++ ) {
-      for (unsigned int j = i + 1 ; j < cell.size() ; j ++) {
-        if (cell[i] == -1 || cell[j] == -1) {continue;}
-        T distance = sqrt( pow(pf->particles[cell[i]].sv.position[0]-pf->particles[cell[j]].sv.position[0],2) +
-                                pow(pf->particles[cell[i]].sv.position[1]-pf->particles[cell[j]].sv.position[1],2) +
-                                pow(pf->particles[cell[i]].sv.position[2]-pf->particles[cell[j]].sv.position[2],2));
-        max_stretch = max_stretch < distance ? distance : max_stretch;
-      }
+    vertices.clear();
+    for (const int pid : cell) {
+      if (pid == -1) { continue; }
+      vertices.push_back(pf->particles[pid].sv.position);
     }
-    info_per_cell[cid].stretch = max_stretch;
+    info_per_cell[cid].stretch = computeCellShape(vertices).diameter;
   }
 }
 void CellInformationFunctionals::CellBoundingBox::processGenericBlocks(Box3D domain, std::vector<AtomicBlock3D*> blocks) {
@@ -125,6 +130,10 @@ void CellInformationFunctionals::CellBoundingBox::processGenericBlocks(Box3D dom
   for (const auto & pair : pf->get_lpc()) {
     hemo::Array<T,6> bbox;
     const int & cid = pair.first;
+    if (const CellState * state = pf->freshCellState(cid)) {
+      info_per_cell[cid].bbox = state->bbox;
+      continue;
+    }
     const vector<int> & cell = pf->get_particles_per_cell().at(cid);
     HemoCellParticle * particle = &pf->particles[cell[0]];
     
@@ -170,14 +179,13 @@ void CellInformationFunctionals::CellType::processGenericBlocks(Box3D domain, st
 void CellInformationFunctionals::allCellInformation::processGenericBlocks(plb::Box3D domain, std::vector<plb::AtomicBlock3D*> blocks) {
   HemoCellParticleField* pf = dynamic_cast<HemoCellParticleField*>(blocks[0]);
   const map<int,vector<int>> & ppc = pf->get_particles_per_cell();
-  
+  vector<hemo::Array<T,3>> vertices;
   
   for (const auto & pair : pf->get_lpc()) {
     const int & cid = pair.first;
     hemo::Array<T,6> bbox;
     hemo::Array<T,3> position = {0.,0.,0.};
     hemo::Array<T,3> velocity = {0.,0.,0.};
-    T max_stretch = 0., distance = 0.;
     T total_area = 0., volume = 0.;
     
     if (ppc.find(cid) == ppc.end()) { continue; }
@@ -194,6 +202,7 @@ void CellInformationFunctionals::allCellInformation::processGenericBlocks(plb::B
     bbox[3] = particle->sv.position[1];
     bbox[4] = particle->sv.position[2];
     bbox[5] = particle->sv.position[2];
+    vertices.clear();
     
     for (unsigned int i = 0 ; i < cell.size() ; i++ ) {
       if (cell[i] == -1) { 
@@ -216,34 +225,31 @@ void CellInformationFunctionals::allCellInformation::processGenericBlocks(plb::B
       //velocity
       velocity += particle->sv.v;
       
-      //Cell stretch (max)
-      for (unsigned int j = i + 1 ; j < cell.size() ; j ++) {
-        if (cell[j] == -1) {goto ignore_cell;}
-        HemoCellParticle * particle2 = &pf->particles[cell[j]];
-        distance = sqrt( pow(particle->sv.position[0]-particle2->sv.position[0],2) +
-                                pow(particle->sv.position[1]-particle2->sv.position[1],2) +
-                                pow(particle->sv.position[2]-particle2->sv.position[2],2));
-        max_stretch = max_stretch < distance ? distance : max_stretch;
-      }
-
+      vertices.push_back(particle->sv.position);
     }
 
-    for (hemo::Array<plint,3> triangle : (*hemocell->cellfields)[ctype]->mechanics->cellConstants.triangle_list) {
-      const hemo::Array<T,3> & v0 = pf->particles[cell[triangle[0]]].sv.position;
-      const hemo::Array<T,3> & v1 = pf->particles[cell[triangle[1]]].sv.position;
-      const hemo::Array<T,3> & v2 = pf->particles[cell[triangle[2]]].sv.position;
+    //Published by the mechanics for the current positions, the vertices are still needed for the shape
+    if (const CellState * state = pf->freshCellState(cid)) {
+      volume = state->volume;
+      total_area = state->area;
+    } else {
+      for (hemo::Array<plint,3> triangle : (*hemocell->cellfields)[ctype]->mechanics->cellConstants.triangle_list) {
+        const hemo::Array<T,3> & v0 = pf->particles[cell[triangle[0]]].sv.position;
+        const hemo::Array<T,3> & v1 = pf->particles[cell[triangle[1]]].sv.position;
+        const hemo::Array<T,3> & v2 = pf->particles[cell[triangle[2]]].sv.position;
 
-      //area
-      total_area += computeTriangleArea(v0,v1,v2);  
-      
-      //Volume
-      const T v210 = v2[0]*v1[1]*v0[2];
-      const T v120 = v1[0]*v2[1]*v0[2];
-      const T v201 = v2[0]*v0[1]*v1[2];
-      const T v021 = v0[0]*v2[1]*v1[2];
-      const T v102 = v1[0]*v0[1]*v2[2];
-      const T v012 = v0[0]*v1[1]*v2[2];
-      volume += (1.0/6.0)*(-v210+v120+v201-v021-v102+v012);
+        //area
+        total_area += computeTriangleArea(v0,v1,v2);  
+        
+        //Volume
+        const T v210 = v2[0]*v1[1]*v0[2];
+        const T v120 = v1[0]*v2[1]*v0[2];
+        const T v201 = v2[0]*v0[1]*v1[2];
+        const T v021 = v0[0]*v2[1]*v1[2];
+        const T v102 = v1[0]*v0[1]*v2[2];
+        const T v012 = v0[0]*v1[1]*v2[2];
+        volume += (1.0/6.0)*(-v210+v120+v201-v021-v102+v012);
+      }
     }
     
     info_per_cell[cid].volume = volume;
@@ -255,7 +261,12 @@ void CellInformationFunctionals::allCellInformation::processGenericBlocks(plb::B
       info_per_cell[cid].centerLocal = pf->isContainedABS(info_per_cell[cid].position,pf->localDomain);
     }
 
-    info_per_cell[cid].stretch = max_stretch;
+    {
+      const CellShape shape = computeCellShape(vertices);
+      info_per_cell[cid].stretch = shape.diameter;
+      info_per_cell[cid].shapeLengths = shape.lengths;
+      info_per_cell[cid].deformationIndex = shape.deformationIndex;
+    }
     info_per_cell[cid].blockId = pf->atomicBlockId;
     info_per_cell[cid].cellType = pf->particles[pf->get_particles_per_cell().at(cid)[0]].sv.celltype;
     info_per_cell[cid].bbox = bbox;    
@@ -27,6 +27,7 @@ along with this program.  If not, see <http://www.gnu.org/licenses/>.
 #include "hemocell.h"
 #include "hemoCellFunctional.h"
 #include "array.h"
+#include "cellShape.h"
 
 /* THIS CLASS IS NOT THREAD SAFE!*/
 /* Calculate and store Cell-Specific Information
@@ -46,7 +47,9 @@ struct CellInformation {
   hemo::Array<T,3> velocity = {};
   T volume = 0;
   T area = 0;
-  T stretch = 0;
+  T stretch = 0; //Largest distance between two vertices (CellShape::diameter)
+  hemo::Array<T,3> shapeLengths = {}; //Extent along the principal axes, longest first
+  T deformationIndex = 0;
   hemo::Array<T,6> bbox = {};
   pluint blockId = UINTMAX_MAX;
   pluint cellType = UINTMAX_MAX;
@@ -104,7 +107,7 @@ public:
   // Legacy interface, should become private at some point.
   static map<int,CellInformation> info_per_cell;
   static void clear_list();
-  static void calculate_vol_pos_area(HemoCell *); /*This excludes Stretch, since it is compute intensive!*/
+  static void calculate_vol_pos_area(HemoCell *);
   static void calculateCellVolume(HemoCell *);
   static void calculateCellArea(HemoCell *);
   static void calculateCellPosition(HemoCell *);
@@ -0,0 +1,176 @@
+/*
+This file is part of the HemoCell library
+
+HemoCell is developed and maintained by the Computational Science Lab 
+in the University of Amsterdam. Any questions or remarks regarding this library 
+can be sent to: info@hemocell.eu
+
+When using the HemoCell library in scientific work please cite the
+corresponding paper: https://doi.org/10.3389/fphys.2017.00563
+
+The HemoCell library is free software: you can redistribute it and/or
+modify it under the terms of the GNU Affero General Public License as
+published by the Free Software Foundation, either version 3 of the
+License, or (at your option) any later version.
+
+The library is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU Affero General Public License for more details.
+
+You should have received a copy of the GNU Affero General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+#include "cellShape.h"
+
+#include <algorithm>
+#include <cmath>
+#include <Eigen3/Eigenvalues>
+
+namespace hemo {
+using namespace std;
+
+namespace {
+  const T S3 = 0.57735026918962576451;
+  /// Coordinate axes, face diagonals and body diagonals
+  const T fixedDirections[13][3] = {
+    {1,0,0},{0,1,0},{0,0,1},
+    {M_SQRT1_2,M_SQRT1_2,0},{M_SQRT1_2,-M_SQRT1_2,0},{M_SQRT1_2,0,M_SQRT1_2},
+    {M_SQRT1_2,0,-M_SQRT1_2},{0,M_SQRT1_2,M_SQRT1_2},{0,M_SQRT1_2,-M_SQRT1_2},
+    {S3,S3,S3},{S3,S3,-S3},{S3,-S3,S3},{-S3,S3,S3}};
+
+  inline T distance2(hemo::Array<T,3> const & a, hemo::Array<T,3> const & b) {
+    const T dx = a[0]-b[0], dy = a[1]-b[1], dz = a[2]-b[2];
+    return dx*dx + dy*dy + dz*dz;
+  }
+
+  /// Index of the vertex farthest from vertices[from]
+  unsigned int farthest(std::vector<hemo::Array<T,3>> const & vertices, unsigned int from, T & best) {
+    unsigned int index = from;
+    best = 0.;
+    for (unsigned int i = 0 ; i < vertices.size() ; i++) {
+      const T d = distance2(vertices[from],vertices[i]);
+      if (d > best) {
+        best = d;
+        index = i;
+      }
+    }
+    return index;
+  }
+}
+
+CellShape computeCellShape(std::vector<hemo::Array<T,3>> const & vertices) {
+  CellShape shape;
+  const unsigned int n = vertices.size();
+  if (n < 2) { return shape; }
+
+  //Covariance of the vertices around their centroid
+  hemo::Array<T,3> center = {0.,0.,0.};
+  for (hemo::Array<T,3> const & vertex : vertices) {
+    center += vertex;
+  }
+  center /= T(n);
+  Eigen::Matrix<T,3,3> covariance = Eigen::Matrix<T,3,3>::Zero();
+  for (hemo::Array<T,3> const & vertex : vertices) {
+    const hemo::Array<T,3> r = vertex - center;
+    for (int a = 0 ; a < 3 ; a++) {
+      for (int b = 0 ; b < 3 ; b++) {
+        covariance(a,b) += r[a]*r[b];
+      }
+    }
+  }
+  //Eigenvalues in increasing order, the principal axes are its columns
+  Eigen::SelfAdjointEigenSolver<Eigen::Matrix<T,3,3>> es(covariance);
+  hemo::Array<hemo::Array<T,3>,3> axes;
+  for (int d = 0 ; d < 3 ; d++) {
+    for (int k = 0 ; k < 3 ; k++) {
+      axes[d][k] = es.eigenvectors()(k,2-d);
+    }
+  }
+
+  //Extreme vertices along the principal axes and the fixed directions, in one pass
+  const unsigned int nDirections = 16;
+  T directions[nDirections][3];
+  for (unsigned int d = 0 ; d < 3 ; d++) {
+    for (unsigned int k = 0 ; k < 3 ; k++) {
+      directions[d][k] = axes[d][k];
+    }
+  }
+  for (unsigned int d = 3 ; d < nDirections ; d++) {
+    for (unsigned int k = 0 ; k < 3 ; k++) {
+      directions[d][k] = fixedDirections[d-3][k];
+    }
+  }
+  T lowest[nDirections], highest[nDirections];
+  unsigned int lowestAt[nDirections], highestAt[nDirections];
+  for (unsigned int d = 0 ; d < nDirections ; d++) {
+    lowest[d] = highest[d] = directions[d][0]*vertices[0][0] + directions[d][1]*vertices[0][1] + directions[d][2]*vertices[0][2];
+    lowestAt[d] = highestAt[d] = 0;
+  }
+  for (unsigned int i = 1 ; i < n ; i++) {
+    hemo::Array<T,3> const & vertex = vertices[i];
+    for (unsigned int d = 0 ; d < nDirections ; d++) {
+      const T projection = directions[d][0]*vertex[0] + directions[d][1]*vertex[1] + directions[d][2]*vertex[2];
+      if (projection < lowest[d]) {
+        lowest[d] = projection;
+        lowestAt[d] = i;
+      }
+      if (projection > highest[d]) {
+        highest[d] = projection;
+        highestAt[d] = i;
+      }
+    }
+  }
+
+  for (unsigned int d = 0 ; d < 3 ; d++) {
+    shape.lengths[d] = highest[d] - lowest[d];
+  }
+  //The eigenvalues order the axes by spread, the extents can order differently for odd shapes
+  unsigned int order[3] = {0,1,2};
+  sort(order,order+3,[&shape](unsigned int a, unsigned int b) { return shape.lengths[a] > shape.lengths[b]; });
+  const hemo::Array<T,3> lengths = shape.lengths;
+  for (unsigned int d = 0 ; d < 3 ; d++) {
+    shape.lengths[d] = lengths[order[d]];
+  }
+  shape.majorAxis = axes[order[0]];
+  const T L = shape.lengths[0], B = shape.lengths[1], S = shape.lengths[2];
+  shape.deformationIndex = L + B > 0. ? (L-B)/(L+B) : 0.;
+  shape.elongation = L + S > 0. ? (L-S)/(L+S) : 0.;
+
+  //Best pair of the candidates, then farthest-point sweeps from it
+  std::vector<unsigned int> candidates(lowestAt,lowestAt+nDirections);
+  candidates.insert(candidates.end(),highestAt,highestAt+nDirections);
+  sort(candidates.begin(),candidates.end());
+  candidates.erase(unique(candidates.begin(),candidates.end()),candidates.end());
+  T best = 0.;
+  unsigned int from = candidates[0], to = candidates[0];
+  for (unsigned int i = 0 ; i < candidates.size() ; i++) {
+    for (unsigned int j = i + 1 ; j < candidates.size() ; j++) {
+      const T d = distance2(vertices[candidates[i]],vertices[candidates[j]]);
+      if (d > best) {
+        best = d;
+        from = candidates[i];
+        to = candidates[j];
+      }
+    }
+  }
+  bool improved = true;
+  for (int sweep = 0 ; sweep < 4 && improved ; sweep++) {
+    improved = false;
+    for (const unsigned int end : {to,from}) {
+      T d;
+      const unsigned int next = farthest(vertices,end,d);
+      if (d > best) {
+        best = d;
+        from = end;
+        to = next;
+        improved = true;
+        break;
+      }
+    }
+  }
+  shape.diameter = sqrt(best);
+  return shape;
+}
+
+}
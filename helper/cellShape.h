@@ -0,0 +1,61 @@
+/*
+This file is part of the HemoCell library
+
+HemoCell is developed and maintained by the Computational Science Lab 
+in the University of Amsterdam. Any questions or remarks regarding this library 
+can be sent to: info@hemocell.eu
+
+When using the HemoCell library in scientific work please cite the
+corresponding paper: https://doi.org/10.3389/fphys.2017.00563
+
+The HemoCell library is free software: you can redistribute it and/or
+modify it under the terms of the GNU Affero General Public License as
+published by the Free Software Foundation, either version 3 of the
+License, or (at your option) any later version.
+
+The library is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU Affero General Public License for more details.
+
+You should have received a copy of the GNU Affero General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+#ifndef HEMO_CELLSHAPE_H
+#define HEMO_CELLSHAPE_H
+
+#include <vector>
+
+#include "array.h"
+
+namespace hemo {
+
+/**
+ * Shape descriptors of a cell, computed from its vertices in O(n).
+ *
+ * The principal axes are the eigenvectors of the covariance (inertia) tensor of
+ * the vertices, the lengths are the extent of the vertices along them. The
+ * diameter approximates the largest distance between two vertices from below:
+ * the farthest pair of the extreme vertices along the principal axes and 13
+ * fixed directions, improved with at most four farthest-point sweeps. One of
+ * the fixed directions is within 27.6 degrees of the true diameter, so the
+ * result is at least 0.886 times it, and it is exact when the diameter lies
+ * along a principal axis, as for (deformed) ellipsoidal cells.
+ */
+struct CellShape {
+  /// Extent of the cell along its principal axes, longest first [lu]
+  hemo::Array<T,3> lengths = {0.,0.,0.};
+  /// Unit vector along the longest principal axis
+  hemo::Array<T,3> majorAxis = {0.,0.,0.};
+  /// Largest distance between two vertices, bounded approximation [lu]
+  T diameter = 0.;
+  /// Taylor deformation index (L-B)/(L+B) of the two longest principal lengths
+  T deformationIndex = 0.;
+  /// (L-S)/(L+S) of the longest and shortest principal length
+  T elongation = 0.;
+};
+
+CellShape computeCellShape(std::vector<hemo::Array<T,3>> const & vertices);
+
+}
+#endif
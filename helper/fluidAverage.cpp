@@ -0,0 +1,255 @@
+/*
+This file is part of the HemoCell library
+
+HemoCell is developed and maintained by the Computational Science Lab 
+in the University of Amsterdam. Any questions or remarks regarding this library 
+can be sent to: info@hemocell.eu
+
+When using the HemoCell library in scientific work please cite the
+corresponding paper: https://doi.org/10.3389/fphys.2017.00563
+
+The HemoCell library is free software: you can redistribute it and/or
+modify it under the terms of the GNU Affero General Public License as
+published by the Free Software Foundation, either version 3 of the
+License, or (at your option) any later version.
+
+The library is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU Affero General Public License for more details.
+
+You should have received a copy of the GNU Affero General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+#include "fluidAverage.h"
+#include "hemocell.h"
+#include "FluidHdf5IO.h"
+#include "AsyncHdf5IO.h"
+#include "palabos3D.h"
+#include "palabos3D.hh"
+
+namespace hemo {
+
+FluidAverage::FluidAverage(HemoCellFields & cellFields_, vector<int> const & variables_, unsigned int interval_, unsigned int window_) :
+  variables(variables_), interval(interval_), window(window_), cellFields(cellFields_)
+{
+  if (interval == 0 || window == 0) {
+    hlog << "(FluidAverage) Error, the interval and window must be at least 1 iteration" << endl;
+    exit(1);
+  }
+  if (window % interval) {
+    hlog << "(FluidAverage) WARNING the window (" << window << ") is not a multiple of the interval (" << interval << "), windows differ in their number of samples" << endl;
+  }
+  for (int variable : variables) {
+    if (!components(variable)) {
+      hlog << "(FluidAverage) Error, output variable " << variable << " cannot be averaged, use OUTPUT_VELOCITY, OUTPUT_FORCE, OUTPUT_DENSITY, OUTPUT_SHEAR_STRESS or OUTPUT_SHEAR_RATE" << endl;
+      exit(1);
+    }
+    nValues += nStatistics*components(variable);
+  }
+}
+
+FluidAverage::~FluidAverage() {
+  if (field) {
+    delete field;
+  }
+}
+
+unsigned int FluidAverage::components(int variable) {
+  switch(variable) {
+    case OUTPUT_VELOCITY:
+    case OUTPUT_FORCE:
+      return 3;
+    case OUTPUT_DENSITY:
+      return 1;
+    case OUTPUT_SHEAR_STRESS:
+      return 6;
+    case OUTPUT_SHEAR_RATE:
+      return 9;
+    default:
+      return 0;
+  }
+}
+
+void FluidAverage::create() {
+  if (field) {
+    delete field;
+  }
+  //Same blocks and envelope as the fluid, so the output can read both with the same coordinates
+  field = new plb::MultiNTensorField3D<T>(nValues,
+              MultiBlockManagement3D (
+                *cellFields.lattice->getSparseBlockStructure().clone(),
+                cellFields.lattice->getMultiBlockManagement().getThreadAttribution().clone(),
+                cellFields.lattice->getMultiBlockManagement().getEnvelopeWidth(),
+                cellFields.lattice->getMultiBlockManagement().getRefinementLevel()),
+                defaultMultiBlockPolicy3D().getBlockCommunicator(),
+                defaultMultiBlockPolicy3D().getCombinedStatistics(),
+                defaultMultiBlockPolicy3D().getMultiNTensorAccess<T>());
+  field->periodicity().toggle(0,cellFields.lattice->periodicity().get(0));
+  field->periodicity().toggle(1,cellFields.lattice->periodicity().get(1));
+  field->periodicity().toggle(2,cellFields.lattice->periodicity().get(2));
+  reset();
+}
+
+void FluidAverage::reset() {
+  vector<MultiBlock3D*> wrapper;
+  wrapper.push_back(field);
+  applyProcessingFunctional(new Reset(),field->getBoundingBox(),wrapper);
+}
+
+void FluidAverage::update() {
+  global.statistics.getCurrent()["fluidAverage"].start();
+  if (!field) {
+    create();
+  }
+  vector<MultiBlock3D*> wrapper;
+  wrapper.push_back(cellFields.lattice);
+  wrapper.push_back(field);
+  applyProcessingFunctional(new Update(variables),cellFields.lattice->getBoundingBox(),wrapper);
+  global.statistics.getCurrent().stop();
+}
+
+void FluidAverage::write(plint iter) {
+  if (!field) {
+    create();
+  }
+  if (global::mpi().isMainProcessor() && global.hdf5OutputLayout != Hdf5OutputLayout::TimeSeries) {
+    string folder = global::directories().getOutputDir() + "/hdf5/" + zeroPadNumber(iter);
+    mkpath(folder.c_str(), 0777);
+  }
+  global::mpi().barrier();
+  hlog << "(FluidAverage) Writing the fluid statistics of the window ending at timestep " << iter << endl;
+  writeFluidAverage_HDF5(cellFields,*this,param::dx,param::dt,iter);
+  //The window can end between two outputs, hand the files to the I/O thread now
+  if (cellFields.hemocell.asyncOutput) {
+    cellFields.hemocell.asyncOutput->submit();
+  }
+  reset();
+}
+
+void FluidAverage::checkpoint() {
+  if (!field) {
+    create();
+  }
+  std::string & outDir = hemo::global.checkpointDirectory;
+  mkpath(outDir.c_str(), 0777);
+
+  if (global::mpi().isMainProcessor()) {
+    renameFileToDotOld(outDir + "fluidAverage.dat");
+    renameFileToDotOld(outDir + "fluidAverage.plb");
+  }
+
+  plb::parallelIO::save(*field, outDir + "fluidAverage", true);
+}
+
+void FluidAverage::restore() {
+  create();
+  std::string & outDir = hemo::global.checkpointDirectory;
+  if(!(file_exists(outDir + "fluidAverage.dat") && file_exists(outDir + "fluidAverage.plb"))) {
+    hlog << "(FluidAverage) No fluid statistics in the checkpoint, starting a new window" << endl;
+    return;
+  }
+  plb::parallelIO::load(outDir + "fluidAverage",*field,true);
+}
+
+void FluidAverage::release() {
+  if (field) {
+    delete field;
+    field = 0;
+  }
+}
+
+/// Fold x into mean, M2, min and max of the n-th sample
+static inline void welford(T * s, T x, T n) {
+  const T delta = x - s[0];
+  s[0] += delta/n;
+  s[1] += delta*(x - s[0]);
+  s[2] = n > 1 ? std::min(s[2],x) : x;
+  s[3] = n > 1 ? std::max(s[3],x) : x;
+}
+
+void FluidAverage::Update::processGenericBlocks(Box3D domain, std::vector<AtomicBlock3D*> blocks) {
+  BlockLattice3D<T,DESCRIPTOR>* ff = dynamic_cast<BlockLattice3D<T,DESCRIPTOR>*>(blocks[0]);
+  NTensorField3D<T>* nt = dynamic_cast<NTensorField3D<T>*>(blocks[1]);
+  const Dot3D offset = computeRelativeDisplacement(*ff,*nt);
+
+  plb::Array<T,3> vel, velp, veln;
+  plb::Array<T,6> stress;
+  T value[9];
+  for (plint iX=domain.x0; iX<=domain.x1; ++iX) {
+    for (plint iY=domain.y0; iY<=domain.y1; ++iY) {
+      for (plint iZ=domain.z0; iZ<=domain.z1; ++iZ) {
+        Cell<T,DESCRIPTOR> & cell = ff->get(iX,iY,iZ);
+        if (cell.getDynamics().isBoundary()) { continue ; }
+
+        T * s = nt->get(iX+offset.x,iY+offset.y,iZ+offset.z);
+        const T n = ++s[0];
+        s++;
+        for (int variable : variables) {
+          switch(variable) {
+            case OUTPUT_VELOCITY:
+              cell.computeVelocity(vel);
+              value[0] = vel[0];
+              value[1] = vel[1];
+              value[2] = vel[2];
+              break;
+            case OUTPUT_FORCE:
+              value[0] = cell.external.data[0];
+              value[1] = cell.external.data[1];
+              value[2] = cell.external.data[2];
+              break;
+            case OUTPUT_DENSITY:
+              value[0] = cell.computeDensity();
+              break;
+            case OUTPUT_SHEAR_STRESS:
+              cell.computeShearStress(stress);
+              for (int i = 0 ; i < 6 ; i++) {
+                value[i] = stress[i];
+              }
+              break;
+            case OUTPUT_SHEAR_RATE:
+              //Central differences, as in the fluid output
+              for (int dir = 0 ; dir < 3 ; dir++) {
+                ff->get(iX+(dir==0),iY+(dir==1),iZ+(dir==2)).computeVelocity(velp);
+                ff->get(iX-(dir==0),iY-(dir==1),iZ-(dir==2)).computeVelocity(veln);
+                for (int c = 0 ; c < 3 ; c++) {
+                  value[3*c+dir] = (velp[c]-veln[c])/2;
+                }
+              }
+              break;
+          }
+          for (unsigned int c = 0 ; c < components(variable) ; c++) {
+            welford(s,value[c],n);
+            s += nStatistics;
+          }
+        }
+      }
+    }
+  }
+}
+
+void FluidAverage::Update::getTypeOfModification(std::vector<plb::modif::ModifT>& modified) const {
+  modified[0] = plb::modif::nothing;
+  modified[1] = plb::modif::staticVariables; //Fills the envelope, which the output reads as well
+}
+
+void FluidAverage::Reset::processGenericBlocks(Box3D domain, std::vector<AtomicBlock3D*> blocks) {
+  NTensorField3D<T>* nt = dynamic_cast<NTensorField3D<T>*>(blocks[0]);
+  for (plint iX=domain.x0; iX<=domain.x1; ++iX) {
+    for (plint iY=domain.y0; iY<=domain.y1; ++iY) {
+      for (plint iZ=domain.z0; iZ<=domain.z1; ++iZ) {
+        T * s = nt->get(iX,iY,iZ);
+        std::fill(s,s+nt->getNdim(),T());
+      }
+    }
+  }
+}
+
+void FluidAverage::Reset::getTypeOfModification(std::vector<plb::modif::ModifT>& modified) const {
+  modified[0] = plb::modif::staticVariables;
+}
+
+FluidAverage::Update * FluidAverage::Update::clone() const { return new FluidAverage::Update(*this); }
+FluidAverage::Reset * FluidAverage::Reset::clone() const { return new FluidAverage::Reset(*this); }
+
+}
@@ -0,0 +1,99 @@
+/*
+This file is part of the HemoCell library
+
+HemoCell is developed and maintained by the Computational Science Lab 
+in the University of Amsterdam. Any questions or remarks regarding this library 
+can be sent to: info@hemocell.eu
+
+When using the HemoCell library in scientific work please cite the
+corresponding paper: https://doi.org/10.3389/fphys.2017.00563
+
+The HemoCell library is free software: you can redistribute it and/or
+modify it under the terms of the GNU Affero General Public License as
+published by the Free Software Foundation, either version 3 of the
+License, or (at your option) any later version.
+
+The library is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU Affero General Public License for more details.
+
+You should have received a copy of the GNU Affero General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+#ifndef HEMO_FLUID_AVERAGE_H
+#define HEMO_FLUID_AVERAGE_H
+
+#include "hemoCellFields.h"
+#include "hemoCellFunctional.h"
+#include "multiBlock/multiDataField3D.h"
+
+namespace hemo {
+
+/* Running statistics of fluid variables (HemoCell::setFluidAverages)
+ *
+ * Every interval iterations the selected variables are sampled in one pass
+ * over the fluid and folded into a running mean, variance (Welford), minimum
+ * and maximum per node. The statistics live in an n-tensor field with the
+ * same blocks as the fluid, per node:
+ *
+ *   [samples, (mean, M2, min, max) for every component of every variable]
+ *
+ * At the end of every window they are written to FluidAverage files
+ * (<Name>_mean, _std, _min, _max) and reset, they are saved with checkpoints
+ * so a window continues after a restart or restructure.
+ */
+class FluidAverage {
+public:
+  FluidAverage(HemoCellFields & cellFields, vector<int> const & variables, unsigned int interval, unsigned int window);
+  ~FluidAverage();
+
+  /// Number of components of a variable that can be averaged, 0 if it cannot
+  static unsigned int components(int variable);
+
+  /// Fold the current fluid state into the statistics
+  void update();
+  /// Write the statistics of the window ending at iter and start a new window
+  void write(plint iter);
+
+  void checkpoint();
+  /// Recreate the statistics on the current blocks, from the checkpoint when there is one
+  void restore();
+  /// Free the statistics when the fluid blocks are replaced (load balancing), restore() recreates them
+  void release();
+
+  vector<int> variables;
+  unsigned int interval;
+  unsigned int window;
+  /// Created on the fluid blocks when first used
+  plb::MultiNTensorField3D<T> * field = 0;
+  /// Statistics stored per component
+  static const unsigned int nStatistics = 4;
+
+private:
+  HemoCellFields & cellFields;
+  /// Values per node, the sample count and nStatistics for every component
+  plint nValues = 1;
+
+  void create();
+  void reset();
+
+  class Update : public HemoCellFunctional {
+    vector<int> variables;
+  public:
+    Update(vector<int> const & variables_) : variables(variables_) {}
+    void processGenericBlocks(plb::Box3D, std::vector<plb::AtomicBlock3D*>);
+    void getTypeOfModification(std::vector<plb::modif::ModifT>& modified) const;
+    Update * clone() const;
+  };
+  class Reset : public HemoCellFunctional {
+  public:
+    void processGenericBlocks(plb::Box3D, std::vector<plb::AtomicBlock3D*>);
+    void getTypeOfModification(std::vector<plb::modif::ModifT>& modified) const;
+    plb::BlockDomain::DomainT appliesTo() const { return plb::BlockDomain::bulkAndEnvelope; }
+    Reset * clone() const;
+  };
+};
+
+}
+#endif
@@ -0,0 +1,210 @@
+/*
+This file is part of the HemoCell library
+
+HemoCell is developed and maintained by the Computational Science Lab 
+in the University of Amsterdam. Any questions or remarks regarding this library 
+can be sent to: info@hemocell.eu
+
+When using the HemoCell library in scientific work please cite the
+corresponding paper: https://doi.org/10.3389/fphys.2017.00563
+
+The HemoCell library is free software: you can redistribute it and/or
+modify it under the terms of the GNU Affero General Public License as
+published by the Free Software Foundation, either version 3 of the
+License, or (at your option) any later version.
+
+The library is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU Affero General Public License for more details.
+
+You should have received a copy of the GNU Affero General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+#include "fluidDecomposition.h"
+#include "spaceFillingCurve.h"
+#include "logfile.h"
+
+#include "palabos3D.h"
+#include "palabos3D.hh"
+
+#include <algorithm>
+
+namespace hemo {
+  using namespace std;
+  using namespace plb;
+
+// ----------------------- Count fluid nodes ------------------------------------
+void CountFluidNodesInBoxes::process(Box3D domain, ScalarField3D<int> &field1) {
+  const Dot3D location = field1.getLocation();
+  const Box3D absDomain = domain.shift(location.x, location.y, location.z);
+
+  for (unsigned int b = 0 ; b < boxes.size() ; b++) {
+    Box3D overlap;
+    if (!intersect(absDomain, boxes[b].enlarge(1), overlap)) {
+      continue;
+    }
+    for (plint iX = overlap.x0; iX <= overlap.x1; ++iX) {
+      for (plint iY = overlap.y0; iY <= overlap.y1; ++iY) {
+        for (plint iZ = overlap.z0; iZ <= overlap.z1; ++iZ) {
+          if (field1.get(iX - location.x, iY - location.y, iZ - location.z) == 0) {
+            continue;
+          }
+          enlarged[b]++;
+          if (contained(iX, iY, iZ, boxes[b])) {
+            inside[b]++;
+          }
+        }
+      }
+    }
+  }
+}
+
+CountFluidNodesInBoxes *CountFluidNodesInBoxes::clone() const {
+  return new CountFluidNodesInBoxes(*this);
+}
+
+void CountFluidNodesInBoxes::getTypeOfModification(std::vector<modif::ModifT> &modified) const {
+  modified[0] = modif::nothing;
+}
+
+BlockDomain::DomainT CountFluidNodesInBoxes::appliesTo() const {
+  return BlockDomain::bulk;
+}
+
+// ----------------------- Decomposition ----------------------------------------
+namespace {
+void countFluidNodes(MultiScalarField3D<int> & flagMatrix, const vector<Box3D> & boxes,
+                     vector<long> & inside, vector<long> & enlarged) {
+  inside.assign(boxes.size(), 0);
+  enlarged.assign(boxes.size(), 0);
+  applyProcessingFunctional(new CountFluidNodesInBoxes(boxes, inside, enlarged),
+                            flagMatrix.getBoundingBox(), flagMatrix);
+  if (boxes.empty()) {
+    return;
+  }
+  MPI_Allreduce(MPI_IN_PLACE, &inside[0], inside.size(), MPI_LONG, MPI_SUM, MPI_COMM_WORLD);
+  MPI_Allreduce(MPI_IN_PLACE, &enlarged[0], enlarged.size(), MPI_LONG, MPI_SUM, MPI_COMM_WORLD);
+}
+
+bool canSplit(const Box3D & box, plint minBlockSize) {
+  plint longest = max(box.getNx(), max(box.getNy(), box.getNz()));
+  return longest/2 >= minBlockSize;
+}
+
+//Split a box in two halves perpendicular to its longest axis
+void splitBox(const Box3D & box, vector<Box3D> & result) {
+  Box3D left = box;
+  Box3D right = box;
+  if (box.getNx() >= box.getNy() && box.getNx() >= box.getNz()) {
+    left.x1 = box.x0 + box.getNx()/2 - 1;
+    right.x0 = left.x1 + 1;
+  } else if (box.getNy() >= box.getNz()) {
+    left.y1 = box.y0 + box.getNy()/2 - 1;
+    right.y0 = left.y1 + 1;
+  } else {
+    left.z1 = box.z0 + box.getNz()/2 - 1;
+    right.z0 = left.z1 + 1;
+  }
+  result.push_back(left);
+  result.push_back(right);
+}
+}
+
+SparseBlockStructure3D fluidWeightedDecomposition(MultiScalarField3D<int> & flagMatrix,
+                                                  SparseBlockStructure3D const & structure,
+                                                  plint nParts, plint minBlockSize,
+                                                  map<plint,plint> & blockToPart) {
+  vector<Box3D> boxes;
+  for (auto const & pair : structure.getBulks()) {
+    boxes.push_back(pair.second);
+  }
+  const unsigned int nOriginal = boxes.size();
+
+  vector<long> inside, enlarged;
+  vector<long> weights;
+  long total = 0;
+  const int maxRounds = 32;
+  for (int round = 0 ; ; round++) {
+    countFluidNodes(flagMatrix, boxes, inside, enlarged);
+
+    //Blocks without fluid and without any fluid neighbour are not needed at all
+    vector<Box3D> kept;
+    weights.clear();
+    total = 0;
+    for (unsigned int i = 0 ; i < boxes.size() ; i++) {
+      if (enlarged[i] == 0) {
+        continue;
+      }
+      kept.push_back(boxes[i]);
+      weights.push_back(inside[i]);
+      total += inside[i];
+    }
+    boxes.swap(kept);
+    if (round == maxRounds) {
+      break;
+    }
+
+    //Split blocks that are heavier than the share of a single part, and keep
+    //splitting the heaviest ones while there are fewer blocks than parts
+    const double target = double(total)/nParts;
+    vector<bool> split(boxes.size(), false);
+    plint nBlocks = boxes.size();
+    for (unsigned int i = 0 ; i < boxes.size() ; i++) {
+      if (weights[i] > target && canSplit(boxes[i], minBlockSize)) {
+        split[i] = true;
+        nBlocks++;
+      }
+    }
+    if (nBlocks < nParts) {
+      vector<unsigned int> order(boxes.size());
+      for (unsigned int i = 0 ; i < order.size() ; i++) {
+        order[i] = i;
+      }
+      stable_sort(order.begin(), order.end(), [&weights](unsigned int a, unsigned int b) {
+        return weights[a] > weights[b];
+      });
+      for (unsigned int i = 0 ; i < order.size() && nBlocks < nParts ; i++) {
+        if (!split[order[i]] && canSplit(boxes[order[i]], minBlockSize)) {
+          split[order[i]] = true;
+          nBlocks++;
+        }
+      }
+    }
+    if (nBlocks == (plint)boxes.size()) {
+      break;
+    }
+
+    vector<Box3D> newBoxes;
+    for (unsigned int i = 0 ; i < boxes.size() ; i++) {
+      if (split[i]) {
+        splitBox(boxes[i], newBoxes);
+      } else {
+        newBoxes.push_back(boxes[i]);
+      }
+    }
+    boxes.swap(newBoxes);
+  }
+
+  map<plint,Box3D> bulks;
+  map<plint,double> blockWeights;
+  SparseBlockStructure3D result(structure.getBoundingBox());
+  for (unsigned int i = 0 ; i < boxes.size() ; i++) {
+    bulks[i] = boxes[i];
+    blockWeights[i] = weights[i];
+    result.addBlock(boxes[i], i);
+  }
+  blockToPart = partitionBlocksHilbert(bulks, blockWeights, nParts);
+
+  vector<double> partWeights(nParts, 0.);
+  for (auto const & pair : blockToPart) {
+    partWeights[pair.second] += blockWeights[pair.first];
+  }
+  const double maxWeight = *max_element(partWeights.begin(), partWeights.end());
+  hlog << "(FluidDecomposition) " << nOriginal << " atomic blocks became " << boxes.size()
+       << " fluid blocks with " << total << " fluid nodes, fluid node imbalance over " << nParts
+       << " parts: " << (total > 0 ? maxWeight/(double(total)/nParts) - 1. : 0.) << endl;
+
+  return result;
+}
+}
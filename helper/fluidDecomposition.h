@@ -0,0 +1,74 @@
+/*
+This file is part of the HemoCell library
+
+HemoCell is developed and maintained by the Computational Science Lab 
+in the University of Amsterdam. Any questions or remarks regarding this library 
+can be sent to: info@hemocell.eu
+
+When using the HemoCell library in scientific work please cite the
+corresponding paper: https://doi.org/10.3389/fphys.2017.00563
+
+The HemoCell library is free software: you can redistribute it and/or
+modify it under the terms of the GNU Affero General Public License as
+published by the Free Software Foundation, either version 3 of the
+License, or (at your option) any later version.
+
+The library is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU Affero General Public License for more details.
+
+You should have received a copy of the GNU Affero General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+#ifndef HEMO_FLUIDDECOMPOSITION_H
+#define HEMO_FLUIDDECOMPOSITION_H
+
+#include "atomicBlock/dataProcessingFunctional3D.h"
+#include "multiBlock/multiDataField3D.h"
+#include "multiBlock/sparseBlockStructure3D.h"
+
+#include <map>
+#include <vector>
+
+namespace hemo {
+/**
+ * Counts the number of fluid nodes (flag != 0) of a flag matrix in a list of
+ * boxes, both in the box itself and in the box enlarged by one node. The counts
+ * are only local, they must be summed over all processes afterwards.
+ */
+class CountFluidNodesInBoxes : public plb::BoxProcessingFunctional3D_S<int> {
+public:
+    CountFluidNodesInBoxes(const std::vector<plb::Box3D> & boxes_, std::vector<long> & inside_, std::vector<long> & enlarged_)
+      : boxes(boxes_), inside(inside_), enlarged(enlarged_) { };
+
+    virtual void process(plb::Box3D domain, plb::ScalarField3D<int> &field1);
+
+    virtual CountFluidNodesInBoxes *clone() const;
+
+    virtual void getTypeOfModification(std::vector<plb::modif::ModifT> &modified) const;
+
+    virtual plb::BlockDomain::DomainT appliesTo() const;
+
+private:
+    const std::vector<plb::Box3D> & boxes;
+    std::vector<long> & inside;
+    std::vector<long> & enlarged;
+};
+
+/**
+ * Remove all blocks from structure that contain no fluid nodes (nor border
+ * nodes next to fluid), split blocks that hold more fluid nodes than a single
+ * part should, and distribute the remaining blocks over nParts parts along a
+ * Hilbert curve, weighted by their number of fluid nodes.
+ *
+ * Blocks are never split into halves smaller than minBlockSize. The
+ * assignment of the returned blocks to parts [0,nParts) is stored in
+ * blockToPart. This function is collective over all mpi processes.
+ */
+plb::SparseBlockStructure3D fluidWeightedDecomposition(plb::MultiScalarField3D<int> & flagMatrix,
+                                                       plb::SparseBlockStructure3D const & structure,
+                                                       plb::plint nParts, plb::plint minBlockSize,
+                                                       std::map<plb::plint,plb::plint> & blockToPart);
+}
+#endif
@@ -23,56 +23,26 @@ along with this program.  If not, see <http://www.gnu.org/licenses/>.
 */
 #include "interiorViscosity.h"
 #include "hemocell.h"
+#include "logfile.h"
 #include "palabos3D.h"
 #include "palabos3D.hh"
 
 namespace hemo {
   InteriorViscosityHelper::InteriorViscosityHelper(HemoCellFields & cellFields_) : cellFields(cellFields_) {
-    //Create viscosity field with same properties as fluid field underlying the particleField.
-    if(cellFields.hemocell.preInlet){
-      preinlet_multiInteriorViscosityField = new plb::MultiScalarField3D<T>(
-            MultiBlockManagement3D (
-                *cellFields.hemocell.preinlet_lattice->getSparseBlockStructure().clone(),
-                cellFields.hemocell.preinlet_lattice->getMultiBlockManagement().getThreadAttribution().clone(),
-                cellFields.hemocell.preinlet_lattice->getMultiBlockManagement().getEnvelopeWidth(),
-                cellFields.hemocell.preinlet_lattice->getMultiBlockManagement().getRefinementLevel()),
-                defaultMultiBlockPolicy3D().getBlockCommunicator(),                
-                defaultMultiBlockPolicy3D().getCombinedStatistics(),
-                defaultMultiBlockPolicy3D().getMultiScalarAccess<T>(),
-                0);
-      preinlet_multiInteriorViscosityField->periodicity().toggle(0,cellFields.hemocell.preinlet_lattice->periodicity().get(0));
-      preinlet_multiInteriorViscosityField->periodicity().toggle(1,cellFields.hemocell.preinlet_lattice->periodicity().get(1));
-      preinlet_multiInteriorViscosityField->periodicity().toggle(2,cellFields.hemocell.preinlet_lattice->periodicity().get(2));
-
-      preinlet_multiInteriorViscosityField->initialize();
-      
-      //Make sure each particleField has access to its local scalarField
-      for (const plint & bId : preinlet_multiInteriorViscosityField->getLocalInfo().getBlocks()) {
-        HemoCellParticleField & pf = cellFields.preinlet_immersedParticles->getComponent(bId);
-        pf.interiorViscosityField = &preinlet_multiInteriorViscosityField->getComponent(bId);
-      }
+    if (cellFields.size() > 254) {
+      hlog << "(InteriorViscosity) Error the tau classes are stored in one byte, at most 254 cell types are supported, exiting ..." << endl;
+      exit(1);
+    }
+    //Class 0 keeps the fluid viscosity, class ctype+1 the interior viscosity of that type
+    omegas.push_back(1.0/param::tau);
+    for (unsigned int ctype = 0 ; ctype < cellFields.size() ; ctype++) {
+      omegas.push_back(1.0/cellFields[ctype]->interiorViscosityTau);
     }
-    domain_multiInteriorViscosityField = new plb::MultiScalarField3D<T>(
-            MultiBlockManagement3D (
-                *cellFields.hemocell.domain_lattice->getSparseBlockStructure().clone(),
-                cellFields.hemocell.domain_lattice->getMultiBlockManagement().getThreadAttribution().clone(),
-                cellFields.hemocell.domain_lattice->getMultiBlockManagement().getEnvelopeWidth(),
-                cellFields.hemocell.domain_lattice->getMultiBlockManagement().getRefinementLevel()),
-                defaultMultiBlockPolicy3D().getBlockCommunicator(),                
-                defaultMultiBlockPolicy3D().getCombinedStatistics(),
-                defaultMultiBlockPolicy3D().getMultiScalarAccess<T>(),
-                0);
-    domain_multiInteriorViscosityField->periodicity().toggle(0,cellFields.hemocell.domain_lattice->periodicity().get(0));
-    domain_multiInteriorViscosityField->periodicity().toggle(1,cellFields.hemocell.domain_lattice->periodicity().get(1));
-    domain_multiInteriorViscosityField->periodicity().toggle(2,cellFields.hemocell.domain_lattice->periodicity().get(2));
 
-    domain_multiInteriorViscosityField->initialize();
-    
-    //Make sure each particleField has access to its local scalarField
-    for (const plint & bId : domain_multiInteriorViscosityField->getLocalInfo().getBlocks()) {
-      HemoCellParticleField & pf = cellFields.domain_immersedParticles->getComponent(bId);
-      pf.interiorViscosityField = &domain_multiInteriorViscosityField->getComponent(bId);
+    if(cellFields.hemocell.preInlet){
+      preinlet_multiInteriorViscosityField = createField(*cellFields.hemocell.preinlet_lattice, *cellFields.preinlet_immersedParticles);
     }
+    domain_multiInteriorViscosityField = createField(*cellFields.hemocell.domain_lattice, *cellFields.domain_immersedParticles);
 
     if(cellFields.hemocell.partOfpreInlet){
       multiInteriorViscosityField = preinlet_multiInteriorViscosityField;
@@ -82,7 +52,60 @@ namespace hemo {
     }
     
   }
+
+  //Create tau class field with same properties as fluid field underlying the particleField and bind it to the fluid dynamics
+  plb::MultiScalarField3D<unsigned char> * InteriorViscosityHelper::createField(plb::MultiBlockLattice3D<T,DESCRIPTOR> & lattice,
+                                                                               plb::MultiParticleField3D<HemoCellParticleField> & particles) {
+    plb::MultiScalarField3D<unsigned char> * field = new plb::MultiScalarField3D<unsigned char>(
+            MultiBlockManagement3D (
+                *lattice.getSparseBlockStructure().clone(),
+                lattice.getMultiBlockManagement().getThreadAttribution().clone(),
+                lattice.getMultiBlockManagement().getEnvelopeWidth(),
+                lattice.getMultiBlockManagement().getRefinementLevel()),
+                defaultMultiBlockPolicy3D().getBlockCommunicator(),
+                defaultMultiBlockPolicy3D().getCombinedStatistics(),
+                defaultMultiBlockPolicy3D().getMultiScalarAccess<unsigned char>(),
+                0);
+    field->periodicity().toggle(0,lattice.periodicity().get(0));
+    field->periodicity().toggle(1,lattice.periodicity().get(1));
+    field->periodicity().toggle(2,lattice.periodicity().get(2));
+
+    field->initialize();
+
+    //Make sure each particleField has access to its local scalarField, and the fluid reads its tau from it
+    for (const plint & bId : field->getLocalInfo().getBlocks()) {
+      HemoCellParticleField & pf = particles.getComponent(bId);
+      pf.interiorViscosityField = &field->getComponent(bId);
+
+      BlockLattice3D<T,DESCRIPTOR> & block = lattice.getComponent(bId);
+      //The dynamics index the classes with the offset of the cell in the block, the layouts must be equal
+      const Dot3D blockLocation = block.getLocation(), fieldLocation = pf.interiorViscosityField->getLocation();
+      if (block.getNx() != pf.interiorViscosityField->getNx() || block.getNy() != pf.interiorViscosityField->getNy() ||
+          block.getNz() != pf.interiorViscosityField->getNz() || blockLocation.x != fieldLocation.x ||
+          blockLocation.y != fieldLocation.y || blockLocation.z != fieldLocation.z) {
+        hlog << "(InteriorViscosity) Error the tau class field of block " << bId << " does not match the fluid block, exiting ..." << endl;
+        exit(1);
+      }
+      InteriorViscosityBGKdynamics<T,DESCRIPTOR> * dynamics = dynamic_cast<InteriorViscosityBGKdynamics<T,DESCRIPTOR>*>(&block.getBackgroundDynamics());
+      if (!dynamics) {
+        hlog << "(InteriorViscosity) Error the background dynamics of the fluid is not InteriorViscosityBGKdynamics, create the lattice with hemocell.initializeLattice() or with InteriorViscosityBGKdynamics, exiting ..." << endl;
+        exit(1);
+      }
+      dynamics->bind(&pf.interiorViscosityField->get(0,0,0),&block.get(0,0,0),omegas.data());
+    }
+    return field;
+  }
   
+  void InteriorViscosityHelper::rebind() {
+    //Only the domain blocks are restructured, the pre-inlet keeps its blocks
+    MultiBlockLattice3D<T,DESCRIPTOR> & lattice = cellFields.hemocell.preInlet ? *cellFields.hemocell.domain_lattice : *cellFields.lattice;
+    delete domain_multiInteriorViscosityField;
+    domain_multiInteriorViscosityField = createField(lattice, *cellFields.domain_immersedParticles);
+    if (!cellFields.hemocell.partOfpreInlet) {
+      multiInteriorViscosityField = domain_multiInteriorViscosityField;
+    }
+  }
+
   InteriorViscosityHelper::~InteriorViscosityHelper() {
     delete multiInteriorViscosityField;
   }
@@ -96,17 +119,17 @@ namespace hemo {
     mkpath(outDir.c_str(), 0777);
     
     if (global::mpi().isMainProcessor()) {
-        renameFileToDotOld(outDir + "internalViscosity.dat");
-        renameFileToDotOld(outDir + "internalViscosity.plb");
+        renameFileToDotOld(outDir + "interiorViscosityClass.dat");
+        renameFileToDotOld(outDir + "interiorViscosityClass.plb");
         if(cellFields.hemocell.preInlet){
-          renameFileToDotOld(outDir + "PRE_internalViscosity.dat");
-          renameFileToDotOld(outDir + "PRE_internalViscosity.plb");
+          renameFileToDotOld(outDir + "PRE_interiorViscosityClass.dat");
+          renameFileToDotOld(outDir + "PRE_interiorViscosityClass.plb");
         }
     }
     if(cellFields.hemocell.preInlet){
-      plb::parallelIO::save(*preinlet_multiInteriorViscosityField, outDir + "PRE_internalViscosity", true);
+      plb::parallelIO::save(*preinlet_multiInteriorViscosityField, outDir + "PRE_interiorViscosityClass", true);
     }
-    plb::parallelIO::save(*domain_multiInteriorViscosityField, outDir + "internalViscosity", true);
+    plb::parallelIO::save(*domain_multiInteriorViscosityField, outDir + "interiorViscosityClass", true);
   }
   
   void InteriorViscosityHelper::restore(HemoCellFields & cellFields) {
@@ -115,43 +138,34 @@ namespace hemo {
       return;
     }
     std::string & outDir = hemo::global.checkpointDirectory;
-    std::string file_dat = outDir + "internalViscosity.dat";
-    std::string file_plb = outDir + "internalViscosity.plb";
+    std::string file_dat = outDir + "interiorViscosityClass.dat";
+    std::string file_plb = outDir + "interiorViscosityClass.plb";
     if(!(file_exists(file_dat) && file_exists(file_plb))) {
       pcout << "(internalViscosityField) Error restoring internalViscosity fields from checkpoint, they do not seem to exist" << endl;
       exit(1);
     }
     if(cellFields.hemocell.preInlet){
-      std::string file_dat = outDir + "PRE_internalViscosity.dat";
-      std::string file_plb = outDir + "PRE_internalViscosity.plb";
+      std::string file_dat = outDir + "PRE_interiorViscosityClass.dat";
+      std::string file_plb = outDir + "PRE_interiorViscosityClass.plb";
       if(!(file_exists(file_dat) && file_exists(file_plb))) {
         pcout << "(PRE_internalViscosityField) Error restoring PRE_internalViscosity fields from checkpoint, they do not seem to exist" << endl;
         exit(1);
       }
     }
-    plb::parallelIO::load(outDir + "internalViscosity",*get(cellFields).domain_multiInteriorViscosityField,true);
+    //The particle field (and after load balancing the fluid) were recreated since the last binding
+    get(cellFields).rebind();
+    plb::parallelIO::load(outDir + "interiorViscosityClass",*get(cellFields).domain_multiInteriorViscosityField,true);
     if(cellFields.hemocell.preInlet){
-      plb::parallelIO::load(outDir + "PRE_internalViscosity",*get(cellFields).preinlet_multiInteriorViscosityField,true);
+      plb::parallelIO::load(outDir + "PRE_interiorViscosityClass",*get(cellFields).preinlet_multiInteriorViscosityField,true);
     }
-    get(cellFields).refillBindingSites();
   }  
   
-  void InteriorViscosityHelper::add(HemoCellParticleField & pf, const Dot3D & internalPoint, T tau) {
-      pf.internalPoints.insert(internalPoint);
-      pf.interiorViscosityField->get(internalPoint.x,internalPoint.y,internalPoint.z) = tau;
-  }
-  
-  void InteriorViscosityHelper::add(HemoCellParticleField & pf, const vector<Dot3D> & internalPoints, T tau) {
+  void InteriorViscosityHelper::add(HemoCellParticleField & pf, const vector<Dot3D> & internalPoints, pluint ctype) {
     for (const Dot3D & internalPoint : internalPoints) {
-      add(pf,internalPoint,tau);
+      add(pf,internalPoint,ctype);
     }
   }
   
-  void InteriorViscosityHelper::remove(HemoCellParticleField & pf, const Dot3D & internalPoint) {
-    pf.internalPoints.erase(internalPoint);
-    pf.interiorViscosityField->get(internalPoint.x,internalPoint.y,internalPoint.z) = 0;
-  }
-  
   void InteriorViscosityHelper::remove(HemoCellParticleField & pf, const vector<Dot3D> & internalPoints) {
     for (const Dot3D & internalPoint: internalPoints) {
       remove(pf,internalPoint);
@@ -159,52 +173,6 @@ namespace hemo {
   } 
   
   void InteriorViscosityHelper::empty(HemoCellParticleField & pf) {
-    for (const Dot3D & internalPoint: pf.internalPoints) {
-      pf.interiorViscosityField->get(internalPoint.x,internalPoint.y,internalPoint.z) = 0;
-    }
-    pf.internalPoints.clear();
-  }
-  
-  void InteriorViscosityHelper::refillBindingSites() {
-    if(cellFields.hemocell.preInlet){
-      for (const plint & bId : cellFields.preinlet_immersedParticles->getLocalInfo().getBlocks()) {
-        HemoCellParticleField & pf = cellFields.preinlet_immersedParticles->getComponent(bId);
-        ScalarField3D<T> & bf = *pf.interiorViscosityField;
-        Box3D domain = bf.getBoundingBox();
-        for (int x = domain.x0; x <= domain.x1 ; x++) {
-          for (int y = domain.y0; y <= domain.y1; y++) {
-            for (int z = domain.z0; z <= domain.z1; z++) {
-              if(bf.get(x,y,z)) {
-                pf.internalPoints.insert({x,y,z});
-                
-                //WARNING this _can_ memory leak, so you should be ok if this is only called one time (from checkpointing)
-                plb::Dynamics<T,DESCRIPTOR>* dynamic = cellFields.hemocell.preinlet_lattice->getBackgroundDynamics().clone();
-                dynamic->setOmega(1.0/bf.get(x,y,z));
-                pf.atomicLattice->get(x,y,z).attributeDynamics(dynamic);
-              }
-            }
-          }
-        }
-      }
-    }
-    for (const plint & bId : cellFields.domain_immersedParticles->getLocalInfo().getBlocks()) {
-      HemoCellParticleField & pf = cellFields.domain_immersedParticles->getComponent(bId);
-      ScalarField3D<T> & bf = *pf.interiorViscosityField;
-      Box3D domain = bf.getBoundingBox();
-      for (int x = domain.x0; x <= domain.x1 ; x++) {
-        for (int y = domain.y0; y <= domain.y1; y++) {
-          for (int z = domain.z0; z <= domain.z1; z++) {
-            if(bf.get(x,y,z)) {
-              pf.internalPoints.insert({x,y,z});
-              
-              //WARNING this _can_ memory leak, so you should be ok if this is only called one time (from checkpointing)
-              plb::Dynamics<T,DESCRIPTOR>* dynamic = cellFields.hemocell.domain_lattice->getBackgroundDynamics().clone();
-              dynamic->setOmega(1.0/bf.get(x,y,z));
-              pf.atomicLattice->get(x,y,z).attributeDynamics(dynamic);
-            }
-          }
-        }
-      }
-    }
+    pf.interiorViscosityField->reset();
   }
-}
\ No newline at end of file
+}
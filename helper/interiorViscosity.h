@@ -26,8 +26,17 @@ along with this program.  If not, see <http://www.gnu.org/licenses/>.
 
 #include "hemoCellParticleField.h"
 #include "multiBlock/multiDataField3D.h"
+#include "interiorViscosityDynamics.h"
 
 namespace hemo {
+  /// Relaxation frequency of a fluid node, including the interior viscosity of cells
+  inline T cellOmega(const plb::Cell<T,DESCRIPTOR> & cell) {
+    if (const InteriorViscosityBGKdynamics<T,DESCRIPTOR> * dynamics = dynamic_cast<const InteriorViscosityBGKdynamics<T,DESCRIPTOR>*>(&cell.getDynamics())) {
+      return dynamics->getOmega(cell);
+    }
+    return cell.getDynamics().getOmega();
+  }
+
   class InteriorViscosityHelper {
   public:
      static InteriorViscosityHelper& get(HemoCellFields & cellFields) {
@@ -37,25 +46,37 @@ namespace hemo {
     }
       
     void checkpoint();
+    /// Rebinds to the current fluid blocks and loads the tau classes of the checkpoint
     static void restore(HemoCellFields & cellFields);
+    /// Recreate the tau class field on the current fluid blocks and bind it, after they were replaced (load balancing)
+    void rebind();
     
     //Called within functional, from particlefield
-    void add(HemoCellParticleField & pf, const Dot3D & bindingSite, T tau);
-    void add(HemoCellParticleField & pf, const vector<Dot3D> & bindingSites, T tau);
-    void remove(HemoCellParticleField & pf, const Dot3D & bindingSite);
-    void remove(HemoCellParticleField & pf, const vector<Dot3D> & bindingSites);
+    /// Mark a node (local coordinates) as inside a cell of type ctype, it relaxes with the interior tau of that type
+    void add(HemoCellParticleField & pf, const Dot3D & internalPoint, pluint ctype) {
+      pf.interiorViscosityField->get(internalPoint.x,internalPoint.y,internalPoint.z) = ctype + 1;
+    }
+    void add(HemoCellParticleField & pf, const vector<Dot3D> & internalPoints, pluint ctype);
+    void remove(HemoCellParticleField & pf, const Dot3D & internalPoint) {
+      pf.interiorViscosityField->get(internalPoint.x,internalPoint.y,internalPoint.z) = 0;
+    }
+    void remove(HemoCellParticleField & pf, const vector<Dot3D> & internalPoints);
     void empty(HemoCellParticleField & pf);
     
   private:
     HemoCellFields & cellFields;
 
-    plb::MultiScalarField3D<T> *multiInteriorViscosityField = nullptr,
+    /// Tau class per node, 0 outside of cells and celltype+1 inside
+    plb::MultiScalarField3D<unsigned char> *multiInteriorViscosityField = nullptr,
      *preinlet_multiInteriorViscosityField = nullptr, *domain_multiInteriorViscosityField = nullptr;
+    /// Relaxation frequency per tau class
+    std::vector<T> omegas;
     
     InteriorViscosityHelper(HemoCellFields & cellFields);
     ~InteriorViscosityHelper();
     
-    void refillBindingSites();
+    plb::MultiScalarField3D<unsigned char> * createField(plb::MultiBlockLattice3D<T,DESCRIPTOR> & lattice,
+                                                          plb::MultiParticleField3D<HemoCellParticleField> & particles);
     
     //Singleton Behaviour
   public:
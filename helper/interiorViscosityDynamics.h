@@ -0,0 +1,104 @@
+/*
+This file is part of the HemoCell library
+
+HemoCell is developed and maintained by the Computational Science Lab 
+in the University of Amsterdam. Any questions or remarks regarding this library 
+can be sent to: info@hemocell.eu
+
+When using the HemoCell library in scientific work please cite the
+corresponding paper: https://doi.org/10.3389/fphys.2017.00563
+
+The HemoCell library is free software: you can redistribute it and/or
+modify it under the terms of the GNU Affero General Public License as
+published by the Free Software Foundation, either version 3 of the
+License, or (at your option) any later version.
+
+The library is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU Affero General Public License for more details.
+
+You should have received a copy of the GNU Affero General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+#ifndef HEMO_INTERIOR_VISCOSITY_DYNAMICS_H
+#define HEMO_INTERIOR_VISCOSITY_DYNAMICS_H
+
+#include "palabos3D.h"
+#include "palabos3D.hh"
+
+namespace hemo {
+  /**
+   * Guo-forced BGK that takes its relaxation frequency per node from a byte
+   * field of tau classes: class 0 relaxes with the omega of the dynamics,
+   * class c with omegas[c]. Marking a node as the inside of a cell is a single
+   * store into the class field, the node keeps this (background) dynamics.
+   *
+   * A clone on every atomic block is bound to that block with bind(); the class
+   * field must have the dimensions of the block, the node is found from the
+   * offset of the cell in the block. Unbound it is plain Guo-forced BGK. The
+   * blocks are rebound whenever they are replaced (load balancing).
+   *
+   * getOmega() is the omega of the node that is being collided, and the
+   * background omega otherwise; getOmega(cell) gives the omega of any node.
+   */
+  template<typename T, template<typename U> class Descriptor>
+  class InteriorViscosityBGKdynamics : public plb::GuoExternalForceBGKdynamics<T,Descriptor> {
+  public:
+    InteriorViscosityBGKdynamics(T omega_) : plb::GuoExternalForceBGKdynamics<T,Descriptor>(omega_) { }
+    InteriorViscosityBGKdynamics(plb::HierarchicUnserializer & unserializer) : plb::GuoExternalForceBGKdynamics<T,Descriptor>(T()) {
+      this->unserialize(unserializer);
+    }
+
+    /// A clone is not bound, every block binds its own
+    virtual InteriorViscosityBGKdynamics<T,Descriptor>* clone() const {
+      InteriorViscosityBGKdynamics<T,Descriptor> * copy = new InteriorViscosityBGKdynamics<T,Descriptor>(*this);
+      copy->bind(0,0,0);
+      return copy;
+    }
+
+    virtual int getId() const { return id; }
+
+    void bind(const unsigned char * tauClasses_, const plb::Cell<T,Descriptor> * origin_, const T * omegas_) {
+      tauClasses = tauClasses_;
+      origin = origin_;
+      omegas = omegas_;
+    }
+
+    virtual T getOmega() const {
+      return collideOmega ? collideOmega : plb::GuoExternalForceBGKdynamics<T,Descriptor>::getOmega();
+    }
+
+    /// Relaxation frequency of a node of the bound block
+    T getOmega(const plb::Cell<T,Descriptor> & cell) const {
+      const unsigned char tauClass = tauClasses ? tauClasses[&cell - origin] : 0;
+      return tauClass ? omegas[tauClass] : plb::GuoExternalForceBGKdynamics<T,Descriptor>::getOmega();
+    }
+
+    virtual void collide(plb::Cell<T,Descriptor> & cell, plb::BlockStatistics & statistics) {
+      const unsigned char tauClass = tauClasses ? tauClasses[&cell - origin] : 0;
+      collideOmega = tauClass ? omegas[tauClass] : 0;
+      plb::GuoExternalForceBGKdynamics<T,Descriptor>::collide(cell,statistics);
+      collideOmega = 0;
+    }
+
+  private:
+    static int id;
+    const unsigned char * tauClasses = 0;
+    const plb::Cell<T,Descriptor> * origin = 0;
+    const T * omegas = 0;
+    /// Omega of the interior node that is being collided, 0 for the background omega
+    T collideOmega = 0;
+  };
+
+  /// Relaxation frequency of a node, the fluid lattice overload (interiorViscosity.h) includes the interior viscosity of cells
+  template<typename T, template<typename U> class Descriptor>
+  inline T cellOmega(const plb::Cell<T,Descriptor> & cell) {
+    return cell.getDynamics().getOmega();
+  }
+
+  template<typename T, template<typename U> class Descriptor>
+  int InteriorViscosityBGKdynamics<T,Descriptor>::id =
+    plb::meta::registerGeneralDynamics<T,Descriptor,InteriorViscosityBGKdynamics<T,Descriptor> >("InteriorViscosityBGK_Guo");
+}
+#endif
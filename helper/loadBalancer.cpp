@@ -22,9 +22,12 @@ You should have received a copy of the GNU Affero General Public License
 along with this program.  If not, see <http://www.gnu.org/licenses/>.
 */
 #include "loadBalancer.h"
+#include "spaceFillingCurve.h"
+#include "fluidAverage.h"
 
 #ifdef HEMO_PARMETIS
 #include <parmetis.h>
+#endif
 
 LoadBalancer::LoadBalancer(HemoCell & hemocell_) : hemocell(hemocell_), original_block_structure(hemocell_.lattice->getSparseBlockStructure().clone()),original_thread_attribution(hemocell_.lattice->getMultiBlockManagement().getThreadAttribution().clone()) { 
 
@@ -58,6 +61,7 @@ void LoadBalancer::GatherTimeOfAtomicBlocks::processGenericBlocks(Box3D domain,
   vector<HemoCellParticle *> found;
   pf->findParticles(pf->localDomain,found);
   gatherValues[pf->atomicBlockId].n_lsp = found.size();
+  gatherValues[pf->atomicBlockId].n_fluid = pf->nFluidCells;
 
   pf->timer.reset();
   ff->timer.reset();
@@ -130,6 +134,45 @@ void LoadBalancer::doLoadBalance() {
   if(!FLI_iscalled) {
     pcerr << "Warning, You did not calculate the fractional load imbalance before trying to balance, this means gatherValues will be unavailable in this function";
   }
+
+#ifdef HEMO_PARMETIS
+  string partitioner = "parmetis";
+#else
+  string partitioner = "hilbert";
+#endif
+  try {
+    partitioner = (*hemocell.cfg)["parameters"]["partitioner"].read<string>();
+  } catch (std::invalid_argument & exeption) {}
+#ifndef HEMO_PARMETIS
+  if (partitioner == "parmetis") {
+    hlog << "(LoadBalancer) WARNING: HemoCell is compiled without ParMETIS, falling back to the hilbert partitioner" << endl;
+    partitioner = "hilbert";
+  }
+#endif
+  if (partitioner != "parmetis" && partitioner != "hilbert" && partitioner != "rcb") {
+    hlog << "(LoadBalancer) Unknown partitioner \"" << partitioner << "\", options are parmetis, hilbert and rcb" << endl;
+    exit(1);
+  }
+
+  //Calibrate the cost of a fluid node and a particle on the timings of the
+  //current distribution, these do not depend on the block structure
+  T fluidCost = 1.0;
+  T particleCost = 1.0;
+  {
+    double fluidTime = 0., particleTime = 0.;
+    long nFluid = 0, nLsp = 0;
+    for (auto const & entry : gatherValues) {
+      fluidTime += entry.second.fluid_time;
+      particleTime += entry.second.particle_time;
+      nFluid += entry.second.n_fluid;
+      nLsp += entry.second.n_lsp;
+    }
+    if (fluidTime > 0. && nFluid > 0) {
+      fluidCost = fluidTime/nFluid;
+      particleCost = (particleTime > 0. && nLsp > 0) ? particleTime/nLsp : fluidCost;
+    }
+  }
+
   hemocell.saveCheckPoint(); // Save Checkpoint
 
   if (original_block_stored) {
@@ -163,6 +206,9 @@ void LoadBalancer::doLoadBalance() {
 
   hemocell.lattice = newlattice;
   hemocell.cellfields->lattice = newlattice;
+  if (hemocell.fluidAverage) {
+    hemocell.fluidAverage->release(); //Recreated on the new blocks by reloadCheckpoint()
+  }
   
   delete hemocell.cellfields->immersedParticles;
   hemocell.cellfields->createParticleField();
@@ -174,6 +220,72 @@ void LoadBalancer::doLoadBalance() {
   }
   
   
+  map<int,plint> newProc;
+#ifdef HEMO_PARMETIS
+  if (partitioner == "parmetis") {
+    newProc = partitionParmetis();
+  } else
+#endif
+  {
+    newProc = partitionNative(partitioner, fluidCost, particleCost);
+  }
+
+  pcout << "(LoadBalancer) Recreating Fluid field with new Distribution of Atomic Blocks" << endl;
+
+  map<plint,plint> nTA; //Conversion is necessary for next function
+  for (auto & pair : newProc) { 
+      nTA[pair.first] = pair.second; 
+  }
+  ExplicitThreadAttribution* newThreadAttribution = new ExplicitThreadAttribution(nTA);
+  delete original_thread_attribution;
+  original_thread_attribution = newThreadAttribution->clone();
+  
+  plint envelopeWidth = hemocell.lattice->getMultiBlockManagement().getEnvelopeWidth();
+  plint refinementLevel = hemocell.lattice->getMultiBlockManagement().getRefinementLevel();
+
+  Dynamics<T,DESCRIPTOR> * dynamics = hemocell.lattice->getBackgroundDynamics().clone();
+  bool perX = hemocell.lattice->periodicity().get(0);
+  bool perY = hemocell.lattice->periodicity().get(1);
+  bool perZ = hemocell.lattice->periodicity().get(2);
+  bool internalStat = hemocell.lattice->isInternalStatisticsOn();
+
+  delete hemocell.lattice;
+
+  MultiBlockLattice3D<T,DESCRIPTOR> * newlattice = new
+            MultiBlockLattice3D<T,DESCRIPTOR>(MultiBlockManagement3D (
+            *original_block_structure->clone(),
+            newThreadAttribution->clone(),
+            envelopeWidth,
+            refinementLevel ),
+            defaultMultiBlockPolicy3D().getBlockCommunicator(),                
+            defaultMultiBlockPolicy3D().getCombinedStatistics(),
+            defaultMultiBlockPolicy3D().getMultiCellAccess<T,DESCRIPTOR>(),
+            dynamics );
+  
+  newlattice->periodicity().toggle(0, perX);
+  newlattice->periodicity().toggle(1, perY);
+  newlattice->periodicity().toggle(2, perZ);
+  newlattice->toggleInternalStatistics(internalStat);
+ 
+  hemocell.lattice = newlattice;
+  hemocell.cellfields->lattice = newlattice;
+  if (hemocell.fluidAverage) {
+    hemocell.fluidAverage->release(); //Recreated on the new blocks by reloadCheckpoint()
+  }
+  
+  delete hemocell.cellfields->immersedParticles;
+  hemocell.cellfields->createParticleField(original_block_structure->clone(),newThreadAttribution->clone());
+
+  delete newThreadAttribution;
+  
+  reloadCheckpoint();
+  pcout << "(LoadBalancer) Continuing simulation with balanced application" << endl;
+  
+  return;
+}
+
+#ifdef HEMO_PARMETIS
+map<int,plint> LoadBalancer::partitionParmetis() {
   //Map atomic blocks to number used in parmetis
   map<plint,plint> id_parmetis_id_real;
   map<plint,plint> id_real_id_parmetis;
@@ -261,56 +373,31 @@ void LoadBalancer::doLoadBalance() {
     pcout << "Atomic block " << pair.first << " is assigned to processor " << pair.second << endl;
   }*/
 
-  
-  pcout << "(LoadBalancer) Recreating Fluid field with new Distribution of Atomic Blocks" << endl;
+  return newProc;
+}
+#endif
 
-  map<plint,plint> nTA; //Conversion is necessary for next function
-  for (auto & pair : newProc) { 
-      nTA[pair.first] = pair.second; 
+map<int,plint> LoadBalancer::partitionNative(const string & partitioner, T fluidCost, T particleCost) {
+  //gatherValues is available on all processes and belongs to the original block
+  //structure, so every process can calculate the same partitioning locally
+  map<plint,double> weights;
+  for (auto const & entry : gatherValues) {
+    weights[entry.first] = fluidCost*entry.second.n_fluid + particleCost*entry.second.n_lsp;
   }
-  ExplicitThreadAttribution* newThreadAttribution = new ExplicitThreadAttribution(nTA);
-  delete original_thread_attribution;
-  original_thread_attribution = newThreadAttribution->clone();
-  
-  plint envelopeWidth = hemocell.lattice->getMultiBlockManagement().getEnvelopeWidth();
-  plint refinementLevel = hemocell.lattice->getMultiBlockManagement().getRefinementLevel();
-
-  Dynamics<T,DESCRIPTOR> * dynamics = hemocell.lattice->getBackgroundDynamics().clone();
-  bool perX = hemocell.lattice->periodicity().get(0);
-  bool perY = hemocell.lattice->periodicity().get(1);
-  bool perZ = hemocell.lattice->periodicity().get(2);
-  bool internalStat = hemocell.lattice->isInternalStatisticsOn();
-
-  delete hemocell.lattice;
 
-  MultiBlockLattice3D<T,DESCRIPTOR> * newlattice = new
-            MultiBlockLattice3D<T,DESCRIPTOR>(MultiBlockManagement3D (
-            *original_block_structure->clone(),
-            newThreadAttribution->clone(),
-            envelopeWidth,
-            refinementLevel ),
-            defaultMultiBlockPolicy3D().getBlockCommunicator(),                
-            defaultMultiBlockPolicy3D().getCombinedStatistics(),
-            defaultMultiBlockPolicy3D().getMultiCellAccess<T,DESCRIPTOR>(),
-            dynamics );
-  
-  newlattice->periodicity().toggle(0, perX);
-  newlattice->periodicity().toggle(1, perY);
-  newlattice->periodicity().toggle(2, perZ);
-  newlattice->toggleInternalStatistics(internalStat);
- 
-  hemocell.lattice = newlattice;
-  hemocell.cellfields->lattice = newlattice;
-  
-  delete hemocell.cellfields->immersedParticles;
-  hemocell.cellfields->createParticleField(original_block_structure->clone(),newThreadAttribution->clone());
+  map<plint,plint> parts;
+  if (partitioner == "rcb") {
+    parts = partitionBlocksRCB(original_block_structure->getBulks(), weights, global::mpi().getSize());
+  } else {
+    parts = partitionBlocksHilbert(original_block_structure->getBulks(), weights, global::mpi().getSize());
+  }
+  hlog << "(LoadBalancer) Partitioned " << parts.size() << " atomic blocks with the " << partitioner << " partitioner" << endl;
 
-  delete newThreadAttribution;
-  
-  reloadCheckpoint();
-  pcout << "(LoadBalancer) Continuing simulation with balanced application" << endl;
-  
-  return;
+  map<int,plint> newProc;
+  for (auto & pair : parts) {
+    newProc[pair.first] = pair.second;
+  }
+  return newProc;
 }
 
 //Necessary C++ crap
@@ -431,6 +518,9 @@ void LoadBalancer::restructureBlocks(bool checkpoint_available) {
   
   hemocell.lattice = newlattice;
   hemocell.cellfields->lattice = newlattice;
+  if (hemocell.fluidAverage) {
+    hemocell.fluidAverage->release(); //Recreated on the new blocks by reloadCheckpoint()
+  }
   
   delete hemocell.cellfields->immersedParticles;
   hemocell.cellfields->createParticleField(new_structure->clone(),newThreadAttribution->clone());
@@ -443,4 +533,3 @@ void LoadBalancer::restructureBlocks(bool checkpoint_available) {
   
   return;
 }
-#endif
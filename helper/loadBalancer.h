@@ -30,7 +30,6 @@ namespace hemo {
 namespace hemo {
 class LoadBalancer {  
   public:
-#ifdef HEMO_PARMETIS
   LoadBalancer(HemoCell & hemocell_);
   T calculateFractionalLoadImbalance();
   /**
@@ -38,12 +37,12 @@ class LoadBalancer {
    * Set checkpoint_available to false if not called in the same iteration right after doLoadBalance()
    */
   void restructureBlocks(bool checkpoint_available=true);
-#else
-  LoadBalancer(HemoCell & hemocell_):hemocell(hemocell_){};
-  double calculateFractionalLoadImbalance() {return 0.0;}
-  void restructureBlocks(bool checkpoint_available=true) {}
-#endif
 
+  /**
+   * Redistribute the atomic blocks over the mpi processes. The partitioner can
+   * be chosen with parameters/partitioner in the config: "parmetis" (default
+   * when compiled with HEMO_PARMETIS), "hilbert" (default otherwise) or "rcb".
+   */
   void doLoadBalance();
 
   /**
@@ -56,6 +55,7 @@ class LoadBalancer {
     double fluid_time;
     double particle_time;
     int n_lsp;
+    int n_fluid;
     int mpi_proc;
   };
   struct Box3D_simple {
@@ -81,6 +81,11 @@ class LoadBalancer {
     GatherTimeOfAtomicBlocks * clone() const;
   };
   private:
+#ifdef HEMO_PARMETIS
+  map<int,plint> partitionParmetis();
+#endif
+  map<int,plint> partitionNative(const string & partitioner, T fluidCost, T particleCost);
+
   bool FLI_iscalled = false;
   map<int,TOAB_t> gatherValues;
   HemoCell & hemocell;
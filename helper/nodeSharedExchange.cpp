@@ -0,0 +1,101 @@
+/*
+This file is part of the HemoCell library
+
+HemoCell is developed and maintained by the Computational Science Lab 
+in the University of Amsterdam. Any questions or remarks regarding this library 
+can be sent to: info@hemocell.eu
+
+When using the HemoCell library in scientific work please cite the
+corresponding paper: https://doi.org/10.3389/fphys.2017.00563
+
+The HemoCell library is free software: you can redistribute it and/or
+modify it under the terms of the GNU Affero General Public License as
+published by the Free Software Foundation, either version 3 of the
+License, or (at your option) any later version.
+
+The library is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU Affero General Public License for more details.
+
+You should have received a copy of the GNU Affero General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+#include "nodeSharedExchange.h"
+#include "logfile.h"
+
+#include <algorithm>
+
+namespace hemo {
+using namespace std;
+
+NodeSharedExchange::NodeSharedExchange() {
+  int worldRank;
+  MPI_Comm_rank(MPI_COMM_WORLD,&worldRank);
+  MPI_Comm_split_type(MPI_COMM_WORLD,MPI_COMM_TYPE_SHARED,worldRank,MPI_INFO_NULL,&nodeComm);
+  MPI_Comm_size(nodeComm,&size);
+  MPI_Comm_rank(nodeComm,&myNodeRank);
+
+  vector<int> worldRanks(size);
+  MPI_Allgather(&worldRank,1,MPI_INT,worldRanks.data(),1,MPI_INT,nodeComm);
+  for (int i = 0 ; i < size ; i++) {
+    worldToNode[worldRanks[i]] = i;
+  }
+  hlogfile << "(HemoCell) (NodeSharedExchange) Sharing particle envelopes with " << size-1 << " processes on this node" << endl;
+  allocate(4096);
+}
+
+NodeSharedExchange::~NodeSharedExchange() {
+  int finalized;
+  MPI_Finalized(&finalized);
+  if (finalized) {
+    return;
+  }
+  free();
+  MPI_Comm_free(&nodeComm);
+}
+
+int NodeSharedExchange::nodeRank(int rank) const {
+  map<int,int>::const_iterator it = worldToNode.find(rank);
+  return it == worldToNode.end() ? -1 : it->second;
+}
+
+void NodeSharedExchange::reserve(size_t bytes) {
+  unsigned long long needed = bytes, maxNeeded;
+  MPI_Allreduce(&needed,&maxNeeded,1,MPI_UNSIGNED_LONG_LONG,MPI_MAX,nodeComm);
+  if (maxNeeded > capacity) {
+    free();
+    allocate(maxNeeded + maxNeeded/2);
+  }
+}
+
+void NodeSharedExchange::fence() {
+  MPI_Win_sync(window);
+  MPI_Barrier(nodeComm);
+  MPI_Win_sync(window);
+}
+
+void NodeSharedExchange::allocate(size_t bytes) {
+  //Keep segments aligned for the particle records
+  capacity = ((bytes + 63)/64)*64;
+  char * base;
+  MPI_Win_allocate_shared(capacity,1,MPI_INFO_NULL,nodeComm,&base,&window);
+  segments.resize(size);
+  for (int i = 0 ; i < size ; i++) {
+    MPI_Aint segmentSize;
+    int dispUnit;
+    MPI_Win_shared_query(window,i,&segmentSize,&dispUnit,&segments[i]);
+  }
+  MPI_Win_lock_all(MPI_MODE_NOCHECK,window);
+}
+
+void NodeSharedExchange::free() {
+  if (window == MPI_WIN_NULL) {
+    return;
+  }
+  MPI_Win_unlock_all(window);
+  MPI_Win_free(&window);
+  capacity = 0;
+}
+
+}
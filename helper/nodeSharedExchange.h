@@ -0,0 +1,78 @@
+/*
+This file is part of the HemoCell library
+
+HemoCell is developed and maintained by the Computational Science Lab 
+in the University of Amsterdam. Any questions or remarks regarding this library 
+can be sent to: info@hemocell.eu
+
+When using the HemoCell library in scientific work please cite the
+corresponding paper: https://doi.org/10.3389/fphys.2017.00563
+
+The HemoCell library is free software: you can redistribute it and/or
+modify it under the terms of the GNU Affero General Public License as
+published by the Free Software Foundation, either version 3 of the
+License, or (at your option) any later version.
+
+The library is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU Affero General Public License for more details.
+
+You should have received a copy of the GNU Affero General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+#ifndef HEMO_NODESHAREDEXCHANGE_H
+#define HEMO_NODESHAREDEXCHANGE_H
+
+#include <mpi.h>
+#include <map>
+#include <vector>
+#include <cstddef>
+
+namespace hemo {
+
+/**
+ * One MPI-3 shared memory window over all processes of a compute node. Every
+ * process owns a segment it writes to, the other processes on the node read
+ * it directly instead of receiving a copy through MPI messages.
+ *
+ * reserve() and fence() are collective over the processes of the node. A
+ * completed reserve() also implies that every process on the node finished
+ * reading the segments of the previous exchange, so a segment can be
+ * overwritten after it.
+ */
+class NodeSharedExchange {
+public:
+  NodeSharedExchange();
+  ~NodeSharedExchange();
+
+  /// Whether (world) rank is on the same node as this process
+  bool onNode(int rank) const { return worldToNode.find(rank) != worldToNode.end(); }
+  /// Index of (world) rank within the node, -1 if it is not on this node
+  int nodeRank(int rank) const;
+  /// Number of processes on this node
+  int nodeSize() const { return size; }
+
+  /// Make sure every segment holds at least bytes, contents are lost when the window grows (collective)
+  void reserve(std::size_t bytes);
+  /// Own segment, valid until the next reserve()
+  char * local() { return segments[myNodeRank]; }
+  /// Segment of another (world) rank on this node, valid until the next reserve()
+  char const * segment(int rank) const { return segments[nodeRank(rank)]; }
+  /// Publish the writes to the own segment and wait for the rest of the node (collective)
+  void fence();
+
+private:
+  void allocate(std::size_t bytes);
+  void free();
+
+  MPI_Comm nodeComm = MPI_COMM_NULL;
+  MPI_Win window = MPI_WIN_NULL;
+  int size = 0, myNodeRank = 0;
+  std::size_t capacity = 0;
+  std::map<int,int> worldToNode;
+  std::vector<char *> segments;
+};
+
+}
+#endif
@@ -492,7 +492,7 @@ void PreInlet::preInletFromSlice(Direction direction_, Box3D boundary) {
       break;
   }
 
-  inflow_length = (*hemocell->cfg)["domain"]["particleEnvelope"].read<int>();
+  inflow_length = global.particleEnvelope;
   Box3D preInletDomain;
   bool foundPreInlet = false;
   vector<MultiBlock3D*> wrapper;
@@ -626,7 +626,7 @@ void PreInlet::autoPreinletFromBoundary(Direction dir_) {
     fluidDomain.z1 = fluidDomain.z0;
   }
 
-  inflow_length = (*hemocell->cfg)["domain"]["particleEnvelope"].read<int>();
+  inflow_length = global.particleEnvelope;
   Box3D preInletDomain;
   bool foundPreInlet = false;
   vector<MultiBlock3D*> wrapper;
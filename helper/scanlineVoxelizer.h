@@ -0,0 +1,146 @@
+/*
+This file is part of the HemoCell library
+
+HemoCell is developed and maintained by the Computational Science Lab 
+in the University of Amsterdam. Any questions or remarks regarding this library 
+can be sent to: info@hemocell.eu
+
+When using the HemoCell library in scientific work please cite the
+corresponding paper: https://doi.org/10.3389/fphys.2017.00563
+
+The HemoCell library is free software: you can redistribute it and/or
+modify it under the terms of the GNU Affero General Public License as
+published by the Free Software Foundation, either version 3 of the
+License, or (at your option) any later version.
+
+The library is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU Affero General Public License for more details.
+
+You should have received a copy of the GNU Affero General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+#ifndef HEMO_SCANLINEVOXELIZER_H
+#define HEMO_SCANLINEVOXELIZER_H
+
+#include <algorithm>
+#include <cmath>
+#include <vector>
+
+#include "array.h"
+
+namespace hemo {
+  /**
+   * Finds the lattice nodes inside a closed triangle mesh (a cell) by
+   * rasterizing it along x. Every triangle is intersected once with the
+   * (y,z) lattice columns its projection covers; the crossings of a column
+   * are sorted and the nodes between the first and second, third and fourth,
+   * ... crossing are inside. This is one pass over the triangles per cell
+   * instead of a ray test per node of the bounding box.
+   *
+   * Nodes on a shared edge or vertex of the projection are claimed by exactly
+   * one triangle (top-left rule), so watertight meshes give an even number of
+   * crossings per column. Columns with an odd number (a broken mesh) ignore
+   * their last crossing.
+   *
+   * The crossing buffer is kept between calls, reuse one voxelizer for all
+   * cells of a block.
+   */
+  class ScanlineVoxelizer {
+  public:
+    /**
+     * Call inside(x,y,z) for every node of domain (global coordinates) inside
+     * the mesh. vertex(i) returns the position of vertex i of the triangles.
+     */
+    template<class Vertex, class F>
+    void forEachInnerNode(plint nVertices, const std::vector<hemo::Array<plint,3>> & triangles, Vertex vertex,
+                          const plb::Box3D & domain, F inside) {
+      //Bounding box of the cell clipped to the domain, in columns
+      hemo::Array<T,3> lower = vertex(0), upper = vertex(0);
+      for (plint i = 1 ; i < nVertices ; i++) {
+        const hemo::Array<T,3> & p = vertex(i);
+        for (int d = 0 ; d < 3 ; d++) {
+          lower[d] = std::min(lower[d],p[d]);
+          upper[d] = std::max(upper[d],p[d]);
+        }
+      }
+      const plint x0 = std::max(domain.x0,(plint)std::ceil(lower[0])), x1 = std::min(domain.x1,(plint)std::floor(upper[0]));
+      y0 = std::max(domain.y0,(plint)std::ceil(lower[1]));
+      y1 = std::min(domain.y1,(plint)std::floor(upper[1]));
+      z0 = std::max(domain.z0,(plint)std::ceil(lower[2]));
+      z1 = std::min(domain.z1,(plint)std::floor(upper[2]));
+      if (x0 > x1 || y0 > y1 || z0 > z1) { return; }
+
+      crossings.clear();
+      for (const hemo::Array<plint,3> & triangle : triangles) {
+        addCrossings(vertex(triangle[0]),vertex(triangle[1]),vertex(triangle[2]));
+      }
+      std::sort(crossings.begin(),crossings.end());
+
+      //Fill the runs between pairs of crossings
+      const plint nz = z1 - z0 + 1;
+      for (std::size_t first = 0 ; first < crossings.size() ; ) {
+        std::size_t last = first;
+        while (last < crossings.size() && crossings[last].column == crossings[first].column) { last++; }
+        const plint y = y0 + crossings[first].column/nz;
+        const plint z = z0 + crossings[first].column%nz;
+        for (std::size_t c = first ; c + 1 < last ; c += 2) {
+          const plint from = std::max(x0,(plint)std::ceil(crossings[c].x));
+          const plint to = std::min(x1,(plint)std::floor(crossings[c+1].x));
+          for (plint x = from ; x <= to ; x++) {
+            inside(x,y,z);
+          }
+        }
+        first = last;
+      }
+    }
+
+  private:
+    struct Crossing {
+      plint column;
+      T x;
+      bool operator<(const Crossing & other) const {
+        return column < other.column || (column == other.column && x < other.x);
+      }
+    };
+    std::vector<Crossing> crossings;
+    plint y0, y1, z0, z1;
+
+    /// Add the crossing of triangle (v0,v1,v2) with every column it covers
+    void addCrossings(const hemo::Array<T,3> & v0, const hemo::Array<T,3> & v1, const hemo::Array<T,3> & v2) {
+      //Twice the signed area of the projection on the (y,z) plane
+      const T area = (v1[1]-v0[1])*(v2[2]-v0[2]) - (v2[1]-v0[1])*(v1[2]-v0[2]);
+      if (area == 0.) { return; } //Parallel to the columns
+      const plint ty0 = std::max(y0,(plint)std::ceil(std::min(v0[1],std::min(v1[1],v2[1]))));
+      const plint ty1 = std::min(y1,(plint)std::floor(std::max(v0[1],std::max(v1[1],v2[1]))));
+      const plint tz0 = std::max(z0,(plint)std::ceil(std::min(v0[2],std::min(v1[2],v2[2]))));
+      const plint tz1 = std::min(z1,(plint)std::floor(std::max(v0[2],std::max(v1[2],v2[2]))));
+      const T sign = area > 0. ? 1. : -1.;
+      const plint nz = z1 - z0 + 1;
+      for (plint y = ty0 ; y <= ty1 ; y++) {
+        for (plint z = tz0 ; z <= tz1 ; z++) {
+          //Edge functions, positive inside the counterclockwise (after sign) projection
+          const T w0 = sign*edge(v1,v2,y,z);
+          const T w1 = sign*edge(v2,v0,y,z);
+          const T w2 = sign*edge(v0,v1,y,z);
+          if (!covers(w0,v1,v2,sign) || !covers(w1,v2,v0,sign) || !covers(w2,v0,v1,sign)) { continue; }
+          const T x = (w0*v0[0] + w1*v1[0] + w2*v2[0])/(w0 + w1 + w2);
+          crossings.push_back({(y-y0)*nz + (z-z0),x});
+        }
+      }
+    }
+
+    static T edge(const hemo::Array<T,3> & a, const hemo::Array<T,3> & b, plint y, plint z) {
+      return (b[1]-a[1])*(T(z)-a[2]) - (b[2]-a[2])*(T(y)-a[1]);
+    }
+
+    /// Inside the edge from a to b, on the edge only when it is a top-left edge of the oriented projection
+    static bool covers(T w, const hemo::Array<T,3> & a, const hemo::Array<T,3> & b, T sign) {
+      if (w != 0.) { return w > 0.; }
+      const T dy = sign*(b[1]-a[1]), dz = sign*(b[2]-a[2]);
+      return dy > 0. || (dy == 0. && dz > 0.);
+    }
+  };
+}
+#endif
@@ -0,0 +1,231 @@
+/*
+This file is part of the HemoCell library
+
+HemoCell is developed and maintained by the Computational Science Lab 
+in the University of Amsterdam. Any questions or remarks regarding this library 
+can be sent to: info@hemocell.eu
+
+When using the HemoCell library in scientific work please cite the
+corresponding paper: https://doi.org/10.3389/fphys.2017.00563
+
+The HemoCell library is free software: you can redistribute it and/or
+modify it under the terms of the GNU Affero General Public License as
+published by the Free Software Foundation, either version 3 of the
+License, or (at your option) any later version.
+
+The library is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU Affero General Public License for more details.
+
+You should have received a copy of the GNU Affero General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+#include "spaceFillingCurve.h"
+
+#include <algorithm>
+
+namespace hemo {
+using namespace plb;
+using namespace std;
+
+uint64_t hilbertIndex3D(uint32_t x, uint32_t y, uint32_t z, unsigned int bits) {
+  //Skilling's algorithm, "Programming the Hilbert curve" (2004)
+  uint32_t X[3] = {x,y,z};
+  const uint32_t M = 1u << (bits-1);
+
+  //Inverse undo excess work
+  for (uint32_t Q = M ; Q > 1 ; Q >>= 1) {
+    const uint32_t P = Q - 1;
+    for (int i = 0 ; i < 3 ; i++) {
+      if (X[i] & Q) {
+        X[0] ^= P;
+      } else {
+        const uint32_t t = (X[0] ^ X[i]) & P;
+        X[0] ^= t;
+        X[i] ^= t;
+      }
+    }
+  }
+
+  //Gray encode
+  for (int i = 1 ; i < 3 ; i++) {
+    X[i] ^= X[i-1];
+  }
+  uint32_t t = 0;
+  for (uint32_t Q = M ; Q > 1 ; Q >>= 1) {
+    if (X[2] & Q) {
+      t ^= Q - 1;
+    }
+  }
+  for (int i = 0 ; i < 3 ; i++) {
+    X[i] ^= t;
+  }
+
+  //The transposed index is interleaved, most significant bit first
+  uint64_t index = 0;
+  for (int b = bits - 1 ; b >= 0 ; b--) {
+    for (int i = 0 ; i < 3 ; i++) {
+      index = (index << 1) | ((X[i] >> b) & 1u);
+    }
+  }
+  return index;
+}
+
+namespace {
+struct BlockEntry {
+  plint id;
+  plint center[3]; //Twice the center, keeps it integer
+  double weight;
+};
+
+vector<BlockEntry> createBlockEntries(const map<plint,Box3D> & bulks, const map<plint,double> & weights) {
+  vector<BlockEntry> entries;
+  entries.reserve(bulks.size());
+  double total = 0.;
+  for (const auto & pair : bulks) {
+    BlockEntry entry;
+    entry.id = pair.first;
+    entry.center[0] = pair.second.x0 + pair.second.x1;
+    entry.center[1] = pair.second.y0 + pair.second.y1;
+    entry.center[2] = pair.second.z0 + pair.second.z1;
+    auto w = weights.find(pair.first);
+    entry.weight = (w == weights.end() || w->second < 0.) ? 0. : w->second;
+    total += entry.weight;
+    entries.push_back(entry);
+  }
+  //Without any usable weights fall back to an equal number of blocks per process
+  if (total <= 0.) {
+    for (BlockEntry & entry : entries) {
+      entry.weight = 1.;
+    }
+  }
+  return entries;
+}
+
+// Cut an ordered list of blocks into nparts consecutive pieces of roughly equal
+// weight, each process receives at least one block when possible
+void splitOrdered(const vector<BlockEntry> & entries, plint partOffset, plint nparts, map<plint,plint> & result) {
+  const plint n = entries.size();
+  if (n <= nparts) {
+    for (plint i = 0 ; i < n ; i++) {
+      result[entries[i].id] = partOffset + i;
+    }
+    return;
+  }
+
+  double total = 0.;
+  for (const BlockEntry & entry : entries) {
+    total += entry.weight;
+  }
+
+  plint part = 0;
+  plint inPart = 0;
+  double cumulative = 0.;
+  for (plint i = 0 ; i < n ; i++) {
+    const double w = entries[i].weight;
+    const double target = total*(part+1)/nparts;
+    const plint remainingParts = nparts - 1 - part;
+    if (inPart > 0 && remainingParts > 0 &&
+        (cumulative + 0.5*w > target || n - i <= remainingParts)) {
+      part++;
+      inPart = 0;
+    }
+    result[entries[i].id] = partOffset + part;
+    cumulative += w;
+    inPart++;
+  }
+}
+
+void bisect(vector<BlockEntry> & entries, plint partOffset, plint nparts, map<plint,plint> & result) {
+  const plint n = entries.size();
+  if (nparts <= 1 || n <= nparts) {
+    splitOrdered(entries, partOffset, nparts, result);
+    return;
+  }
+
+  //Cut perpendicular to the longest extent of the block centers
+  plint lo[3] = {entries[0].center[0],entries[0].center[1],entries[0].center[2]};
+  plint hi[3] = {lo[0],lo[1],lo[2]};
+  double total = 0.;
+  for (const BlockEntry & entry : entries) {
+    for (int d = 0 ; d < 3 ; d++) {
+      lo[d] = std::min(lo[d],entry.center[d]);
+      hi[d] = std::max(hi[d],entry.center[d]);
+    }
+    total += entry.weight;
+  }
+  int axis = 0;
+  for (int d = 1 ; d < 3 ; d++) {
+    if (hi[d] - lo[d] > hi[axis] - lo[axis]) {
+      axis = d;
+    }
+  }
+  std::stable_sort(entries.begin(), entries.end(), [axis](const BlockEntry & a, const BlockEntry & b) {
+    return a.center[axis] < b.center[axis];
+  });
+
+  const plint nLeft = nparts/2;
+  const plint nRight = nparts - nLeft;
+  const double target = total*nLeft/nparts;
+  plint split = 0;
+  double cumulative = 0.;
+  while (split < n && cumulative + 0.5*entries[split].weight <= target) {
+    cumulative += entries[split].weight;
+    split++;
+  }
+  split = std::max(nLeft, std::min(split, n - nRight));
+
+  vector<BlockEntry> left(entries.begin(), entries.begin() + split);
+  vector<BlockEntry> right(entries.begin() + split, entries.end());
+  bisect(left, partOffset, nLeft, result);
+  bisect(right, partOffset + nLeft, nRight, result);
+}
+}
+
+map<plint,plint> partitionBlocksHilbert(const map<plint,Box3D> & bulks, const map<plint,double> & weights, plint nparts) {
+  map<plint,plint> result;
+  vector<BlockEntry> entries = createBlockEntries(bulks, weights);
+  if (entries.empty()) {
+    return result;
+  }
+
+  plint lo[3] = {entries[0].center[0],entries[0].center[1],entries[0].center[2]};
+  for (const BlockEntry & entry : entries) {
+    for (int d = 0 ; d < 3 ; d++) {
+      lo[d] = std::min(lo[d],entry.center[d]);
+    }
+  }
+
+  const unsigned int bits = 21;
+  const plint maxCoord = (plint(1) << bits) - 1;
+  vector<std::pair<uint64_t,plint>> keys;
+  keys.reserve(entries.size());
+  for (unsigned int i = 0 ; i < entries.size() ; i++) {
+    uint32_t c[3];
+    for (int d = 0 ; d < 3 ; d++) {
+      c[d] = std::min(entries[i].center[d] - lo[d], maxCoord);
+    }
+    keys.push_back(std::make_pair(hilbertIndex3D(c[0],c[1],c[2],bits), (plint)i));
+  }
+  std::sort(keys.begin(), keys.end());
+
+  vector<BlockEntry> ordered;
+  ordered.reserve(entries.size());
+  for (const auto & key : keys) {
+    ordered.push_back(entries[key.second]);
+  }
+  splitOrdered(ordered, 0, nparts, result);
+  return result;
+}
+
+map<plint,plint> partitionBlocksRCB(const map<plint,Box3D> & bulks, const map<plint,double> & weights, plint nparts) {
+  map<plint,plint> result;
+  vector<BlockEntry> entries = createBlockEntries(bulks, weights);
+  if (entries.empty()) {
+    return result;
+  }
+  bisect(entries, 0, nparts, result);
+  return result;
+}
+}
@@ -0,0 +1,63 @@
+/*
+This file is part of the HemoCell library
+
+HemoCell is developed and maintained by the Computational Science Lab 
+in the University of Amsterdam. Any questions or remarks regarding this library 
+can be sent to: info@hemocell.eu
+
+When using the HemoCell library in scientific work please cite the
+corresponding paper: https://doi.org/10.3389/fphys.2017.00563
+
+The HemoCell library is free software: you can redistribute it and/or
+modify it under the terms of the GNU Affero General Public License as
+published by the Free Software Foundation, either version 3 of the
+License, or (at your option) any later version.
+
+The library is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU Affero General Public License for more details.
+
+You should have received a copy of the GNU Affero General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+#ifndef HEMO_SPACEFILLINGCURVE_H
+#define HEMO_SPACEFILLINGCURVE_H
+
+#include <map>
+#include <vector>
+#include <stdint.h>
+
+#include "core/globalDefs.h"
+#include "core/geometry3D.h"
+
+namespace hemo {
+
+/**
+ * Native partitioners for the atomic blocks of a (sparse) block structure.
+ * They are used by the LoadBalancer when ParMETIS is not available, or when it
+ * is explicitly requested in the config (parameters/partitioner).
+ *
+ * Both functions take the bulk of every atomic block together with a weight
+ * (e.g. measured time or number of fluid nodes) and return a map from the
+ * atomic block id to the mpi process it should live on. The result only
+ * depends on the input, so every process can calculate it independently
+ * after the weights are gathered.
+ */
+
+/// Index of point (x,y,z) along a 3D Hilbert curve with 2^bits points per axis
+uint64_t hilbertIndex3D(uint32_t x, uint32_t y, uint32_t z, unsigned int bits = 21);
+
+/// Order blocks along a Hilbert curve through their centers and cut the curve
+/// into nparts consecutive pieces of (approximately) equal weight
+std::map<plb::plint,plb::plint> partitionBlocksHilbert(const std::map<plb::plint,plb::Box3D> & bulks,
+                                                       const std::map<plb::plint,double> & weights,
+                                                       plb::plint nparts);
+
+/// Recursively bisect the blocks along the longest axis of their centers,
+/// dividing the weight proportionally to the number of processes on each side
+std::map<plb::plint,plb::plint> partitionBlocksRCB(const std::map<plb::plint,plb::Box3D> & bulks,
+                                                   const std::map<plb::plint,double> & weights,
+                                                   plb::plint nparts);
+}
+#endif
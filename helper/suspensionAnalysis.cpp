@@ -0,0 +1,427 @@
+/*
+This file is part of the HemoCell library
+
+HemoCell is developed and maintained by the Computational Science Lab 
+in the University of Amsterdam. Any questions or remarks regarding this library 
+can be sent to: info@hemocell.eu
+
+When using the HemoCell library in scientific work please cite the
+corresponding paper: https://doi.org/10.3389/fphys.2017.00563
+
+The HemoCell library is free software: you can redistribute it and/or
+modify it under the terms of the GNU Affero General Public License as
+published by the Free Software Foundation, either version 3 of the
+License, or (at your option) any later version.
+
+The library is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU Affero General Public License for more details.
+
+You should have received a copy of the GNU Affero General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+#include "suspensionAnalysis.h"
+#include "hemoCellParticleField.h"
+#include "cellShape.h"
+#include "AsyncHdf5IO.h"
+#include "genericFunctions.h"
+#include "logfile.h"
+
+#include <hdf5.h>
+#include <hdf5_hl.h>
+#include <fstream>
+#include <limits>
+
+namespace hemo {
+
+SuspensionAnalysis * SuspensionAnalysis::fromConfig(Config & cfg) {
+  tinyxml2::XMLElement * orig;
+  try {
+    orig = cfg["parameters"]["analysis"].getOrig();
+  } catch (std::invalid_argument & e) {
+    return 0;
+  }
+  XMLElement analysisCfg(orig);
+  SuspensionAnalysis * analysis = new SuspensionAnalysis();
+
+  try {
+    analysis->interval = analysisCfg["interval"].read<unsigned int>();
+  } catch (std::invalid_argument & e) {}
+  try {
+    std::string binning = analysisCfg["bins"].read<std::string>();
+    if (binning == "axial") {
+      analysis->binning = Binning::Axial;
+    } else if (binning != "radial") {
+      hlog << "(SuspensionAnalysis) Error unknown bins \"" << binning << "\", use \"radial\" or \"axial\"" << std::endl;
+      exit(1);
+    }
+  } catch (std::invalid_argument & e) {}
+  try {
+    std::string axis = analysisCfg["axis"].read<std::string>();
+    if (axis != "x" && axis != "y" && axis != "z") {
+      hlog << "(SuspensionAnalysis) Error unknown axis \"" << axis << "\", use \"x\", \"y\" or \"z\"" << std::endl;
+      exit(1);
+    }
+    analysis->axis = axis[0] - 'x';
+  } catch (std::invalid_argument & e) {}
+  try {
+    analysis->nBins = analysisCfg["nBins"].read<unsigned int>();
+  } catch (std::invalid_argument & e) {}
+  //Lattice units, since param::dx is not known yet at this point
+  try {
+    std::stringstream range(analysisCfg["range"].getOrig()->GetText());
+    if (!(range >> analysis->binMin >> analysis->binMax) || analysis->binMax <= analysis->binMin) {
+      hlog << "(SuspensionAnalysis) Error range must be two increasing numbers [lu]" << std::endl;
+      exit(1);
+    }
+  } catch (std::invalid_argument & e) {}
+  try {
+    std::stringstream center(analysisCfg["center"].getOrig()->GetText());
+    if (!(center >> analysis->center[0] >> analysis->center[1])) {
+      hlog << "(SuspensionAnalysis) Error center must be two numbers [lu]" << std::endl;
+      exit(1);
+    }
+    analysis->centerSet = true;
+  } catch (std::invalid_argument & e) {}
+  try {
+    std::string format = analysisCfg["format"].read<std::string>();
+    if (format == "hdf5") {
+      analysis->hdf5 = true;
+    } else if (format != "csv") {
+      hlog << "(SuspensionAnalysis) Error unknown format \"" << format << "\", use \"csv\" or \"hdf5\"" << std::endl;
+      exit(1);
+    }
+  } catch (std::invalid_argument & e) {}
+
+  if (analysis->interval == 0 || analysis->nBins == 0) {
+    hlog << "(SuspensionAnalysis) Error interval and nBins must be at least 1" << std::endl;
+    exit(1);
+  }
+  hlog << "(SuspensionAnalysis) " << analysis->nBins << (analysis->binning == Binning::Radial ? " radial" : " axial")
+       << " bins, axis " << char('x'+analysis->axis) << " every " << analysis->interval << " iterations" << std::endl;
+  return analysis;
+}
+
+T SuspensionAnalysis::coordinate(hemo::Array<T,3> const & position) const {
+  if (binning == Binning::Axial) {
+    return position[axis];
+  }
+  const T da = position[(axis+1)%3] - center[0];
+  const T db = position[(axis+2)%3] - center[1];
+  return sqrt(da*da + db*db);
+}
+
+unsigned int SuspensionAnalysis::bin(T coordinate) const {
+  const plint b = plint(std::floor((coordinate-binMin)/(binMax-binMin)*nBins));
+  return b < 0 ? 0 : (b >= plint(nBins) ? nBins-1 : b);
+}
+
+void SuspensionAnalysis::initialize(HemoCell & hemocell) {
+  const Box3D bb = hemocell.lattice->getBoundingBox();
+  const plint lo[3] = {bb.x0, bb.y0, bb.z0};
+  const plint hi[3] = {bb.x1, bb.y1, bb.z1};
+  const unsigned int a = (axis+1)%3, b = (axis+2)%3;
+  if (!centerSet) {
+    center[0] = (lo[a]+hi[a])/2.;
+    center[1] = (lo[b]+hi[b])/2.;
+  }
+  if (binMax <= binMin) {
+    if (binning == Binning::Axial) {
+      binMin = lo[axis] - 0.5;
+      binMax = hi[axis] + 0.5;
+    } else {
+      binMin = 0;
+      binMax = std::min(hi[a]-lo[a],hi[b]-lo[b])/2. + 0.5;
+    }
+  }
+
+  //The geometry does not change, so the fluid volume of the bins is only counted once
+  fluidNodes.assign(nBins,0.);
+  vector<MultiBlock3D*> wrapper;
+  wrapper.push_back(hemocell.lattice);
+  applyProcessingFunctional(new CountFluidNodes(*this,fluidNodes),hemocell.lattice->getBoundingBox(),wrapper);
+  if (global::mpi().getRank()) {
+    MPI_Reduce(&fluidNodes[0],0,nBins,MPI_DOUBLE,MPI_SUM,0,MPI_COMM_WORLD);
+  } else {
+    MPI_Reduce(MPI_IN_PLACE,&fluidNodes[0],nBins,MPI_DOUBLE,MPI_SUM,0,MPI_COMM_WORLD);
+  }
+}
+
+void SuspensionAnalysis::run(HemoCell & hemocell) {
+  global.statistics.getCurrent()["suspensionAnalysis"].start();
+  if (fluidNodes.empty()) {
+    initialize(hemocell);
+  }
+  hemocell.cellfields->syncEnvelopes();
+
+  const unsigned int rows = hemocell.cellfields->size()*nBins;
+  vector<double> sums(rows*NColumns,0.);
+  vector<double> extents(rows,std::numeric_limits<double>::lowest());
+  vector<MultiBlock3D*> wrapper;
+  wrapper.push_back(hemocell.cellfields->immersedParticles);
+  applyProcessingFunctional(new BinCells(*this,hemocell,sums,extents),hemocell.cellfields->immersedParticles->getBoundingBox(),wrapper);
+
+  //Fixed size tables, so the root only receives kilobytes regardless of the number of cells
+  if (global::mpi().getRank()) {
+    MPI_Reduce(&sums[0],0,sums.size(),MPI_DOUBLE,MPI_SUM,0,MPI_COMM_WORLD);
+    MPI_Reduce(&extents[0],0,extents.size(),MPI_DOUBLE,MPI_MAX,0,MPI_COMM_WORLD);
+  } else {
+    MPI_Reduce(MPI_IN_PLACE,&sums[0],sums.size(),MPI_DOUBLE,MPI_SUM,0,MPI_COMM_WORLD);
+    MPI_Reduce(MPI_IN_PLACE,&extents[0],extents.size(),MPI_DOUBLE,MPI_MAX,0,MPI_COMM_WORLD);
+    write(hemocell,sums,extents);
+  }
+  global.statistics.getCurrent().stop();
+}
+
+void SuspensionAnalysis::write(HemoCell & hemocell, vector<double> const & sums, vector<double> const & extents) {
+  static const char * columns[] = {"iteration","celltype","bin","binStart","binEnd","cells","volumeFraction",
+                                   "meanVolume","meanElongation","stdElongation","maxExtent"};
+  const unsigned int nColumns = sizeof(columns)/sizeof(columns[0]);
+  const double dx = hemocell.outputInSiUnits ? param::dx : 1.;
+  const unsigned int rows = hemocell.cellfields->size()*nBins;
+
+  vector<double> table(rows*nColumns);
+  for (unsigned int ctype = 0 ; ctype < hemocell.cellfields->size() ; ctype++) {
+    for (unsigned int b = 0 ; b < nBins ; b++) {
+      const unsigned int row = ctype*nBins + b;
+      const double * sum = &sums[row*NColumns];
+      const double cells = sum[Cells];
+      const double meanElongation = cells ? sum[Elongation]/cells : 0.;
+      double * out = &table[row*nColumns];
+      out[0] = hemocell.iter;
+      out[1] = ctype;
+      out[2] = b;
+      out[3] = (binMin + (binMax-binMin)*b/nBins)*dx;
+      out[4] = (binMin + (binMax-binMin)*(b+1)/nBins)*dx;
+      out[5] = cells;
+      out[6] = fluidNodes[b] ? sum[Volume]/fluidNodes[b] : 0.;
+      out[7] = cells ? sum[Volume]/cells*dx*dx*dx : 0.;
+      out[8] = meanElongation;
+      out[9] = cells ? sqrt(std::max(0.,sum[Elongation2]/cells - meanElongation*meanElongation)) : 0.;
+      out[10] = cells ? extents[row]*dx : 0.;
+    }
+  }
+
+  if (!hdf5) {
+    std::string folder = global::directories().getOutputDir() + "/csv/";
+    mkpath(folder.c_str(),0777);
+    std::string fileName = folder + "analysis.csv";
+    const bool header = !file_exists(fileName);
+    ofstream csvFile(fileName, ofstream::app);
+    if (header) {
+      for (unsigned int c = 0 ; c < nColumns ; c++) {
+        csvFile << (c ? "," : "") << columns[c];
+      }
+      csvFile << "\n";
+    }
+    for (unsigned int row = 0 ; row < rows ; row++) {
+      const double * out = &table[row*nColumns];
+      csvFile << plint(out[0]) << "," << (*hemocell.cellfields)[(unsigned int)out[1]]->name << "," << plint(out[2]);
+      for (unsigned int c = 3 ; c < nColumns ; c++) {
+        csvFile << "," << out[c];
+      }
+      csvFile << "\n";
+    }
+    return;
+  }
+
+  //The I/O thread of asyncOutput may still be writing the previous output
+  if (hemocell.asyncOutput) {
+    hemocell.asyncOutput->wait();
+  }
+
+  //One growing (rows x columns) dataset, the celltype is its index in the celltypes attribute
+  std::string fileName = global::directories().getOutputDir() + "/hdf5/analysis.h5";
+  hsize_t dims[2] = {rows, nColumns};
+  hid_t file_id;
+  if (file_exists(fileName)) {
+    file_id = H5Fopen(fileName.c_str(), H5F_ACC_RDWR, H5P_DEFAULT);
+    hid_t dataset_id = H5Dopen2(file_id, "Analysis", H5P_DEFAULT);
+    hid_t space_id = H5Dget_space(dataset_id);
+    hsize_t current[2];
+    H5Sget_simple_extent_dims(space_id, current, NULL);
+    H5Sclose(space_id);
+    hsize_t size[2] = {current[0]+rows, nColumns};
+    hsize_t start[2] = {current[0], 0};
+    H5Dset_extent(dataset_id, size);
+    space_id = H5Dget_space(dataset_id);
+    H5Sselect_hyperslab(space_id, H5S_SELECT_SET, start, NULL, dims, NULL);
+    hid_t memspace_id = H5Screate_simple(2, dims, NULL);
+    H5Dwrite(dataset_id, H5T_NATIVE_DOUBLE, memspace_id, space_id, H5P_DEFAULT, &table[0]);
+    H5Sclose(memspace_id);
+    H5Sclose(space_id);
+    H5Dclose(dataset_id);
+  } else {
+    file_id = H5Fcreate(fileName.c_str(), H5F_ACC_TRUNC, H5P_DEFAULT, H5P_DEFAULT);
+    hsize_t maxDims[2] = {H5S_UNLIMITED, nColumns};
+    hid_t space_id = H5Screate_simple(2, dims, maxDims);
+    hid_t plist_id = H5Pcreate(H5P_DATASET_CREATE);
+    H5Pset_chunk(plist_id, 2, dims);
+    hid_t dataset_id = H5Dcreate2(file_id, "Analysis", H5T_NATIVE_DOUBLE, space_id, H5P_DEFAULT, plist_id, H5P_DEFAULT);
+    H5Dwrite(dataset_id, H5T_NATIVE_DOUBLE, H5S_ALL, H5S_ALL, H5P_DEFAULT, &table[0]);
+    H5Pclose(plist_id);
+    H5Sclose(space_id);
+    H5Dclose(dataset_id);
+
+    std::string columnNames, celltypes;
+    for (unsigned int c = 0 ; c < nColumns ; c++) {
+      columnNames += (c ? "," : "") + std::string(columns[c]);
+    }
+    for (unsigned int ctype = 0 ; ctype < hemocell.cellfields->size() ; ctype++) {
+      celltypes += (ctype ? "," : "") + (*hemocell.cellfields)[ctype]->name;
+    }
+    H5LTset_attribute_string(file_id, "Analysis", "columns", columnNames.c_str());
+    H5LTset_attribute_string(file_id, "Analysis", "celltypes", celltypes.c_str());
+  }
+  H5Fclose(file_id);
+}
+
+void SuspensionAnalysis::restart(HemoCell & hemocell, plint iteration) {
+  if (global::mpi().getRank()) {
+    return;
+  }
+
+  if (!hdf5) {
+    std::string fileName = global::directories().getOutputDir() + "/csv/analysis.csv";
+    if (!file_exists(fileName)) {
+      return;
+    }
+    vector<std::string> lines;
+    {
+      ifstream csvFile(fileName);
+      std::string line;
+      while (std::getline(csvFile,line)) {
+        //The header and the rows before the checkpoint are kept
+        if (!lines.empty() && !line.empty() && std::stol(line) >= iteration) {
+          break;
+        }
+        lines.push_back(line);
+      }
+    }
+    ofstream csvFile(fileName, ofstream::trunc);
+    for (std::string const & line : lines) {
+      csvFile << line << "\n";
+    }
+    return;
+  }
+
+  if (hemocell.asyncOutput) {
+    hemocell.asyncOutput->wait();
+  }
+  std::string fileName = global::directories().getOutputDir() + "/hdf5/analysis.h5";
+  if (!file_exists(fileName)) {
+    return;
+  }
+  hid_t file_id = H5Fopen(fileName.c_str(), H5F_ACC_RDWR, H5P_DEFAULT);
+  hid_t dataset_id = H5Dopen2(file_id, "Analysis", H5P_DEFAULT);
+  hid_t space_id = H5Dget_space(dataset_id);
+  hsize_t current[2];
+  H5Sget_simple_extent_dims(space_id, current, NULL);
+  H5Sclose(space_id);
+
+  //Rows are appended in order of iteration, only the first column is needed
+  vector<double> iterations(current[0]);
+  if (current[0]) {
+    hsize_t start[2] = {0, 0};
+    hsize_t count[2] = {current[0], 1};
+    space_id = H5Dget_space(dataset_id);
+    H5Sselect_hyperslab(space_id, H5S_SELECT_SET, start, NULL, count, NULL);
+    hid_t memspace_id = H5Screate_simple(2, count, NULL);
+    H5Dread(dataset_id, H5T_NATIVE_DOUBLE, memspace_id, space_id, H5P_DEFAULT, &iterations[0]);
+    H5Sclose(memspace_id);
+    H5Sclose(space_id);
+  }
+  hsize_t keep = 0;
+  while (keep < current[0] && iterations[keep] < iteration) {
+    keep++;
+  }
+  if (keep < current[0]) {
+    hsize_t size[2] = {keep, current[1]};
+    H5Dset_extent(dataset_id, size);
+  }
+  H5Dclose(dataset_id);
+  H5Fclose(file_id);
+}
+
+void SuspensionAnalysis::CountFluidNodes::processGenericBlocks(Box3D domain, std::vector<AtomicBlock3D*> blocks) {
+  BlockLattice3D<T,DESCRIPTOR>* ff = dynamic_cast<BlockLattice3D<T,DESCRIPTOR>*>(blocks[0]);
+  const Dot3D location = ff->getLocation();
+  for (plint iX=domain.x0; iX<=domain.x1; ++iX) {
+    for (plint iY=domain.y0; iY<=domain.y1; ++iY) {
+      for (plint iZ=domain.z0; iZ<=domain.z1; ++iZ) {
+        if (ff->get(iX,iY,iZ).getDynamics().isBoundary()) { continue ; }
+        const hemo::Array<T,3> position = {T(iX+location.x), T(iY+location.y), T(iZ+location.z)};
+        counts[analysis.bin(analysis.coordinate(position))] += 1;
+      }
+    }
+  }
+}
+
+void SuspensionAnalysis::BinCells::processGenericBlocks(Box3D domain, std::vector<AtomicBlock3D*> blocks) {
+  HemoCellParticleField* pf = dynamic_cast<HemoCellParticleField*>(blocks[0]);
+  const map<int,vector<int>> & ppc = pf->get_particles_per_cell();
+  vector<hemo::Array<T,3>> vertices;
+
+  for (const auto & pair : pf->get_lpc()) {
+    const int & cid = pair.first;
+    if (ppc.find(cid) == ppc.end()) { continue; }
+    const vector<int> & cell = ppc.at(cid);
+    if (cell[0] == -1) { continue; }
+
+    hemo::Array<T,3> position = {0.,0.,0.};
+    vertices.clear();
+    for (const int pid : cell) {
+      if (pid == -1) { goto ignore_cell; }
+      position += pf->particles[pid].sv.position;
+      vertices.push_back(pf->particles[pid].sv.position);
+    }
+    position /= T(cell.size());
+    //Every cell is counted once, by the block that holds its centroid
+    if (!pf->isContainedABS(position,pf->localDomain)) { continue; }
+
+    {
+      const pluint ctype = pf->particles[cell[0]].sv.celltype;
+      T volume = 0.;
+      if (const CellState * state = pf->freshCellState(cid)) {
+        volume = state->volume; //Published by the mechanics for the current positions
+      } else {
+        for (const hemo::Array<plint,3> & triangle : (*hemocell.cellfields)[ctype]->mechanics->cellConstants.triangle_list) {
+          const hemo::Array<T,3> & v0 = pf->particles[cell[triangle[0]]].sv.position;
+          const hemo::Array<T,3> & v1 = pf->particles[cell[triangle[1]]].sv.position;
+          const hemo::Array<T,3> & v2 = pf->particles[cell[triangle[2]]].sv.position;
+          const T v210 = v2[0]*v1[1]*v0[2];
+          const T v120 = v1[0]*v2[1]*v0[2];
+          const T v201 = v2[0]*v0[1]*v1[2];
+          const T v021 = v0[0]*v2[1]*v1[2];
+          const T v102 = v1[0]*v0[1]*v2[2];
+          const T v012 = v0[0]*v1[1]*v2[2];
+          volume += (-v210+v120+v201-v021-v102+v012);
+        }
+        volume *= (1.0/6.0);
+      }
+
+      //Along the principal axes, so it does not depend on the orientation of the cell
+      const T elongation = computeCellShape(vertices).elongation;
+
+      T extent = std::numeric_limits<T>::lowest();
+      for (const int pid : cell) {
+        extent = std::max(extent,analysis.coordinate(pf->particles[pid].sv.position));
+      }
+
+      const unsigned int row = ctype*analysis.nBins + analysis.bin(analysis.coordinate(position));
+      double * sum = &sums[row*NColumns];
+      sum[Cells] += 1;
+      sum[Volume] += volume;
+      sum[Elongation] += elongation;
+      sum[Elongation2] += elongation*elongation;
+      extents[row] = std::max(extents[row],double(extent));
+    }
+ignore_cell:;
+  }
+}
+
+SuspensionAnalysis::CountFluidNodes * SuspensionAnalysis::CountFluidNodes::clone() const { return new SuspensionAnalysis::CountFluidNodes(*this); }
+SuspensionAnalysis::BinCells * SuspensionAnalysis::BinCells::clone() const { return new SuspensionAnalysis::BinCells(*this); }
+
+}
@@ -0,0 +1,111 @@
+/*
+This file is part of the HemoCell library
+
+HemoCell is developed and maintained by the Computational Science Lab 
+in the University of Amsterdam. Any questions or remarks regarding this library 
+can be sent to: info@hemocell.eu
+
+When using the HemoCell library in scientific work please cite the
+corresponding paper: https://doi.org/10.3389/fphys.2017.00563
+
+The HemoCell library is free software: you can redistribute it and/or
+modify it under the terms of the GNU Affero General Public License as
+published by the Free Software Foundation, either version 3 of the
+License, or (at your option) any later version.
+
+The library is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU Affero General Public License for more details.
+
+You should have received a copy of the GNU Affero General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+#ifndef SUSPENSIONANALYSIS_H
+#define SUSPENSIONANALYSIS_H
+
+#include "hemocell.h"
+#include "hemoCellFunctional.h"
+#include "array.h"
+
+namespace hemo {
+
+/* In-situ binned statistics of the cells (parameters/analysis)
+ *
+ * Every interval iterations the cells are binned per celltype by the position
+ * of their centroid, either by the distance to an axis (radial) or along it
+ * (axial). Each process sums the cells whose centroid is in one of its blocks,
+ * the sums are reduced to the root process, which appends one row per celltype
+ * and bin to csv/analysis.csv or hdf5/analysis.h5:
+ *
+ *   iteration, celltype, bin, binStart, binEnd, cells, volumeFraction,
+ *   meanVolume, meanElongation, stdElongation, maxExtent
+ *
+ * volumeFraction is the cell volume over the fluid volume of the bin (the
+ * hematocrit for RBC), the elongation is (L-S)/(L+S) of the longest and
+ * shortest principal length of a cell (CellShape::elongation), maxExtent is
+ * the largest distance (radial) or position (axial) reached by a vertex of the
+ * cells of the bin, from which the cell-free layer follows.
+ */
+class SuspensionAnalysis {
+public:
+  enum class Binning { Radial, Axial };
+
+  /// Read parameters/analysis, returns 0 when it is not present
+  static SuspensionAnalysis * fromConfig(Config & cfg);
+
+  /// Compute and write the statistics of the current iteration
+  void run(HemoCell & hemocell);
+  /// Drop the rows of iteration and later, which are written again after restarting from a checkpoint there
+  void restart(HemoCell & hemocell, plint iteration);
+
+  unsigned int interval = 1;
+private:
+  Binning binning = Binning::Radial;
+  /// Axis of the vessel (0,1,2), radial bins are around it, axial bins along it
+  unsigned int axis = 0;
+  unsigned int nBins = 20;
+  /// Binned range [lu], taken from the lattice when not set
+  T binMin = 0, binMax = -1;
+  /// Position of the axis in the other two directions [lu], the center of the lattice when not set
+  hemo::Array<T,2> center = {0.,0.};
+  bool centerSet = false;
+  bool hdf5 = false;
+
+  /// Fluid nodes per bin, counted on the first run
+  vector<double> fluidNodes;
+
+  /// Values summed per celltype and bin
+  enum Column { Cells, Volume, Elongation, Elongation2, NColumns };
+
+  /// Binned coordinate of a position [lu]
+  T coordinate(hemo::Array<T,3> const & position) const;
+  /// Bin of a coordinate, the outer bins take everything outside of the range
+  unsigned int bin(T coordinate) const;
+
+  void initialize(HemoCell & hemocell);
+  void write(HemoCell & hemocell, vector<double> const & sums, vector<double> const & extents);
+
+  class CountFluidNodes : public HemoCellFunctional {
+    SuspensionAnalysis & analysis;
+    vector<double> & counts;
+  public:
+    CountFluidNodes(SuspensionAnalysis & analysis_, vector<double> & counts_) : analysis(analysis_), counts(counts_) {}
+    void processGenericBlocks(plb::Box3D, std::vector<plb::AtomicBlock3D*>);
+    CountFluidNodes * clone() const;
+  };
+  class BinCells : public HemoCellFunctional {
+    SuspensionAnalysis & analysis;
+    HemoCell & hemocell;
+    vector<double> & sums;
+    vector<double> & extents;
+  public:
+    BinCells(SuspensionAnalysis & analysis_, HemoCell & hemocell_, vector<double> & sums_, vector<double> & extents_) :
+      analysis(analysis_), hemocell(hemocell_), sums(sums_), extents(extents_) {}
+    void processGenericBlocks(plb::Box3D, std::vector<plb::AtomicBlock3D*>);
+    BinCells * clone() const;
+  };
+};
+
+}
+#endif /* SUSPENSIONANALYSIS_H */
@@ -25,14 +25,23 @@ You should have received a copy of the GNU Affero General Public License
 along with this program.  If not, see <http://www.gnu.org/licenses/>.
 */
 
+#include <mpi.h>
+
 #include "constant_defaults.h"
 #include "voxelizeDomain.h"
 #include "logfile.h"
+#include "config.h"
 
 #include "palabos3D.h"
 #include "palabos3D.hh"
 #include "genericFunctions.h"
 
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <iomanip>
+#include <sstream>
+
 namespace hemo {
   using namespace std;
   using namespace plb;
@@ -61,6 +70,240 @@ BlockDomain::DomainT CopyFromNeighbor::appliesTo() const {
 }
 
 
+// ---------------------- Flag matrix cache ------------------------------------
+
+namespace {
+  const char flagCacheMagic[8] = {'H','C','F','L','A','G','S','2'};
+
+  struct FlagCacheHeader {
+    char magic[8];
+    uint64_t key;
+    int64_t boundingBox[6];
+    int64_t nBlocks;
+    /// Number of processors of the run that wrote the file
+    int64_t nProcs;
+  };
+
+  /// Bulk of an atomic block, the position of its flags (one byte per node, x-major) and its processor
+  struct FlagCacheBlock {
+    int64_t id;
+    int64_t bulk[6];
+    uint64_t offset;
+    int64_t rank;
+  };
+
+  // FNV-1a
+  void hashBytes(uint64_t & hash, const void * data, size_t size) {
+    for (size_t i = 0 ; i < size ; i++) {
+      hash ^= ((const unsigned char *)data)[i];
+      hash *= 1099511628211ULL;
+    }
+  }
+
+  /// Hash of the STL contents and the voxelization parameters, computed on the root
+  uint64_t flagCacheKey(const string & meshFileName, plint extendedEnvelopeWidth, plint refDirLength, plint refDir, plint blockSize) {
+    uint64_t key = 14695981039346656037ULL;
+    if (global::mpi().getRank() == 0) {
+      hashBytes(key, flagCacheMagic, sizeof(flagCacheMagic));
+      const int64_t parameters[4] = {extendedEnvelopeWidth, refDirLength, refDir, blockSize};
+      hashBytes(key, parameters, sizeof(parameters));
+      ifstream stl(meshFileName, ios::binary);
+      vector<char> chunk(1 << 20);
+      while (stl.read(chunk.data(), chunk.size()) || stl.gcount()) {
+        hashBytes(key, chunk.data(), stl.gcount());
+      }
+    }
+    MPI_Bcast(&key, 1, MPI_UINT64_T, 0, MPI_COMM_WORLD);
+    return key;
+  }
+
+  Box3D toBox(const int64_t b[6]) { return Box3D(b[0],b[1],b[2],b[3],b[4],b[5]); }
+
+  /// True on every processor when it is true on all of them
+  bool allTrue(bool value) {
+    int local = value, all = 0;
+    MPI_Allreduce(&local, &all, 1, MPI_INT, MPI_MIN, MPI_COMM_WORLD);
+    return all;
+  }
+
+  /// The header and block table describe the whole file: the blocks lie in the
+  /// bounding box and their flags follow the table back to back up to the end
+  bool validFlagCacheTable(const FlagCacheHeader & header, const vector<FlagCacheBlock> & table, uint64_t fileSize) {
+    const Box3D bb = toBox(header.boundingBox);
+    uint64_t offset = sizeof(FlagCacheHeader) + table.size()*sizeof(FlagCacheBlock);
+    for (FlagCacheBlock const & block : table) {
+      const Box3D bulk = toBox(block.bulk);
+      if (bulk.x0 > bulk.x1 || bulk.y0 > bulk.y1 || bulk.z0 > bulk.z1 || !contained(bulk, bb)
+          || block.offset != offset || block.rank < 0 || block.rank >= header.nProcs) {
+        return false;
+      }
+      offset += bulk.nCells();
+    }
+    return offset == fileSize;
+  }
+}
+
+// ---------------------- Flag matrix cache ------------------------------------
+
+MultiScalarField3D<int> * readFlagCache(const string & fileName, uint64_t key, plint envelopeWidth) {
+  FlagCacheHeader header;
+  vector<FlagCacheBlock> table;
+  int found = 0;
+  if (global::mpi().getRank() == 0) {
+    ifstream in(fileName, ios::binary | ios::ate);
+    const uint64_t fileSize = in ? uint64_t(in.tellg()) : 0;
+    in.seekg(0);
+    if (in.read((char *)&header, sizeof(header)) && !memcmp(header.magic, flagCacheMagic, 8) && header.key == key) {
+      if (header.nBlocks > 0 && header.nProcs > 0
+          && uint64_t(header.nBlocks) <= (fileSize - sizeof(header))/sizeof(FlagCacheBlock)) {
+        table.resize(header.nBlocks);
+        found = in.read((char *)table.data(), table.size()*sizeof(FlagCacheBlock))
+                && validFlagCacheTable(header, table, fileSize);
+      }
+      if (!found) {
+        hlog << "(Voxelizer) (Warning) The flag matrix cache " << fileName << " is damaged, voxelizing again" << endl;
+      }
+    }
+  }
+  MPI_Bcast(&found, 1, MPI_INT, 0, MPI_COMM_WORLD);
+  if (!found) {
+    return 0;
+  }
+  MPI_Bcast(&header, sizeof(header), MPI_BYTE, 0, MPI_COMM_WORLD);
+  table.resize(header.nBlocks);
+  MPI_Bcast(table.data(), table.size()*sizeof(FlagCacheBlock), MPI_BYTE, 0, MPI_COMM_WORLD);
+
+  // Same structure as the voxelizer made. With as many processors as the run
+  // that wrote the file, every block goes to the processor it had then. Otherwise
+  // the blocks are spread linearly over the processors, until the load balancer
+  // or initializeLattice() with the flag matrix redistributes them.
+  SparseBlockStructure3D structure(toBox(header.boundingBox));
+  map<plint,plint> blockToMpi;
+  map<plint,const FlagCacheBlock *> blocks;
+  const plint nProcs = global::mpi().getSize();
+  for (unsigned int i = 0 ; i < table.size() ; i++) {
+    structure.addBlock(toBox(table[i].bulk), table[i].id);
+    blockToMpi[table[i].id] = header.nProcs == nProcs ? table[i].rank : (plint(i) * nProcs) / table.size();
+    blocks[table[i].id] = &table[i];
+  }
+  MultiBlockManagement3D management(structure, new ExplicitThreadAttribution(blockToMpi), envelopeWidth);
+  MultiScalarField3D<int> * flagMatrix = new MultiScalarField3D<int>(management,
+          defaultMultiBlockPolicy3D().getBlockCommunicator(),
+          defaultMultiBlockPolicy3D().getCombinedStatistics(),
+          defaultMultiBlockPolicy3D().getMultiScalarAccess<int>(),
+          0);
+
+  // Every processor reads only the bulks of its own blocks
+  MPI_File file = MPI_FILE_NULL;
+  bool ok = MPI_File_open(MPI_COMM_WORLD, fileName.c_str(), MPI_MODE_RDONLY, MPI_INFO_NULL, &file) == MPI_SUCCESS;
+  vector<unsigned char> flags;
+  for (plint id : flagMatrix->getLocalInfo().getBlocks()) {
+    if (!ok) {
+      break;
+    }
+    const Box3D bulk = toBox(blocks[id]->bulk);
+    flags.resize(bulk.nCells());
+    MPI_Status status;
+    int count = 0;
+    ok = MPI_File_read_at(file, blocks[id]->offset, flags.data(), flags.size(), MPI_BYTE, &status) == MPI_SUCCESS
+         && MPI_Get_count(&status, MPI_BYTE, &count) == MPI_SUCCESS && count == int(flags.size());
+    if (!ok) {
+      break;
+    }
+    ScalarField3D<int> & field = flagMatrix->getComponent(id);
+    const Dot3D location = field.getLocation();
+    plint i = 0;
+    for (plint x = bulk.x0 ; x <= bulk.x1 ; x++) {
+      for (plint y = bulk.y0 ; y <= bulk.y1 ; y++) {
+        for (plint z = bulk.z0 ; z <= bulk.z1 ; z++) {
+          field.get(x - location.x, y - location.y, z - location.z) = flags[i++];
+        }
+      }
+    }
+  }
+  if (file != MPI_FILE_NULL) {
+    MPI_File_close(&file);
+  }
+  if (!allTrue(ok)) {
+    hlog << "(Voxelizer) (Warning) Could not read the flag matrix cache " << fileName << ", voxelizing again" << endl;
+    delete flagMatrix;
+    return 0;
+  }
+  flagMatrix->getBlockCommunicator().duplicateOverlaps(*flagMatrix, modif::staticVariables);
+  return flagMatrix;
+}
+
+bool writeFlagCache(const string & fileName, uint64_t key, MultiScalarField3D<int> & flagMatrix) {
+  MultiBlockManagement3D const & management = flagMatrix.getMultiBlockManagement();
+  SparseBlockStructure3D const & structure = management.getSparseBlockStructure();
+  FlagCacheHeader header;
+  memcpy(header.magic, flagCacheMagic, 8);
+  header.key = key;
+  const Box3D bb = structure.getBoundingBox();
+  const int64_t boundingBox[6] = {bb.x0, bb.x1, bb.y0, bb.y1, bb.z0, bb.z1};
+  memcpy(header.boundingBox, boundingBox, sizeof(boundingBox));
+  header.nBlocks = structure.getBulks().size();
+  header.nProcs = global::mpi().getSize();
+
+  vector<FlagCacheBlock> table;
+  map<plint,uint64_t> offsets;
+  uint64_t offset = sizeof(FlagCacheHeader) + header.nBlocks*sizeof(FlagCacheBlock);
+  for (auto const & pair : structure.getBulks()) {
+    const Box3D & b = pair.second;
+    table.push_back({pair.first, {b.x0, b.x1, b.y0, b.y1, b.z0, b.z1}, offset,
+                     management.getThreadAttribution().getMpiProcess(pair.first)});
+    offsets[pair.first] = offset;
+    offset += b.nCells();
+  }
+
+  const string tmpName = fileName + ".tmp";
+  MPI_File file = MPI_FILE_NULL;
+  if (!allTrue(MPI_File_open(MPI_COMM_WORLD, tmpName.c_str(), MPI_MODE_CREATE | MPI_MODE_WRONLY, MPI_INFO_NULL, &file) == MPI_SUCCESS)) {
+    if (file != MPI_FILE_NULL) {
+      MPI_File_close(&file);
+    }
+    hlog << "(Voxelizer) (Warning) Could not write the flag matrix cache " << fileName << endl;
+    return false;
+  }
+  // MPI_MODE_CREATE keeps the tail of a longer temporary file left by an earlier run
+  bool ok = MPI_File_set_size(file, 0) == MPI_SUCCESS;
+  if (global::mpi().getRank() == 0) {
+    ok = ok && MPI_File_write_at(file, 0, &header, sizeof(header), MPI_BYTE, MPI_STATUS_IGNORE) == MPI_SUCCESS
+         && MPI_File_write_at(file, sizeof(header), table.data(), table.size()*sizeof(FlagCacheBlock), MPI_BYTE, MPI_STATUS_IGNORE) == MPI_SUCCESS;
+  }
+  vector<unsigned char> flags;
+  for (plint id : flagMatrix.getLocalInfo().getBlocks()) {
+    Box3D bulk;
+    structure.getBulk(id, bulk);
+    ScalarField3D<int> & field = flagMatrix.getComponent(id);
+    const Dot3D location = field.getLocation();
+    flags.clear();
+    for (plint x = bulk.x0 ; x <= bulk.x1 ; x++) {
+      for (plint y = bulk.y0 ; y <= bulk.y1 ; y++) {
+        for (plint z = bulk.z0 ; z <= bulk.z1 ; z++) {
+          flags.push_back(field.get(x - location.x, y - location.y, z - location.z));
+        }
+      }
+    }
+    ok = ok && MPI_File_write_at(file, offsets[id], flags.data(), flags.size(), MPI_BYTE, MPI_STATUS_IGNORE) == MPI_SUCCESS;
+  }
+  ok = MPI_File_close(&file) == MPI_SUCCESS && ok;
+  // Only a completely written file is renamed into place
+  ok = allTrue(ok);
+  if (global::mpi().getRank() == 0) {
+    if (ok) {
+      ok = rename(tmpName.c_str(), fileName.c_str()) == 0;
+    } else {
+      remove(tmpName.c_str());
+    }
+  }
+  ok = allTrue(ok);
+  if (!ok) {
+    hlog << "(Voxelizer) (Warning) Could not write the flag matrix cache " << fileName << endl;
+  }
+  return ok;
+}
+
 // ---------------------- Read in STL geometry ---------------------------------
 
 void getFlagMatrixFromSTL(std::string meshFileName, plb::plint extendedEnvelopeWidth, plb::plint refDirLength, plb::plint refDir,
@@ -86,6 +329,24 @@ void getFlagMatrixFromSTL(std::string meshFileName, plint extendedEnvelopeWidth,
       hlog << "(Voxelizer) Error: " << meshFileName << " is not an existing stl file." << endl;
       exit(1);
     }
+
+    string cacheFile;
+    uint64_t cacheKey = 0;
+    if (!global.flagMatrixCache.empty()) {
+      cacheKey = flagCacheKey(meshFileName, extendedEnvelopeWidth, refDirLength, refDir, blockSize);
+      stringstream name;
+      string stlName = meshFileName.substr(meshFileName.find_last_of('/') + 1);
+      name << global.flagMatrixCache << "/" << stlName << "." << hex << setw(16) << setfill('0') << cacheKey << ".flags";
+      cacheFile = name.str();
+      flagMatrix = readFlagCache(cacheFile, cacheKey, extendedEnvelopeWidth);
+      if (flagMatrix) {
+        // There is no voxelized domain, use flagMatrix->getMultiBlockManagement() instead
+        voxelizedDomain = 0;
+        hlog << "(Voxelizer) Read the flag matrix from " << cacheFile << endl;
+        hlog << getMultiBlockInfo(*flagMatrix) << std::endl;
+        return;
+      }
+    }
     
     TriangleSet<T> *triangleSet = new TriangleSet<T>(meshFileName, DBL);
 
@@ -149,6 +410,11 @@ void getFlagMatrixFromSTL(std::string meshFileName, plint extendedEnvelopeWidth,
     domain = Box3D(nx - 2, nx - 1, 0, ny - 1, 0, nz - 1);
     applyProcessingFunctional(new CopyFromNeighbor(hemo::Array<plint, 3>({-1, 0, 0})), domain, *flagMatrix);
 
+    if (!cacheFile.empty()) {
+      if (writeFlagCache(cacheFile, cacheKey, *flagMatrix)) {
+        hlog << "(Voxelizer) Wrote the flag matrix to " << cacheFile << endl;
+      }
+    }
 }
 
 }
@@ -47,6 +47,14 @@ private:
     hemo::Array<plb::plint, 3> offset;
 };
 
+/// Collective. Reads the flag matrix cache written by writeFlagCache, every
+/// processor reads the flags of its own blocks. Returns 0 when the file does
+/// not exist, belongs to another key or is damaged
+plb::MultiScalarField3D<int> * readFlagCache(const std::string & fileName, uint64_t key, plb::plint envelopeWidth);
+/// Collective. Writes the block structure and flags of flagMatrix, true on every
+/// processor when the file is in place (see parameters/flagMatrixCache)
+bool writeFlagCache(const std::string & fileName, uint64_t key, plb::MultiScalarField3D<int> & flagMatrix);
+
 void getFlagMatrixFromSTL(std::string meshFileName, plb::plint extendedEnvelopeWidth, plb::plint refDirLength, plb::plint refDir,
                           plb::VoxelizedDomain3D<T> *&voxelizedDomain, plb::MultiScalarField3D<int> *&flagMatrix, plint blockSize, int particleEnvelope = 0);
 void getFlagMatrixFromSTL(std::string meshFileName, plb::plint extendedEnvelopeWidth, plb::plint refDirLength, plb::plint refDir,
@@ -41,6 +41,7 @@ along with this program.  If not, see <http://www.gnu.org/licenses/>.
 
 /* Helpers */
 #include "preInlet.h"
+#include "interiorViscosityDynamics.h"
 // #include "leesEdwardsBC.h"
 
 /* Always used palabos functions in case files*/
@@ -54,6 +55,10 @@ using namespace plb;
 
 namespace hemo { 
 
+class AsyncHdf5Writer;
+class SuspensionAnalysis;
+class FluidAverage;
+
 /*!
  * The HemoCell class contains all the information, data and methods to set up a
  * basic HemoCell simulation.
@@ -177,6 +182,20 @@ class HemoCell {
   
   //Set the output of the CEPAC field
   void setCEPACOutputs(vector<int> outputs);
+  /// Restrict the output to a box in lattice units, can be called more than once.
+  /// Fluid output is limited to the boxes, cells are written when their centroid is in one of them
+  void addOutputRegion(Box3D region);
+  /// Restrict the output to a box with its corners in SI units [m]
+  void addOutputRegion(hemo::Array<T,3> lower, hemo::Array<T,3> upper);
+  /// Write every stride-th fluid node in each direction, or with average the mean of the stride^3 nodes
+  void setFluidOutputStride(unsigned int stride, bool average = false);
+  /// Write a celltype only at every interval-th output, counting from the first output
+  void setOutputInterval(string name, unsigned int interval);
+  /// Select the cells of a celltype that are written by their centroid [lu], replaces the selection by output region
+  void setOutputCellSelection(string name, std::function<bool(hemo::Array<T,3> const &)> selection);
+  /// Keep the running mean, standard deviation, minimum and maximum of fluid variables, sampled every interval
+  /// iterations and written (as FluidAverage) and reset every window iterations. Call after initializeCellfield
+  void setFluidAverages(vector<int> variables, unsigned int interval, unsigned int window);
   
   //Explicitly set the periodicity of the domain along the different axes
   void setSystemPeriodicity(unsigned int axis, bool bePeriodic);
@@ -221,7 +240,8 @@ public:
   void doRestructure(bool checkpoint_avail = true);
   
   ///Initialize the fluid field with the given management, should be done after specifing the pre inlets and before initializing the cellfields
-  void initializeLattice(MultiBlockManagement3D const & management);
+  ///When a flagMatrix is given, atomic blocks without fluid are dropped and the remaining ones are split and distributed by their number of fluid nodes
+  void initializeLattice(MultiBlockManagement3D const & management, MultiScalarField3D<int> * flagMatrix = 0);
  
   PreInlet * preInlet = 0;
   
@@ -230,6 +250,18 @@ public:
   map<plint,plint> BlockToMpi;
   
   LoadBalancer * loadBalancer = 0;
+
+  /// Background writer of the per-block HDF5 files, only with parameters/asyncOutput
+  AsyncHdf5Writer * asyncOutput = 0;
+
+  /// In-situ binned cell statistics, run by iterate(), only with parameters/analysis
+  SuspensionAnalysis * analysis = 0;
+
+  /// Running statistics of the fluid, only with setFluidAverages
+  FluidAverage * fluidAverage = 0;
+
+  /// Iteration at which the static output (parameters/staticOutput) of the current decomposition was written, -1 if not yet
+  plint staticOutputAt = -1;
   ///The fluid lattice
   MultiBlockLattice3D<T, DESCRIPTOR> * lattice = 0, *preinlet_lattice = 0, * domain_lattice = 0;
   
@@ -246,6 +278,12 @@ public:
   unsigned int lastOutputAt = 0;
   std::chrono::high_resolution_clock::duration lastOutput = std::chrono::high_resolution_clock::duration::zero();
   
+  /// Restrict candidates to the fluid part of flagMatrix and assign the blocks to the processors in partToMpi
+  MultiBlockManagement3D * createFluidDomainManagement(SparseBlockStructure3D const & candidates,
+                                                       MultiBlockManagement3D const & management,
+                                                       MultiScalarField3D<int> & flagMatrix,
+                                                       map<plint,plint> & partToMpi);
+
   /// To be run right before the first iteration, all checking should move here
   void sanityCheck();
   /// Checked in iteration, do sanity check when not yet done
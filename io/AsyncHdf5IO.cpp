@@ -0,0 +1,183 @@
+/*
+This file is part of the HemoCell library
+
+HemoCell is developed and maintained by the Computational Science Lab 
+in the University of Amsterdam. Any questions or remarks regarding this library 
+can be sent to: info@hemocell.eu
+
+When using the HemoCell library in scientific work please cite the
+corresponding paper: https://doi.org/10.3389/fphys.2017.00563
+
+The HemoCell library is free software: you can redistribute it and/or
+modify it under the terms of the GNU Affero General Public License as
+published by the Free Software Foundation, either version 3 of the
+License, or (at your option) any later version.
+
+The library is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU Affero General Public License for more details.
+
+You should have received a copy of the GNU Affero General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+#include "AsyncHdf5IO.h"
+
+#include <hdf5_hl.h>
+#include <chrono>
+
+namespace hemo {
+
+void Hdf5BlockFile::attribute(std::string const & name, double value) {
+  attributes.push_back({Attribute::Double,name,{value}});
+}
+void Hdf5BlockFile::attribute(std::string const & name, long value) {
+  attributes.push_back({Attribute::Long,name,{double(value)}});
+}
+void Hdf5BlockFile::attribute(std::string const & name, int value) {
+  attributes.push_back({Attribute::Int,name,{double(value)}});
+}
+void Hdf5BlockFile::attribute(std::string const & name, int const * values, unsigned int n) {
+  attributes.push_back({Attribute::Int,name,std::vector<double>(values,values+n)});
+}
+void Hdf5BlockFile::attribute(std::string const & name, float const * values, unsigned int n) {
+  attributes.push_back({Attribute::Float,name,std::vector<double>(values,values+n)});
+}
+
+void Hdf5BlockFile::dataset(std::string const & name, std::vector<hsize_t> const & dims, float * data) {
+  datasets.emplace_back();
+  datasets.back().name = name;
+  datasets.back().dims = dims;
+  datasets.back().compression = hdf5Compression(identifier,name);
+  datasets.back().fvalues.reset(data);
+}
+void Hdf5BlockFile::dataset(std::string const & name, std::vector<hsize_t> const & dims, int * data) {
+  datasets.emplace_back();
+  datasets.back().name = name;
+  datasets.back().dims = dims;
+  datasets.back().compression = hdf5Compression(identifier,name);
+  datasets.back().ivalues.reset(data);
+}
+
+void Hdf5BlockFile::write() {
+  hid_t file_id = H5Fcreate(fileName.c_str(), H5F_ACC_TRUNC, H5P_DEFAULT, H5P_DEFAULT);
+
+  for (Attribute const & a : attributes) {
+    const size_t n = a.values.size();
+    switch (a.kind) {
+      case Attribute::Double:
+        H5LTset_attribute_double(file_id, "/", a.name.c_str(), a.values.data(), n);
+        break;
+      case Attribute::Long: {
+        std::vector<long> v(a.values.begin(),a.values.end());
+        H5LTset_attribute_long(file_id, "/", a.name.c_str(), v.data(), n);
+        break;
+      }
+      case Attribute::Int: {
+        std::vector<int> v(a.values.begin(),a.values.end());
+        H5LTset_attribute_int(file_id, "/", a.name.c_str(), v.data(), n);
+        break;
+      }
+      case Attribute::Float: {
+        std::vector<float> v(a.values.begin(),a.values.end());
+        H5LTset_attribute_float(file_id, "/", a.name.c_str(), v.data(), n);
+        break;
+      }
+    }
+  }
+
+  for (Dataset & d : datasets) {
+    const hid_t type = d.fvalues ? H5T_NATIVE_FLOAT : H5T_NATIVE_INT;
+    hid_t sid = H5Screate_simple(d.dims.size(),d.dims.data(),NULL);
+    hid_t plist_id = H5Pcreate (H5P_DATASET_CREATE);
+    if (d.fvalues) {
+      hsize_t n = 1;
+      for (hsize_t dim : d.dims) { n *= dim; }
+      d.compression.quantize(d.fvalues.get(),n);
+    }
+    d.compression.apply(plist_id,type,d.dims);
+    hid_t did = H5Dcreate2(file_id,d.name.c_str(),type,sid,H5P_DEFAULT,plist_id,H5P_DEFAULT);
+    if (d.fvalues) {
+      H5Dwrite(did,type,H5S_ALL,H5S_ALL,H5P_DEFAULT,d.fvalues.get());
+    } else {
+      H5Dwrite(did,type,H5S_ALL,H5S_ALL,H5P_DEFAULT,d.ivalues.get());
+    }
+    H5Dclose(did);
+    H5Pclose(plist_id);
+    H5Sclose(sid);
+  }
+
+  H5Fclose(file_id);
+}
+
+AsyncHdf5Writer::AsyncHdf5Writer() {
+  thread = std::thread(&AsyncHdf5Writer::run,this);
+}
+
+AsyncHdf5Writer::~AsyncHdf5Writer() {
+  //Files added after the last submit() would be lost otherwise
+  submit();
+  {
+    std::unique_lock<std::mutex> lock(mutex);
+    stop = true;
+  }
+  cv.notify_all();
+  thread.join();
+}
+
+bool AsyncHdf5Writer::supported() {
+  hbool_t threadsafe = 0;
+  if (H5is_library_threadsafe(&threadsafe) < 0) {
+    return false;
+  }
+  return threadsafe;
+}
+
+void AsyncHdf5Writer::add(Hdf5BlockFile * file) {
+  //Only the simulation thread touches the dump being filled
+  filling.emplace_back(file);
+}
+
+double AsyncHdf5Writer::submit() {
+  std::chrono::duration<double> waited(0.);
+  std::unique_lock<std::mutex> lock(mutex);
+  if (inFlight) {
+    //Back-pressure, the previous dump is still being written
+    auto start = std::chrono::steady_clock::now();
+    cv.wait(lock,[this]{ return !inFlight; });
+    waited = std::chrono::steady_clock::now() - start;
+  }
+
+  writing.swap(filling);
+  filling.clear();
+  inFlight = !writing.empty();
+  lock.unlock();
+  cv.notify_all();
+  return waited.count();
+}
+
+void AsyncHdf5Writer::wait() {
+  std::unique_lock<std::mutex> lock(mutex);
+  cv.wait(lock,[this]{ return !inFlight; });
+}
+
+void AsyncHdf5Writer::run() {
+  std::unique_lock<std::mutex> lock(mutex);
+  while (true) {
+    cv.wait(lock,[this]{ return inFlight || stop; });
+    if (!inFlight) {
+      return; //Stopped and nothing left to write
+    }
+    lock.unlock();
+    for (std::unique_ptr<Hdf5BlockFile> & file : writing) {
+      file->write();
+      file.reset(); //Free the buffers as soon as they are on disk
+    }
+    lock.lock();
+    writing.clear();
+    inFlight = false;
+    cv.notify_all();
+  }
+}
+
+}
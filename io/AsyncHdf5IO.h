@@ -0,0 +1,115 @@
+/*
+This file is part of the HemoCell library
+
+HemoCell is developed and maintained by the Computational Science Lab 
+in the University of Amsterdam. Any questions or remarks regarding this library 
+can be sent to: info@hemocell.eu
+
+When using the HemoCell library in scientific work please cite the
+corresponding paper: https://doi.org/10.3389/fphys.2017.00563
+
+The HemoCell library is free software: you can redistribute it and/or
+modify it under the terms of the GNU Affero General Public License as
+published by the Free Software Foundation, either version 3 of the
+License, or (at your option) any later version.
+
+The library is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU Affero General Public License for more details.
+
+You should have received a copy of the GNU Affero General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+#ifndef ASYNC_HDF5IO_H
+#define ASYNC_HDF5IO_H
+
+#include "Hdf5Compression.h"
+
+#include <hdf5.h>
+#include <condition_variable>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace hemo {
+
+/**
+ * Everything that goes into one per-block output file, kept in memory until
+ * write() is called. The simulation data is copied in when the file is built,
+ * so it can be written (and compressed) later while the simulation continues.
+ */
+class Hdf5BlockFile {
+public:
+  /// identifier ("Fluid", "RBC", ...) selects the compression of the datasets, see hdf5Compression()
+  Hdf5BlockFile(std::string const & fileName_, std::string const & identifier_) : fileName(fileName_), identifier(identifier_) {}
+
+  void attribute(std::string const & name, double value);
+  void attribute(std::string const & name, long value);
+  void attribute(std::string const & name, int value);
+  void attribute(std::string const & name, int const * values, unsigned int n);
+  void attribute(std::string const & name, float const * values, unsigned int n);
+
+  /// Dataset of dims (row-major), takes ownership of data (allocated with new[])
+  void dataset(std::string const & name, std::vector<hsize_t> const & dims, float * data);
+  void dataset(std::string const & name, std::vector<hsize_t> const & dims, int * data);
+
+  /// Create the file and write all attributes and datasets, lossy settings round the data in place
+  void write();
+
+private:
+  struct Attribute {
+    enum Kind { Double, Long, Int, Float } kind;
+    std::string name;
+    std::vector<double> values;
+  };
+  struct Dataset {
+    std::string name;
+    std::vector<hsize_t> dims;
+    Hdf5Compression compression;
+    std::unique_ptr<float[]> fvalues;
+    std::unique_ptr<int[]> ivalues;
+  };
+  std::string fileName, identifier;
+  std::vector<Attribute> attributes;
+  std::vector<Dataset> datasets;
+};
+
+/**
+ * Writes the per-block output files on a background thread (parameters/asyncOutput).
+ *
+ * Double buffered: the output functions fill one dump with add() while the
+ * previous dump is written. submit() hands the filled dump to the I/O thread,
+ * and waits first when the previous dump is still in flight, so at most two
+ * dumps are kept in memory. The I/O thread only calls HDF5, no MPI.
+ */
+class AsyncHdf5Writer {
+public:
+  AsyncHdf5Writer();
+  /// Submits the dump being filled and writes everything pending before returning
+  ~AsyncHdf5Writer();
+
+  /// The I/O thread needs an HDF5 library built with thread-safety
+  static bool supported();
+
+  /// Add a file to the dump that is being filled, takes ownership
+  void add(Hdf5BlockFile * file);
+  /// Hand the filled dump to the I/O thread, returns the time [s] spent waiting for the previous one
+  double submit();
+  /// Block until all submitted dumps are on disk
+  void wait();
+
+private:
+  void run();
+
+  std::vector<std::unique_ptr<Hdf5BlockFile>> filling, writing;
+  bool inFlight = false, stop = false;
+  std::mutex mutex;
+  std::condition_variable cv;
+  std::thread thread;
+};
+
+}
+#endif
@@ -29,14 +29,69 @@ along with this program.  If not, see <http://www.gnu.org/licenses/>.
 
 namespace hemo {
 
+/// Write the blocks collected in staging to <identifier>.<iter>.h5 or append them to <identifier>.h5, collective over the (pre-inlet or domain) processes
+static void writeStagedFluidField(Hdf5Staging & staging, HemoCellFields& cellfields, string identifier, T dx, T dt, plint iter, bool staticFields = false, bool averages = false) {
+  MPI_Comm comm;
+  MPI_Comm_split(MPI_COMM_WORLD,cellfields.hemocell.partOfpreInlet,global::mpi().getRank(),&comm);
+  if (cellfields.hemocell.partOfpreInlet) {
+    identifier += "_PRE";
+  }
+  hid_t file_id;
+  const bool timeSeries = global.hdf5OutputLayout == Hdf5OutputLayout::TimeSeries && !staticFields;
+  if (timeSeries) {
+    std::string fileName = global::directories().getOutputDir() + "/hdf5/" + identifier + ".h5";
+    vector<pair<string,long long>> stepValues;
+    if (global.staticOutput && !averages) {
+      stepValues.push_back({"StaticIteration",cellfields.hemocell.staticOutputAt});
+    }
+    file_id = staging.append(fileName,identifier,iter,comm,stepValues);
+  } else {
+    std::string directory = staticFields ? "/hdf5/static/" : "/hdf5/" + zeroPadNumber(iter) + '/';
+    std::string fileName = global::directories().getOutputDir() + directory + identifier + "."  + zeroPadNumber(iter) + ".h5";
+    file_id = staging.write(fileName,identifier,comm);
+  }
+
+  double dx_d = dx, dt_d = dt;
+  H5LTset_attribute_double (file_id, "/", "dx", &dx_d, 1);
+  H5LTset_attribute_double (file_id, "/", "dt", &dt_d, 1);
+  float dxdydz[3];
+  dxdydz[0] = dxdydz[1] = dxdydz[2] = cellfields.fluidOutputStride;
+  if (cellfields.hemocell.outputInSiUnits) {
+    dxdydz[0] = dxdydz[1] = dxdydz[2] = cellfields.fluidOutputStride*param::dx;
+  }
+  H5LTset_attribute_float(file_id,"/","dxdydz",dxdydz,3);
+  if (timeSeries) { //The iteration and size of every dump are in the Index group
+    H5Fclose(file_id);
+    MPI_Comm_free(&comm);
+    return;
+  }
+  long int iterHDF5=iter;
+  H5LTset_attribute_long (file_id, "/", "iteration", &iterHDF5, 1);
+  if (global.staticOutput && !staticFields && !averages) {
+    long int staticIteration = cellfields.hemocell.staticOutputAt;
+    H5LTset_attribute_long (file_id, "/", "staticIteration", &staticIteration, 1);
+  }
+  if (Hdf5StagedDataset * ds = staging.find("BlockOffset")) {
+    long int nB = ds->total;
+    H5LTset_attribute_long (file_id, "/", "numberOfBlocks", &nB, 1);
+  }
+  H5Fclose(file_id);
+  MPI_Comm_free(&comm);
+}
+
 void writeCEPACField_HDF5(HemoCellFields& cellfields, T dx, T dt, plint iter, string preString) {
   global.statistics.getCurrent()["writeCEPACField"].start();
 
-  WriteFluidField<plb::descriptors::AdvectionDiffusionD3Q19Descriptor> * wff = new WriteFluidField<plb::descriptors::AdvectionDiffusionD3Q19Descriptor>(cellfields, *cellfields.CEPACfield,iter,"CEPAC",dx,dt,cellfields.desiredCEPACfieldOutputVariables);
+  Hdf5Staging staging;
+  const bool singleFile = global.hdf5OutputLayout != Hdf5OutputLayout::Blocks && cellfields.desiredCEPACfieldOutputVariables.size();
+  WriteFluidField<plb::descriptors::AdvectionDiffusionD3Q19Descriptor> * wff = new WriteFluidField<plb::descriptors::AdvectionDiffusionD3Q19Descriptor>(cellfields, *cellfields.CEPACfield,iter,"CEPAC",dx,dt,cellfields.desiredCEPACfieldOutputVariables, singleFile ? &staging : 0);
   vector<MultiBlock3D*> wrapper;
   wrapper.push_back(cellfields.CEPACfield);
   wrapper.push_back(cellfields.immersedParticles); //Needed for the atomicblock id, nothing else
   applyProcessingFunctional(wff,cellfields.CEPACfield->getBoundingBox(),wrapper);
+  if (singleFile) {
+    writeStagedFluidField(staging,cellfields,"CEPAC",dx,dt,iter);
+  }
   
   global.statistics.getCurrent().stop();
 }
@@ -47,11 +102,16 @@ void writeFluidField_HDF5(HemoCellFields& cellfields, T dx, T dt, plint iter, st
     hlogfile << "(FluidOutput) (OutputForce) The force on the fluid field is reset to zero, If there is a bodyforce, reset it after this output function (FluidField write force, OUTPUT_FORCE)" << endl; 
     cellfields.spreadParticleForce();
   }
-  WriteFluidField<DESCRIPTOR> * wff = new WriteFluidField<DESCRIPTOR>(cellfields, *cellfields.lattice,iter,"Fluid",dx,dt,cellfields.desiredFluidOutputVariables);
+  Hdf5Staging staging;
+  const bool singleFile = global.hdf5OutputLayout != Hdf5OutputLayout::Blocks && cellfields.desiredFluidOutputVariables.size();
+  WriteFluidField<DESCRIPTOR> * wff = new WriteFluidField<DESCRIPTOR>(cellfields, *cellfields.lattice,iter,"Fluid",dx,dt,cellfields.desiredFluidOutputVariables, singleFile ? &staging : 0);
   vector<MultiBlock3D*> wrapper;
   wrapper.push_back(cellfields.lattice);
   wrapper.push_back(cellfields.immersedParticles); //Needed for the atomicblock id, nothing else
   applyProcessingFunctional(wff,cellfields.lattice->getBoundingBox(),wrapper);
+  if (singleFile) {
+    writeStagedFluidField(staging,cellfields,"Fluid",dx,dt,iter);
+  }
   if(std::find(cellfields.desiredFluidOutputVariables.begin(), cellfields.desiredFluidOutputVariables.end(), OUTPUT_FORCE) != cellfields.desiredFluidOutputVariables.end()) {
     // Reset Forces on the lattice, TODO do own efficient implementation
     plb::setExternalVector(*cellfields.hemocell.lattice, (*cellfields.hemocell.lattice).getBoundingBox(),
@@ -62,4 +122,47 @@ void writeFluidField_HDF5(HemoCellFields& cellfields, T dx, T dt, plint iter, st
   global.statistics.getCurrent().stop();
 }
 
+void writeFluidAverage_HDF5(HemoCellFields& cellfields, FluidAverage & average, T dx, T dt, plint iter) {
+  global.statistics.getCurrent()["writeFluidAverage"].start();
+
+  Hdf5Staging staging;
+  const bool singleFile = global.hdf5OutputLayout != Hdf5OutputLayout::Blocks;
+  WriteFluidField<DESCRIPTOR> * wff = new WriteFluidField<DESCRIPTOR>(cellfields, *cellfields.lattice,iter,"FluidAverage",dx,dt,average.variables, singleFile ? &staging : 0, false, &average);
+  vector<MultiBlock3D*> wrapper;
+  wrapper.push_back(cellfields.lattice);
+  wrapper.push_back(cellfields.immersedParticles); //Needed for the atomicblock id, nothing else
+  wrapper.push_back(average.field);
+  applyProcessingFunctional(wff,cellfields.lattice->getBoundingBox(),wrapper);
+  if (singleFile) {
+    writeStagedFluidField(staging,cellfields,"FluidAverage",dx,dt,iter,false,true);
+  }
+
+  global.statistics.getCurrent().stop();
+}
+
+template<template<class U> class DD>
+static void writeStaticField(HemoCellFields& cellfields, MultiBlock3D & field, string identifier, vector<int> & variables, T dx, T dt, plint iter) {
+  if(std::find(variables.begin(), variables.end(), OUTPUT_BOUNDARY) == variables.end()) {
+    return;
+  }
+  vector<int> staticVariables = {OUTPUT_BOUNDARY};
+  Hdf5Staging staging;
+  const bool singleFile = global.hdf5OutputLayout != Hdf5OutputLayout::Blocks;
+  WriteFluidField<DD> * wff = new WriteFluidField<DD>(cellfields, field,iter,identifier,dx,dt,staticVariables, singleFile ? &staging : 0, true);
+  vector<MultiBlock3D*> wrapper;
+  wrapper.push_back(&field);
+  wrapper.push_back(cellfields.immersedParticles); //Needed for the atomicblock id, nothing else
+  applyProcessingFunctional(wff,field.getBoundingBox(),wrapper);
+  if (singleFile) {
+    writeStagedFluidField(staging,cellfields,identifier,dx,dt,iter,true);
+  }
+}
+
+void writeStaticFluidField_HDF5(HemoCellFields& cellfields, T dx, T dt, plint iter) {
+  writeStaticField<DESCRIPTOR>(cellfields,*cellfields.lattice,"Fluid",cellfields.desiredFluidOutputVariables,dx,dt,iter);
+  if (global.enableCEPACfield) {
+    writeStaticField<plb::descriptors::AdvectionDiffusionD3Q19Descriptor>(cellfields,*cellfields.CEPACfield,"CEPAC",cellfields.desiredCEPACfieldOutputVariables,dx,dt,iter);
+  }
+}
+
 }
@@ -27,8 +27,14 @@ along with this program.  If not, see <http://www.gnu.org/licenses/>.
 #include "hemoCellFields.h"
 
 namespace hemo {
+class FluidAverage;
+
 void writeFluidField_HDF5(HemoCellFields& cellFields, T dx, T dt, plint iter, string preString="");
 void writeCEPACField_HDF5(HemoCellFields& cellfields, T dx, T dt, plint iter, string preString=""); 
+/// The constant fluid fields (boundary) to hdf5/static, once per decomposition (parameters/staticOutput)
+void writeStaticFluidField_HDF5(HemoCellFields& cellfields, T dx, T dt, plint iter);
+/// The running fluid statistics to FluidAverage files, in the same layout as the fluid output (HemoCell::setFluidAverages)
+void writeFluidAverage_HDF5(HemoCellFields& cellfields, FluidAverage & average, T dx, T dt, plint iter);
 
 #ifndef hsize_t
 typedef long long unsigned int hsize_t;
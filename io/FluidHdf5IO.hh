@@ -25,6 +25,10 @@ along with this program.  If not, see <http://www.gnu.org/licenses/>.
 #define FLUID_HDF5_IO_HH
 
 #include "FluidHdf5IO.hh"
+#include "SingleFileHdf5IO.h"
+#include "AsyncHdf5IO.h"
+#include "fluidAverage.h"
+#include "interiorViscosity.h"
 #include "palabos3D.h"
 #include "palabos3D.hh"
 
@@ -33,27 +37,12 @@ along with this program.  If not, see <http://www.gnu.org/licenses/>.
 
 namespace hemo {
   
-void outputHDF5(hsize_t* dim, hsize_t* chunk, hid_t& file_id, string& name, float* output) {
-    //We can calulate nvalues through the dims
-    chunk[3] = dim[3];
-    //unsigned int nvalues = dim[0]*dim[1]*dim[2]*dim[3];
-
-    hid_t sid = H5Screate_simple(4,dim,NULL);
-      hid_t plist_id = H5Pcreate (H5P_DATASET_CREATE);
-        H5Pset_chunk(plist_id, 4, chunk); 
-        H5Pset_deflate(plist_id, 7);
-        hid_t did = H5Dcreate2(file_id,name.c_str(),H5T_NATIVE_FLOAT,sid,H5P_DEFAULT,plist_id,H5P_DEFAULT);
-        H5Dwrite(did,H5T_NATIVE_FLOAT,H5S_ALL,H5S_ALL,H5P_DEFAULT,output);
-      H5Dclose(did);
-    H5Sclose(sid);
-}
-
 template<template<class U> class DD>
 class WriteFluidField : public BoxProcessingFunctional3D
 {
 public:
- WriteFluidField(HemoCellFields& cellfields_, MultiBlock3D & fluid_, plint iter_, string identifier_, T dx_, T dt_, vector<int> & outputVariables_) :
-    cellfields(cellfields_), fluid(fluid_), iter(iter_), identifier(identifier_), dx(dx_), dt(dt_),outputVariables(outputVariables_) { }
+ WriteFluidField(HemoCellFields& cellfields_, MultiBlock3D & fluid_, plint iter_, string identifier_, T dx_, T dt_, vector<int> & outputVariables_, Hdf5Staging * staging_ = 0, bool staticFields_ = false, FluidAverage * averages_ = 0) :
+    cellfields(cellfields_), fluid(fluid_), iter(iter_), identifier(identifier_), dx(dx_), dt(dt_),outputVariables(outputVariables_), staging(staging_), staticFields(staticFields_), averages(averages_) { }
  
  ~WriteFluidField(){};
 
@@ -82,115 +71,115 @@ public:
     if (outputVariables.size() == 0 ) {
       return; //No output needed? ok
     }
+    Dot3D rp_temp = blocks[0]->getLocation();
+    if (!setOutputGrid(domain,rp_temp)) {
+      return; //Outside of the output regions
+    }
     
-    if (cellfields.hemocell.partOfpreInlet) {
-      identifier += "_PRE";
+    file = 0;
+    if (!staging) {
+      if (cellfields.hemocell.partOfpreInlet) {
+        identifier += "_PRE";
+      }
+      std::string directory = staticFields ? "/hdf5/static/" : "/hdf5/" + zeroPadNumber(iter) + '/';
+      std::string fileName = global::directories().getOutputDir() + directory + identifier + "."  + zeroPadNumber(iter) + ".p." + to_string(blockid) + ".h5";
+      file = new Hdf5BlockFile(fileName,identifier);
+          file->attribute("dx", dx);
+          file->attribute("dt", dt);
+          file->attribute("iteration", long(iter));
+          file->attribute("processorId", id);
+      if (global.staticOutput && !staticFields && !averages) {
+          file->attribute("staticIteration", long(cellfields.hemocell.staticOutputAt));
+      }
     }
-    std::string fileName = global::directories().getOutputDir() + "/hdf5/" + zeroPadNumber(iter) + '/' + identifier + "."  + zeroPadNumber(iter) + ".p." + to_string(blockid) + ".h5";
-    hid_t file_id;
-    file_id = H5Fcreate(fileName.c_str(), H5F_ACC_TRUNC, H5P_DEFAULT, H5P_DEFAULT);
-          H5LTset_attribute_double (file_id, "/", "dx", &dx, 1);
-          H5LTset_attribute_double (file_id, "/", "dt", &dt, 1);
-          long int iterHDF5=iter;
-          H5LTset_attribute_long (file_id, "/", "iteration", &iterHDF5, 1);
-          H5LTset_attribute_int (file_id, "/", "processorId", &id, 1);
-
-    hsize_t Nx = domain.x1 - domain.x0+1 +2;//+1 for = and <=, +2 for an envelope of 1 on each side for paraview
-    hsize_t Ny = domain.y1 - domain.y0+1 +2;
-    hsize_t Nz = domain.z1 - domain.z0+1 +2;
+
+    hsize_t Nx = grid.nx;
+    hsize_t Ny = grid.ny;
+    hsize_t Nz = grid.nz;
     hsize_t nCells = Nx*Ny*Nz;
     this->nCells = &nCells;
     int ncells = Nx*Ny*Nz;
-    Dot3D rp_temp = blocks[0]->getLocation();
     int subdomainSize[]  = {int(Nz), int(Ny), int(Nx)}; //Reverse for paraview
-    float dxdydz[3] = {1.,1.,1.};
-    float relativePosition[3] = {float(rp_temp.z+domain.z0-1.5),
-                                 float(rp_temp.y+domain.y0-1.5),
-                                 float(rp_temp.x+domain.x0-1.5)}; //Reverse for paraview
+    //A row is the node itself, or the first node of the averaged block, the cell around it starts half a node before
+    const T cellStart = grid.average ? 0.5 : 0.5*grid.stride;
+    float dxdydz[3] = {float(grid.stride),float(grid.stride),float(grid.stride)};
+    float relativePosition[3] = {float(rp_temp.z+grid.z0-cellStart),
+                                 float(rp_temp.y+grid.y0-cellStart),
+                                 float(rp_temp.x+grid.x0-cellStart)}; //Reverse for paraview
 
     if (cellfields.hemocell.outputInSiUnits) {
       relativePosition[0] *= param::dx;
       relativePosition[1] *= param::dx;
       relativePosition[2] *= param::dx;
-      dxdydz[0] = param::dx;
-      dxdydz[1] = param::dx;
-      dxdydz[2] = param::dx;
+      dxdydz[0] *= param::dx;
+      dxdydz[1] *= param::dx;
+      dxdydz[2] *= param::dx;
     }
 
-    H5LTset_attribute_int (file_id, "/", "numberOfCells", &ncells, 1);
-    H5LTset_attribute_int (file_id, "/", "subdomainSize", subdomainSize, 3);
-    H5LTset_attribute_float(file_id, "/", "relativePosition", relativePosition, 3);
-    H5LTset_attribute_float(file_id,"/","dxdydz",dxdydz,3);
+    if (staging) {
+      //One row per block, the variables of all blocks are concatenated in the same order
+      Hdf5StagedDataset & sizes = staging->dataset("subdomainSize",3,Hdf5Type::Int);
+      long long nodeBase = 0;
+      for (unsigned int b = 0 ; b < sizes.ivalues.size() ; b += 3) {
+        nodeBase += sizes.ivalues[b]*sizes.ivalues[b+1]*sizes.ivalues[b+2];
+      }
+      sizes.ivalues.insert(sizes.ivalues.end(),subdomainSize,subdomainSize+3);
+      Hdf5StagedDataset & positions = staging->dataset("relativePosition",3);
+      positions.values.insert(positions.values.end(),relativePosition,relativePosition+3);
+      staging->dataset("BlockOffset",1,Hdf5Type::Long).ivalues.push_back(nodeBase);
+      staging->dataset("BlockId",1,Hdf5Type::Int).ivalues.push_back(blockid);
+      staging->dataset("processorId",1,Hdf5Type::Int).ivalues.push_back(id);
+    } else {
+      file->attribute("numberOfCells", ncells);
+      file->attribute("subdomainSize", subdomainSize, 3);
+      file->attribute("relativePosition", relativePosition, 3);
+      file->attribute("dxdydz", dxdydz, 3);
+    }
+
+    if (averages) {
+      hsize_t dim[3] = {Nz,Ny,Nx};
+      outputAverages(dynamic_cast<NTensorField3D<T>*>(blocks[2]),dim);
+      finishBlock();
+      return;
+    }
 
-    //Also compute chunking here
-    hsize_t chunk[4];
-    chunk[2] = 1000 < Nx ? 1000 : Nx;
-    chunk[1] = 1000 < Ny ? 1000 : Ny;
-    chunk[0] = 1000 < Nz ? 1000 : Nz;
+    //All variables that are read per node are extracted in a single pass over the block
+    vector<NodeOutput> nodeOutputs;
+    for (int outputVariable : outputVariables) {
+      if (outputVariable == OUTPUT_BOUNDARY && global.staticOutput && !staticFields) {
+        continue; //Constant, written once to the static files
+      }
+      NodeOutput o;
+      if (nodeVariable(outputVariable,o)) {
+        o.data = new float[nCells*o.columns];
+        nodeOutputs.push_back(o);
+      }
+    }
+    outputNodeVariables(nodeOutputs);
 
-    //I could do fancy schmancy function pointer lookup like with the particles, but it
-    //takes time, just do it here
+    unsigned int nextNodeOutput = 0;
     for (int outputVariable : outputVariables) {
+      hsize_t dim[4] = {Nz,Ny,Nx,0};
+      if (nextNodeOutput < nodeOutputs.size() && nodeOutputs[nextNodeOutput].variable == outputVariable) {
+        NodeOutput & o = nodeOutputs[nextNodeOutput++];
+        dim[3] = o.columns;
+        store(dim,o.name,o.data);
+        continue;
+      }
+
       //These variables should be set by the functions:
       float * output = 0;
-      hsize_t dim[4] = {Nz,Ny,Nx,0};
       string name;
 
       switch(outputVariable) {
-        case OUTPUT_VELOCITY:
-          output = outputVelocity();
-          name = "Velocity";
-          dim[3] = 3;
-          break;
-        case OUTPUT_FORCE:
-          output = outputForce();
-          name = "Force";
-          dim[3] = 3;
-          break;
-        case OUTPUT_DENSITY:
-          output = outputDensity();
-          name = "Density";
-          dim[3] = 1;
-          break;
-        case OUTPUT_BOUNDARY:
-          output = outputBoundary();
-          name = "Boundary";
-          dim[3] = 1;
-        break;
-        case OUTPUT_BINDING_SITES:
-          output = outputBindingSites();
-          name = "BindingSites";
-          dim[3] = 1;
-        break;
-        case OUTPUT_INTERIOR_POINTS:
-          output = outputInteriorPoints();
-          name = "InteriorPoints";
-          dim[3] = 1;
-        break;
-        case OUTPUT_OMEGA:
-          output = outputOmega();
-          name = "Omega";
-          dim[3] = 1;
-          break;
         case OUTPUT_CELL_DENSITY:
           for (unsigned int i = 0 ; i < cellfields.size() ; i++) {
             output = outputCellDensity(cellfields[i]->name);
             name = "CellDensity_" + cellfields[i]->name;
             dim[3] = 1;
-            outputHDF5(dim,chunk,file_id,name,output);
-            delete[] output;
+            store(dim,name,output);
           }
           continue;
-        case OUTPUT_SHEAR_STRESS:
-          output = outputShearStress();
-          name = "ShearStress";
-          dim[3] = 6;
-          break;
-        case OUTPUT_SHEAR_RATE:
-          output = outputShearRate();
-          name = "ShearRate";
-          dim[3] = 9;
-          break;
         case OUTPUT_STRAIN_RATE:
           output = outputStrainRate();
           name = "StrainRate";
@@ -203,176 +192,317 @@ public:
       }
 
 
-      outputHDF5(dim,chunk,file_id,name,output);
-      delete[] output;
+      store(dim,name,output);
 
     }
-    H5Fclose(file_id);
+    finishBlock();
   }
 
 private:
 
-  float * outputVelocity() {
-    float * output = new float [(*nCells)*3];
-    unsigned int n = 0;
-    plb::Array<T,3> vel;
-    for (plint iZ=odomain->z0-1; iZ<=odomain->z1+1; ++iZ) {
-      for (plint iY=odomain->y0-1; iY<=odomain->y1+1; ++iY) {
-        for (plint iX=odomain->x0-1; iX<=odomain->x1+1; ++iX) {
-
-          ablock->get(iX,iY,iZ).computeVelocity(vel);
-          output[n] = vel[0];
-          output[n+1] = vel[1];
-          output[n+2] = vel[2];
-          n += 3;
-        }
-      }
-    }
-
-    if (cellfields.hemocell.outputInSiUnits) {
-      for (unsigned int i = 0 ; i < (*nCells)*3 ; i++) {
-        output[i] = output[i]*param::dx/param::dt;
-      }
+  /// Write the block file, with asynchronous output it is compressed and written on the I/O thread
+  void finishBlock() {
+    if (file && cellfields.hemocell.asyncOutput) {
+      cellfields.hemocell.asyncOutput->add(file);
+    } else if (file) {
+      file->write();
+      delete file;
     }
-
-    return output;
   }
 
-  float * outputForce() {
-    float * output = new float [(*nCells)*3];
-    unsigned int n = 0;
-    hemo::Array<T,3> vel;
-    for (plint iZ=odomain->z0-1; iZ<=odomain->z1+1; ++iZ) {
-      for (plint iY=odomain->y0-1; iY<=odomain->y1+1; ++iY) {
-        for (plint iX=odomain->x0-1; iX<=odomain->x1+1; ++iX) {
-
-          output[n] = ablock->get(iX,iY,iZ).external.data[0];
-          output[n+1] = ablock->get(iX,iY,iZ).external.data[1];
-          output[n+2] = ablock->get(iX,iY,iZ).external.data[2];
-          n += 3;
+  /// The statistics of every averaged variable as <Name>_mean, _std, _min and _max (HemoCell::setFluidAverages)
+  void outputAverages(NTensorField3D<T> * statistics, hsize_t * dims) {
+    const Dot3D offset = computeRelativeDisplacement(*ablock,*statistics);
+    const char * suffixes[FluidAverage::nStatistics] = {"_mean","_std","_min","_max"};
+    unsigned int first = 1; //After the number of samples
+    for (int variable : outputVariables) {
+      NodeOutput o;
+      nodeVariable(variable,o);
+      float * outputs[FluidAverage::nStatistics];
+      for (unsigned int i = 0 ; i < FluidAverage::nStatistics ; i++) {
+        outputs[i] = new float[(*nCells)*o.columns];
+        memset(outputs[i], 0, sizeof(float)*(*nCells)*o.columns);
+      }
+      //With averaging the mean and std are averaged, of min and max the extremes are taken
+      vector<bool> sampled(grid.average ? *nCells : 0,false);
+      forEachOutputNode([&](hsize_t n, plint iX, plint iY, plint iZ) {
+        const T * node = statistics->get(iX+offset.x,iY+offset.y,iZ+offset.z);
+        const T samples = node[0];
+        for (unsigned int c = 0 ; c < o.columns ; c++) {
+          const T * s = node + first + FluidAverage::nStatistics*c;
+          const T value[FluidAverage::nStatistics] = {s[0]*o.scale,
+                                                      (samples > 0 ? sqrt(s[1]/samples) : 0)*o.scale,
+                                                      s[2]*o.scale, s[3]*o.scale};
+          const hsize_t i = n*o.columns + c;
+          if (!grid.average) {
+            for (unsigned int j = 0 ; j < FluidAverage::nStatistics ; j++) {
+              outputs[j][i] = value[j];
+            }
+            continue;
+          }
+          outputs[0][i] += value[0];
+          outputs[1][i] += value[1];
+          outputs[2][i] = sampled[n] ? std::min(outputs[2][i],float(value[2])) : value[2];
+          outputs[3][i] = sampled[n] ? std::max(outputs[3][i],float(value[3])) : value[3];
+        }
+        if (grid.average) {
+          sampled[n] = true;
         }
+      });
+      if (grid.average) {
+        averageRows(outputs[0],o.columns);
+        averageRows(outputs[1],o.columns);
       }
-    }
-
-    if (cellfields.hemocell.outputInSiUnits) {
-      for (unsigned int i = 0 ; i < (*nCells)*3 ; i++) {
-        output[i] = output[i]*param::df;
+      for (unsigned int i = 0 ; i < FluidAverage::nStatistics ; i++) {
+        hsize_t dim[4] = {dims[0],dims[1],dims[2],o.columns};
+        string name = o.name + suffixes[i];
+        store(dim,name,outputs[i]);
       }
+      first += FluidAverage::nStatistics*o.columns;
     }
-
-    return output;
   }
 
-  float * outputDensity() {
-    float * output = new float [(*nCells)];
-    unsigned int n = 0;
-    for (plint iZ=odomain->z0-1; iZ<=odomain->z1+1; ++iZ) {
-      for (plint iY=odomain->y0-1; iY<=odomain->y1+1; ++iY) {
-        for (plint iX=odomain->x0-1; iX<=odomain->x1+1; ++iX) {
+  /// Hand output (allocated with new[]) to the block file or the staging, takes ownership
+  void store(hsize_t* dim, string& name, float* output) {
+    if (!staging) {
+      file->dataset(name,{dim[0],dim[1],dim[2],dim[3]},output);
+      return;
+    }
+    Hdf5StagedDataset & ds = staging->dataset(name,dim[3]);
+    ds.values.insert(ds.values.end(),output,output+dim[0]*dim[1]*dim[2]*dim[3]);
+    delete[] output;
+    //Block offsets count nodes, the rows of any of the variables
+    Hdf5StagedDataset * offsets = staging->find("BlockOffset");
+    if (offsets && offsets->indexInto.empty()) {
+      offsets->indexInto = name;
+    }
+  }
 
-          output[n] = ablock->get(iX,iY,iZ).computeDensity();
-          n++;
+  /// The nodes that are written: every stride-th node of bounds starting at (x0,y0,z0), nx*ny*nz rows
+  struct OutputGrid {
+    Box3D bounds;
+    plint x0, y0, z0, nx, ny, nz;
+    plint stride;
+    bool average;
+  };
+
+  /// Set grid for the block domain at location, false when nothing of it is written (HemoCell::addOutputRegion, setFluidOutputStride)
+  bool setOutputGrid(Box3D const & domain, Dot3D const & location) {
+    Box3D bounds = domain;
+    if (cellfields.outputRegions.size()) {
+      bool found = false;
+      for (Box3D const & region : cellfields.outputRegions) {
+        Box3D part;
+        if (!intersect(domain,region.shift(-location.x,-location.y,-location.z),part)) {
+          continue;
+        }
+        if (found) {
+          bounds = Box3D(std::min(bounds.x0,part.x0),std::max(bounds.x1,part.x1),
+                         std::min(bounds.y0,part.y0),std::max(bounds.y1,part.y1),
+                         std::min(bounds.z0,part.z0),std::max(bounds.z1,part.z1));
+        } else {
+          bounds = part;
         }
+        found = true;
       }
-    }
-
-    if (cellfields.hemocell.outputInSiUnits) {
-      for (unsigned int i = 0 ; i < (*nCells) ; i++) {
-        output[i] = output[i]*(param::df/(param::dx*param::dx));
+      if (!found) {
+        return false;
       }
     }
-
-    return output;
+    grid.bounds = bounds.enlarge(1); //An envelope of 1 on each side for paraview
+    grid.stride = cellfields.fluidOutputStride;
+    grid.average = cellfields.fluidOutputAverage;
+    //Rows at multiples of the stride in lattice coordinates, so the grids of the blocks line up
+    const plint s = grid.stride;
+    auto first = [s](plint lo, plint offset) { return lo + ((-(lo+offset))%s + s)%s; };
+    grid.x0 = first(grid.bounds.x0,location.x);
+    grid.y0 = first(grid.bounds.y0,location.y);
+    grid.z0 = first(grid.bounds.z0,location.z);
+    grid.nx = grid.x0 <= grid.bounds.x1 ? (grid.bounds.x1-grid.x0)/s + 1 : 0;
+    grid.ny = grid.y0 <= grid.bounds.y1 ? (grid.bounds.y1-grid.y0)/s + 1 : 0;
+    grid.nz = grid.z0 <= grid.bounds.z1 ? (grid.bounds.z1-grid.z0)/s + 1 : 0;
+    return grid.nx && grid.ny && grid.nz;
   }
-  
-  float * outputBoundary() {
-    float * output = new float [(*nCells)];
-    unsigned int n = 0;
-    for (plint iZ=odomain->z0-1; iZ<=odomain->z1+1; ++iZ) {
-      for (plint iY=odomain->y0-1; iY<=odomain->y1+1; ++iY) {
-        for (plint iX=odomain->x0-1; iX<=odomain->x1+1; ++iX) {
-
-          if (ablock->get(iX,iY,iZ).getDynamics().isBoundary()) {
-            output[n] = 1;
-          } else {
-            output[n] = 0;
+
+  /// Call f(row, iX, iY, iZ) for the node of every row, with averaging for every node of its block (within the bounds)
+  template<class F>
+  void forEachOutputNode(F f) {
+    const plint s = grid.stride;
+    const plint e = grid.average ? s : 1;
+    hsize_t n = 0;
+    for (plint iZ = grid.z0 ; iZ < grid.z0 + grid.nz*s ; iZ += s) {
+      for (plint iY = grid.y0 ; iY < grid.y0 + grid.ny*s ; iY += s) {
+        for (plint iX = grid.x0 ; iX < grid.x0 + grid.nx*s ; iX += s) {
+          for (plint z = iZ ; z < iZ + e && z <= grid.bounds.z1 ; z++) {
+            for (plint y = iY ; y < iY + e && y <= grid.bounds.y1 ; y++) {
+              for (plint x = iX ; x < iX + e && x <= grid.bounds.x1 ; x++) {
+                f(n,x,y,z);
+              }
+            }
           }
           n++;
         }
       }
     }
-    return output;
   }
-  
-  float * outputBindingSites() {
-    float * output = new float [(*nCells)];
-    if (!particlefield->bindingField) {
-      pcout << "(FluidHdf5) (Error) OUTPUT_BINDING_SITES requested, but binding sites not used, outputting a zero field" << endl;
-      for (hsize_t i = 0 ; i < *nCells ; i++) {
-        output[i] = 0;
-      }
-      return output;
-    }
-    unsigned int n = 0;
-    for (plint iZ=odomain->z0-1; iZ<=odomain->z1+1; ++iZ) {
-      for (plint iY=odomain->y0-1; iY<=odomain->y1+1; ++iY) {
-        for (plint iX=odomain->x0-1; iX<=odomain->x1+1; ++iX) {
-
-          if (particlefield->bindingField->get(iX,iY,iZ)) {
-            output[n] = 1;
-          } else {
-            output[n] = 0;
+
+  /// Divide the sums of forEachOutputNode() by the number of nodes of every row
+  void averageRows(float * data, unsigned int columns) {
+    const plint s = grid.stride;
+    hsize_t n = 0;
+    for (plint iZ = grid.z0 ; iZ < grid.z0 + grid.nz*s ; iZ += s) {
+      for (plint iY = grid.y0 ; iY < grid.y0 + grid.ny*s ; iY += s) {
+        for (plint iX = grid.x0 ; iX < grid.x0 + grid.nx*s ; iX += s) {
+          const T nodes = (std::min(iZ+s-1,grid.bounds.z1)-iZ+1)*(std::min(iY+s-1,grid.bounds.y1)-iY+1)*(std::min(iX+s-1,grid.bounds.x1)-iX+1);
+          for (unsigned int c = 0 ; c < columns ; c++) {
+            data[n*columns+c] /= nodes;
           }
           n++;
         }
       }
     }
-    return output;
   }
 
-  float * outputInteriorPoints() {
-    float * output = new float [(*nCells)];
-    if (!particlefield->interiorViscosityField) {
-      pcout << "(FluidHdf5) (Error) OUTPUT_INTERIOR_POINTS requested, but interior viscosity not used, outputting a zero field" << endl;
-      for (hsize_t i = 0 ; i < *nCells ; i++) {
-        output[i] = 0;
-      }
-      return output;
-    }
-    unsigned int n = 0;
-    for (plint iZ=odomain->z0-1; iZ<=odomain->z1+1; ++iZ) {
-      for (plint iY=odomain->y0-1; iY<=odomain->y1+1; ++iY) {
-        for (plint iX=odomain->x0-1; iX<=odomain->x1+1; ++iX) {
-          output[n] = (particlefield->interiorViscosityField->get(iX,iY,iZ));
-          n++;
-        }
-      }
+  /// A variable that is read node by node, its values are written to data (nCells x columns)
+  struct NodeOutput {
+    int variable;
+    string name;
+    hsize_t columns;
+    T scale; //Conversion to SI units
+    float * data;
+  };
+
+  bool nodeVariable(int variable, NodeOutput & o) {
+    const bool si = cellfields.hemocell.outputInSiUnits;
+    o.variable = variable;
+    o.scale = 1.;
+    o.columns = 1;
+    switch(variable) {
+      case OUTPUT_VELOCITY:
+        o.name = "Velocity";
+        o.columns = 3;
+        if (si) { o.scale = param::dx/param::dt; }
+        return true;
+      case OUTPUT_FORCE:
+        o.name = "Force";
+        o.columns = 3;
+        if (si) { o.scale = param::df; }
+        return true;
+      case OUTPUT_DENSITY:
+        o.name = "Density";
+        if (si) { o.scale = param::df/(param::dx*param::dx); }
+        return true;
+      case OUTPUT_BOUNDARY:
+        o.name = "Boundary";
+        return true;
+      case OUTPUT_BINDING_SITES:
+        o.name = "BindingSites";
+        return true;
+      case OUTPUT_INTERIOR_POINTS:
+        o.name = "InteriorPoints";
+        return true;
+      case OUTPUT_OMEGA:
+        o.name = "Omega";
+        if (si) { o.scale = param::df/(param::dx*param::dx); }
+        return true;
+      case OUTPUT_SHEAR_STRESS:
+        o.name = "ShearStress";
+        o.columns = 6;
+        if (si) { o.scale = param::df/(param::dx*param::dx); }
+        return true;
+      case OUTPUT_SHEAR_RATE:
+        o.name = "ShearRate";
+        o.columns = 9;
+        if (si) { o.scale = 1/param::dt; }
+        return true;
+      default:
+        return false;
     }
-    return output;
   }
-   
-  float * outputOmega() {
-    float * output = new float [(*nCells)];
-    unsigned int n = 0;
-    for (plint iZ=odomain->z0-1; iZ<=odomain->z1+1; ++iZ) {
-      for (plint iY=odomain->y0-1; iY<=odomain->y1+1; ++iY) {
-        for (plint iX=odomain->x0-1; iX<=odomain->x1+1; ++iX) {
 
-          output[n] = ablock->get(iX,iY,iZ).getDynamics().getOmega();
-          n++;
-        }
+  /// Fill all node variables in one pass over the block (including the envelope of 1 for paraview)
+  void outputNodeVariables(vector<NodeOutput> & outputs) {
+    if (outputs.empty()) {
+      return;
+    }
+    for (NodeOutput & o : outputs) {
+      if (o.variable == OUTPUT_BINDING_SITES && !particlefield->bindingField) {
+        pcout << "(FluidHdf5) (Error) OUTPUT_BINDING_SITES requested, but binding sites not used, outputting a zero field" << endl;
+      }
+      if (o.variable == OUTPUT_INTERIOR_POINTS && !particlefield->interiorViscosityField) {
+        pcout << "(FluidHdf5) (Error) OUTPUT_INTERIOR_POINTS requested, but interior viscosity not used, outputting a zero field" << endl;
       }
     }
 
-    if (cellfields.hemocell.outputInSiUnits) {
-      for (unsigned int i = 0 ; i < (*nCells) ; i++) {
-        output[i] = output[i]*(param::df/(param::dx*param::dx));
+    if (grid.average) {
+      for (NodeOutput & o : outputs) {
+        memset(o.data, 0, sizeof(float)*(*nCells)*o.columns);
+      }
+    }
+    plb::Array<T,3> vel, velp, veln;
+    plb::Array<T,6> stress;
+    T value[9];
+    forEachOutputNode([&](hsize_t n, plint iX, plint iY, plint iZ) {
+      Cell<T,DD> & cell = ablock->get(iX,iY,iZ);
+
+      for (NodeOutput & o : outputs) {
+        switch(o.variable) {
+          case OUTPUT_VELOCITY:
+            cell.computeVelocity(vel);
+            value[0] = vel[0];
+            value[1] = vel[1];
+            value[2] = vel[2];
+            break;
+          case OUTPUT_FORCE:
+            value[0] = cell.external.data[0];
+            value[1] = cell.external.data[1];
+            value[2] = cell.external.data[2];
+            break;
+          case OUTPUT_DENSITY:
+            value[0] = cell.computeDensity();
+            break;
+          case OUTPUT_BOUNDARY:
+            value[0] = cell.getDynamics().isBoundary() ? 1 : 0;
+            break;
+          case OUTPUT_BINDING_SITES:
+            value[0] = (particlefield->bindingField && particlefield->bindingField->get(iX,iY,iZ)) ? 1 : 0;
+            break;
+          case OUTPUT_INTERIOR_POINTS:
+            value[0] = particlefield->interiorViscosityField ? particlefield->interiorViscosityField->get(iX,iY,iZ) : 0;
+            break;
+          case OUTPUT_OMEGA:
+            value[0] = cellOmega(cell);
+            break;
+          case OUTPUT_SHEAR_STRESS:
+            cell.computeShearStress(stress);
+            for (int i = 0 ; i < 6 ; i++) {
+              value[i] = stress[i];
+            }
+            break;
+          case OUTPUT_SHEAR_RATE:
+            //Central differences, value[3*component+direction] = dv_component / 2*d_direction
+            for (int dir = 0 ; dir < 3 ; dir++) {
+              ablock->get(iX+(dir==0),iY+(dir==1),iZ+(dir==2)).computeVelocity(velp);
+              ablock->get(iX-(dir==0),iY-(dir==1),iZ-(dir==2)).computeVelocity(veln);
+              for (int c = 0 ; c < 3 ; c++) {
+                value[3*c+dir] = (velp[c]-veln[c])/2;
+              }
+            }
+            break;
+        }
+        float * out = o.data + n*o.columns;
+        for (unsigned int c = 0 ; c < o.columns ; c++) {
+          out[c] = grid.average ? out[c] + value[c]*o.scale : value[c]*o.scale;
+        }
+      }
+    });
+    if (grid.average) {
+      for (NodeOutput & o : outputs) {
+        averageRows(o.data,o.columns);
       }
     }
-
-    return output;
   }
-    
+
   float * outputCellDensity(string name) {
     float * output = new float [(*nCells)];
     memset(output, 0, sizeof(float)*(*nCells));
@@ -380,20 +510,22 @@ private:
     vector<HemoCellParticle*> found;
     particlefield->findParticles(particlefield->localDomain,found,cellfields[name]->ctype);
 
-    int Ystride = ((odomain->x1-odomain->x0)+3);
-    int Zstride = Ystride*((odomain->y1-odomain->y0)+3);
-
+    const Dot3D tmpDot = ablock->getLocation();
     for (HemoCellParticle * particle : found) {
-      plint iX,iY,iZ;
-      //Coordinates are relative
-      const Dot3D tmpDot = ablock->getLocation(); 
-      iX = plint((particle->sv.position[0]-tmpDot.x)+0.5);
-      iY = plint((particle->sv.position[1]-tmpDot.y)+0.5);
-      iZ = plint((particle->sv.position[2]-tmpDot.z)+0.5);
-
-      output[(iX)+(iY)*Ystride+(iZ)*Zstride] += 1;
+      //Coordinates are relative, counted in the row of the nearest node (or of the block it is averaged in)
+      const plint dX = plint((particle->sv.position[0]-tmpDot.x)+0.5) - grid.x0;
+      const plint dY = plint((particle->sv.position[1]-tmpDot.y)+0.5) - grid.y0;
+      const plint dZ = plint((particle->sv.position[2]-tmpDot.z)+0.5) - grid.z0;
+      if (dX < 0 || dY < 0 || dZ < 0) { continue; }
+      if (!grid.average && (dX % grid.stride || dY % grid.stride || dZ % grid.stride)) { continue; }
+      const plint iX = dX/grid.stride, iY = dY/grid.stride, iZ = dZ/grid.stride;
+      if (iX >= grid.nx || iY >= grid.ny || iZ >= grid.nz) { continue; }
+      output[iX + grid.nx*(iY + grid.ny*iZ)] += 1;
     }
 
+    if (grid.average) {
+      averageRows(output,1);
+    }
     if (cellfields.hemocell.outputInSiUnits) {
       for (unsigned int i = 0 ; i < (*nCells) ; i++) {
         output[i] *= cellfields[name]->volumeFractionOfLspPerNode;
@@ -403,137 +535,26 @@ private:
     return output;
   }
 
-  float * outputShearStress() {
+  float * outputStrainRate() {
     float * output = new float [(*nCells)*6];
-    unsigned int n = 0;
-    plb::Array<T,6> stress;
-
-    for (plint iZ=odomain->z0-1; iZ<=odomain->z1+1; ++iZ) {
-      for (plint iY=odomain->y0-1; iY<=odomain->y1+1; ++iY) {
-        for (plint iX=odomain->x0-1; iX<=odomain->x1+1; ++iX) {
-
-          ablock->get(iX,iY,iZ).computeShearStress(stress);
-          //Array<T,6> stress_vec = stress.get(iX,iY,iZ);
-          output[n] = stress[0];
-          output[n+1] = stress[1];
-          output[n+2] = stress[2];
-          output[n+3] = stress[3];
-          output[n+4] = stress[4];
-          output[n+5] = stress[5];
-          n += 6;
-        }
-      }
-    }
-        
-    if (cellfields.hemocell.outputInSiUnits) {
-      for (unsigned int i = 0 ; i < (*nCells)*6 ; i++) {
-        output[i] = output[i]*(param::df/(param::dx*param::dx));
-      }
-    }
+    memset(output, 0, sizeof(float)*(*nCells)*6);
+    // calculate tensorfield strain rate
+    std::unique_ptr<TensorField3D<T,6> > strainrate (computeStrainRateFromStress(*ablock));
 
-    return output;
-  }
-     
-  float * outputShearRate() {
-    float * output = new float [(*nCells)*9];
-    unsigned int n = 0;
-    plb::Array<T,9> shearrate;
-    plb::Array<T,3> velp1;
-    plb::Array<T,3> veln1;
-    plb::Array<T,3> velp2;
-    plb::Array<T,3> veln2;
-    plb::Array<T,3> velp3;
-    plb::Array<T,3> veln3;
-
-    for (plint iZ=odomain->z0-1; iZ<=odomain->z1+1; ++iZ) {
-      for (plint iY=odomain->y0-1; iY<=odomain->y1+1; ++iY) {
-        for (plint iX=odomain->x0-1; iX<=odomain->x1+1; ++iX) {
-
-          // velocity gradients in y-direction
-          ablock->get(iX+1,iY,iZ).computeVelocity(velp1); //vel at cell+1
-          ablock->get(iX-1,iY,iZ).computeVelocity(veln1); //vel at cell+1
-
-          // velocity gradients in y-direction
-          ablock->get(iX,iY+1,iZ).computeVelocity(velp2); //vel at cell+1
-          ablock->get(iX,iY-1,iZ).computeVelocity(veln2); //vel at cell+1
-
-          // velocity gradients in z-direction
-          ablock->get(iX,iY,iZ+1).computeVelocity(velp3); //vel at cell+1
-          ablock->get(iX,iY,iZ-1).computeVelocity(veln3); //vel at cell+1
-
-          shearrate[0] = (velp1[0]-veln1[0])/2; // dv_x /2*dx
-          shearrate[3] = (velp1[1]-veln1[1])/2; // dv_y/ 2*dx
-          shearrate[6] = (velp1[2]-veln1[2])/2; // dv_z /2*dx
-          shearrate[1] = (velp2[0]-veln2[0])/2; // dv_x / 2*dy
-          shearrate[4] = (velp2[1]-veln2[1])/2; // dv_y / 2*dy
-          shearrate[7] = (velp2[2]-veln2[2])/2; // dv_z / 2*dy
-          shearrate[2] = (velp3[0]-veln3[0])/2; // dv_x / 2*dz
-          shearrate[5] = (velp3[1]-veln3[1])/2; // dv_y / 2*dz
-          shearrate[8] = (velp3[2]-veln3[2])/2; // dv_z / 2*dz
-
-          output[n] = shearrate[0];
-          output[n+1] = shearrate[1];
-          output[n+2] = shearrate[2];
-          output[n+3] = shearrate[3];
-          output[n+4] = shearrate[4];
-          output[n+5] = shearrate[5];
-          output[n+6] = shearrate[6];
-          output[n+7] = shearrate[7];
-          output[n+8] = shearrate[8];
-          n += 9;
-        }
+    forEachOutputNode([&](hsize_t n, plint iX, plint iY, plint iZ) {
+      if ((iX < fluid.getBoundingBox().x0-2) || (iX > fluid.getBoundingBox().x1+2) ||
+          (iY < fluid.getBoundingBox().y0-2) || (iY > fluid.getBoundingBox().y1+2) ||
+          (iZ < fluid.getBoundingBox().z0-2) || (iZ > fluid.getBoundingBox().z1+2) ) {
+        return; //Stays zero
       }
-    }
-     
-    if (cellfields.hemocell.outputInSiUnits) {
-      for (unsigned int i = 0 ; i < (*nCells)*9 ; i++) {
-        output[i] = output[i]*(1/(param::dt));
+      for (int i = 0 ; i < 6 ; i++) {
+        output[n*6+i] += strainrate->get(iX,iY,iZ)[i];
       }
+    });
+    if (grid.average) {
+      averageRows(output,6);
     }
 
-    return output;
-  }
-  
-  float * outputStrainRate() {
-    float * output = new float [(*nCells)*6];
-    unsigned int n = 0;
-    // calculate tensorfield strain rate
-    std::unique_ptr<TensorField3D<T,6> > strainrate (computeStrainRateFromStress(*ablock));
-    // calculate norm of tensorfield
-    std::unique_ptr<ScalarField3D<T> > shearrate (computeSymmetricTensorNorm(*strainrate));
-    
-    //strainrate.get()
-    
-    for (plint iZ=odomain->z0-1; iZ<=odomain->z1+1; ++iZ) {
-      for (plint iY=odomain->y0-1; iY<=odomain->y1+1; ++iY) {
-        for (plint iX=odomain->x0-1; iX<=odomain->x1+1; ++iX) {
-            
-            
-            if ((iX < fluid.getBoundingBox().x0-2) || (iX > fluid.getBoundingBox().x1+2) ||
-	    (iY < fluid.getBoundingBox().y0-2) || (iY > fluid.getBoundingBox().y1+2) ||
-	    (iZ < fluid.getBoundingBox().z0-2) || (iZ > fluid.getBoundingBox().z1+2) )
-            {   output[n] = 0;
-                output[n+1] = 0;
-                output[n+2] = 0;
-                output[n+3] = 0;
-                output[n+4] = 0;
-                output[n+5] = 0;
-                n += 6;
-           }
-            else {
-    
-            output[n] = strainrate->get(iX,iY,iZ)[0];
-            output[n+1] = strainrate->get(iX,iY,iZ)[1];
-            output[n+2] = strainrate->get(iX,iY,iZ)[2];
-            output[n+3] = strainrate->get(iX,iY,iZ)[3];
-            output[n+4] = strainrate->get(iX,iY,iZ)[4];
-            output[n+5] = strainrate->get(iX,iY,iZ)[5];
-            n += 6;
-            }
-        }
-      }
-    }   
-     
     if (cellfields.hemocell.outputInSiUnits) {
       for (unsigned int i = 0 ; i < (*nCells)*6 ; i++) {
         output[i] = output[i]*(1/(param::dt));
@@ -556,6 +577,16 @@ private:
     int blockid;
     hsize_t * nCells;
     vector<int> & outputVariables;
+    /// When set, the blocks are collected here for a single file instead of written per block
+    Hdf5Staging * staging;
+    /// Per block file being filled when not staging
+    Hdf5BlockFile * file = 0;
+    /// Nodes of the current block that are written
+    OutputGrid grid;
+    /// Writing the fields that do not change to hdf5/static (parameters/staticOutput)
+    bool staticFields;
+    /// Writing the running statistics of this instead of the fluid, blocks[2] holds them
+    FluidAverage * averages;
 };
 }
 #endif
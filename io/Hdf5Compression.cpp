@@ -0,0 +1,182 @@
+/*
+This file is part of the HemoCell library
+
+HemoCell is developed and maintained by the Computational Science Lab 
+in the University of Amsterdam. Any questions or remarks regarding this library 
+can be sent to: info@hemocell.eu
+
+When using the HemoCell library in scientific work please cite the
+corresponding paper: https://doi.org/10.3389/fphys.2017.00563
+
+The HemoCell library is free software: you can redistribute it and/or
+modify it under the terms of the GNU Affero General Public License as
+published by the Free Software Foundation, either version 3 of the
+License, or (at your option) any later version.
+
+The library is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU Affero General Public License for more details.
+
+You should have received a copy of the GNU Affero General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+#include "Hdf5Compression.h"
+#include "config.h"
+#include "logfile.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <sstream>
+#include <stdexcept>
+
+namespace hemo {
+
+namespace {
+  /// <variable name="..." [file="..."]> of parameters/compression
+  struct Hdf5CompressionRule {
+    std::string file, dataset;
+    Hdf5Compression setting;
+  };
+  Hdf5Compression defaultCompression;
+  std::vector<Hdf5CompressionRule> compressionRules;
+}
+
+Hdf5Compression Hdf5Compression::parse(std::string const & setting) {
+  Hdf5Compression c;
+  std::stringstream in(setting);
+  std::string mode;
+  in >> mode;
+  double value;
+  int level;
+  if (mode == "none") {
+    c.mode = Mode::None;
+    return c;
+  } else if (mode == "deflate" || mode == "shuffle") {
+    c.mode = mode == "deflate" ? Mode::Deflate : Mode::Shuffle;
+    if (in >> level) { c.level = level; }
+  } else if (mode == "scaleoffset" || mode == "precision" || mode == "absolute") {
+    c.mode = mode == "scaleoffset" ? Mode::ScaleOffset : (mode == "precision" ? Mode::Precision : Mode::Absolute);
+    if (!(in >> value) || value < 0. || (c.mode != Mode::ScaleOffset && value == 0.)) {
+      hlog << "(HemoCell) (Config) Error compression \"" << setting << "\" needs a positive " << (c.mode == Mode::ScaleOffset ? "number of digits" : "error") << std::endl;
+      exit(1);
+    }
+    c.value = value;
+    if (in >> level) { c.level = level; }
+  } else {
+    hlog << "(HemoCell) (Config) Error unknown compression \"" << setting << "\", use none, deflate, shuffle, scaleoffset, precision or absolute" << std::endl;
+    exit(1);
+  }
+  if (c.level < 0 || c.level > 9) {
+    hlog << "(HemoCell) (Config) Error compression \"" << setting << "\" has a deflate level outside 0-9" << std::endl;
+    exit(1);
+  }
+  return c;
+}
+
+void Hdf5Compression::quantize(float * values, size_t n) const {
+  if (mode == Mode::Precision) {
+    //Keep enough mantissa bits for the relative error, round to nearest and zero the rest
+    const int keep = std::max(0,int(std::ceil(-std::log2(value))));
+    if (keep >= 23) { return; }
+    const uint32_t drop = 23 - keep;
+    const uint32_t half = 1u << (drop-1);
+    const uint32_t mask = ~((1u << drop) - 1);
+    for (size_t i = 0 ; i < n ; i++) {
+      uint32_t bits;
+      std::memcpy(&bits,&values[i],sizeof(bits));
+      if ((bits & 0x7f800000u) == 0x7f800000u) { continue; } //Inf and NaN
+      bits = (bits + half) & mask;
+      std::memcpy(&values[i],&bits,sizeof(bits));
+    }
+  } else if (mode == Mode::Absolute) {
+    const double step = 2.*value;
+    for (size_t i = 0 ; i < n ; i++) {
+      values[i] = float(std::nearbyint(values[i]/step)*step);
+    }
+  }
+}
+
+void Hdf5Compression::apply(hid_t plist, hid_t type, std::vector<hsize_t> const & dims, bool extendable) const {
+  if (!extendable && (mode == Mode::None || std::find(dims.begin(),dims.end(),0) != dims.end())) {
+    return; //Empty datasets cannot be chunked
+  }
+  std::vector<hsize_t> chunk = hdf5Chunk(dims,H5Tget_size(type));
+  H5Pset_chunk(plist,chunk.size(),chunk.data());
+  switch (mode) {
+    case Mode::None:
+      break;
+    case Mode::Deflate:
+      H5Pset_deflate(plist,level);
+      break;
+    case Mode::ScaleOffset:
+      if (H5Tget_class(type) == H5T_FLOAT) {
+        H5Pset_scaleoffset(plist,H5Z_SO_FLOAT_DSCALE,int(value));
+      } else {
+        H5Pset_scaleoffset(plist,H5Z_SO_INT,H5Z_SO_INT_MINBITS_DEFAULT);
+      }
+      break;
+    default: //Shuffle, and the rounded values compress best shuffled
+      H5Pset_shuffle(plist);
+      H5Pset_deflate(plist,level);
+  }
+}
+
+void loadHdf5Compression(Config * cfg) {
+  tinyxml2::XMLElement * compression;
+  try {
+    compression = (*cfg)["parameters"]["compression"].getOrig();
+  } catch (std::invalid_argument & e) {
+    return;
+  }
+  compressionRules.clear();
+  for (tinyxml2::XMLElement * e = compression->FirstChildElement(); e; e = e->NextSiblingElement()) {
+    std::string tag = e->Value();
+    std::string setting = e->GetText() ? e->GetText() : "";
+    if (tag == "default") {
+      defaultCompression = Hdf5Compression::parse(setting);
+    } else if (tag == "variable" && e->Attribute("name")) {
+      const char * file = e->Attribute("file");
+      compressionRules.push_back({file ? file : "", e->Attribute("name"), Hdf5Compression::parse(setting)});
+    } else {
+      hlog << "(HemoCell) (Config) Error in parameters/compression, expected <default> or <variable name=\"...\">, got <" << tag << ">" << std::endl;
+      exit(1);
+    }
+  }
+}
+
+Hdf5Compression const & hdf5Compression(std::string const & identifier, std::string const & dataset) {
+  std::string file = identifier;
+  if (file.size() > 4 && file.compare(file.size()-4,4,"_PRE") == 0) {
+    file.resize(file.size()-4);
+  }
+  Hdf5Compression const * found = &defaultCompression;
+  for (Hdf5CompressionRule const & rule : compressionRules) {
+    if (rule.dataset != dataset) { continue; }
+    if (rule.file == file) { return rule.setting; }
+    if (rule.file.empty()) { found = &rule.setting; }
+  }
+  return *found;
+}
+
+std::vector<hsize_t> hdf5Chunk(std::vector<hsize_t> const & dims, size_t elementSize) {
+  const hsize_t target = 1 << 20;
+  std::vector<hsize_t> chunk(dims.size(),1);
+  hsize_t bytes = elementSize;
+  for (int d = int(dims.size())-1 ; d >= 0 ; d--) {
+    const hsize_t dim = std::max<hsize_t>(dims[d],1);
+    if (bytes*dim <= target) {
+      chunk[d] = dim;
+      bytes *= dim;
+    } else {
+      chunk[d] = std::max<hsize_t>(target/bytes,1);
+      break;
+    }
+  }
+  return chunk;
+}
+
+}
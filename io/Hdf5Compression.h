@@ -0,0 +1,74 @@
+/*
+This file is part of the HemoCell library
+
+HemoCell is developed and maintained by the Computational Science Lab 
+in the University of Amsterdam. Any questions or remarks regarding this library 
+can be sent to: info@hemocell.eu
+
+When using the HemoCell library in scientific work please cite the
+corresponding paper: https://doi.org/10.3389/fphys.2017.00563
+
+The HemoCell library is free software: you can redistribute it and/or
+modify it under the terms of the GNU Affero General Public License as
+published by the Free Software Foundation, either version 3 of the
+License, or (at your option) any later version.
+
+The library is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU Affero General Public License for more details.
+
+You should have received a copy of the GNU Affero General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+#ifndef HDF5_COMPRESSION_H
+#define HDF5_COMPRESSION_H
+
+#include <hdf5.h>
+#include <string>
+#include <vector>
+
+namespace hemo {
+class Config;
+
+/**
+ * How one HDF5 dataset is stored (parameters/compression). A setting is written
+ * as "<mode> [value] [deflate level]":
+ *  - none                  contiguous, no filters
+ *  - deflate <level>       gzip (the default is deflate 7)
+ *  - shuffle <level>       byte shuffle before deflate
+ *  - scaleoffset <digits>  HDF5 scale-offset, floats keep <digits> decimal digits
+ *  - precision <relative>  float mantissa rounded to the relative error, then shuffle and deflate
+ *  - absolute <error>      floats rounded to multiples of 2*error, then shuffle and deflate
+ * The last two are lossy, integer datasets are always stored lossless.
+ */
+struct Hdf5Compression {
+  enum class Mode { None, Deflate, Shuffle, ScaleOffset, Precision, Absolute };
+  Mode mode = Mode::Deflate;
+  int level = 7;
+  /// Decimal digits (ScaleOffset) or the allowed error (Precision, Absolute)
+  double value = 0.;
+
+  /// Parse a setting, exits on an unknown mode
+  static Hdf5Compression parse(std::string const & setting);
+
+  /// Round the values in place to the allowed error, only for Precision and Absolute
+  void quantize(float * values, size_t n) const;
+  /**
+   * Set chunking and filters on a dataset creation property list, nothing for empty datasets.
+   * Extendable datasets are always chunked, dims is then the expected size of one append.
+   */
+  void apply(hid_t plist, hid_t type, std::vector<hsize_t> const & dims, bool extendable = false) const;
+};
+
+/// Read parameters/compression, keeps the default when it is not there
+void loadHdf5Compression(Config * cfg);
+
+/// Setting for a dataset in the file of identifier ("Fluid", "RBC", ..., a "_PRE" suffix is ignored)
+Hdf5Compression const & hdf5Compression(std::string const & identifier, std::string const & dataset);
+
+/// Chunks of about 1 MiB: whole trailing (fastest varying) dimensions, split along the first one that does not fit
+std::vector<hsize_t> hdf5Chunk(std::vector<hsize_t> const & dims, size_t elementSize);
+
+}
+#endif
@@ -23,18 +23,20 @@ along with this program.  If not, see <http://www.gnu.org/licenses/>.
 */
 #include "ParticleHdf5IO.h"
 #include "hemocell.h"
+#include "AsyncHdf5IO.h"
 
 #include <hdf5.h>
 #include <hdf5_hl.h>
 #include <vector>
 
 namespace hemo {
+
 /* ******** WriteCellField3DInMultipleHDF5Files *********************************** */
 WriteCellField3DInMultipleHDF5Files::WriteCellField3DInMultipleHDF5Files (
         HemoCellField & cellField3D_,
         plint iter_, std::string identifier_,
-        T dx_, T dt_, int ctype_) :
-        cellField3D(cellField3D_), iter(iter_), identifier(identifier_), dx(dx_), dt(dt_), ctype(ctype_) {};
+        T dx_, T dt_, int ctype_, Hdf5Staging * staging_) :
+        cellField3D(cellField3D_), iter(iter_), identifier(identifier_), dx(dx_), dt(dt_), ctype(ctype_), staging(staging_) {};
 
 void WriteCellField3DInMultipleHDF5Files::processGenericBlocks (
         Box3D domain, std::vector<AtomicBlock3D*> blocks )
@@ -51,6 +53,11 @@ void WriteCellField3DInMultipleHDF5Files::processGenericBlocks (
           return; //No output desired, no problem
       }
       
+    if (staging) {
+      stageBlock(particleField,domain);
+      return;
+    }
+
     if (cellField3D.cellFields.hemocell.partOfpreInlet) {
       identifier += "_PRE";
     }
@@ -58,141 +65,143 @@ void WriteCellField3DInMultipleHDF5Files::processGenericBlocks (
     /**            Initialise HDF5 file                        **/
    /************************************************************/
      std::string fileName = global::directories().getOutputDir() + "/hdf5/" + zeroPadNumber(iter) + '/' + identifier + "."  + zeroPadNumber(iter) + ".p." + to_string(particleField.atomicBlockId) + ".h5";
-     hid_t file_id;
-     file_id = H5Fcreate(fileName.c_str(), H5F_ACC_TRUNC, H5P_DEFAULT, H5P_DEFAULT);
-
-     H5LTset_attribute_double (file_id, "/", "dx", &dx, 1);
-     H5LTset_attribute_double (file_id, "/", "dt", &dt, 1);
-     long int iterHDF5=iter;
-     H5LTset_attribute_long (file_id, "/", "iteration", &iterHDF5, 1);
-     H5LTset_attribute_int (file_id, "/", "processorId", &id, 1);
-     H5LTset_attribute_long (file_id, "/", "numberOfProcessors", &size, 1);
-          
-     hsize_t dimVertices[2];
-     hsize_t chunk[2];  
- 
-     //vector<vector<T>> positions;
-     
+     Hdf5BlockFile * file = new Hdf5BlockFile(fileName,identifier);
+
+     file->attribute("dx", dx);
+     file->attribute("dt", dt);
+     file->attribute("iteration", long(iter));
+     file->attribute("processorId", id);
+     file->attribute("numberOfProcessors", size);
+
     /************************************************************/
-    /**            Write output to HDF5 file                   **/
+    /**            Collect output for the HDF5 file            **/
    /************************************************************/
-    
-    for (pluint i = 0; i < cellField3D.desiredOutputVariables.size(); i++) {
-        vector<vector<T>> * output = new vector<vector<T>>();
-        std::string vectorname = "";
-        particleField.passthroughpass(cellField3D.desiredOutputVariables[i],domain,*output,cellField3D.ctype,vectorname);
-        if (vectorname == "") { continue; }
-        dimVertices[0] = (*output).size();
-        dimVertices[1] = dimVertices[0] == 0 ? 0 :(*output)[0].size();
-        chunk[0] = 1000 < (*output).size() ? 1000 : (*output).size();
-        chunk[1] = dimVertices[1];
-        chunk[0] = chunk[0] > 1 ? chunk[0] : 1;
-        chunk[1] = chunk[1] > 1 ? chunk[1] : 1;
-
-        float* output_formatted = new float[dimVertices[0] * dimVertices[1]];
-        
-        int fmt_cnt = 0;
-        for (pluint x=0; x< dimVertices[0];x++) {
-            for (pluint y=0; y < dimVertices[1] ; y++) {
-                output_formatted[fmt_cnt] = (*output)[x][y];
-                fmt_cnt++;
-            }
-        }
-        hid_t sid = H5Screate_simple(2,dimVertices,NULL);
-        hid_t plist_id = H5Pcreate (H5P_DATASET_CREATE);
-        H5Pset_chunk(plist_id, 2, chunk); 
-        H5Pset_deflate(plist_id, 7);
-        hid_t did = H5Dcreate2(file_id,vectorname.c_str(),H5T_NATIVE_FLOAT,sid,H5P_DEFAULT,plist_id,H5P_DEFAULT);
-        H5Dwrite(did,H5T_NATIVE_FLOAT,H5S_ALL,H5S_ALL,H5P_DEFAULT,output_formatted);
-        H5Dclose(did);
-        H5Sclose(sid);
-            
-        if (cellField3D.desiredOutputVariables[i] == OUTPUT_POSITION) {
-            //positions = (*output);
-            long int nP = (*output).size();
-            H5LTset_attribute_long (file_id, "/", "numberOfParticles", &nP, 1);
+    vector<int> variables;
+    vector<std::string> names;
+    vector<unsigned int> columns;
+    for (int variable : cellField3D.desiredOutputVariables) {
+        std::string name;
+        unsigned int ncolumns;
+        if (HemoCellParticleField::particleOutputVariable(variable,name,ncolumns)) {
+            variables.push_back(variable);
+            names.push_back(name);
+            columns.push_back(ncolumns);
         }
+    }
 
-        delete output;
-        delete[] output_formatted;
+    //All variables are copied in one pass over the particles, straight into the buffers of the file
+    plint nCells;
+    const hsize_t nParticles = particleField.countOutputParticles(cellField3D.ctype,&nCells);
+    vector<float*> buffers;
+    for (unsigned int ncolumns : columns) {
+        buffers.push_back(new float[nParticles*ncolumns]);
+    }
+    particleField.extractOutput(cellField3D.ctype,variables,buffers);
+    for (unsigned int v = 0; v < variables.size(); v++) {
+        file->dataset(names[v], {nParticles, columns[v]}, buffers[v]);
+        if (variables[v] == OUTPUT_POSITION) {
+            file->attribute("numberOfParticles", long(nParticles));
+        }
     }
      
-    if (cellField3D.outputTriangles) { //Treat triangles seperately because of T/int issues
-        vector<vector<plint>> * output = new vector<vector<plint>>();
-        std::string vectorname;
-        particleField.outputTriangles(domain,*output, cellField3D.ctype,vectorname);
-        
-        dimVertices[0] = output->size();
-        dimVertices[1] = dimVertices[0] == 0 ? 0 :(*output)[0].size();
-        chunk[0] = 1000 < output->size() ? 1000 : output->size();
-        chunk[1] = dimVertices[1];
-        chunk[0] = chunk[0] > 1 ? chunk[0] : 1;
-        chunk[1] = chunk[1] > 1 ? chunk[1] : 1;
-           
-        int* output_formatted = new int[dimVertices[0] * dimVertices[1]];
-        int fmt_cnt = 0;
-        for (pluint x=0; x< dimVertices[0];x++) {
-            for (pluint y=0; y < dimVertices[1] ; y++) {
-                output_formatted[fmt_cnt] = (*output)[x][y];
-                fmt_cnt++;
+    if (global.staticOutput) { //Connectivity is in the topology file, store where every cell starts
+        int * ids = new int[nCells];
+        int * offsets = new int[nCells];
+        if (hsize_t(particleField.extractCellOffsets(cellField3D.ctype,ids,offsets)) != nParticles) {
+            hlog << "(WriteCellField3DInMultipleHDF5Files) Error, the cell offsets of " << identifier << " do not match the Position rows" << endl;
+            exit(1);
+        }
+        file->dataset("CellIds", {hsize_t(nCells), 1}, ids);
+        file->dataset("CellOffsets", {hsize_t(nCells), 1}, offsets);
+        file->attribute("numberOfCells", long(nCells));
+    } else {
+        if (cellField3D.outputTriangles) { //Treat triangles seperately because of T/int issues
+            const hsize_t nTriangles = nCells*cellField3D.triangle_list.size();
+            int * triangles = new int[nTriangles*3];
+            particleField.extractTriangles(cellField3D.ctype,triangles);
+            file->dataset("Triangles", {nTriangles, 3}, triangles);
+            file->attribute("numberOfTriangles", long(nTriangles));
+        }
+
+        if (std::find(cellField3D.desiredOutputVariables.begin(), cellField3D.desiredOutputVariables.end(),OUTPUT_INNER_LINKS) != cellField3D.desiredOutputVariables.end()) { //Treat lines seperately because of T/int issues
+            const hsize_t nLinks = nCells*cellField3D.mechanics->cellConstants.inner_edge_list.size();
+            if (nLinks != 0) {
+              int * links = new int[nLinks*2];
+              particleField.extractInnerLinks(cellField3D.ctype,links);
+              file->dataset("InnerLinks", {nLinks, 2}, links);
+              file->attribute("numberOfInnerLinks", long(nLinks));
             }
         }
-        
-        hid_t sid = H5Screate_simple(2,dimVertices,NULL);
-        hid_t plist_id = H5Pcreate (H5P_DATASET_CREATE);
-        H5Pset_chunk(plist_id, 2, chunk); 
-        H5Pset_deflate(plist_id, 7);
-        hid_t did = H5Dcreate2(file_id,vectorname.c_str(),H5T_NATIVE_INT,sid,H5P_DEFAULT,plist_id,H5P_DEFAULT);
-        H5Dwrite(did,H5T_NATIVE_INT,H5S_ALL,H5S_ALL,H5P_DEFAULT,output_formatted);
-        H5Dclose(did);
-        H5Sclose(sid);
-        
-        long int nT = output->size();
-        H5LTset_attribute_long (file_id, "/", "numberOfTriangles", &nT, 1);
-        delete output;
-        delete[] output_formatted;
-     }
-   
-     if (std::find(cellField3D.desiredOutputVariables.begin(), cellField3D.desiredOutputVariables.end(),OUTPUT_INNER_LINKS) != cellField3D.desiredOutputVariables.end()) { //Treat lines seperately because of T/int issues
-       
-        vector<vector<plint>> * output = new vector<vector<plint>>();
-        std::string vectorname;
-        particleField.outputInnerLinks(domain,*output, cellField3D.ctype,vectorname);
-        if (output->size() != 0) {
-          dimVertices[0] = output->size();
-          dimVertices[1] = dimVertices[0] == 0 ? 0 :(*output)[0].size();
-          chunk[0] = 1000 < output->size() ? 1000 : output->size();
-          chunk[1] = dimVertices[1];
-          chunk[0] = chunk[0] > 1 ? chunk[0] : 1;
-          chunk[1] = chunk[1] > 1 ? chunk[1] : 1;
-
-          int* output_formatted = new int[dimVertices[0] * dimVertices[1]];
-          int fmt_cnt = 0;
-          for (pluint x=0; x< dimVertices[0];x++) {
-              for (pluint y=0; y < dimVertices[1] ; y++) {
-                  output_formatted[fmt_cnt] = (*output)[x][y];
-                  fmt_cnt++;
-              }
-          }
-
-          hid_t sid = H5Screate_simple(2,dimVertices,NULL);
-          hid_t plist_id = H5Pcreate (H5P_DATASET_CREATE);
-          H5Pset_chunk(plist_id, 2, chunk); 
-          H5Pset_deflate(plist_id, 7);
-          hid_t did = H5Dcreate2(file_id,vectorname.c_str(),H5T_NATIVE_INT,sid,H5P_DEFAULT,plist_id,H5P_DEFAULT);
-          H5Dwrite(did,H5T_NATIVE_INT,H5S_ALL,H5S_ALL,H5P_DEFAULT,output_formatted);
-          H5Dclose(did);
-          H5Sclose(sid);
-
-          long int nT = output->size();
-          H5LTset_attribute_long (file_id, "/", "numberOfInnerLinks", &nT, 1);
-          delete[] output_formatted;
-        }
-        delete output;
-     }
-     
-     H5Fclose(file_id);
+    }
 
+    //With asynchronous output the file is compressed and written on the I/O thread
+    if (cellField3D.cellFields.hemocell.asyncOutput) {
+      cellField3D.cellFields.hemocell.asyncOutput->add(file);
+    } else {
+      file->write();
+      delete file;
+    }
+}
+
+void WriteCellField3DInMultipleHDF5Files::stageBlock(HemoCellParticleField & particleField, Box3D domain) {
+    //Connectivity of this block indexes its own positions, which start here in the staged Position rows
+    Hdf5StagedDataset * staged = staging->find("Position");
+    const long long positionBase = staged ? staged->rows() : 0;
+
+    plint nCells;
+    const size_t nParticles = particleField.countOutputParticles(cellField3D.ctype,&nCells);
+
+    //Grow the staged datasets first, their buffers are filled in one pass over the particles
+    vector<int> variables;
+    vector<std::pair<std::string,size_t>> appendAt;
+    for (int variable : cellField3D.desiredOutputVariables) {
+        std::string name;
+        unsigned int ncolumns;
+        if (!HemoCellParticleField::particleOutputVariable(variable,name,ncolumns)) { continue; }
+        Hdf5StagedDataset & ds = staging->dataset(name,ncolumns);
+        variables.push_back(variable);
+        appendAt.push_back({name,ds.values.size()});
+        ds.values.resize(ds.values.size() + nParticles*ncolumns);
+    }
+    vector<float*> buffers;
+    for (auto const & at : appendAt) {
+        buffers.push_back(staging->find(at.first)->values.data() + at.second);
+    }
+    particleField.extractOutput(cellField3D.ctype,variables,buffers);
+
+    if (global.staticOutput) {
+        //Create both before taking references, a new dataset can move the others
+        staging->dataset("CellIds",1,Hdf5Type::Int);
+        staging->dataset("CellOffsets",1,Hdf5Type::Int).indexInto = "Position";
+        vector<long long> & ids = staging->find("CellIds")->ivalues;
+        vector<long long> & offsets = staging->find("CellOffsets")->ivalues;
+        const size_t at = offsets.size();
+        ids.resize(at + nCells);
+        offsets.resize(at + nCells);
+        const long long rows = particleField.extractCellOffsets(cellField3D.ctype,ids.data() + at,offsets.data() + at,positionBase);
+        Hdf5StagedDataset * position = staging->find("Position");
+        if (rows != positionBase + (long long)nParticles || (position && (long long)position->rows() != rows)) {
+            hlog << "(WriteCellField3DInMultipleHDF5Files) Error, the cell offsets of " << identifier << " do not match the Position rows" << endl;
+            exit(1);
+        }
+        return;
+    }
+
+    if (cellField3D.outputTriangles) {
+        Hdf5StagedDataset & ds = staging->dataset("Triangles",3,Hdf5Type::Int);
+        ds.indexInto = "Position";
+        const size_t at = ds.ivalues.size();
+        ds.ivalues.resize(at + nCells*cellField3D.triangle_list.size()*3);
+        particleField.extractTriangles(cellField3D.ctype,ds.ivalues.data() + at,positionBase);
+    }
+
+    if (std::find(cellField3D.desiredOutputVariables.begin(), cellField3D.desiredOutputVariables.end(),OUTPUT_INNER_LINKS) != cellField3D.desiredOutputVariables.end()) {
+        Hdf5StagedDataset & ds = staging->dataset("InnerLinks",2,Hdf5Type::Int);
+        ds.indexInto = "Position";
+        const size_t at = ds.ivalues.size();
+        ds.ivalues.resize(at + nCells*cellField3D.mechanics->cellConstants.inner_edge_list.size()*2);
+        particleField.extractInnerLinks(cellField3D.ctype,ds.ivalues.data() + at,positionBase);
+    }
 }
 
 WriteCellField3DInMultipleHDF5Files* WriteCellField3DInMultipleHDF5Files::clone() const {
@@ -217,7 +226,16 @@ void writeCellField3D_HDF5(HemoCellFields& cellFields, T dx, T dt, plint iter, s
 {
     global.statistics.getCurrent()["writeCellField"].start();
 
+    if (global.hdf5OutputLayout != Hdf5OutputLayout::Blocks) {
+        writeCellField3D_HDF5_SingleFile(cellFields,dx,dt,iter,preString);
+        global.statistics.getCurrent().stop();
+        return;
+    }
+
     for (pluint i = 0; i < cellFields.size(); i++) {
+        if (!cellFields[i]->nextOutputIsWritten()) {
+            continue; //Not written at this output (HemoCell::setOutputInterval)
+        }
 	std::string identifier = preString + cellFields[i]->getIdentifier();
         WriteCellField3DInMultipleHDF5Files * bprf = new WriteCellField3DInMultipleHDF5Files(*cellFields[i], iter, identifier, dx, dt, i);
         vector<MultiBlock3D*> wrapper;
@@ -228,4 +246,118 @@ void writeCellField3D_HDF5(HemoCellFields& cellFields, T dx, T dt, plint iter, s
     global.statistics.getCurrent().stop();
 }
 
-}
\ No newline at end of file
+void writeCellField3D_HDF5_SingleFile(HemoCellFields& cellFields, T dx, T dt, plint iter, std::string preString)
+{
+    //The pre-inlet and the domain processes write separate files
+    MPI_Comm comm;
+    int id = global::mpi().getRank();
+    MPI_Comm_split(MPI_COMM_WORLD,cellFields.hemocell.partOfpreInlet,id,&comm);
+    int commSize;
+    MPI_Comm_size(comm,&commSize);
+
+    for (pluint i = 0; i < cellFields.size(); i++) {
+        if (!cellFields[i]->nextOutputIsWritten() || cellFields[i]->desiredOutputVariables.size() == 0) {
+            continue; //No output desired, same decision on every process
+        }
+        std::string identifier = preString + cellFields[i]->getIdentifier();
+        if (cellFields.hemocell.partOfpreInlet) {
+            identifier += "_PRE";
+        }
+
+        Hdf5Staging staging;
+        WriteCellField3DInMultipleHDF5Files * bprf = new WriteCellField3DInMultipleHDF5Files(*cellFields[i], iter, identifier, dx, dt, i, &staging);
+        vector<MultiBlock3D*> wrapper;
+        wrapper.push_back(cellFields[i]->getParticleArg());
+        applyProcessingFunctional (bprf,cellFields[i]->getParticleField3D()->getBoundingBox(), wrapper );
+
+        hid_t file_id;
+        const bool timeSeries = global.hdf5OutputLayout == Hdf5OutputLayout::TimeSeries;
+        if (timeSeries) {
+            std::string fileName = global::directories().getOutputDir() + "/hdf5/" + identifier + ".h5";
+            file_id = staging.append(fileName,identifier,iter,comm);
+        } else {
+            std::string fileName = global::directories().getOutputDir() + "/hdf5/" + zeroPadNumber(iter) + '/' + identifier + "."  + zeroPadNumber(iter) + ".h5";
+            file_id = staging.write(fileName,identifier,comm);
+        }
+
+        double dx_d = dx, dt_d = dt;
+        H5LTset_attribute_double (file_id, "/", "dx", &dx_d, 1);
+        H5LTset_attribute_double (file_id, "/", "dt", &dt_d, 1);
+        long int size = commSize;
+        H5LTset_attribute_long (file_id, "/", "numberOfProcessors", &size, 1);
+        if (timeSeries) { //The iteration and size of every dump are in the Index group
+            H5Fclose(file_id);
+            continue;
+        }
+        long int iterHDF5=iter;
+        H5LTset_attribute_long (file_id, "/", "iteration", &iterHDF5, 1);
+        if (Hdf5StagedDataset * ds = staging.find("Position")) {
+            long int nP = ds->total;
+            H5LTset_attribute_long (file_id, "/", "numberOfParticles", &nP, 1);
+        }
+        if (Hdf5StagedDataset * ds = staging.find("Triangles")) {
+            long int nT = ds->total;
+            H5LTset_attribute_long (file_id, "/", "numberOfTriangles", &nT, 1);
+        }
+        if (Hdf5StagedDataset * ds = staging.find("InnerLinks")) {
+            long int nT = ds->total;
+            H5LTset_attribute_long (file_id, "/", "numberOfInnerLinks", &nT, 1);
+        }
+        if (Hdf5StagedDataset * ds = staging.find("CellIds")) {
+            long int nC = ds->total;
+            H5LTset_attribute_long (file_id, "/", "numberOfCells", &nC, 1);
+        }
+        H5Fclose(file_id);
+    }
+    MPI_Comm_free(&comm);
+}
+
+void writeCellTopology_HDF5(HemoCellFields& cellFields)
+{
+    if (global::mpi().getRank() != 0) {
+        return; //The template is the same everywhere
+    }
+    for (pluint i = 0; i < cellFields.size(); i++) {
+        HemoCellField & cellField = *cellFields[i];
+        if (cellField.desiredOutputVariables.size() == 0) {
+            continue;
+        }
+        std::string fileName = global::directories().getOutputDir() + "/hdf5/static/" + cellField.getIdentifier() + ".topology.h5";
+        Hdf5BlockFile * file = new Hdf5BlockFile(fileName,cellField.getIdentifier());
+        file->attribute("numVertex", long(cellField.numVertex));
+
+        if (cellField.outputTriangles) {
+            const hsize_t nTriangles = cellField.triangle_list.size();
+            int * triangles = new int[nTriangles*3];
+            for (hsize_t t = 0; t < nTriangles; t++) {
+                for (int v = 0; v < 3; v++) {
+                    triangles[t*3+v] = cellField.triangle_list[t][v];
+                }
+            }
+            file->dataset("Triangles", {nTriangles, 3}, triangles);
+            file->attribute("numberOfTriangles", long(nTriangles));
+        }
+
+        std::vector<hemo::Array<plint,2>> const & innerLinks = cellField.mechanics->cellConstants.inner_edge_list;
+        if (std::find(cellField.desiredOutputVariables.begin(), cellField.desiredOutputVariables.end(),OUTPUT_INNER_LINKS) != cellField.desiredOutputVariables.end() && innerLinks.size()) {
+            const hsize_t nLinks = innerLinks.size();
+            int * links = new int[nLinks*2];
+            for (hsize_t l = 0; l < nLinks; l++) {
+                links[l*2] = innerLinks[l][0];
+                links[l*2+1] = innerLinks[l][1];
+            }
+            file->dataset("InnerLinks", {nLinks, 2}, links);
+            file->attribute("numberOfInnerLinks", long(nLinks));
+        }
+
+        //Never write HDF5 next to the I/O thread
+        if (cellFields.hemocell.asyncOutput) {
+            cellFields.hemocell.asyncOutput->add(file);
+        } else {
+            file->write();
+            delete file;
+        }
+    }
+}
+
+}
@@ -27,8 +27,13 @@ along with this program.  If not, see <http://www.gnu.org/licenses/>.
 #include "hemoCellParticle.h"
 #include "hemoCellFields.h"
 #include "hemoCellField.h"
+#include "SingleFileHdf5IO.h"
 namespace hemo {
 void writeCellField3D_HDF5(HemoCellFields& cellFields, T dx, T dt, plint iter, std::string preString="");
+/// All blocks of a cell type in one file per timestep, or appended to one file per run, written collectively (parameters/hdf5Output "single", "timeseries")
+void writeCellField3D_HDF5_SingleFile(HemoCellFields& cellFields, T dx, T dt, plint iter, std::string preString="");
+/// Template connectivity of every cell type to hdf5/static/<type>.topology.h5 (parameters/staticOutput)
+void writeCellTopology_HDF5(HemoCellFields& cellFields);
 
 
 class WriteCellField3DInMultipleHDF5Files : public BoxProcessingFunctional3D
@@ -37,7 +42,7 @@ public:
     WriteCellField3DInMultipleHDF5Files (
             HemoCellField & cellField3D_,
             plint iter_, std::string identifier_,
-            T dx_, T dt_, int i);
+            T dx_, T dt_, int i, Hdf5Staging * staging_ = 0);
     /// Arguments: [0] Particle-field. [1] Lattice.
     ~WriteCellField3DInMultipleHDF5Files(){}; //Fuck C c++
     virtual void processGenericBlocks(Box3D domain, std::vector<AtomicBlock3D*> fields);
@@ -51,6 +56,9 @@ private:
     double dx;
     double dt;
     int ctype;
+    /// When set, the blocks are collected here for a single file instead of written per block
+    Hdf5Staging * staging;
+    void stageBlock(HemoCellParticleField & particleField, Box3D domain);
 };
 }
 #endif  // FICSION_PARTICLE_HDF5IO_H
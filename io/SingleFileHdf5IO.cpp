@@ -0,0 +1,413 @@
+/*
+This file is part of the HemoCell library
+
+HemoCell is developed and maintained by the Computational Science Lab 
+in the University of Amsterdam. Any questions or remarks regarding this library 
+can be sent to: info@hemocell.eu
+
+When using the HemoCell library in scientific work please cite the
+corresponding paper: https://doi.org/10.3389/fphys.2017.00563
+
+The HemoCell library is free software: you can redistribute it and/or
+modify it under the terms of the GNU Affero General Public License as
+published by the Free Software Foundation, either version 3 of the
+License, or (at your option) any later version.
+
+The library is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU Affero General Public License for more details.
+
+You should have received a copy of the GNU Affero General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+#include "SingleFileHdf5IO.h"
+#include "Hdf5Compression.h"
+#include "logfile.h"
+
+#include <algorithm>
+#include <cstdlib>
+#include <sstream>
+#include <sys/stat.h>
+
+namespace hemo {
+using namespace std;
+
+bool singleFileHdf5Supported() {
+#ifdef H5_HAVE_PARALLEL
+  return true;
+#else
+  return false;
+#endif
+}
+
+Hdf5StagedDataset & Hdf5Staging::dataset(string const & name, hsize_t columns, Hdf5Type type) {
+  map<string,unsigned int>::iterator it = index.find(name);
+  if (it != index.end()) {
+    Hdf5StagedDataset & ds = datasets[it->second];
+    //The width is only known once a block has rows
+    if (ds.rows() == 0 && columns > 0) {
+      ds.columns = columns;
+    }
+    return ds;
+  }
+  index[name] = datasets.size();
+  datasets.emplace_back();
+  Hdf5StagedDataset & ds = datasets.back();
+  ds.name = name;
+  ds.columns = columns > 0 ? columns : 1;
+  ds.type = type;
+  return ds;
+}
+
+Hdf5StagedDataset * Hdf5Staging::find(string const & name) {
+  map<string,unsigned int>::iterator it = index.find(name);
+  return it == index.end() ? 0 : &datasets[it->second];
+}
+
+void Hdf5Staging::agree(MPI_Comm comm) {
+  //One line per dataset: name, columns, type, indexInto (names contain spaces, not tabs)
+  stringstream local;
+  for (Hdf5StagedDataset const & ds : datasets) {
+    local << ds.name << '\t' << ds.columns << '\t' << int(ds.type) << '\t' << ds.indexInto << '\n';
+  }
+  string localString = local.str();
+  int size, localLength = localString.size();
+  MPI_Comm_size(comm,&size);
+  vector<int> lengths(size), displs(size,0);
+  MPI_Allgather(&localLength,1,MPI_INT,lengths.data(),1,MPI_INT,comm);
+  for (int i = 1 ; i < size ; i++) {
+    displs[i] = displs[i-1] + lengths[i-1];
+  }
+  vector<char> all(displs[size-1]+lengths[size-1]+1,'\0');
+  MPI_Allgatherv(&localString[0],localLength,MPI_CHAR,all.data(),lengths.data(),displs.data(),MPI_CHAR,comm);
+
+  //The order of first appearance over the processes is the same everywhere
+  vector<Hdf5StagedDataset> ordered;
+  map<string,unsigned int> orderedIndex;
+  stringstream lines(string(all.data(),all.size()-1));
+  string line;
+  while (getline(lines,line)) {
+    stringstream fields(line);
+    string name, columns, type, indexInto;
+    getline(fields,name,'\t');
+    getline(fields,columns,'\t');
+    getline(fields,type,'\t');
+    getline(fields,indexInto,'\t');
+    if (orderedIndex.find(name) != orderedIndex.end()) {
+      //Processes without rows might not know the width
+      Hdf5StagedDataset & known = ordered[orderedIndex[name]];
+      known.columns = std::max<hsize_t>(known.columns,atoll(columns.c_str()));
+      continue;
+    }
+    orderedIndex[name] = ordered.size();
+    Hdf5StagedDataset * mine = find(name);
+    if (mine) {
+      ordered.push_back(std::move(*mine));
+    } else {
+      ordered.emplace_back();
+      ordered.back().name = name;
+      ordered.back().columns = atoll(columns.c_str());
+      ordered.back().type = Hdf5Type(atoi(type.c_str()));
+      ordered.back().indexInto = indexInto;
+    }
+  }
+  datasets.swap(ordered);
+  index.swap(orderedIndex);
+}
+
+void Hdf5Staging::distribute(MPI_Comm comm) {
+  //Prefix sum of the rows of every dataset over the processes
+  const unsigned int n = datasets.size();
+  vector<unsigned long long> rows(n), offsets(n,0), totals(n);
+  for (unsigned int i = 0 ; i < n ; i++) {
+    rows[i] = datasets[i].rows();
+  }
+  int rank;
+  MPI_Comm_rank(comm,&rank);
+  MPI_Exscan(rows.data(),offsets.data(),n,MPI_UNSIGNED_LONG_LONG,MPI_SUM,comm);
+  if (rank == 0) {
+    std::fill(offsets.begin(),offsets.end(),0);
+  }
+  MPI_Allreduce(rows.data(),totals.data(),n,MPI_UNSIGNED_LONG_LONG,MPI_SUM,comm);
+  for (unsigned int i = 0 ; i < n ; i++) {
+    datasets[i].offset = offsets[i];
+    datasets[i].total = totals[i];
+  }
+  for (Hdf5StagedDataset & ds : datasets) {
+    Hdf5StagedDataset * target = ds.indexInto.empty() ? 0 : find(ds.indexInto);
+    if (!target || !ds.isInteger()) { continue; }
+    for (long long & value : ds.ivalues) {
+      value += target->offset;
+    }
+  }
+}
+
+#ifdef H5_HAVE_PARALLEL
+namespace {
+  hid_t fileType(Hdf5StagedDataset const & ds) {
+    return ds.type == Hdf5Type::Float ? H5T_NATIVE_FLOAT : (ds.type == Hdf5Type::Int ? H5T_NATIVE_INT : H5T_NATIVE_LLONG);
+  }
+
+  /// The filters of a setting that can be used with collective writes
+  Hdf5Compression collectiveFilters(Hdf5Compression compression) {
+#if !H5_VERSION_GE(1,10,2)
+    compression.mode = Hdf5Compression::Mode::None;
+#endif
+    return compression;
+  }
+
+  /// Collective write of the rows of ds, the rows of this process start at row first + ds.offset of did
+  void writeRows(hid_t did, Hdf5StagedDataset const & ds, hsize_t first, hid_t dxpl) {
+    hsize_t start[2] = {first+ds.offset,0};
+    hsize_t count[2] = {ds.rows(),ds.columns};
+    hid_t memType = ds.isInteger() ? H5T_NATIVE_LLONG : H5T_NATIVE_FLOAT;
+
+    hid_t fspace = H5Dget_space(did);
+    hid_t mspace;
+    long long dummy = 0;
+    const void * buffer = &dummy;
+    if (count[0] > 0) {
+      H5Sselect_hyperslab(fspace,H5S_SELECT_SET,start,NULL,count,NULL);
+      mspace = H5Screate_simple(2,count,NULL);
+      buffer = ds.isInteger() ? (const void *)ds.ivalues.data() : (const void *)ds.values.data();
+    } else {
+      //Processes without rows still take part in the collective write
+      H5Sselect_none(fspace);
+      hsize_t one[2] = {1,ds.columns};
+      mspace = H5Screate_simple(2,one,NULL);
+      H5Sselect_none(mspace);
+    }
+    H5Dwrite(did,memType,mspace,fspace,dxpl,buffer);
+    H5Sclose(mspace);
+    H5Sclose(fspace);
+  }
+
+  /// Open the dataset with an unlimited number of rows, or create it empty, rows is set to its current number of rows
+  hid_t openExtendable(hid_t file, string const & name, hid_t type, hsize_t columns, hsize_t appendRows, Hdf5Compression const & compression, hsize_t & rows) {
+    if (H5Lexists(file,name.c_str(),H5P_DEFAULT) > 0) {
+      hid_t did = H5Dopen2(file,name.c_str(),H5P_DEFAULT);
+      hid_t space = H5Dget_space(did);
+      hsize_t dims[2];
+      H5Sget_simple_extent_dims(space,dims,NULL);
+      H5Sclose(space);
+      rows = dims[0];
+      return did;
+    }
+    hsize_t dims[2] = {0,columns};
+    hsize_t maxdims[2] = {H5S_UNLIMITED,columns};
+    hid_t space = H5Screate_simple(2,dims,maxdims);
+    hid_t dcpl = H5Pcreate(H5P_DATASET_CREATE);
+    compression.apply(dcpl,type,{appendRows,columns},true);
+    hid_t did = H5Dcreate2(file,name.c_str(),type,space,H5P_DEFAULT,dcpl,H5P_DEFAULT);
+    H5Pclose(dcpl);
+    H5Sclose(space);
+    rows = 0;
+    return did;
+  }
+
+  /// Set row step of an index dataset, only the first process writes it
+  void writeIndexRow(hid_t file, string const & name, hsize_t step, vector<long long> const & values, int rank, hid_t dxpl) {
+    hsize_t rows;
+    hid_t did = openExtendable(file,name,H5T_NATIVE_LLONG,values.size(),1024,collectiveFilters(Hdf5Compression()),rows);
+    hsize_t dims[2] = {std::max(rows,step+1),values.size()};
+    H5Dset_extent(did,dims);
+    hid_t fspace = H5Dget_space(did);
+    hsize_t start[2] = {step,0};
+    hsize_t count[2] = {1,values.size()};
+    hid_t mspace = H5Screate_simple(2,count,NULL);
+    if (rank == 0) {
+      H5Sselect_hyperslab(fspace,H5S_SELECT_SET,start,NULL,count,NULL);
+    } else {
+      H5Sselect_none(fspace);
+      H5Sselect_none(mspace);
+    }
+    H5Dwrite(did,H5T_NATIVE_LLONG,mspace,fspace,dxpl,values.data());
+    H5Sclose(mspace);
+    H5Sclose(fspace);
+    H5Dclose(did);
+  }
+
+  /// Read a whole (rows x columns) index dataset
+  vector<long long> readIndex(hid_t file, string const & name, hsize_t & rows, hsize_t & columns) {
+    hid_t did = H5Dopen2(file,name.c_str(),H5P_DEFAULT);
+    hid_t space = H5Dget_space(did);
+    hsize_t dims[2];
+    H5Sget_simple_extent_dims(space,dims,NULL);
+    H5Sclose(space);
+    rows = dims[0];
+    columns = dims[1];
+    vector<long long> values(rows*columns);
+    if (values.size()) {
+      H5Dread(did,H5T_NATIVE_LLONG,H5S_ALL,H5S_ALL,H5P_DEFAULT,values.data());
+    }
+    H5Dclose(did);
+    return values;
+  }
+
+  herr_t collectName(hid_t, const char * name, const H5L_info_t *, void * names) {
+    static_cast<vector<string>*>(names)->push_back(name);
+    return 0;
+  }
+
+  /**
+   * Drop the dumps at or after iteration, these are left by a run that was restarted
+   * from an earlier checkpoint. Returns the number of dumps that are kept.
+   */
+  hsize_t truncateIndex(hid_t file, long long iteration) {
+    if (H5Lexists(file,"Index/Iteration",H5P_DEFAULT) <= 0) {
+      return 0;
+    }
+    hsize_t steps, columns;
+    vector<long long> iterations = readIndex(file,"Index/Iteration",steps,columns);
+    const hsize_t kept = std::find_if(iterations.begin(),iterations.end(),[iteration](long long i) { return i >= iteration; }) - iterations.begin();
+    if (kept == steps) {
+      return kept;
+    }
+
+    vector<string> names;
+    hid_t group = H5Gopen2(file,"Index",H5P_DEFAULT);
+    H5Literate(group,H5_INDEX_NAME,H5_ITER_NATIVE,NULL,collectName,&names);
+    H5Gclose(group);
+    for (string const & name : names) {
+      hsize_t rows;
+      //The (first row, rows) of every dump of the dataset with the same name
+      vector<long long> index = readIndex(file,"Index/" + name,rows,columns);
+      if (columns == 2 && H5Lexists(file,name.c_str(),H5P_DEFAULT) > 0) {
+        hsize_t end = 0;
+        for (hsize_t s = 0 ; s < std::min(rows,kept) ; s++) {
+          end = std::max<hsize_t>(end,index[s*2]+index[s*2+1]);
+        }
+        hid_t did = H5Dopen2(file,name.c_str(),H5P_DEFAULT);
+        hid_t space = H5Dget_space(did);
+        hsize_t dims[2];
+        H5Sget_simple_extent_dims(space,dims,NULL);
+        H5Sclose(space);
+        dims[0] = end;
+        H5Dset_extent(did,dims);
+        H5Dclose(did);
+      }
+      hid_t did = H5Dopen2(file,("Index/" + name).c_str(),H5P_DEFAULT);
+      hsize_t dims[2] = {std::min(rows,kept),columns};
+      H5Dset_extent(did,dims);
+      H5Dclose(did);
+    }
+    return kept;
+  }
+}
+#endif
+
+hid_t Hdf5Staging::write(string const & fileName, string const & identifier, MPI_Comm comm) {
+#ifdef H5_HAVE_PARALLEL
+  agree(comm);
+  distribute(comm);
+
+  hid_t fapl = H5Pcreate(H5P_FILE_ACCESS);
+  H5Pset_fapl_mpio(fapl,comm,MPI_INFO_NULL);
+  hid_t file_id = H5Fcreate(fileName.c_str(),H5F_ACC_TRUNC,H5P_DEFAULT,fapl);
+  H5Pclose(fapl);
+
+  hid_t dxpl = H5Pcreate(H5P_DATASET_XFER);
+  H5Pset_dxpl_mpio(dxpl,H5FD_MPIO_COLLECTIVE);
+  for (Hdf5StagedDataset & ds : datasets) {
+    Hdf5Compression const & compression = hdf5Compression(identifier,ds.name);
+    compression.quantize(ds.values.data(),ds.values.size());
+    hid_t dcpl = H5Pcreate(H5P_DATASET_CREATE);
+    //The chunks follow from the global size, the same on every process
+    hsize_t dims[2] = {ds.total,ds.columns};
+    collectiveFilters(compression).apply(dcpl,fileType(ds),{dims[0],dims[1]});
+
+    hid_t fspace = H5Screate_simple(2,dims,NULL);
+    hid_t did = H5Dcreate2(file_id,ds.name.c_str(),fileType(ds),fspace,H5P_DEFAULT,dcpl,H5P_DEFAULT);
+    H5Sclose(fspace);
+    H5Pclose(dcpl);
+    writeRows(did,ds,0,dxpl);
+    H5Dclose(did);
+  }
+  H5Pclose(dxpl);
+  return file_id;
+#else
+  hlog << "(HemoCell) (Output) Single file HDF5 output requires HDF5 with parallel (MPI-IO) support" << endl;
+  exit(1);
+#endif
+}
+
+hid_t Hdf5Staging::append(string const & fileName, string const & identifier, long long iteration, MPI_Comm comm,
+                          vector<pair<string,long long>> const & stepValues) {
+#ifdef H5_HAVE_PARALLEL
+  agree(comm);
+  distribute(comm);
+
+  int rank, exists = 0;
+  MPI_Comm_rank(comm,&rank);
+  if (rank == 0) {
+    struct stat buffer;
+    exists = stat(fileName.c_str(),&buffer) == 0;
+  }
+  MPI_Bcast(&exists,1,MPI_INT,0,comm);
+  hid_t fapl = H5Pcreate(H5P_FILE_ACCESS);
+  H5Pset_fapl_mpio(fapl,comm,MPI_INFO_NULL);
+  hid_t file_id;
+  if (exists) {
+    file_id = H5Fopen(fileName.c_str(),H5F_ACC_RDWR,fapl);
+  } else {
+    file_id = H5Fcreate(fileName.c_str(),H5F_ACC_TRUNC,H5P_DEFAULT,fapl);
+    H5Gclose(H5Gcreate2(file_id,"Index",H5P_DEFAULT,H5P_DEFAULT,H5P_DEFAULT));
+  }
+  H5Pclose(fapl);
+  const hsize_t step = truncateIndex(file_id,iteration);
+
+  hid_t dxpl = H5Pcreate(H5P_DATASET_XFER);
+  H5Pset_dxpl_mpio(dxpl,H5FD_MPIO_COLLECTIVE);
+  for (Hdf5StagedDataset & ds : datasets) {
+    Hdf5Compression const & compression = hdf5Compression(identifier,ds.name);
+    compression.quantize(ds.values.data(),ds.values.size());
+    hsize_t first;
+    hid_t did = openExtendable(file_id,ds.name,fileType(ds),ds.columns,std::max<hsize_t>(ds.total,1024),collectiveFilters(compression),first);
+    hsize_t dims[2] = {first+ds.total,ds.columns};
+    H5Dset_extent(did,dims);
+    writeRows(did,ds,first,dxpl);
+    H5Dclose(did);
+    writeIndexRow(file_id,"Index/" + ds.name,step,{(long long)first,(long long)ds.total},rank,dxpl);
+  }
+  writeIndexRow(file_id,"Index/Iteration",step,{iteration},rank,dxpl);
+  for (pair<string,long long> const & value : stepValues) {
+    writeIndexRow(file_id,"Index/" + value.first,step,{value.second},rank,dxpl);
+  }
+  H5Pclose(dxpl);
+  return file_id;
+#else
+  hlog << "(HemoCell) (Output) Time series HDF5 output requires HDF5 with parallel (MPI-IO) support" << endl;
+  exit(1);
+#endif
+}
+
+hid_t Hdf5Staging::writeLocal(string const & fileName, string const & identifier) {
+  hid_t file_id = H5Fcreate(fileName.c_str(),H5F_ACC_TRUNC,H5P_DEFAULT,H5P_DEFAULT);
+  for (Hdf5StagedDataset & ds : datasets) {
+    ds.offset = 0;
+    ds.total = ds.rows();
+    Hdf5Compression const & compression = hdf5Compression(identifier,ds.name);
+    compression.quantize(ds.values.data(),ds.values.size());
+    hid_t type = ds.type == Hdf5Type::Float ? H5T_NATIVE_FLOAT : (ds.type == Hdf5Type::Int ? H5T_NATIVE_INT : H5T_NATIVE_LLONG);
+    hid_t dcpl = H5Pcreate(H5P_DATASET_CREATE);
+    hsize_t dims[2] = {ds.total,ds.columns};
+    compression.apply(dcpl,type,{dims[0],dims[1]});
+
+    hid_t fspace = H5Screate_simple(2,dims,NULL);
+    hid_t did = H5Dcreate2(file_id,ds.name.c_str(),type,fspace,H5P_DEFAULT,dcpl,H5P_DEFAULT);
+    if (ds.total > 0) {
+      if (ds.isInteger()) {
+        H5Dwrite(did,H5T_NATIVE_LLONG,H5S_ALL,H5S_ALL,H5P_DEFAULT,ds.ivalues.data());
+      } else {
+        H5Dwrite(did,H5T_NATIVE_FLOAT,H5S_ALL,H5S_ALL,H5P_DEFAULT,ds.values.data());
+      }
+    }
+    H5Sclose(fspace);
+    H5Pclose(dcpl);
+    H5Dclose(did);
+  }
+  return file_id;
+}
+
+}
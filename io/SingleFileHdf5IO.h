@@ -0,0 +1,102 @@
+/*
+This file is part of the HemoCell library
+
+HemoCell is developed and maintained by the Computational Science Lab 
+in the University of Amsterdam. Any questions or remarks regarding this library 
+can be sent to: info@hemocell.eu
+
+When using the HemoCell library in scientific work please cite the
+corresponding paper: https://doi.org/10.3389/fphys.2017.00563
+
+The HemoCell library is free software: you can redistribute it and/or
+modify it under the terms of the GNU Affero General Public License as
+published by the Free Software Foundation, either version 3 of the
+License, or (at your option) any later version.
+
+The library is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU Affero General Public License for more details.
+
+You should have received a copy of the GNU Affero General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+#ifndef SINGLE_FILE_HDF5IO_H
+#define SINGLE_FILE_HDF5IO_H
+
+#include <hdf5.h>
+#include <mpi.h>
+#include <map>
+#include <string>
+#include <utility>
+#include <vector>
+
+namespace hemo {
+
+/// True when HDF5 is build with MPI-IO support, needed for parameters/hdf5Output "single"
+bool singleFileHdf5Supported();
+
+/// Type of a dataset in the file, integer datasets are staged as long long
+enum class Hdf5Type { Float = 0, Int = 1, Long = 2 };
+
+/// Rows of one dataset produced by this process, to be written in a shared file
+struct Hdf5StagedDataset {
+  std::string name;
+  hsize_t columns = 1;
+  Hdf5Type type = Hdf5Type::Float;
+  std::vector<float> values;
+  std::vector<long long> ivalues;
+  /// Integer datasets that index rows of another dataset (e.g. Triangles into Position) get its global row offset added
+  std::string indexInto;
+
+  /// Set by Hdf5Staging::write(), global offset of our rows and total number of rows
+  hsize_t offset = 0, total = 0;
+
+  bool isInteger() const { return type != Hdf5Type::Float; }
+  hsize_t rows() const { return (isInteger() ? ivalues.size() : values.size())/columns; }
+};
+
+/**
+ * Collects the output of all atomic blocks of this process, and writes it
+ * to a single file per timestep together with all other processes of comm.
+ * The rows of every process are placed after each other (prefix sum over the
+ * processes) and written with one collective MPI-IO call per dataset.
+ */
+class Hdf5Staging {
+public:
+  /// Dataset to append rows to, created on first use
+  Hdf5StagedDataset & dataset(std::string const & name, hsize_t columns, Hdf5Type type = Hdf5Type::Float);
+  Hdf5StagedDataset * find(std::string const & name);
+
+  /**
+   * Create fileName collectively and write all datasets, returns the open file for attributes (collective).
+   * identifier selects the compression of the datasets (hdf5Compression()), filters need HDF5 1.10.2 or newer,
+   * older versions only apply the lossy rounding.
+   */
+  hid_t write(std::string const & fileName, std::string const & identifier, MPI_Comm comm);
+  /**
+   * Append all datasets to the time series fileName (parameters/hdf5Output "timeseries"), created on first use (collective).
+   * The datasets have an unlimited number of rows, every dump adds its rows at the end. Index/Iteration holds
+   * the iteration of every dump, Index/<dataset> the first row and number of rows of the dump, and every
+   * stepValue is stored as Index/<name>. Dumps at or after iteration (from before a restart) are dropped first.
+   * Returns the open file for attributes.
+   */
+  hid_t append(std::string const & fileName, std::string const & identifier, long long iteration, MPI_Comm comm,
+               std::vector<std::pair<std::string,long long>> const & stepValues = {});
+  /**
+   * Create fileName from this process alone and write the rows staged here, returns the open file.
+   * For serial HDF5 builds, after the rows of all processes are gathered on one process.
+   */
+  hid_t writeLocal(std::string const & fileName, std::string const & identifier);
+
+  std::vector<Hdf5StagedDataset> datasets;
+private:
+  /// Make the list of datasets the same on every process, also for processes without blocks
+  void agree(MPI_Comm comm);
+  /// Global offset and total of the rows of every dataset, shifts the indexInto datasets
+  void distribute(MPI_Comm comm);
+  std::map<std::string,unsigned int> index;
+};
+
+}
+#endif
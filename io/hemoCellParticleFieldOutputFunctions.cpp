@@ -25,427 +25,159 @@ along with this program.  If not, see <http://www.gnu.org/licenses/>.
 #include "hemocell.h"
 namespace hemo {
 
-void HemoCellParticleField::AddOutputMap() {
-  outputFunctionMap[OUTPUT_POSITION] = &HemoCellParticleField::outputPositions;
-  outputFunctionMap[OUTPUT_VELOCITY] = &HemoCellParticleField::outputVelocities;
-  outputFunctionMap[OUTPUT_FORCE] = &HemoCellParticleField::outputForces;
-  outputFunctionMap[OUTPUT_FORCE_VOLUME] = &HemoCellParticleField::outputForceVolume;
-  outputFunctionMap[OUTPUT_FORCE_AREA] = &HemoCellParticleField::outputForceArea;
-  outputFunctionMap[OUTPUT_FORCE_LINK] = &HemoCellParticleField::outputForceLink;
-  outputFunctionMap[OUTPUT_FORCE_INNER_LINK] = &HemoCellParticleField::outputForceInnerLink;
-  outputFunctionMap[OUTPUT_FORCE_BENDING] = &HemoCellParticleField::outputForceBending;
-  outputFunctionMap[OUTPUT_FORCE_VISC] = &HemoCellParticleField::outputForceVisc;
-  outputFunctionMap[OUTPUT_VERTEX_ID] = &HemoCellParticleField::outputVertexId;
-  outputFunctionMap[OUTPUT_CELL_ID] = &HemoCellParticleField::outputCellId;
-  outputFunctionMap[OUTPUT_FORCE_REPULSION] = &HemoCellParticleField::outputForceRepulsion;
-  outputFunctionMap[OUTPUT_RES_TIME] = &HemoCellParticleField::outputResTime;
-
-}
-
-void HemoCellParticleField::passthroughpass(int type, Box3D domain, vector<vector<T>>& output, pluint ctype, std::string & name) {
-  if (outputFunctionMap.find(type) == outputFunctionMap.end()) { return; }
-  void (HemoCellParticleField::*badideapointer)(Box3D,vector<vector<T>>&, pluint, std::string&) = outputFunctionMap[type];
-  (this->*badideapointer)(domain,output,ctype,name);
-}
-
-void HemoCellParticleField::outputPositions(Box3D domain,vector<vector<T>>& output, pluint ctype, std::string & name) {
-  deleteIncompleteCells(ctype);
-  name = "Position";
-  output.clear();
-  HemoCellParticle * sparticle;
-  const map<int,bool> & lpc = get_lpc();
-  const map<int,vector<int>> & particles_per_cell = get_particles_per_cell();
-  for ( const auto &lpc_it : lpc ) {
-    int cellid = lpc_it.first;
-    if (particles_per_cell.at(cellid)[0] == -1) { continue; }
-    if (ctype != particles[particles_per_cell.at(cellid)[0]].sv.celltype) {continue;}
-    for (pluint i = 0; i < particles_per_cell.at(cellid).size(); i++) {
-      if (particles_per_cell.at(cellid)[i] == -1) { continue; }
-      sparticle = &particles[particles_per_cell.at(cellid)[i]];
-
-      vector<T> pbv;
-      pbv.push_back(sparticle->sv.position[0]);
-      pbv.push_back(sparticle->sv.position[1]);
-      pbv.push_back(sparticle->sv.position[2]);
-      output.push_back(pbv); //TODO, memory copy
-
-    }
-  }
-  if(cellFields->hemocell.outputInSiUnits) {
-    for (vector<T> & tf : output) {
-      for (T & n : tf) {
-        n = n * param::dx;
-      }
-    }
-  }
-}
-
-void HemoCellParticleField::outputVelocities(Box3D domain,vector<vector<T>>& output, pluint ctype, std::string & name) {
+bool HemoCellParticleField::particleOutputVariable(int variable, std::string & name, unsigned int & columns) {
+  columns = 3;
+  switch (variable) {
+    case OUTPUT_POSITION: name = "Position"; return true;
+    case OUTPUT_VELOCITY: name = "Velocity"; return true;
+    case OUTPUT_FORCE: name = "Total force"; return true;
+    case OUTPUT_FORCE_VOLUME: name = "Volume force"; return true;
+    case OUTPUT_FORCE_AREA: name = "Area force"; return true;
+    case OUTPUT_FORCE_LINK: name = "Link force"; return true;
+    case OUTPUT_FORCE_INNER_LINK: name = "Inner link force"; return true;
+    case OUTPUT_FORCE_BENDING: name = "Bending force"; return true;
+    case OUTPUT_FORCE_VISC: name = "Viscous force"; return true;
+    case OUTPUT_FORCE_REPULSION: name = "Repulsion force"; return true;
+  }
+  columns = 1;
+  switch (variable) {
+    case OUTPUT_VERTEX_ID: name = "Vertex Id"; return true;
+    case OUTPUT_CELL_ID: name = "Cell Id"; return true;
+    case OUTPUT_RES_TIME: name = "Res Time"; return true;
+  }
+  return false;
+}
+
+plint HemoCellParticleField::countOutputParticles(pluint ctype, plint * nCells) {
   deleteIncompleteCells(ctype);
-  name = "Velocity";
-  output.clear();
-  HemoCellParticle * sparticle;
-  const map<int,bool> & lpc = get_lpc();
-  const map<int,vector<int>> & particles_per_cell = get_particles_per_cell();
-  for ( const auto &lpc_it : lpc ) {
-    int cellid = lpc_it.first;
-    if (particles_per_cell.at(cellid)[0] == -1) { continue; }
-    if (ctype != particles[particles_per_cell.at(cellid)[0]].sv.celltype) {continue;}
-    for (pluint i = 0; i < particles_per_cell.at(cellid).size(); i++) {
-      if (particles_per_cell.at(cellid)[i] == -1) { continue; }
-      sparticle = &particles[particles_per_cell.at(cellid)[i]];
-
-      vector<T> pbv;
-      pbv.push_back(sparticle->sv.v[0]);
-      pbv.push_back(sparticle->sv.v[1]);
-      pbv.push_back(sparticle->sv.v[2]);
-      output.push_back(pbv); //TODO, memory copy
-    }
-  }
-  if(cellFields->hemocell.outputInSiUnits) {
-    for (vector<T> & tf : output) {
-      for (T & n : tf) {
-        n = n * param::dx/param::dt;
-      }
-    }
-  }
-}
-
-void HemoCellParticleField::outputForceBending(Box3D domain,vector<vector<T>>& output, pluint ctype, std::string & name) {
-  name = "Bending force";
-  output.clear();
-  HemoCellParticle * sparticle;
-  const map<int,bool> & lpc = get_lpc();
-  const map<int,vector<int>> & particles_per_cell = get_particles_per_cell();
-  for ( const auto &lpc_it : lpc ) {
-    int cellid = lpc_it.first;
-    if (particles_per_cell.at(cellid)[0] == -1) { continue; }
-    if (ctype != particles[particles_per_cell.at(cellid)[0]].sv.celltype) {continue;}
-    for (pluint i = 0; i < particles_per_cell.at(cellid).size(); i++) {
-      sparticle = &particles[particles_per_cell.at(cellid)[i]];
-
-      vector<T> tf;
-      tf.push_back((*sparticle->force_bending)[0]);
-      tf.push_back((*sparticle->force_bending)[1]);
-      tf.push_back((*sparticle->force_bending)[2]);
-      output.push_back(tf);
-    }
-  }
-  if(cellFields->hemocell.outputInSiUnits) {
-    for (vector<T> & tf : output) {
-      for (T & n : tf) {
-        n = n * param::df;
-      }
-    }
-  }
-}
-
-void HemoCellParticleField::outputForceArea(Box3D domain,vector<vector<T>>& output, pluint ctype, std::string & name) {
-  name = "Area force";
-  output.clear();
-  HemoCellParticle * sparticle;
-  const map<int,bool> & lpc = get_lpc();
-  const map<int,vector<int>> & particles_per_cell = get_particles_per_cell();
-  for ( const auto &lpc_it : lpc ) {
-    int cellid = lpc_it.first;
-    if (particles_per_cell.at(cellid)[0] == -1) { continue; }
-    if (ctype != particles[particles_per_cell.at(cellid)[0]].sv.celltype) {continue;}
-    for (pluint i = 0; i < particles_per_cell.at(cellid).size(); i++) {
-      sparticle = &particles[particles_per_cell.at(cellid)[i]];
- 
-      vector<T> tf;
-      tf.push_back((*sparticle->force_area)[0]);
-      tf.push_back((*sparticle->force_area)[1]);
-      tf.push_back((*sparticle->force_area)[2]);
-      output.push_back(tf);
-    }
-  }
-  if(cellFields->hemocell.outputInSiUnits) {
-    for (vector<T> & tf : output) {
-      for (T & n : tf) {
-        n = n * param::df;
-      }
-    }
-  }
-}
-
-void HemoCellParticleField::outputForceLink(Box3D domain,vector<vector<T>>& output, pluint ctype, std::string & name) {
-  name = "Link force";
-  output.clear();
-  HemoCellParticle * sparticle;
-  const map<int,bool> & lpc = get_lpc();
-  const map<int,vector<int>> & particles_per_cell = get_particles_per_cell();
-  for ( const auto &lpc_it : lpc ) {
-    int cellid = lpc_it.first;
-    if (particles_per_cell.at(cellid)[0] == -1) { continue; }
-    if (ctype != particles[particles_per_cell.at(cellid)[0]].sv.celltype) {continue;}
-    for (pluint i = 0; i < particles_per_cell.at(cellid).size(); i++) {
-      sparticle = &particles[particles_per_cell.at(cellid)[i]];
- 
-      vector<T> tf;
-      tf.push_back((*sparticle->force_link)[0]);
-      tf.push_back((*sparticle->force_link)[1]);
-      tf.push_back((*sparticle->force_link)[2]);
-      output.push_back(tf);
-    }
-  }
-  if(cellFields->hemocell.outputInSiUnits) {
-    for (vector<T> & tf : output) {
-      for (T & n : tf) {
-        n = n * param::df;
-      }
-    }
-  }
-}
-
-void HemoCellParticleField::outputForceInnerLink(Box3D domain,vector<vector<T>>& output, pluint ctype, std::string & name) {
-  name = "Inner link force";
-  output.clear();
-  HemoCellParticle * sparticle;
-  const map<int,bool> & lpc = get_lpc();
-  const map<int,vector<int>> & particles_per_cell = get_particles_per_cell();
-  for ( const auto &lpc_it : lpc ) {
-    int cellid = lpc_it.first;
-    if (particles_per_cell.at(cellid)[0] == -1) { continue; }
-    if (ctype != particles[particles_per_cell.at(cellid)[0]].sv.celltype) {continue;}
-    for (pluint i = 0; i < particles_per_cell.at(cellid).size(); i++) {
-      sparticle = &particles[particles_per_cell.at(cellid)[i]];
- 
-      vector<T> tf;
-      tf.push_back((*sparticle->force_inner_link)[0]);
-      tf.push_back((*sparticle->force_inner_link)[1]);
-      tf.push_back((*sparticle->force_inner_link)[2]);
-      output.push_back(tf);
-    }
-  }
-  if(cellFields->hemocell.outputInSiUnits) {
-    for (vector<T> & tf : output) {
-      for (T & n : tf) {
-        n = n * param::df;
-      }
-    }
-  }
-}
-
-void HemoCellParticleField::outputForceVolume(Box3D domain,vector<vector<T>>& output, pluint ctype, std::string & name) {
-  name = "Volume force";
-  output.clear();
-  HemoCellParticle * sparticle;
+  HemoCellField & cellField = *(*cellFields)[ctype];
+  const bool select = cellField.hasOutputCellSelection();
+  plint particleCount = 0;
+  outputCells.clear();
   const map<int,bool> & lpc = get_lpc();
   const map<int,vector<int>> & particles_per_cell = get_particles_per_cell();
   for ( const auto &lpc_it : lpc ) {
-    int cellid = lpc_it.first;
-    if (particles_per_cell.at(cellid)[0] == -1) { continue; }
-    if (ctype != particles[particles_per_cell.at(cellid)[0]].sv.celltype) {continue;}
-    for (pluint i = 0; i < particles_per_cell.at(cellid).size(); i++) {
-      sparticle = &particles[particles_per_cell.at(cellid)[i]];
-
-      vector<T> tf;
-      tf.push_back((*sparticle->force_volume)[0]);
-      tf.push_back((*sparticle->force_volume)[1]);
-      tf.push_back((*sparticle->force_volume)[2]);
-      output.push_back(tf);
-    }
-  }
+    vector<int> const & cell = particles_per_cell.at(lpc_it.first);
+    if (cell[0] == -1) { continue; }
+    if (ctype != particles[cell[0]].sv.celltype) {continue;}
+    plint count = 0;
+    hemo::Array<T,3> centroid = {0.,0.,0.};
+    for (int pid : cell) {
+      if (pid == -1) { continue; }
+      count++;
+      if (select) { centroid += particles[pid].sv.position; }
+    }
+    if (select && !cellField.isOutputCell(centroid/T(count))) { continue; }
+    outputCells.push_back(lpc_it.first);
+    particleCount += count;
+  }
+  if (nCells) {
+    *nCells = outputCells.size();
+  }
+  return particleCount;
+}
+
+template<typename O>
+void HemoCellParticleField::extractOutput(pluint ctype, vector<int> const & variables, vector<O*> const & buffers) {
+  //Conversion to SI units is folded into the copy
+  vector<T> scale(variables.size(),1.);
   if(cellFields->hemocell.outputInSiUnits) {
-    for (vector<T> & tf : output) {
-      for (T & n : tf) {
-        n = n * param::df;
+    for (unsigned int v = 0 ; v < variables.size() ; v++) {
+      switch (variables[v]) {
+        case OUTPUT_POSITION: scale[v] = param::dx; break;
+        case OUTPUT_VELOCITY: scale[v] = param::dx/param::dt; break;
+        case OUTPUT_RES_TIME: scale[v] = param::dt; break;
+        case OUTPUT_VERTEX_ID: case OUTPUT_CELL_ID: break;
+        default: scale[v] = param::df; //All forces
       }
     }
   }
-}
 
-void HemoCellParticleField::outputForceVisc(Box3D domain,vector<vector<T>>& output, pluint ctype, std::string & name) {
-  name = "Viscous force";
-  output.clear();
-  HemoCellParticle * sparticle;
-  const map<int,bool> & lpc = get_lpc();
+  size_t row = 0;
   const map<int,vector<int>> & particles_per_cell = get_particles_per_cell();
-  for ( const auto &lpc_it : lpc ) {
-    int cellid = lpc_it.first;
-    if (particles_per_cell.at(cellid)[0] == -1) { continue; }
-    if (ctype != particles[particles_per_cell.at(cellid)[0]].sv.celltype) {continue;}
-    for (pluint i = 0; i < particles_per_cell.at(cellid).size(); i++) {
-      sparticle = &particles[particles_per_cell.at(cellid)[i]];
-
-      vector<T> tf;
-      tf.push_back((*sparticle->force_visc)[0]);
-      tf.push_back((*sparticle->force_visc)[1]);
-      tf.push_back((*sparticle->force_visc)[2]);
-      output.push_back(tf);
-    }
-  }
-  if(cellFields->hemocell.outputInSiUnits) {
-    for (vector<T> & tf : output) {
-      for (T & n : tf) {
-        n = n * param::df;
+  for (int cellid : outputCells) {
+    for (int pid : particles_per_cell.at(cellid)) {
+      if (pid == -1) { continue; }
+      HemoCellParticle & particle = particles[pid];
+      for (unsigned int v = 0 ; v < variables.size() ; v++) {
+        const hemo::Array<T,3> * vec = 0;
+        T value = 0;
+        switch (variables[v]) {
+          case OUTPUT_POSITION: vec = &particle.sv.position; break;
+          case OUTPUT_VELOCITY: vec = &particle.sv.v; break;
+          case OUTPUT_FORCE: vec = &particle.force_total; break;
+          case OUTPUT_FORCE_VOLUME: vec = particle.force_volume; break;
+          case OUTPUT_FORCE_AREA: vec = particle.force_area; break;
+          case OUTPUT_FORCE_LINK: vec = particle.force_link; break;
+          case OUTPUT_FORCE_INNER_LINK: vec = particle.force_inner_link; break;
+          case OUTPUT_FORCE_BENDING: vec = particle.force_bending; break;
+          case OUTPUT_FORCE_VISC: vec = particle.force_visc; break;
+          case OUTPUT_FORCE_REPULSION: vec = &particle.sv.force_repulsion; break;
+          case OUTPUT_VERTEX_ID: value = particle.sv.vertexId; break;
+          case OUTPUT_CELL_ID: value = particle.sv.cellId; break;
+          case OUTPUT_RES_TIME: value = particle.sv.restime; break;
+          default: continue;
+        }
+        if (vec) {
+          O * out = buffers[v] + row*3;
+          out[0] = (*vec)[0]*scale[v];
+          out[1] = (*vec)[1]*scale[v];
+          out[2] = (*vec)[2]*scale[v];
+        } else {
+          buffers[v][row] = value*scale[v];
+        }
       }
+      row++;
     }
   }
 }
+template void HemoCellParticleField::extractOutput<float>(pluint, vector<int> const &, vector<float*> const &);
+template void HemoCellParticleField::extractOutput<double>(pluint, vector<int> const &, vector<double*> const &);
 
-void HemoCellParticleField::outputForceRepulsion(Box3D domain,vector<vector<T>>& output, pluint ctype, std::string & name) {
-  name = "Repulsion force";
-  output.clear();
-  HemoCellParticle * sparticle;
-  const map<int,bool> & lpc = get_lpc();
-  const map<int,vector<int>> & particles_per_cell = get_particles_per_cell();
-  for ( const auto &lpc_it : lpc ) {
-    int cellid = lpc_it.first;
-    if (particles_per_cell.at(cellid)[0] == -1) { continue; }
-    if (ctype != particles[particles_per_cell.at(cellid)[0]].sv.celltype) {continue;}
-    for (pluint i = 0; i < particles_per_cell.at(cellid).size(); i++) {
-      sparticle = &particles[particles_per_cell.at(cellid)[i]];
-
-      vector<T> tf;
-      tf.push_back(sparticle->sv.force_repulsion[0]);
-      tf.push_back(sparticle->sv.force_repulsion[1]);
-      tf.push_back(sparticle->sv.force_repulsion[2]);
-      output.push_back(tf);
-    }
-  }
-  if(cellFields->hemocell.outputInSiUnits) {
-    for (vector<T> & tf : output) {
-      for (T & n : tf) {
-        n = n * param::df;
-      }
+template<typename I>
+void HemoCellParticleField::extractTriangles(pluint ctype, I * output, I base) {
+  vector<hemo::Array<plint,3>> const & triangles = (*cellFields)[ctype]->triangle_list;
+  for (unsigned int c = 0 ; c < outputCells.size() ; c++) {
+    for (hemo::Array<plint,3> const & triangle : triangles) {
+      output[0] = triangle[0] + base;
+      output[1] = triangle[1] + base;
+      output[2] = triangle[2] + base;
+      output += 3;
     }
+    base += (*cellFields)[ctype]->numVertex;
   }
 }
+template void HemoCellParticleField::extractTriangles<int>(pluint, int *, int);
+template void HemoCellParticleField::extractTriangles<long long>(pluint, long long *, long long);
 
-void HemoCellParticleField::outputForces(Box3D domain,vector<vector<T>>& output, pluint ctype, std::string & name) {
-  name = "Total force";
-  output.clear();
-  HemoCellParticle * sparticle;
-  const map<int,bool> & lpc = get_lpc();
-  const map<int,vector<int>> & particles_per_cell = get_particles_per_cell();
-  for ( const auto &lpc_it : lpc ) {
-    int cellid = lpc_it.first;
-    if (particles_per_cell.at(cellid)[0] == -1) { continue; }
-    if (ctype != particles[particles_per_cell.at(cellid)[0]].sv.celltype) {continue;}
-    for (pluint i = 0; i < particles_per_cell.at(cellid).size(); i++) {
-      sparticle = &particles[particles_per_cell.at(cellid)[i]];
- 
-      vector<T> tf;
-      tf.push_back(sparticle->force_total[0]);
-      tf.push_back(sparticle->force_total[1]);
-      tf.push_back(sparticle->force_total[2]);
-      output.push_back(tf);
-    }
-  }
-  if(cellFields->hemocell.outputInSiUnits) {
-    for (vector<T> & tf : output) {
-      for (T & n : tf) {
-        n = n * param::df;
-      }
+template<typename I>
+void HemoCellParticleField::extractInnerLinks(pluint ctype, I * output, I base) {
+  vector<hemo::Array<plint,2>> const & links = (*cellFields)[ctype]->mechanics->cellConstants.inner_edge_list;
+  for (unsigned int c = 0 ; c < outputCells.size() ; c++) {
+    for (hemo::Array<plint,2> const & link : links) {
+      output[0] = link[0] + base;
+      output[1] = link[1] + base;
+      output += 2;
     }
+    base += (*cellFields)[ctype]->numVertex;
   }
 }
+template void HemoCellParticleField::extractInnerLinks<int>(pluint, int *, int);
+template void HemoCellParticleField::extractInnerLinks<long long>(pluint, long long *, long long);
 
-void HemoCellParticleField::outputTriangles(Box3D domain, vector<vector<plint>>& output, pluint ctype, std::string & name) {
-  name = "Triangles";
-  output.clear();
-  int counter = 0;
-  const map<int,bool> & lpc = get_lpc();
+template<typename I>
+I HemoCellParticleField::extractCellOffsets(pluint ctype, I * ids, I * offsets, I base) {
   const map<int,vector<int>> & particles_per_cell = get_particles_per_cell();
-  for ( const auto &lpc_it : lpc ) {
-    int cellid = lpc_it.first;
-    if (particles_per_cell.at(cellid)[0] == -1) { continue; }
-    if (ctype != particles[particles_per_cell.at(cellid)[0]].sv.celltype) {continue;}
-    for (pluint i = 0; i < (*cellFields)[ctype]->triangle_list.size(); i++) {
-      vector<plint> triangle = {(*cellFields)[ctype]->triangle_list[i][0] + counter,
-                          (*cellFields)[ctype]->triangle_list[i][1] + counter,
-                          (*cellFields)[ctype]->triangle_list[i][2] + counter};
-      output.push_back(triangle);
+  for (int cellid : outputCells) {
+    *ids++ = cellid;
+    *offsets++ = base;
+    for (int pid : particles_per_cell.at(cellid)) {
+      if (pid != -1) { base++; }
     }
-    counter += (*cellFields)[ctype]->numVertex;
   }
-   
+  return base;
 }
+template int HemoCellParticleField::extractCellOffsets<int>(pluint, int *, int *, int);
+template long long HemoCellParticleField::extractCellOffsets<long long>(pluint, long long *, long long *, long long);
 
-void HemoCellParticleField::outputInnerLinks(Box3D domain,vector<vector<plint>>& output, pluint ctype, std::string & name) {
-  name = "InnerLinks";
-  output.clear();
-  unsigned int counter = 0;
-  const map<int,bool> & lpc = get_lpc();
-  const map<int,vector<int>> & particles_per_cell = get_particles_per_cell();
-  for ( const auto &lpc_it : lpc ) {
-    int cellid = lpc_it.first;
-    if (particles_per_cell.at(cellid)[0] == -1) { continue; }
-    if (ctype != particles[particles_per_cell.at(cellid)[0]].sv.celltype)  {continue;}
-    for (pluint i = 0; i < (*cellFields)[ctype]->mechanics->cellConstants.inner_edge_list.size(); i++) {
-      vector<plint> link = {(*cellFields)[ctype]->mechanics->cellConstants.inner_edge_list[i][0] + counter,
-                            (*cellFields)[ctype]->mechanics->cellConstants.inner_edge_list[i][1] + counter,
-                           };
-      output.push_back(link);
-    }
-    counter += (*cellFields)[ctype]->numVertex;
-  }
 }
-
-void HemoCellParticleField::outputVertexId(Box3D domain,vector<vector<T>>& output, pluint ctype, std::string & name) {
-  name = "Vertex Id";
-  output.clear();
-  HemoCellParticle * sparticle;
-  const map<int,bool> & lpc = get_lpc();
-  const map<int,vector<int>> & particles_per_cell = get_particles_per_cell();
-  for ( const auto &lpc_it : lpc ) {
-    int cellid = lpc_it.first;
-    if (particles_per_cell.at(cellid)[0] == -1) { continue; }
-    if (ctype != particles[particles_per_cell.at(cellid)[0]].sv.celltype)  {continue;}
-    for (pluint i = 0; i < particles_per_cell.at(cellid).size(); i++) {
-      sparticle = &particles[particles_per_cell.at(cellid)[i]];
-      vector<T> tf;
-      tf.push_back((sparticle->sv.vertexId));
-      output.push_back(tf);
-    }
-  }
-}
-
-void HemoCellParticleField::outputCellId(Box3D domain,vector<vector<T>>& output, pluint ctype, std::string & name) {
-  name = "Cell Id";
-  output.clear();
-  HemoCellParticle * sparticle;
-  const map<int,bool> & lpc = get_lpc();
-  const map<int,vector<int>> & particles_per_cell = get_particles_per_cell();
-  for ( const auto &lpc_it : lpc ) {
-    int cellid = lpc_it.first;
-    if (particles_per_cell.at(cellid)[0] == -1) { continue; }
-    if (ctype != particles[particles_per_cell.at(cellid)[0]].sv.celltype) {continue;}
-    for (pluint i = 0; i < particles_per_cell.at(cellid).size(); i++) {
-      sparticle = &particles[particles_per_cell.at(cellid)[i]];
-      vector<T> tf;
-      tf.push_back((sparticle->sv.cellId));
-      output.push_back(tf);
-    }
-  }
-}
-
-void HemoCellParticleField::outputResTime(Box3D domain,vector<vector<T>>& output, pluint ctype, std::string & name) {
-  name = "Res Time";
-  output.clear();
-  HemoCellParticle * sparticle;
-  const map<int,bool> & lpc = get_lpc();
-  const map<int,vector<int>> & particles_per_cell = get_particles_per_cell();
-  for ( const auto &lpc_it : lpc ) {
-    int cellid = lpc_it.first;
-    if (particles_per_cell.at(cellid)[0] == -1) { continue; }
-    if (ctype != particles[particles_per_cell.at(cellid)[0]].sv.celltype) {continue;}
-    for (pluint i = 0; i < particles_per_cell.at(cellid).size(); i++) {
-      sparticle = &particles[particles_per_cell.at(cellid)[i]];
-      vector<T> tf;
-      tf.push_back((sparticle->sv.restime));
-      output.push_back(tf);
-    }
-  }
-  if(cellFields->hemocell.outputInSiUnits) {
-    for (vector<T> & tf : output) {
-      for (T & n : tf) {
-        n = n * param::dt;
-      }
-    }
-  }
-}
-
-}
\ No newline at end of file
@@ -23,7 +23,14 @@ along with this program.  If not, see <http://www.gnu.org/licenses/>.
 */
 #include "readPositionsBloodCells.h"
 #include "tools/packCells/geometry.h"
+#include "tools/packCells/positionFile.h"
 #include <sstream>
+#include <map>
+#include <memory>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
 #include "logfile.h"
 #include "hemocell.h"
 #include "preInlet.h"
@@ -33,16 +40,11 @@ along with this program.  If not, see <http://www.gnu.org/licenses/>.
 
 namespace hemo {
 
-/// Rotates a triangular surface mesh inplace. The rotation is applied in order
-/// X, Y, Z. NOTE: plb::TriangularSurfaceMesh does provide an method to rotate
-/// the surface mesh, however, that routine is defined in ZYX order.
-template<typename T>
-void rotateTriangularMeshXYZ(plb::TriangularSurfaceMesh<T>* mesh, T alpha, T beta, T gamma) {
-  PLB_ASSERT((theta > T() || util::fpequal(theta, T(), eps0)) &&
-             (theta < PI  || util::fpequal(theta, PI, eps0)));
-
+/// Rotation matrix of a rotation in order X, Y, Z, applied as x'_i = r_ij x_j.
+/// NOTE: plb::TriangularSurfaceMesh does provide an method to rotate the
+/// surface mesh, however, that routine is defined in ZYX order.
+static void rotationMatrixXYZ(T alpha, T beta, T gamma, T a[3][3]) {
   // Rotation matrix around x axis (column-first)
-  T a[3][3];
   a[0][0] =  (T) 1.0;
   a[0][1] =  (T) 0.0;
   a[0][2] =  (T) 0.0;
@@ -96,82 +98,237 @@ void rotateTriangularMeshXYZ(plb::TriangularSurfaceMesh<T>* mesh, T alpha, T bet
           }
       }
   }
+}
+
+/// Vertices of a cell type around the center of its bounding box, stored per
+/// component so that placing a cell is a vectorizable loop instead of a
+/// rotated copy of the whole surface mesh.
+struct CellTemplate {
+  CellTemplate(TriangularSurfaceMesh<T> & mesh) {
+    plb::Array<T,2> xRange, yRange, zRange;
+    mesh.computeBoundingBox (xRange, yRange, zRange);
+    plb::Array<T,3> center = plb::Array<T,3>(xRange[1] + xRange[0], yRange[1] + yRange[0], zRange[1] + zRange[0]) * (T)0.5;
+    for (plint iVertex = 0; iVertex < mesh.getNumVertices(); iVertex++) {
+      x.push_back(mesh.getVertex(iVertex)[0] - center[0]);
+      y.push_back(mesh.getVertex(iVertex)[1] - center[1]);
+      z.push_back(mesh.getVertex(iVertex)[2] - center[2]);
+    }
+    px.resize(x.size()); py.resize(x.size()); pz.resize(x.size());
+  }
+
+  /// Rotates (XYZ order) and translates the template into px, py, pz
+  void place(const hemo::Array<T,3> & position, const hemo::Array<T,3> & angles) {
+    T r[3][3];
+    rotationMatrixXYZ(angles[0], angles[1], angles[2], r);
+    const size_t n = x.size();
+    const T * __restrict__ tx = x.data(), * __restrict__ ty = y.data(), * __restrict__ tz = z.data();
+    T * __restrict__ ox = px.data(), * __restrict__ oy = py.data(), * __restrict__ oz = pz.data();
+    for (size_t i = 0; i < n; i++) {
+      ox[i] = position[0] + r[0][0]*tx[i] + r[0][1]*ty[i] + r[0][2]*tz[i];
+      oy[i] = position[1] + r[1][0]*tx[i] + r[1][1]*ty[i] + r[1][2]*tz[i];
+      oz[i] = position[2] + r[2][0]*tx[i] + r[2][1]*ty[i] + r[2][2]*tz[i];
+    }
+  }
 
-  for (auto iVertex = 0; iVertex < mesh->getNumVertices(); iVertex++) {
-      Array<T,3> x = mesh->getVertex(iVertex);
-      for (int i = 0; i < 3; i++) {
-          mesh->getVertex(iVertex)[i] = (T) 0.0;
-          for (int j = 0; j < 3; j++) {
-              mesh->getVertex(iVertex)[i] += a[i][j]*x[j];
+  vector<T> x, y, z;
+  /// Vertices of the last placed cell
+  vector<T> px, py, pz;
+};
+
+/// Nodes of a fluid block (extended by the layer size) that have a boundary
+/// node of the block within their (2d+1)^3 neighbourhood. Built once per
+/// block and layer size with a separable dilation, instead of testing the
+/// neighbourhood of every vertex of every cell with virtual isBoundary() calls.
+class WallDistanceMask {
+public:
+  WallDistanceMask(BlockLattice3D<T,DESCRIPTOR> & fluid, const vector<unsigned char> & boundary, int d_) : d(d_) {
+    Box3D bb = fluid.getBoundingBox();
+    n[0] = bb.getNx(); n[1] = bb.getNy(); n[2] = bb.getNz();
+    for (int a = 0; a < 3; a++) { e[a] = n[a] + 2*d; }
+    mask.assign(e[0]*e[1]*e[2], 0);
+    for (plint x = 0; x < n[0]; x++) {
+      for (plint y = 0; y < n[1]; y++) {
+        for (plint z = 0; z < n[2]; z++) {
+          mask[index(x,y,z)] = boundary[(x*n[1] + y)*n[2] + z];
+        }
+      }
+    }
+    if (d > 0) {
+      const plint stride[3] = {e[1]*e[2], e[2], 1};
+      vector<plint> count;
+      for (int a = 0; a < 3; a++) {
+        // Dilate every line along axis a with a running count of boundary nodes
+        const int b = (a+1)%3, c = (a+2)%3;
+        count.resize(e[a] + 1);
+        for (plint i = 0; i < e[b]; i++) {
+          for (plint j = 0; j < e[c]; j++) {
+            unsigned char * line = &mask[i*stride[b] + j*stride[c]];
+            count[0] = 0;
+            for (plint k = 0; k < e[a]; k++) { count[k+1] = count[k] + line[k*stride[a]]; }
+            for (plint k = 0; k < e[a]; k++) {
+              line[k*stride[a]] = count[std::min(e[a], k + d + 1)] > count[std::max(plint(0), k - d)];
+            }
           }
+        }
       }
+    }
   }
-}
 
-inline void meshRotation (TriangularSurfaceMesh<T> * mesh, hemo::Array<T,3> rotationAngles) {
-    plb::Array<T,2> xRange, yRange, zRange;
-    mesh->computeBoundingBox (xRange, yRange, zRange);
-    plb::Array<T,3> meshCenter = plb::Array<T,3>(xRange[1] + xRange[0], yRange[1] + yRange[0], zRange[1] + zRange[0]) * (T)0.5;
-    mesh->translate((T)-1.0 * meshCenter);
-    rotateTriangularMeshXYZ(mesh, rotationAngles[0], rotationAngles[1], rotationAngles[2]);
-    mesh->translate(meshCenter);
-}
+  /// Location relative to the fluid block
+  bool denied(const Dot3D & rel) const {
+    if (rel.x < -d || rel.y < -d || rel.z < -d || rel.x >= n[0] + d || rel.y >= n[1] + d || rel.z >= n[2] + d) {
+      return false;
+    }
+    return mask[index(rel.x,rel.y,rel.z)];
+  }
+
+  /// Boundary flag of every node of the fluid block, in x-major order
+  static vector<unsigned char> boundaryNodes(BlockLattice3D<T,DESCRIPTOR> & fluid) {
+    Box3D bb = fluid.getBoundingBox();
+    vector<unsigned char> boundary(bb.nCells());
+    plint i = 0;
+    for (plint x = bb.x0; x <= bb.x1; x++) {
+      for (plint y = bb.y0; y <= bb.y1; y++) {
+        for (plint z = bb.z0; z <= bb.z1; z++) {
+          boundary[i++] = fluid.get(x,y,z).getDynamics().isBoundary();
+        }
+      }
+    }
+    return boundary;
+  }
+
+private:
+  plint index(plint x, plint y, plint z) const { return ((x+d)*e[1] + y+d)*e[2] + z+d; }
+
+  plint d;
+  plint n[3], e[3];
+  vector<unsigned char> mask;
+};
 
 inline void positionCellInParticleField(HemoCellParticleField& particleField, BlockLattice3D<T,DESCRIPTOR>& fluid,
-                                            TriangularSurfaceMesh<T> * mesh, hemo::Array<T,3> startingPoint, plint cellId, pluint celltype) {
-    plint nVertices=mesh->getNumVertices();
-    Box3D fluidbb = fluid.getBoundingBox();
-    Dot3D rrelfluidloc; // used later;
-    int denyLayerSize; // used later;
-    HemoCellParticle::serializeValues_t to_add_particle; // used_later
-
-    for (plint iVertex=0; iVertex < nVertices; ++iVertex) {
-        hemo::Array<T,3> vertex = startingPoint + mesh->getVertex(iVertex);
-        
+                                            const WallDistanceMask & wallMask, const CellTemplate & cell, plint cellId, pluint celltype) {
+    const Box3D particlebb = particleField.getBoundingBox();
+    const Dot3D fluidLocation = fluid.getLocation();
+
+    for (plint iVertex = 0; iVertex < plint(cell.px.size()); ++iVertex) {
+        hemo::Array<T,3> vertex({cell.px[iVertex], cell.py[iVertex], cell.pz[iVertex]});
+
         //If we cannot place it in the particle field continue
-        if (!particleField.isContainedABS(vertex,particleField.getBoundingBox())) { continue; }
-        
-        //Custom contains function for generic blocklattice3D structure
+        if (!particleField.isContainedABS(vertex,particlebb)) { continue; }
+
+        // Deny particles in a boundary or in the outer most layer, aka. the "shear layer"
         Dot3D absfluidloc(int(vertex[0]+0.5),int(vertex[1]+0.5),int(vertex[2]+0.5));
-        Dot3D relfluidloc = absfluidloc - fluid.getLocation();
-        
-        
-        if (!(relfluidloc.x < fluidbb.x0 || relfluidloc.x > fluidbb.x1 ||
-            relfluidloc.y < fluidbb.y0 || relfluidloc.y > fluidbb.y1 ||
-            relfluidloc.z < fluidbb.z0 || relfluidloc.z > fluidbb.z1)) {
-              // Test when particle is inside if in a boundary -> dont add this particle
-            if (fluid.get(relfluidloc.x,relfluidloc.y,relfluidloc.z).getDynamics().isBoundary()) {
-        	goto no_add;
-            }
-        } 
-            
-      //bool neighboringBoundariesAnywhere = false;  
-      // Deny particles that are in the outer most layer, aka. the "shear layer"    
-      denyLayerSize = ((*particleField.cellFields)[celltype]->minimumDistanceFromSolid*1e-6)/param::dx;
-      for (int px = -denyLayerSize; px <= denyLayerSize; ++px) {  
-        for (int py = -denyLayerSize; py <= denyLayerSize; ++py) { 
-          for (int pz = -denyLayerSize; pz <= denyLayerSize; ++pz) {
-            rrelfluidloc = {relfluidloc.x+px,relfluidloc.y+py,relfluidloc.z+pz};
-            if (!(rrelfluidloc.x < fluidbb.x0 || rrelfluidloc.x > fluidbb.x1 ||
-                  rrelfluidloc.y < fluidbb.y0 || rrelfluidloc.y > fluidbb.y1 ||
-                  rrelfluidloc.z < fluidbb.z0 || rrelfluidloc.z > fluidbb.z1)) {
-              if (fluid.get(rrelfluidloc.x,rrelfluidloc.y,rrelfluidloc.z).getDynamics().isBoundary()) {
-        	goto no_add;
-              }
-            }
-          }  
-        }  
+        if (wallMask.denied(absfluidloc - fluidLocation)) { continue; }
+
+        HemoCellParticle::serializeValues_t to_add_particle = HemoCellParticle(vertex,cellId,iVertex,celltype).sv;
+        particleField.addParticle(to_add_particle);
+    }
+}
+
+/// Binary position file (tools/packCells/positionFile.h), mapped once per
+/// process and shared by all atomic blocks of this process while reading.
+class MappedPositionFile {
+public:
+  explicit MappedPositionFile(const string & fileName) {
+    int fd = open(fileName.c_str(), O_RDONLY);
+    struct stat st;
+    if (fd < 0 || fstat(fd,&st) || size_t(st.st_size) < sizeof(posfile::Header)) {
+      hlog << "(readPositionsBloodCells) Cannot read binary position file " << fileName << ", exiting ..." << endl;
+      exit(1);
+    }
+    size = st.st_size;
+    data = mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (data == MAP_FAILED) {
+      hlog << "(readPositionsBloodCells) Cannot map binary position file " << fileName << ", exiting ..." << endl;
+      exit(1);
+    }
+    header = (const posfile::Header *)data;
+    table = (const posfile::TableEntry *)(header + 1);
+    records = (const posfile::Record *)(table + header->tableEntries);
+    if (header->version != posfile::version || header->recordSize != sizeof(posfile::Record) ||
+        sizeof(posfile::Header) + header->tableEntries*sizeof(posfile::TableEntry) + header->cells*sizeof(posfile::Record) > size) {
+      hlog << "(readPositionsBloodCells) Binary position file " << fileName << " is truncated or of an unsupported version, exiting ..." << endl;
+      exit(1);
+    }
+  }
+  ~MappedPositionFile() { munmap(data,size); }
+
+  /// Calls f(record) for every record in the bins overlapping [lower,upper] [µm],
+  /// the caller still has to test the exact position
+  template<class F>
+  void forEachInBox(const double lower[3], const double upper[3], F f) const {
+    uint32_t lo[3], hi[3];
+    uint64_t nBins = 1;
+    for (int d = 0 ; d < 3 ; d++) {
+      double l = (lower[d] - header->lower[d])/header->binSize;
+      double u = (upper[d] - header->lower[d])/header->binSize;
+      if (u < 0 || u < l) { return; }
+      // The last bin also holds the records beyond it when the bin count was capped
+      lo[d] = l < 0 ? 0 : (l >= header->bins[d] - 1 ? header->bins[d] - 1 : uint32_t(l));
+      hi[d] = u >= header->bins[d] - 1 ? header->bins[d] - 1 : uint32_t(u);
+      nBins *= hi[d] - lo[d] + 1;
+    }
+    auto visit = [&](const posfile::TableEntry & entry) {
+      for (uint64_t i = entry.first ; i < entry.first + entry.count ; i++) {
+        f(records[i]);
+      }
+    };
+    const posfile::TableEntry * end = table + header->tableEntries;
+    if (nBins > header->tableEntries) {
+      // The box covers most of the file, walking the table is cheaper
+      for (const posfile::TableEntry * entry = table ; entry != end ; entry++) {
+        uint32_t bin[3];
+        posfile::binOfKey(entry->key,bin);
+        if (bin[0] >= lo[0] && bin[0] <= hi[0] && bin[1] >= lo[1] && bin[1] <= hi[1] &&
+            bin[2] >= lo[2] && bin[2] <= hi[2]) {
+          visit(*entry);
+        }
       }
-      
-      to_add_particle = HemoCellParticle(vertex,cellId,iVertex,celltype).sv;
-      particleField.addParticle(to_add_particle);
-no_add:;
+      return;
     }
+    for (uint32_t x = lo[0] ; x <= hi[0] ; x++) {
+      for (uint32_t y = lo[1] ; y <= hi[1] ; y++) {
+        for (uint32_t z = lo[2] ; z <= hi[2] ; z++) {
+          uint64_t key = posfile::mortonKey(x,y,z);
+          const posfile::TableEntry * entry = std::lower_bound(table, end, key,
+              [](const posfile::TableEntry & e, uint64_t k) { return e.key < k; });
+          if (entry != end && entry->key == key) {
+            visit(*entry);
+          }
+        }
+      }
+    }
+  }
+
+  const posfile::Header * header;
+private:
+  void * data;
+  size_t size;
+  const posfile::TableEntry * table;
+  const posfile::Record * records;
+};
+
+static std::map<string,std::unique_ptr<MappedPositionFile>> mappedPositionFiles;
+
+static const MappedPositionFile & getMappedPositionFile(const string & fileName) {
+  std::unique_ptr<MappedPositionFile> & file = mappedPositionFiles[fileName];
+  if (!file) {
+    file.reset(new MappedPositionFile(fileName));
+  }
+  return *file;
 }
 
 int getTotalNumberOfCells(HemoCellFields & cellFields){
   int nCells, totalCells = 0;
   for (pluint j = 0; j < cellFields.size(); j++) {
+    if (posfile::isBinary(cellFields[j]->name + ".pos")) {
+      posfile::Header header;
+      ifstream fIn(cellFields[j]->name + ".pos", ios::binary);
+      fIn.read((char *)&header,sizeof(header));
+      totalCells += header.cells;
+      continue;
+    }
     fstream fIn;
     fIn.open(cellFields[j]->name + ".pos", fstream::in);
     fIn >> nCells;
@@ -206,6 +363,46 @@ void getReadPositionsBloodCellsVector(Box3D realDomain,
     // TODO: proper try-catch
     for(pluint j = 0; j < Np.size(); j++) {
 
+        if (posfile::isBinary(cellFields[j]->name + ".pos")) {
+          // Only visit the bins around this block, ids follow the line order of the text format
+          const MappedPositionFile & file = getMappedPositionFile(cellFields[j]->name + ".pos");
+          if (first_time) {
+            hlog << "(readPositionsBloodCells) Particle count in binary file (" << cellFields[j]->name << "): " << file.header->cells << "." << endl;
+          }
+          vector3 shift;
+          if (cellFields.hemocell.preInlet && cellFields.hemocell.preInlet->initialized) {
+            shift = vector3(cellFields.hemocell.preInlet->location.x0/dx,
+                            cellFields.hemocell.preInlet->location.y0/dx,
+                            cellFields.hemocell.preInlet->location.z0/dx);
+          }
+          const double lower[3] = {(realDomain.x0 - (plint)cellFields.envelopeSize)/dx - shift[0],
+                                   (realDomain.y0 - (plint)cellFields.envelopeSize)/dx - shift[1],
+                                   (realDomain.z0 - (plint)cellFields.envelopeSize)/dx - shift[2]};
+          const double upper[3] = {(realDomain.x1 + (plint)cellFields.envelopeSize)/dx - shift[0],
+                                   (realDomain.y1 + (plint)cellFields.envelopeSize)/dx - shift[1],
+                                   (realDomain.z1 + (plint)cellFields.envelopeSize)/dx - shift[2]};
+          file.forEachInBox(lower, upper, [&](const posfile::Record & record) {
+            vector3 position(record.position[0] + shift[0], record.position[1] + shift[1], record.position[2] + shift[2]);
+            if (position[0]*dx < realDomain.x0 - (plint)cellFields.envelopeSize ||
+                position[0]*dx > realDomain.x1 + (plint)cellFields.envelopeSize ||
+                position[1]*dx < realDomain.y0 - (plint)cellFields.envelopeSize ||
+                position[1]*dx > realDomain.y1 + (plint)cellFields.envelopeSize ||
+                position[2]*dx < realDomain.z0 - (plint)cellFields.envelopeSize ||
+                position[2]*dx > realDomain.z1 + (plint)cellFields.envelopeSize) {
+              return;
+            }
+            vector3 angles(record.angles[0], record.angles[1], record.angles[2]);
+            angles *= PI/180.0; // Deg to Rad
+            angles *= -1.0;  // Right- to left-handed coordinate system
+            packPositions[j].push_back(position);
+            packAngles[j].push_back(angles);
+            cellIdss[j].push_back(cellid + record.index);
+          });
+          Np[j] = packPositions[j].size();
+          cellid += file.header->cells;
+          continue;
+        }
+
         // Reading data from file
         fstream fIn;
         fIn.open(cellFields[j]->name + ".pos", fstream::in);
@@ -237,12 +434,12 @@ void getReadPositionsBloodCellsVector(Box3D realDomain,
             }
             
             //Check if it actually fits (mostly) in this atomic block
-            if (packPositions[j][i-less][0]*dx < realDomain.x0 - cfg["domain"]["particleEnvelope"].read<int>() ||
-                packPositions[j][i-less][0]*dx > realDomain.x1 + cfg["domain"]["particleEnvelope"].read<int>() ||
-                packPositions[j][i-less][1]*dx < realDomain.y0 - cfg["domain"]["particleEnvelope"].read<int>() ||
-                packPositions[j][i-less][1]*dx > realDomain.y1 + cfg["domain"]["particleEnvelope"].read<int>() ||
-                packPositions[j][i-less][2]*dx < realDomain.z0 - cfg["domain"]["particleEnvelope"].read<int>() ||
-                packPositions[j][i-less][2]*dx > realDomain.z1 + cfg["domain"]["particleEnvelope"].read<int>()) {
+            if (packPositions[j][i-less][0]*dx < realDomain.x0 - (plint)cellFields.envelopeSize ||
+                packPositions[j][i-less][0]*dx > realDomain.x1 + (plint)cellFields.envelopeSize ||
+                packPositions[j][i-less][1]*dx < realDomain.y0 - (plint)cellFields.envelopeSize ||
+                packPositions[j][i-less][1]*dx > realDomain.y1 + (plint)cellFields.envelopeSize ||
+                packPositions[j][i-less][2]*dx < realDomain.z0 - (plint)cellFields.envelopeSize ||
+                packPositions[j][i-less][2]*dx > realDomain.z1 + (plint)cellFields.envelopeSize) {
               less ++;
             }
             cellid++;
@@ -336,18 +533,23 @@ void ReadPositionsBloodCellField3D::processGenericBlocks (
     // Change positions to match dx (it is in um originally)
     T wallWidth = 0; // BB wall in [lu]. Offset to count in width of the wall in particle position (useful for pipeflow, not necessarily useful elswhere)
     
+    // Boundary flags are read once per block, the dilated masks once per distinct layer size
+    const vector<unsigned char> boundary = WallDistanceMask::boundaryNodes(fluid);
+    std::map<int,std::unique_ptr<WallDistanceMask>> wallMasks;
+
     for (pluint iCF = 0; iCF < positions.size(); ++iCF)
     {
+        int denyLayerSize = (cellFields[iCF]->minimumDistanceFromSolid*1e-6)/param::dx;
+        std::unique_ptr<WallDistanceMask> & wallMask = wallMasks[denyLayerSize];
+        if (!wallMask) {
+            wallMask.reset(new WallDistanceMask(fluid, boundary, denyLayerSize));
+        }
+        CellTemplate cell(*meshes[iCF]);
+
         for (pluint c = 0; c < positions[iCF].size(); ++c)
         {
-            ElementsOfTriangularSurfaceMesh<T> emptyEoTSMCopy;
-    	    TriangularSurfaceMesh<T> * meshCopy = copyTriangularSurfaceMesh(*meshes[iCF], emptyEoTSMCopy);
-    	    
-            meshRotation (meshCopy, randomAngles[iCF][c]);
-            
-            positionCellInParticleField(*(particleFields[iCF]), fluid,
-                                         meshCopy, positions[iCF][c]*posRatio+wallWidth, cellIds[iCF][c], iCF); 
-			delete meshCopy;
+            cell.place(positions[iCF][c]*posRatio+wallWidth, randomAngles[iCF][c]);
+            positionCellInParticleField(*(particleFields[iCF]), fluid, *wallMask, cell, cellIds[iCF][c], iCF);
         }
 
         particleFields[iCF]->deleteIncompleteCells(iCF,false);
@@ -405,6 +607,7 @@ void readPositionsBloodCellField3D(HemoCellFields & cellFields, T dx, Config & c
             cellFields.lattice->getBoundingBox(), fluidAndParticleFieldsArg);
     hlogfile << "Mpi Process: " << global::mpi().getRank()  << " Completed loading particles" << std::endl;
     }
+    mappedPositionFiles.clear();
     cellFields.number_of_cells = getTotalNumberOfCells(cellFields);
 }
 
@@ -41,7 +41,8 @@ void writeCellInfo_CSV(HemoCell & hemocell) {
     }
   }
   
-  HemoCellGatheringFunctional<CellInformation>::gather(info_per_cell);
+  //Only the root writes, the others do not need the cells of everyone
+  HemoCellGatheringFunctional<CellInformation>::gatherToRoot(info_per_cell);
  
   if (!global::mpi().getRank()) {
     vector<std::string> fileNames = vector<std::string>(hemocell.cellfields->size());
@@ -49,7 +50,7 @@ void writeCellInfo_CSV(HemoCell & hemocell) {
     for (unsigned int i = 0 ; i < fileNames.size(); i++ ) {
       fileNames[i] = global::directories().getOutputDir() + "/csv/" +  (*hemocell.cellfields)[i]->name + "." + zeroPadNumber(hemocell.iter) + ".csv";
       csvFiles[i].open(fileNames[i], ofstream::trunc);
-      csvFiles[i] << "X,Y,Z,area,volume,atomic_block,cellId,baseCellId,velocity_x,velocity_y,velocity_z" << endl;
+      csvFiles[i] << "X,Y,Z,area,volume,atomic_block,cellId,baseCellId,velocity_x,velocity_y,velocity_z,diameter,deformation_index\n";
     }
 
     for (auto & pair : info_per_cell) {
@@ -61,12 +62,14 @@ void writeCellInfo_CSV(HemoCell & hemocell) {
         cinfo.area *= param::dx*param::dx;
         cinfo.velocity *= param::dx/param::dt;
         cinfo.volume *= param::dx*param::dx*param::dx;
+        cinfo.stretch *= param::dx;
       }
 
       if (cinfo.centerLocal) {
         csvFiles[cinfo.cellType] << cinfo.position[0] << "," << cinfo.position[1] << "," << cinfo.position[2] << ",";
         csvFiles[cinfo.cellType] << cinfo.area << "," << cinfo.volume << "," << cinfo.blockId << "," << cid  << "," << cinfo.base_cell_id << ",";
-        csvFiles[cinfo.cellType] << cinfo.velocity[0] << "," << cinfo.velocity[1] << "," << cinfo.velocity[2] << endl;
+        csvFiles[cinfo.cellType] << cinfo.velocity[0] << "," << cinfo.velocity[1] << "," << cinfo.velocity[2] << ",";
+        csvFiles[cinfo.cellType] << cinfo.stretch << "," << cinfo.deformationIndex << "\n";
       }
     }
 
@@ -0,0 +1,133 @@
+/*
+This file is part of the HemoCell library
+
+HemoCell is developed and maintained by the Computational Science Lab 
+in the University of Amsterdam. Any questions or remarks regarding this library 
+can be sent to: info@hemocell.eu
+
+When using the HemoCell library in scientific work please cite the
+corresponding paper: https://doi.org/10.3389/fphys.2017.00563
+
+The HemoCell library is free software: you can redistribute it and/or
+modify it under the terms of the GNU Affero General Public License as
+published by the Free Software Foundation, either version 3 of the
+License, or (at your option) any later version.
+
+The library is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU Affero General Public License for more details.
+
+You should have received a copy of the GNU Affero General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+#include "writeCellInfoHDF5.h"
+#include "SingleFileHdf5IO.h"
+#include "cellInfo.h"
+#include "hemocell.h"
+#include "AsyncHdf5IO.h"
+
+#include <hdf5.h>
+#include <hdf5_hl.h>
+
+namespace hemo {
+
+void writeCellInfo_HDF5(HemoCell & hemocell) {
+  global.statistics.getCurrent()["writeCellHDF5Info"].start();
+
+  map<int,CellInformation> info_per_cell;
+  CellInformationFunctionals::calculateCellInformation(&hemocell,info_per_cell);
+  for (auto it = info_per_cell.cbegin(); it != info_per_cell.cend() ;) 
+  {
+    if (!it->second.centerLocal) {
+      it = info_per_cell.erase(it);
+    } else {
+      ++it;
+    }
+  }
+
+  //Without MPI-IO only the root can write, so it needs the cells of everyone
+  const bool collective = singleFileHdf5Supported();
+  if (!collective) {
+    HemoCellGatheringFunctional<CellInformation>::gatherToRoot(info_per_cell);
+  }
+
+  string folder = global::directories().getOutputDir() + "/cellinfo/";
+  if (global::mpi().isMainProcessor()) {
+    mkpath(folder.c_str(), 0777);
+  }
+  global::mpi().barrier();
+
+  if (!collective && !global::mpi().isMainProcessor()) {
+    global.statistics.getCurrent().stop();
+    return;
+  }
+
+  Hdf5Staging staging;
+  const char * names[] = {"Position","Velocity","Area","Volume","Diameter","PrincipalLengths","DeformationIndex"};
+  const hsize_t columns[] = {3,3,1,1,1,3,1};
+  for (unsigned int i = 0 ; i < 7 ; i++) {
+    staging.dataset(names[i],columns[i]);
+  }
+  staging.dataset("AtomicBlock",1,Hdf5Type::Long);
+  staging.dataset("CellId",1,Hdf5Type::Int);
+  staging.dataset("BaseCellId",1,Hdf5Type::Int);
+  staging.dataset("CellType",1,Hdf5Type::Int);
+  //All datasets exist now, so the references stay valid
+  vector<float> & position = staging.find("Position")->values;
+  vector<float> & velocity = staging.find("Velocity")->values;
+  vector<float> & area = staging.find("Area")->values;
+  vector<float> & volume = staging.find("Volume")->values;
+  vector<float> & diameter = staging.find("Diameter")->values;
+  vector<float> & lengths = staging.find("PrincipalLengths")->values;
+  vector<float> & deformationIndex = staging.find("DeformationIndex")->values;
+  vector<long long> & blockId = staging.find("AtomicBlock")->ivalues;
+  vector<long long> & cellId = staging.find("CellId")->ivalues;
+  vector<long long> & baseCellId = staging.find("BaseCellId")->ivalues;
+  vector<long long> & cellType = staging.find("CellType")->ivalues;
+
+  const T dx = hemocell.outputInSiUnits ? param::dx : 1.;
+  const T dt = hemocell.outputInSiUnits ? param::dt : 1.;
+  for (auto const & pair : info_per_cell) {
+    CellInformation const & cinfo = pair.second;
+    for (unsigned int d = 0 ; d < 3 ; d++) {
+      position.push_back(cinfo.position[d]*dx);
+      velocity.push_back(cinfo.velocity[d]*dx/dt);
+      lengths.push_back(cinfo.shapeLengths[d]*dx);
+    }
+    area.push_back(cinfo.area*dx*dx);
+    volume.push_back(cinfo.volume*dx*dx*dx);
+    diameter.push_back(cinfo.stretch*dx);
+    deformationIndex.push_back(cinfo.deformationIndex);
+    blockId.push_back(cinfo.blockId);
+    cellId.push_back(pair.first);
+    baseCellId.push_back(cinfo.base_cell_id);
+    cellType.push_back(cinfo.cellType);
+  }
+
+  //Never write HDF5 next to the I/O thread, it may still be writing the previous output
+  if (hemocell.asyncOutput) {
+    hemocell.asyncOutput->wait();
+  }
+  string fileName = folder + "CellInfo." + zeroPadNumber(hemocell.iter) + ".h5";
+  hid_t file_id = collective ? staging.write(fileName,"CellInfo",MPI_COMM_WORLD) : staging.writeLocal(fileName,"CellInfo");
+
+  double dx_d = dx, dt_d = dt;
+  long iterHDF5 = hemocell.iter;
+  long nCells = staging.find("CellId")->total;
+  H5LTset_attribute_double(file_id, "/", "dx", &dx_d, 1);
+  H5LTset_attribute_double(file_id, "/", "dt", &dt_d, 1);
+  H5LTset_attribute_long(file_id, "/", "iteration", &iterHDF5, 1);
+  H5LTset_attribute_long(file_id, "/", "numberOfCells", &nCells, 1);
+  //CellType indexes this list
+  string cellTypes;
+  for (unsigned int i = 0 ; i < hemocell.cellfields->size() ; i++) {
+    cellTypes += (i ? "," : "") + (*hemocell.cellfields)[i]->name;
+  }
+  H5LTset_attribute_string(file_id, "/", "cellTypes", cellTypes.c_str());
+  H5Fclose(file_id);
+
+  global.statistics.getCurrent().stop();
+}
+
+}
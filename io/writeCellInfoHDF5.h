@@ -0,0 +1,39 @@
+/*
+This file is part of the HemoCell library
+
+HemoCell is developed and maintained by the Computational Science Lab 
+in the University of Amsterdam. Any questions or remarks regarding this library 
+can be sent to: info@hemocell.eu
+
+When using the HemoCell library in scientific work please cite the
+corresponding paper: https://doi.org/10.3389/fphys.2017.00563
+
+The HemoCell library is free software: you can redistribute it and/or
+modify it under the terms of the GNU Affero General Public License as
+published by the Free Software Foundation, either version 3 of the
+License, or (at your option) any later version.
+
+The library is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU Affero General Public License for more details.
+
+You should have received a copy of the GNU Affero General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+#ifndef WRITECELLINFOHDF5_H
+#define WRITECELLINFOHDF5_H
+
+#include "hemocell.h"
+
+namespace hemo {
+  /**
+   * Centroid, velocity, area, volume, shape, atomic block, id and type of every cell
+   * as one binary table per output iteration in cellinfo/CellInfo.<iter>.h5 .
+   * With parallel HDF5 every process writes its own cells collectively,
+   * otherwise the cells are gathered on the root which writes the file.
+   * (parameters/cellInfoOutput "hdf5")
+   */
+  void writeCellInfo_HDF5(HemoCell &);
+}
+#endif /* WRITECELLINFOHDF5_H */
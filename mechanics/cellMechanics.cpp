@@ -0,0 +1,58 @@
+/*
+This file is part of the HemoCell library
+
+HemoCell is developed and maintained by the Computational Science Lab 
+in the University of Amsterdam. Any questions or remarks regarding this library 
+can be sent to: info@hemocell.eu
+
+When using the HemoCell library in scientific work please cite the
+corresponding paper: https://doi.org/10.3389/fphys.2017.00563
+
+The HemoCell library is free software: you can redistribute it and/or
+modify it under the terms of the GNU Affero General Public License as
+published by the Free Software Foundation, either version 3 of the
+License, or (at your option) any later version.
+
+The library is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU Affero General Public License for more details.
+
+You should have received a copy of the GNU Affero General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+#include "cellMechanics.h"
+
+namespace hemo {
+
+void CellMechanics::publishCellState(int cid, const std::vector<HemoCellParticle *> & cell, T volume, const std::vector<T> & triangle_areas) {
+  if (!cellState) { return; }
+  CellState & state = (*cellState)[cid];
+  state.volume = volume;
+  state.area = 0.;
+  for (const T area : triangle_areas) {
+    state.area += area;
+  }
+
+  const hemo::Array<T,3> & first = cell[0]->sv.position;
+  hemo::Array<T,3> position = {0.,0.,0.};
+  hemo::Array<T,3> velocity = {0.,0.,0.};
+  hemo::Array<T,6> bbox = {first[0],first[0],first[1],first[1],first[2],first[2]};
+  for (const HemoCellParticle * particle : cell) {
+    const hemo::Array<T,3> & p = particle->sv.position;
+    position += p;
+    velocity += particle->sv.v;
+    bbox[0] = bbox[0] > p[0] ? p[0] : bbox[0];
+    bbox[1] = bbox[1] < p[0] ? p[0] : bbox[1];
+    bbox[2] = bbox[2] > p[1] ? p[1] : bbox[2];
+    bbox[3] = bbox[3] < p[1] ? p[1] : bbox[3];
+    bbox[4] = bbox[4] > p[2] ? p[2] : bbox[4];
+    bbox[5] = bbox[5] < p[2] ? p[2] : bbox[5];
+  }
+  state.position = position/T(cell.size());
+  state.velocity = velocity/T(cell.size());
+  state.bbox = bbox;
+  state.iteration = cellStateIteration;
+}
+
+}
@@ -45,6 +45,12 @@ class CellMechanics {
   virtual void ParticleMechanics(std::map<int,std::vector<HemoCellParticle *>> &,const std::map<int,bool> &, pluint ctype) = 0 ;
   virtual void statistics() = 0;
   virtual void solidifyMechanics(const std::map<int,std::vector<int>>&,std::vector<HemoCellParticle>&,plb::BlockLattice3D<T,DESCRIPTOR> *,plb::BlockLattice3D<T,CEPAC_DESCRIPTOR> *, pluint ctype, HemoCellParticleField &) {};
+
+  /// Per-cell table of the block being calculated, only set during ParticleMechanics() (HemoCellParticleField::applyConstitutiveModel)
+  std::map<int,CellState> * cellState = 0;
+  plint cellStateIteration = -1;
+  /// Store the volume and triangle areas computed by the model, together with the centroid, velocity and bounding box, so cell information does not recompute them
+  void publishCellState(int cid, const std::vector<HemoCellParticle *> & cell, T volume, const std::vector<T> & triangle_areas);
   
   
   T calculate_kLink(Config & cfg, plb::MeshMetrics<T> & meshmetric){
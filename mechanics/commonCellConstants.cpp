@@ -21,7 +21,14 @@ GNU Affero General Public License for more details.
 You should have received a copy of the GNU Affero General Public License
 along with this program.  If not, see <http://www.gnu.org/licenses/>.
 */
+#include <mpi.h>
+
 #include "commonCellConstants.h"
+#include "logfile.h"
+#include <cstring>
+#include <fstream>
+#include <sstream>
+#include <iomanip>
 
 namespace hemo {
  using namespace std; 
@@ -67,7 +74,7 @@ CommonCellConstants::CommonCellConstants(HemoCellField & cellField_,
     inner_edge_length_eq_list(inner_edge_length_eq_list_)
   {};
 
-CommonCellConstants CommonCellConstants::CommonCellConstantsConstructor(HemoCellField & cellField_, Config & modelCfg_) {
+CommonCellConstants CommonCellConstants::calculate(HemoCellField & cellField_, const vector<hemo::Array<plint,2>> & inner_edge_list_) {
     HemoCellField & cellField = cellField_;
     //Calculate triangles
     vector<hemo::Array<plint,3>> triangle_list_ = cellField.triangle_list;
@@ -139,21 +146,6 @@ CommonCellConstants CommonCellConstants::CommonCellConstantsConstructor(HemoCell
       edge_angle_eq_list_.push_back(angle);
     }
 
-    // Define opposite points TODO: make it automatic / or add the 33 links version ;) 
-    vector<hemo::Array<plint,2>> inner_edge_list_; 
-    try {
-      int v1 = 0, v2 = 0;
-      tinyxml2::XMLElement * ie = modelCfg_["MaterialModel"]["InnerEdges"].getOrig();
-      for (tinyxml2::XMLElement* edge = ie->FirstChildElement(); edge != NULL; edge = edge->NextSiblingElement())
-      {
-        if (sscanf(edge->GetText(), "%d %d", &v1, &v2) != 2 ) {
-         pcout << "Inner Edges not read, somethings wrong" << endl; 
-        }
-        // read out integers
-        inner_edge_list_.push_back({v1,v2});
-      }
-    } catch (std::invalid_argument & exeption) {}
-
     //Calculate eq edges lengths
     vector<T> inner_edge_length_eq_list_;
     for (const hemo::Array<plint,2> & edge : inner_edge_list_) {
@@ -408,4 +400,215 @@ CommonCellConstants CommonCellConstants::CommonCellConstantsConstructor(HemoCell
     return CCC;
 };
 
-}
\ No newline at end of file
+namespace {
+  // Increase when the derived constants or their layout change, so old cache files are ignored
+  const uint64_t cacheFormatVersion = 1;
+
+  struct Writer {
+    vector<char> buffer;
+    template<class V> void value(const V & v) {
+      const char * data = (const char *)&v;
+      buffer.insert(buffer.end(), data, data + sizeof(V));
+    }
+    template<class V> void list(const vector<V> & v) {
+      value(uint64_t(v.size()));
+      const char * data = (const char *)v.data();
+      buffer.insert(buffer.end(), data, data + v.size()*sizeof(V));
+    }
+  };
+
+  /// Reads past the end of the buffer return empty values and clear ok
+  struct Reader {
+    const vector<char> & buffer;
+    size_t offset = 0;
+    bool ok = true;
+    Reader(const vector<char> & buffer_) : buffer(buffer_) {}
+    template<class V> V value() {
+      V v = V();
+      if (!ok || buffer.size() - offset < sizeof(V)) {
+        ok = false;
+        return v;
+      }
+      memcpy((char *)&v, &buffer[offset], sizeof(V));
+      offset += sizeof(V);
+      return v;
+    }
+    template<class V> vector<V> list() {
+      const uint64_t size = value<uint64_t>();
+      if (!ok || (buffer.size() - offset)/sizeof(V) < size) {
+        ok = false;
+        return vector<V>();
+      }
+      vector<V> v(size);
+      memcpy((char *)v.data(), &buffer[offset], v.size()*sizeof(V));
+      offset += v.size()*sizeof(V);
+      return v;
+    }
+  };
+
+  // FNV-1a
+  void hashBytes(uint64_t & hash, const void * data, size_t size) {
+    for (size_t i = 0 ; i < size ; i++) {
+      hash ^= ((const unsigned char *)data)[i];
+      hash *= 1099511628211ULL;
+    }
+  }
+}
+
+uint64_t CommonCellConstants::meshHash(HemoCellField & cellField, const vector<hemo::Array<plint,2>> & inner_edge_list_) {
+  uint64_t hash = 14695981039346656037ULL;
+  hashBytes(hash, &cacheFormatVersion, sizeof(cacheFormatVersion));
+  for (plint iVertex = 0 ; iVertex < cellField.meshElement->getNumVertices() ; iVertex++) {
+    const hemo::Array<T,3> vertex = cellField.meshElement->getVertex(iVertex);
+    hashBytes(hash, vertex.data(), sizeof(T)*3);
+  }
+  hashBytes(hash, cellField.triangle_list.data(), cellField.triangle_list.size()*sizeof(hemo::Array<plint,3>));
+  hashBytes(hash, inner_edge_list_.data(), inner_edge_list_.size()*sizeof(hemo::Array<plint,2>));
+  return hash;
+}
+
+vector<char> CommonCellConstants::serialize() const {
+  Writer w;
+  w.list(triangle_list);
+  w.list(edge_list);
+  w.list(edge_length_eq_list);
+  w.list(edge_angle_eq_list);
+  w.list(surface_patch_center_dist_eq_list);
+  w.list(edge_bending_triangles_list);
+  w.list(edge_bending_triangles_outer_points);
+  w.list(triangle_area_eq_list);
+  w.list(vertex_vertexes);
+  w.list(vertex_edges);
+  w.list(vertex_edges_sign);
+  w.list(vertex_n_vertexes);
+  w.list(vertex_outer_edges_per_vertex);
+  w.list(vertex_outer_edges_per_vertex_sign);
+  w.value(volume_eq);
+  w.value(area_mean_eq);
+  w.value(edge_mean_eq);
+  w.value(angle_mean_eq);
+  w.list(inner_edge_list);
+  w.list(inner_edge_length_eq_list);
+  return w.buffer;
+}
+
+CommonCellConstants CommonCellConstants::deserialize(HemoCellField & cellField_, const vector<char> & buffer, bool & complete) {
+  // Function arguments have no defined evaluation order, so read in sequence first
+  Reader r(buffer);
+  auto triangle_list_ = r.list<hemo::Array<plint,3>>();
+  auto edge_list_ = r.list<hemo::Array<plint,2>>();
+  auto edge_length_eq_list_ = r.list<T>();
+  auto edge_angle_eq_list_ = r.list<T>();
+  auto surface_patch_center_dist_eq_list_ = r.list<T>();
+  auto edge_bending_triangles_ = r.list<hemo::Array<plint,2>>();
+  auto edge_bending_triangles_outer_points_ = r.list<hemo::Array<plint,2>>();
+  auto triangle_area_eq_list_ = r.list<T>();
+  auto vertex_vertexes_ = r.list<hemo::Array<plint,6>>();
+  auto vertex_edges_ = r.list<hemo::Array<plint,6>>();
+  auto vertex_edges_sign_ = r.list<hemo::Array<signed int,6>>();
+  auto vertex_n_vertexes_ = r.list<unsigned int>();
+  auto vertex_outer_edges_per_vertex_ = r.list<hemo::Array<hemo::Array<plint,2>,6>>();
+  auto vertex_outer_edges_per_vertex_sign_ = r.list<hemo::Array<hemo::Array<signed int,2>,6>>();
+  T volume_eq_ = r.value<T>();
+  T area_mean_eq_ = r.value<T>();
+  T edge_mean_eq_ = r.value<T>();
+  T angle_mean_eq_ = r.value<T>();
+  auto inner_edge_list_ = r.list<hemo::Array<plint,2>>();
+  auto inner_edge_length_eq_list_ = r.list<T>();
+  //The whole buffer is used and the lists fit the mesh of the cell field
+  complete = r.ok && r.offset == buffer.size()
+             && triangle_list_.size() == cellField_.triangle_list.size()
+             && vertex_n_vertexes_.size() == (size_t)cellField_.meshElement->getNumVertices();
+  return CommonCellConstants(cellField_,
+            triangle_list_,
+            edge_list_,
+            edge_length_eq_list_,
+            edge_angle_eq_list_,
+            surface_patch_center_dist_eq_list_,
+            edge_bending_triangles_,
+            edge_bending_triangles_outer_points_,
+            triangle_area_eq_list_,
+            vertex_vertexes_,
+            vertex_edges_,
+            vertex_edges_sign_,
+            vertex_n_vertexes_,
+            vertex_outer_edges_per_vertex_,
+            vertex_outer_edges_per_vertex_sign_,
+            volume_eq_,
+            area_mean_eq_,
+            edge_mean_eq_,
+            angle_mean_eq_,
+            inner_edge_list_,
+            inner_edge_length_eq_list_);
+}
+
+CommonCellConstants CommonCellConstants::CommonCellConstantsConstructor(HemoCellField & cellField_, Config & modelCfg_) {
+    // Define opposite points TODO: make it automatic / or add the 33 links version ;) 
+    vector<hemo::Array<plint,2>> inner_edge_list_; 
+    try {
+      int v1 = 0, v2 = 0;
+      tinyxml2::XMLElement * ie = modelCfg_["MaterialModel"]["InnerEdges"].getOrig();
+      for (tinyxml2::XMLElement* edge = ie->FirstChildElement(); edge != NULL; edge = edge->NextSiblingElement())
+      {
+        if (sscanf(edge->GetText(), "%d %d", &v1, &v2) != 2 ) {
+         pcout << "Inner Edges not read, somethings wrong" << endl; 
+        }
+        // read out integers
+        inner_edge_list_.push_back({v1,v2});
+      }
+    } catch (std::invalid_argument & exeption) {}
+
+    vector<char> buffer;
+    if (plb::global::mpi().getRank() == 0) {
+      string cacheFile;
+      if (!global.cellConstantsCache.empty()) {
+        stringstream name;
+        name << global.cellConstantsCache << "/" << cellField_.name << "." << hex << setw(16) << setfill('0') << meshHash(cellField_, inner_edge_list_) << ".constants";
+        cacheFile = name.str();
+        ifstream in(cacheFile, ios::binary);
+        uint64_t version = 0, size = 0;
+        if (in.read((char *)&version, sizeof(version)) && version == cacheFormatVersion && in.read((char *)&size, sizeof(size))) {
+          bool complete = false;
+          //The size comes from the file, do not allocate more than the file holds
+          const streamoff start = in.tellg();
+          in.seekg(0, ios::end);
+          if (uint64_t(streamoff(in.tellg()) - start) >= size) {
+            in.seekg(start);
+            buffer.resize(size);
+            if (in.read(buffer.data(), size)) {
+              deserialize(cellField_, buffer, complete);
+            }
+          }
+          if (complete) {
+            hlog << "(CommonCellConstants) (" << cellField_.name << ") Read cell constants from " << cacheFile << endl;
+          } else {
+            hlog << "(CommonCellConstants) (" << cellField_.name << ") (WARNING) The cell constants cache " << cacheFile << " is damaged, calculating them again" << endl;
+            buffer.clear();
+          }
+        }
+      }
+      if (buffer.empty()) {
+        buffer = calculate(cellField_, inner_edge_list_).serialize();
+        if (!cacheFile.empty()) {
+          ofstream out(cacheFile, ios::binary);
+          uint64_t size = buffer.size();
+          out.write((const char *)&cacheFormatVersion, sizeof(cacheFormatVersion));
+          out.write((const char *)&size, sizeof(size));
+          out.write(buffer.data(), size);
+          if (!out) {
+            hlog << "(CommonCellConstants) (" << cellField_.name << ") (WARNING) Could not write the cell constants cache " << cacheFile << endl;
+          }
+        }
+      }
+    }
+
+    // The other processors receive the constants instead of deriving them again
+    uint64_t size = buffer.size();
+    MPI_Bcast(&size, 1, MPI_UINT64_T, 0, MPI_COMM_WORLD);
+    buffer.resize(size);
+    MPI_Bcast(buffer.data(), int(size), MPI_CHAR, 0, MPI_COMM_WORLD);
+    bool complete;
+    return deserialize(cellField_, buffer, complete);
+}
+
+}
@@ -30,6 +30,8 @@ along with this program.  If not, see <http://www.gnu.org/licenses/>.
 namespace hemo {
 class CommonCellConstants;
 }
+// Test fixture in tests/test_commonCellConstants.cpp
+class CommonCellConstantsTest;
 #include "geometryUtils.h"
 #include "config.h"
 #include "hemoCellField.h"
@@ -37,6 +39,7 @@ class CommonCellConstants;
 namespace hemo {
 
 class CommonCellConstants {
+  friend class ::CommonCellConstantsTest;
   private:
   CommonCellConstants(HemoCellField & cellField_,
                       std::vector<hemo::Array<plint,3>> triangle_list_,
@@ -57,7 +60,17 @@ class CommonCellConstants {
                       T edge_mean_eq_, T angle_mean_eq_,
                       std::vector<hemo::Array<plint,2>> inner_edge_list_,
                       std::vector<T> inner_edge_length_eq_list_);
+  /// Derives the constants from the mesh of the cell field
+  static CommonCellConstants calculate(HemoCellField &, const std::vector<hemo::Array<plint,2>> & inner_edge_list_);
+  /// Hash of everything the constants are derived from, names the cache file
+  static uint64_t meshHash(HemoCellField &, const std::vector<hemo::Array<plint,2>> & inner_edge_list_);
+  /// Binary form used for the cache file and the broadcast from the root
+  std::vector<char> serialize() const;
+  /// complete is false when the buffer is truncated, too long or does not fit the mesh
+  static CommonCellConstants deserialize(HemoCellField &, const std::vector<char> &, bool & complete);
   public: 
+  /// Calculated once on the root and broadcast, or read from the cache
+  /// directory (xml tag: parameters/cellConstantsCache) when the mesh matches
   static CommonCellConstants CommonCellConstantsConstructor(HemoCellField &, hemo::Config & modelCfg_);
 
   HemoCellField & cellField;
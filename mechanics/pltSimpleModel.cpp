@@ -23,7 +23,7 @@ along with this program.  If not, see <http://www.gnu.org/licenses/>.
 */
 #include "pltSimpleModel.h"
 #include "logfile.h"
-#include "octree.h"
+#include "scanlineVoxelizer.h"
 #include "mollerTrumbore.h"
 
 #include "palabos3D.h"
@@ -101,6 +101,7 @@ void PltSimpleModel::ParticleMechanics(map<int,vector<HemoCellParticle *>> & par
     }
 
     volume *= (1.0/6.0);
+    publishCellState(cid,cell,volume,triangle_areas);
 
     //Volume
     const T volume_frac = (volume-cellConstants.volume_eq)/cellConstants.volume_eq;
@@ -209,6 +210,11 @@ void PltSimpleModel::ParticleMechanics(map<int,vector<HemoCellParticle *>> & par
 
 #ifdef SOLIDIFY_MECHANICS
 void PltSimpleModel::solidifyMechanics(const std::map<int,std::vector<int>>& ppc,std::vector<HemoCellParticle>& particles,plb::BlockLattice3D<T,DESCRIPTOR> * fluid,plb::BlockLattice3D<T,CEPAC_DESCRIPTOR> * CEPAC, pluint ctype, HemoCellParticleField & pf) {
+  const Dot3D location = fluid->getLocation();
+  const Box3D block(location.x, location.x + fluid->getNx() - 1,
+                    location.y, location.y + fluid->getNy() - 1,
+                    location.z, location.z + fluid->getNz() - 1);
+  hemo::ScanlineVoxelizer voxelizer;
   //For all cells
   for (auto & pair : ppc) {
     bool broken = false;
@@ -233,17 +239,19 @@ void PltSimpleModel::solidifyMechanics(const std::map<int,std::vector<int>>& ppc
 
     // If it was tagged last round, solidify it now
     if (solidify) {
-      hemo::OctreeStructCell octCell(3, 1, 30, cellConstants.triangle_list, particles, cell);
- 
-      set<Array<plint,3>> innerNodes;
-      octCell.findInnerNodes(fluid,particles,cell,innerNodes);
-      for (const Array<plint,3> & node : innerNodes) {
-          if (!fluid->get(node[0],node[1],node[2]).getDynamics().isBoundary()) {
-          defineDynamics(*fluid,node[0],node[1],node[2],new BounceBack<T,DESCRIPTOR>(1.));
-          bindingFieldHelper::get(*pf.cellFields).add(pf, {node[0],node[1],node[2]});
+      voxelizer.forEachInnerNode(cell.size(), cellConstants.triangle_list,
+                                 [&](plint i) -> const hemo::Array<T,3> & { return particles[cell[i]].sv.position; },
+                                 block,
+                                 [&](plint x, plint y, plint z) {
+        x -= location.x; y -= location.y; z -= location.z;
+        if (!fluid->get(x,y,z).getDynamics().isBoundary()) {
+          defineDynamics(*fluid,x,y,z,new BounceBack<T,DESCRIPTOR>(1.));
+          bindingFieldHelper::get(*pf.cellFields).add(pf, {x,y,z});
+          pf.solidifiedSites.push_back({x+location.x,y+location.y,z+location.z});
         }
-      }
-     
+      });
+      pf.solidifiedCells.push_back(pf.cellFields->base_cell_id(particles[cell[0]].sv.cellId));
+
       for (const int & particle : cell) {
         particles[particle].tag = 1; //tag for removal
       }
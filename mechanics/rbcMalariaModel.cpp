@@ -100,6 +100,7 @@ void RbcMalariaModel::ParticleMechanics(map<int,vector<HemoCellParticle *>> & pa
     }
     
     volume *= (1.0/6.0);
+    publishCellState(cid,cell,volume,triangle_areas);
 
     //Volume
     const T volume_frac = (volume-cellConstants.volume_eq)/cellConstants.volume_eq;
@@ -102,6 +102,7 @@ void WbcHighOrderModel::ParticleMechanics(map<int,vector<HemoCellParticle *>> &
     }
     
     volume *= (1.0/6.0);
+    publishCellState(cid,cell,volume,triangle_areas);
 
     //Volume
     const T volume_frac = (volume-cellConstants.volume_eq)/cellConstants.volume_eq;
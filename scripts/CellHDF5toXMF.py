@@ -60,7 +60,7 @@ def InnerLinksGrid(xmlInt=XMLIndentation()):
     h5TopologyAndGeometry = ""
     h5TopologyAndGeometry += xmlInt.inc() + '<Topology TopologyType="Polygon" NumberOfElements="%(numberOfInnerLinks)d">\n'
     h5TopologyAndGeometry += xmlInt.inc() + '<DataItem Dimensions="%(numberOfInnerLinks)d 2" Format="HDF">\n'
-    h5TopologyAndGeometry += xmlInt.cur() + '%(pathToHDF5)s:/InnerLinks\n'
+    h5TopologyAndGeometry += xmlInt.cur() + '%(pathToInnerLinks)s\n'
     h5TopologyAndGeometry += xmlInt.dec() + '</DataItem>\n'
     h5TopologyAndGeometry += xmlInt.dec() + '</Topology>\n'
     h5TopologyAndGeometry += xmlInt.inc() + '<Geometry GeometryType="XYZ">\n'
@@ -84,7 +84,7 @@ def createH5TopologyAndGeometryCell(xmlInt=XMLIndentation()):
     h5TopologyAndGeometry = ""
     h5TopologyAndGeometry += xmlInt.inc() + '<Topology TopologyType="Triangle" NumberOfElements="%(numberOfTriangles)d">\n'
     h5TopologyAndGeometry += xmlInt.inc() + '<DataItem Dimensions="%(numberOfTriangles)d 3" Format="HDF">\n'
-    h5TopologyAndGeometry += xmlInt.cur() + '%(pathToHDF5)s:/Triangles\n'
+    h5TopologyAndGeometry += xmlInt.cur() + '%(pathToTriangles)s\n'
     h5TopologyAndGeometry += xmlInt.dec() + '</DataItem>\n'
     h5TopologyAndGeometry += xmlInt.dec() + '</Topology>\n'
     h5TopologyAndGeometry += xmlInt.inc() + '<Geometry GeometryType="XYZ">\n'
@@ -193,6 +193,18 @@ def readH5FileToDictionary(h5fname, close=True):
     return ret      
 
 
+def staticTopologyFile(h5fname):
+    """
+        Template connectivity (hdf5/static/<type>.topology.h5) of a timestep file
+        hdf5/<iter>/<type>[_PRE].<iter>[.p.<block>].h5, written with <staticOutput> 1 </staticOutput>
+    """
+    iterDir, base = os.path.split(h5fname)
+    identifier = base.split('.')[0]
+    if identifier.endswith('_PRE'):
+        identifier = identifier[:-len('_PRE')]
+    return os.path.join(os.path.dirname(iterDir), 'static', identifier + '.topology.h5')
+
+
 def iteratePossibleDataSetsDict(h5dict):
     """
         Generator updating each time the h5dict with the values of the dictionary
@@ -236,6 +248,8 @@ class HDF5toXDMF_Cell(object):
 
     def open(self, fname):
         self.xdmfFile  = open(fname, 'w')
+        self.connectivityName = fname[:-len('.xmf')] + '.connectivity.h5'
+        self.connectivity = None
         stringToWrite  = self.xmlInt.cur() + '<?xml version="1.0" ?>\n'
         stringToWrite += self.xmlInt.cur() + '<!DOCTYPE Xdmf SYSTEM "Xdmf.dtd" []>\n'
         stringToWrite += self.xmlInt.inc() + '<Xdmf xmlns:xi="http://www.w3.org/2003/XInclude" Version="2.2">\n'
@@ -248,6 +262,8 @@ class HDF5toXDMF_Cell(object):
         stringToWrite += self.xmlInt.dec() + '</Xdmf>\n'
         self.xdmfFile.write(stringToWrite)
         self.xdmfFile.close()
+        if self.connectivity is not None:
+            self.connectivity.close()
         return -1
 
     def openGrid(self, gridName="Domain", gridType="Uniform"):
@@ -260,21 +276,51 @@ class HDF5toXDMF_Cell(object):
         self.xdmfFile.write(stringToWrite)
         return -1
 
+    def reconstructConnectivity(self, h5dict, groupName):
+        """
+            Output written with <staticOutput> 1 </staticOutput> stores the first row
+            of every cell instead of the connectivity. The connectivity is rebuilt from
+            the template of the cell type and stored next to the XMF file.
+            Returns the names of the rebuilt datasets.
+        """
+        h5File = h5.File(h5dict['pathToHDF5'], 'r')
+        offsets = h5File['CellOffsets'][()].reshape(-1)
+        h5File.close()
+        topology = h5.File(staticTopologyFile(h5dict['pathToHDF5']), 'r')
+        if self.connectivity is None:
+            self.connectivity = h5.File(self.connectivityName, 'w')
+        group = self.connectivity.require_group(groupName)
+        rebuilt = []
+        for ds, count in (("Triangles", "numberOfTriangles"), ("InnerLinks", "numberOfInnerLinks")):
+            if not ds in topology:
+                continue
+            template = topology[ds][()]
+            elements = (offsets[:, None, None] + template[None, :, :]).reshape(-1, template.shape[1])
+            group.create_dataset(ds, data=elements.astype(np.int32), compression="gzip")
+            h5dict[count] = elements.shape[0]
+            h5dict['pathTo' + ds] = self.connectivityName + ':/' + groupName + '/' + ds
+            rebuilt.append(ds)
+        topology.close()
+        return rebuilt
+
     def writeSubDomain(self, h5dict, gridName="Subdomain "):
         pId = (" " + str(h5dict['processorId'])) if 'processorId' in h5dict else ""
+        datasetNames = [d['attributeName'] for d in h5dict['DataSets']]
+        h5dict['pathToTriangles'] = h5dict['pathToHDF5'] + ':/Triangles'
+        h5dict['pathToInnerLinks'] = h5dict['pathToHDF5'] + ':/InnerLinks'
+        if "CellOffsets" in datasetNames:
+            datasetNames += self.reconstructConnectivity(h5dict, (gridName + pId).replace(' ', '_'))
         self.openGrid(gridName + pId)
         stringToWrite = createH5TopologyAndGeometryCell(self.xmlInt)%(h5dict)
         for datasetDict in iteratePossibleDataSetsDict(h5dict):
-            if not datasetDict['attributeName'] == "Triangles":
-              if not datasetDict['attributeName'] == "InnerLinks":
+            if not datasetDict['attributeName'] in ("Triangles", "InnerLinks", "CellIds", "CellOffsets"):
                 stringToWrite += createH5AttibuteCell(self.xmlInt)%(datasetDict)
         self.xdmfFile.write(stringToWrite)
         self.closeGrid()
-        for datasetDict in iteratePossibleDataSetsDict(h5dict):
-            if  datasetDict['attributeName'] == "InnerLinks":
-              self.openGrid(gridName + pId + "_innerLink")
-              self.xdmfFile.write(InnerLinksGrid(self.xmlInt)%(h5dict))
-              self.closeGrid()
+        if "InnerLinks" in datasetNames:
+            self.openGrid(gridName + pId + "_innerLink")
+            self.xdmfFile.write(InnerLinksGrid(self.xmlInt)%(h5dict))
+            self.closeGrid()
         return -1
 
     def openCollection(self, gridName="Domain"):
@@ -317,6 +363,95 @@ def createXDMF(fnameString, processorStrings, iterDir):
     print("Created file:", fnameToSave)
 
 
+def hyperSlab(xmlInt, path, name, first, rows, total, columns):
+    """
+        DataItem selecting rows [first, first+rows) of dataset name (total x columns)
+    """
+    stringToWrite  = xmlInt.inc() + '<DataItem ItemType="HyperSlab" Dimensions="%d %d" Type="HyperSlab">\n'%(rows, columns)
+    stringToWrite += xmlInt.cur() + '<DataItem Dimensions="3 2" Format="XML">%d 0 1 1 %d %d</DataItem>\n'%(first, rows, columns)
+    stringToWrite += xmlInt.cur() + '<DataItem Dimensions="%d %d" Format="HDF">%s:/%s</DataItem>\n'%(total, columns, path, name)
+    stringToWrite += xmlInt.dec() + '</DataItem>\n'
+    return stringToWrite
+
+
+def createTimeSeriesXDMF(fname):
+    """
+    One XMF file per dump of hdf5/<identifier>.h5, written with <hdf5Output> timeseries </hdf5Output>.
+    Every dump is appended to the datasets, Index/Iteration holds the iteration of every dump and
+    Index/<dataset> its first row and number of rows. The rows of a dump are selected with hyperslabs,
+    connectivity and offsets count from the first row of the dump.
+    """
+    identifier = os.path.basename(fname)[:-len('.h5')]
+    h5File = h5.File(fname, 'r')
+    path = fname.replace('//','/')
+    iterations = h5File['Index/Iteration'][()].reshape(-1)
+    for step, iteration in enumerate(iterations):
+        fnameToSave = fname[:-len('.h5')].replace('/hdf5/','/') + '.' + str(iteration).zfill(12) + '.xmf'
+        if os.path.isfile(fnameToSave):
+            continue
+        rows = {}
+        for name, index in h5File['Index'].items():
+            if name in h5File and index.shape[1] == 2 and step < index.shape[0]:
+                rows[name] = (int(index[step][0]), int(index[step][1]), h5File[name].shape[0], h5File[name].shape[1])
+        if not 'Position' in rows:
+            continue
+        xdmfFile = HDF5toXDMF_Cell(fnameToSave)
+        xmlInt = xdmfFile.xmlInt
+        connectivity = {}
+        if 'CellOffsets' in rows:
+            # Written with <staticOutput> 1 </staticOutput>, rebuild the connectivity from the template
+            first, count = rows['CellOffsets'][:2]
+            offsets = h5File['CellOffsets'][first:first+count].reshape(-1)
+            base = identifier[:-len('_PRE')] if identifier.endswith('_PRE') else identifier
+            topology = h5.File(os.path.join(os.path.dirname(fname), 'static', base + '.topology.h5'), 'r')
+            xdmfFile.connectivity = h5.File(xdmfFile.connectivityName, 'w')
+            for ds in ("Triangles", "InnerLinks"):
+                if ds in topology:
+                    template = topology[ds][()]
+                    elements = (offsets[:, None, None] + template[None, :, :]).reshape(-1, template.shape[1])
+                    xdmfFile.connectivity.create_dataset(ds, data=elements.astype(np.int32), compression="gzip")
+                    connectivity[ds] = (0, elements.shape[0], elements.shape[0], template.shape[1])
+            topology.close()
+        def slab(ds):
+            if ds in connectivity:
+                return hyperSlab(xmlInt, xdmfFile.connectivityName, ds, *connectivity[ds])
+            return hyperSlab(xmlInt, path, ds, *rows[ds])
+        elements = dict(connectivity)
+        elements.update((ds, rows[ds]) for ds in ("Triangles", "InnerLinks") if ds in rows)
+        geometry  = xmlInt.inc() + '<Geometry GeometryType="XYZ">\n'
+        geometry += slab('Position')
+        geometry += xmlInt.dec() + '</Geometry>\n'
+
+        xdmfFile.openCollection("Domain")
+        xdmfFile.openGrid("Subdomain")
+        stringToWrite = ""
+        if 'Triangles' in elements:
+            stringToWrite += xmlInt.inc() + '<Topology TopologyType="Triangle" NumberOfElements="%d">\n'%(elements['Triangles'][1])
+            stringToWrite += slab('Triangles')
+            stringToWrite += xmlInt.dec() + '</Topology>\n'
+        stringToWrite += geometry
+        for ds, (first, count, total, columns) in sorted(rows.items()):
+            if ds in ("Position", "Triangles", "InnerLinks", "CellIds", "CellOffsets"):
+                continue
+            attributeType = {1: "Scalar", 3: "Vector"}.get(columns, "Matrix")
+            stringToWrite += xmlInt.inc() + '<Attribute Name="%s" AttributeType="%s">\n'%(ds, attributeType)
+            stringToWrite += slab(ds)
+            stringToWrite += xmlInt.dec() + '</Attribute>\n'
+        xdmfFile.xdmfFile.write(stringToWrite)
+        xdmfFile.closeGrid()
+        if 'InnerLinks' in elements:
+            xdmfFile.openGrid("Subdomain_innerLink")
+            stringToWrite  = xmlInt.inc() + '<Topology TopologyType="Polygon" NumberOfElements="%d">\n'%(elements['InnerLinks'][1])
+            stringToWrite += slab('InnerLinks')
+            stringToWrite += xmlInt.dec() + '</Topology>\n'
+            xdmfFile.xdmfFile.write(stringToWrite + geometry)
+            xdmfFile.closeGrid()
+        xdmfFile.closeCollection()
+        xdmfFile.close()
+        print("Created file:", fnameToSave)
+    h5File.close()
+
+
 if __name__ == '__main__':
     if len(sys.argv) == 1:
         sys.argv += ['RBC']
@@ -330,8 +465,28 @@ if __name__ == '__main__':
             dirname = './hdf5/'
 
         try:
+            # <hdf5Output> timeseries </hdf5Output>: every dump appended to hdf5/<identifier>.h5
+            if os.path.isfile(dirname + '/' + identifier + '.h5'):
+                createTimeSeriesXDMF(dirname + '/' + identifier + '.h5')
+                continue
             directories = sorted(os.listdir(dirname))
             for iterDir in directories:
+                if not iterDir.isdigit():
+                    continue # hdf5/static holds the output written once per run
+                # <hdf5Output> single </hdf5Output>: all blocks in one file, written as a single subdomain
+                singleFiles = sorted( f for f in glob(dirname + '/' + iterDir + '/' + identifier + '.*.h5') if not ('.p.' in f or '.pgz.' in f) )
+                for fname in singleFiles:
+                    fnameToSave = fname[:-3].replace('/hdf5/','/').replace("/" + iterDir + "/", "") + '.xmf'
+                    if os.path.isfile(fnameToSave):
+                        continue
+                    xdmfFile = HDF5toXDMF_Cell(fnameToSave)
+                    xdmfFile.openCollection("Domain")
+                    xdmfFile.writeSubDomain(readH5FileToDictionary(fname), "Subdomain")
+                    xdmfFile.closeCollection()
+                    xdmfFile.close()
+                    print("Created file:", fnameToSave)
+                if singleFiles:
+                    continue
                 fluidH5files = sorted( glob(dirname + '/' + iterDir + '/' + identifier + '.*p*.h5') )
                 fluidIDs = [x[:-3] for x in fluidH5files]
                 iterationStrings, processorStrings  = list(zip(*[[f.split('.')[-3], f.split('.')[-1]] for f in fluidIDs]))
@@ -35,6 +35,8 @@ class createXDMF(object):
       h5dict[key] = val[0] if len(val) == 1 else val
     h5dict["datasets"] = []
     for ds, val in h5File.items():
+      if not isinstance(val, h5.Dataset):
+        continue # The Index group of a time series
       dimObjShape = len(val.shape)
       if dimObjShape==3:
         attributeType, rankString = "Scalar", ""
@@ -58,6 +60,24 @@ class createXDMF(object):
       
     h5File.close()
     return h5dict
+  def staticFile(self, h5dict):
+    """
+    Constant fields (boundary) of a timestep file written with <staticOutput> 1 </staticOutput>,
+    hdf5/static/<identifier>.<staticIteration>[.p.<block>].h5
+    """
+    iterDir, base = os.path.split(h5dict['pathToHDF5'])
+    parts = base.split('.')
+    parts[1] = str(int(h5dict['staticIteration'])).zfill(len(parts[1]))
+    return os.path.join(os.path.dirname(iterDir), 'static', '.'.join(parts))
+
+  def datasetsWithPath(self, h5dict):
+    """ (path, dataset) of the timestep file, and of its static file if there is one """
+    datasets = [(h5dict["pathToHDF5"], ds) for ds in h5dict["datasets"]]
+    if "staticIteration" in h5dict and os.path.isfile(self.staticFile(h5dict)):
+      staticDict = self.readH5File(self.staticFile(h5dict))
+      datasets += [(staticDict["pathToHDF5"], ds) for ds in staticDict["datasets"]]
+    return datasets
+
   def writeHeader(self):
     self.output += self.xmlInt.cur() + '<?xml version="1.0" ?>\n'
     #self.output += self.xmlInt.cur() + '<!DOCTYPE Xdmf SYSTEM "Xdmf.dtd" []>\n'
@@ -83,11 +103,11 @@ class createXDMF(object):
     output += self.xmlInt.dec() + '</DataItem>\n'
     output += self.xmlInt.dec() + '</Geometry>\n'
 
-    for ds in h5dict["datasets"]:
+    for path, ds in self.datasetsWithPath(h5dict):
       output += self.xmlInt.inc() + '<Attribute Name="%s" AttributeType="%s" Center="Cell">\n'%(ds["attributeName"],ds["AttributeType"])
       output += self.xmlInt.inc() + '<DataItem Dimensions="%d %d %d %s" Format="HDF">\n'% \
            (h5dict["subdomainSize"][0],h5dict["subdomainSize"][1],h5dict["subdomainSize"][2], ds["rankString"])
-      output += self.xmlInt.cur() + '%s:/%s\n'%(h5dict["pathToHDF5"],ds["attributeName"])
+      output += self.xmlInt.cur() + '%s:/%s\n'%(path,ds["attributeName"])
       output += self.xmlInt.dec() + '</DataItem>\n'
       output += self.xmlInt.dec() + '</Attribute>\n'
 
@@ -130,6 +150,122 @@ class createXDMF(object):
     print("Created file:", fnameToSave)
 
 
+class createXDMFSingle(createXDMF):
+  """
+  XMF file for output written with <hdf5Output> single </hdf5Output>: one file per
+  timestep where the blocks are concatenated. Every block becomes a grid that
+  selects its rows (BlockOffset, subdomainSize) with a hyperslab.
+  """
+  blockTable = ["subdomainSize", "relativePosition", "BlockOffset", "BlockId", "processorId"]
+
+  def __init__(self, fname, iterDir):
+    fnameToSave = fname[:-3] + '.xmf'
+    fnameToSave = fnameToSave.replace('/hdf5/','/').replace("/" + iterDir + "/", "")
+    if os.path.isfile(fnameToSave):
+      print("%s (existed), skipping ..." % (fnameToSave))
+      return
+    h5dict = self.readH5File(fname)
+    h5File = h5.File(fname, 'r')
+    sizes = h5File["subdomainSize"][()]
+    positions = h5File["relativePosition"][()]
+    offsets = h5File["BlockOffset"][()]
+    procs = h5File["processorId"][()]
+    h5File.close()
+    datasets = self.datasetsWithPath(h5dict)
+    shapes = {}
+    for path in set(path for path, ds in datasets):
+      h5File = h5.File(path, 'r')
+      shapes.update(((path, ds), h5File[ds].shape) for ds in h5File.keys())
+      h5File.close()
+    dxdydz = tuple(h5dict["dxdydz"])
+
+    self.xmlInt = XMLIndentation()
+    self.output = ""
+    self.writeHeader()
+    self.writeBlocks(sizes, positions, offsets, procs, datasets, shapes, dxdydz)
+    self.writeFooter()
+    xdmf_file = open(fnameToSave, "w")
+    xdmf_file.write(self.output)
+    xdmf_file.close()
+    print("Created file:", fnameToSave)
+
+  def writeBlocks(self, sizes, positions, offsets, procs, datasets, shapes, dxdydz, firstRow={}):
+    """ One grid per block, the rows of a block start at its BlockOffset plus firstRow[(path, dataset)] """
+    self.output += self.xmlInt.inc() + '<Grid Name="Domain" GridType="Collection">\n'
+    for b in range(len(offsets)):
+      nodes = int(sizes[b][0]*sizes[b][1]*sizes[b][2])
+      self.output += self.xmlInt.inc() + '<Grid Name="Subdomain %d %d" GridType="Uniform">\n'%(b,procs[b][0])
+      self.output += self.xmlInt.cur() + '<Topology TopologyType="3DCoRectMesh" NumberOfElements="%d %d %d"/>\n' % tuple(sizes[b])
+      self.output += self.xmlInt.inc() + '<Geometry GeometryType="Origin_DxDyDz">\n'
+      self.output += self.xmlInt.inc() + '<DataItem Dimensions="3" NumberType="Float" Precision="4" Format="XML">\n'
+      self.output += self.xmlInt.cur() + '%G %G %G\n'%tuple(positions[b])
+      self.output += self.xmlInt.dec() + '</DataItem>\n'
+      self.output += self.xmlInt.inc() + '<DataItem Dimensions="3" NumberType="Float" Precision="4" Format="XML">\n'
+      self.output += self.xmlInt.cur() + '%G %G %G\n'%dxdydz
+      self.output += self.xmlInt.dec() + '</DataItem>\n'
+      self.output += self.xmlInt.dec() + '</Geometry>\n'
+      # The static file is written with the same blocks, in the same order
+      for path, ds in datasets:
+        if ds["attributeName"] in self.blockTable:
+          continue
+        total, columns = shapes[(path, ds["attributeName"])]
+        attributeType = {1: "Scalar", 3: "Vector", 6: "Tensor6", 9: "Tensor"}.get(columns, "Matrix")
+        self.output += self.xmlInt.inc() + '<Attribute Name="%s" AttributeType="%s" Center="Cell">\n'%(ds["attributeName"],attributeType)
+        self.output += self.xmlInt.inc() + '<DataItem ItemType="HyperSlab" Dimensions="%d %d %d %d" Type="HyperSlab">\n'%(sizes[b][0],sizes[b][1],sizes[b][2],columns)
+        self.output += self.xmlInt.cur() + '<DataItem Dimensions="3 2" Format="XML">%d 0 1 1 %d %d</DataItem>\n'%(firstRow.get((path, ds["attributeName"]), 0) + offsets[b][0],nodes,columns)
+        self.output += self.xmlInt.cur() + '<DataItem Dimensions="%d %d" Format="HDF">%s:/%s</DataItem>\n'%(total,columns,path,ds["attributeName"])
+        self.output += self.xmlInt.dec() + '</DataItem>\n'
+        self.output += self.xmlInt.dec() + '</Attribute>\n'
+      self.output += self.xmlInt.dec() + '</Grid>\n'
+    self.output += self.xmlInt.dec() + '</Grid>\n'
+
+
+class createXDMFTimeSeries(createXDMFSingle):
+  """
+  One XMF file per dump of hdf5/<identifier>.h5, written with <hdf5Output> timeseries </hdf5Output>.
+  Every dump is appended to the datasets as with <hdf5Output> single </hdf5Output>. Index/Iteration
+  holds the iteration of every dump and Index/<dataset> its first row and number of rows.
+  """
+  def __init__(self, fname):
+    identifier = os.path.basename(fname)[:-len('.h5')]
+    path = fname.replace('//','/')
+    h5dict = self.readH5File(fname)
+    h5File = h5.File(fname, 'r')
+    index = h5File['Index']
+    iterations = index['Iteration'][()].reshape(-1)
+    for step, iteration in enumerate(iterations):
+      fnameToSave = fname[:-len('.h5')].replace('/hdf5/','/') + '.' + str(iteration).zfill(12) + '.xmf'
+      if os.path.isfile(fnameToSave):
+        print("%s (existed), skipping ..." % (fnameToSave))
+        continue
+      def rowsOf(ds):
+        first, count = index[ds][step]
+        return h5File[ds][first:first+count]
+      sizes, positions, offsets, procs = [rowsOf(ds) for ds in ("subdomainSize", "relativePosition", "BlockOffset", "processorId")]
+      firstRow = dict(((path, ds), int(index[ds][step][0])) for ds in h5File.keys() if ds in index)
+      datasets = [(path, ds) for ds in h5dict["datasets"] if ds["attributeName"] in index]
+      shapes = dict(((path, ds), h5File[ds].shape) for ds in h5File.keys() if ds in index)
+      if 'StaticIteration' in index:
+        staticName = os.path.join(os.path.dirname(fname), 'static', identifier + '.' + str(index['StaticIteration'][step][0]).zfill(12) + '.h5')
+        if os.path.isfile(staticName):
+          staticDict = self.readH5File(staticName)
+          datasets += [(staticDict["pathToHDF5"], ds) for ds in staticDict["datasets"] if not ds["attributeName"] in self.blockTable]
+          staticFile = h5.File(staticName, 'r')
+          shapes.update(((staticDict["pathToHDF5"], ds), staticFile[ds].shape) for ds in staticFile.keys())
+          staticFile.close()
+
+      self.xmlInt = XMLIndentation()
+      self.output = ""
+      self.writeHeader()
+      self.writeBlocks(sizes, positions, offsets, procs, datasets, shapes, tuple(h5dict["dxdydz"]), firstRow)
+      self.writeFooter()
+      xdmf_file = open(fnameToSave, "w")
+      xdmf_file.write(self.output)
+      xdmf_file.close()
+      print("Created file:", fnameToSave)
+    h5File.close()
+
+
 if __name__ == '__main__':
     try:
         if os.environ["ABSPATH"] == "1":
@@ -144,9 +280,23 @@ if __name__ == '__main__':
 
     if len(sys.argv) > 1:
       identifier = sys.argv[-1]
+
+    # <hdf5Output> timeseries </hdf5Output>: every dump appended to hdf5/<identifier>.h5
+    if os.path.isfile(dirname + '/' + identifier + '.h5'):
+      createXDMFTimeSeries(dirname + '/' + identifier + '.h5')
+      sys.exit(0)
     
     for iterDir in directories:
-        fluidH5files = sorted( glob(dirname + '/' + iterDir + '/' + identifier + '*p*.h5') )
+        if not iterDir.isdigit():
+            continue # hdf5/static holds the output written once per run
+        singleFiles = sorted( f for f in glob(dirname + '/' + iterDir + '/' + identifier + '.*.h5') if not ('.p.' in f or '.pgz.' in f) )
+        for fname in singleFiles:
+            createXDMFSingle(fname, iterDir)
+        if singleFiles:
+            continue
+        fluidH5files = sorted( glob(dirname + '/' + iterDir + '/' + identifier + '.*.p*.h5') )
+        if not fluidH5files:
+            continue # e.g. FluidAverage is only written at the end of its windows
         fluidIDs = [x[:-3] for x in fluidH5files]
         iterationStrings, processorStrings  = list(zip(*[[f.split('.')[-3], f.split('.')[-1]] for f in fluidIDs]))
         iterationStrings, processorStrings = [sorted(set(l)) for l in (iterationStrings, processorStrings)]
@@ -28,7 +28,23 @@ function do_work {
   # Fluid
   ${python_c} ${scriptsDir}/FluidHDF5.py; 
 
-  for dir in ./hdf5/*/
+  # Time series (one file per identifier in ./hdf5)
+  for file in ./hdf5/*.h5
+  do
+    [ -f $file ] || continue
+    name=`basename $file .h5`
+    if [ $name == "Fluid" ]; then
+      continue
+    fi
+    if [ $name == "Fluid_PRE" ] || [ $name == "CEPAC" ] || [ $name == "FluidAverage" ]; then
+      ${python_c} ${scriptsDir}/FluidHDF5.py ${name};
+      continue
+    fi
+    echo ${name}:
+    ${python_c} ${scriptsDir}/CellHDF5toXMF.py ${name};
+  done
+
+  for dir in ./hdf5/[0-9]*/
   do
     filenames=`ls ${dir}* | cut -d/ -f4 | cut -d. -f1 | sort| uniq`
     for name in $filenames
@@ -44,11 +60,19 @@ function do_work {
         ${python_c} ${scriptsDir}/FluidHDF5.py CEPAC; 
         continue
       fi
+      if [ $name == "FluidAverage" ]; then
+        continue
+      fi
       echo ${name}:
       ${python_c} ${scriptsDir}/CellHDF5toXMF.py ${name}; 
     done
     break;
   done
+
+  # Only at the end of its windows, so not necessarily in the first directory
+  if ls ./hdf5/[0-9]*/FluidAverage.* > /dev/null 2>&1; then
+    ${python_c} ${scriptsDir}/FluidHDF5.py FluidAverage;
+  fi
 }
 
 do_work;
@@ -0,0 +1,88 @@
+#include "helper/cellShape.h"
+#include "gtest/gtest.h"
+
+#include <algorithm>
+#include <cmath>
+#include <random>
+#include <vector>
+
+// Vertices of an ellipsoid with semi-axes (a, b, c), sampled on a latitude /
+// longitude grid that contains the six tips, rotated by `angle` around z and
+// moved to `center`.
+static std::vector<hemo::Array<T, 3>> ellipsoid(T a, T b, T c, T angle,
+                                                hemo::Array<T, 3> center) {
+  std::vector<hemo::Array<T, 3>> vertices;
+  const int nTheta = 12, nPhi = 24;
+  for (int i = 0; i <= nTheta; i++) {
+    const T theta = M_PI * i / nTheta;
+    for (int j = 0; j < ((i == 0 || i == nTheta) ? 1 : nPhi); j++) {
+      const T phi = 2 * M_PI * j / nPhi;
+      const T x = a * std::sin(theta) * std::cos(phi);
+      const T y = b * std::sin(theta) * std::sin(phi);
+      const T z = c * std::cos(theta);
+      vertices.push_back({center[0] + x * std::cos(angle) - y * std::sin(angle),
+                          center[1] + x * std::sin(angle) + y * std::cos(angle),
+                          center[2] + z});
+    }
+  }
+  return vertices;
+}
+
+TEST(CellShape, SpherePrincipalLengths) {
+  hemo::CellShape shape = hemo::computeCellShape(ellipsoid(4, 4, 4, 0, {10, 10, 10}));
+  for (int d = 0; d < 3; d++) {
+    EXPECT_NEAR(shape.lengths[d], 8, 1e-9);
+  }
+  EXPECT_NEAR(shape.diameter, 8, 1e-9);
+  EXPECT_NEAR(shape.elongation, 0, 1e-9);
+  EXPECT_NEAR(shape.deformationIndex, 0, 1e-9);
+}
+
+TEST(CellShape, EllipsoidPrincipalLengths) {
+  const T a = 6, b = 3, c = 1.5;
+  hemo::CellShape shape = hemo::computeCellShape(ellipsoid(a, b, c, 0, {0, 0, 0}));
+  EXPECT_NEAR(shape.lengths[0], 2 * a, 1e-9);
+  EXPECT_NEAR(shape.lengths[1], 2 * b, 1e-9);
+  EXPECT_NEAR(shape.lengths[2], 2 * c, 1e-9);
+  EXPECT_NEAR(shape.diameter, 2 * a, 1e-9);
+  EXPECT_NEAR(shape.deformationIndex, (a - b) / (a + b), 1e-9);
+  EXPECT_NEAR(shape.elongation, (a - c) / (a + c), 1e-9);
+  EXPECT_NEAR(std::fabs(shape.majorAxis[0]), 1, 1e-9);
+}
+
+TEST(CellShape, ElongationDoesNotDependOnOrientation) {
+  const T a = 5, b = 2, c = 1;
+  hemo::CellShape aligned = hemo::computeCellShape(ellipsoid(a, b, c, 0, {0, 0, 0}));
+  hemo::CellShape rotated = hemo::computeCellShape(ellipsoid(a, b, c, M_PI / 6, {3, -2, 7}));
+  for (int d = 0; d < 3; d++) {
+    EXPECT_NEAR(rotated.lengths[d], aligned.lengths[d], 1e-9);
+  }
+  EXPECT_NEAR(rotated.elongation, aligned.elongation, 1e-9);
+  EXPECT_NEAR(rotated.diameter, 2 * a, 1e-9);
+  EXPECT_NEAR(std::fabs(rotated.majorAxis[0]), std::cos(M_PI / 6), 1e-9);
+  EXPECT_NEAR(std::fabs(rotated.majorAxis[1]), std::sin(M_PI / 6), 1e-9);
+  EXPECT_NEAR(rotated.majorAxis[2], 0, 1e-9);
+}
+
+TEST(CellShape, DiameterIsBoundedApproximation) {
+  // Near-spherical, irregular vertex set, as for a WBC, compared to all pairs
+  std::mt19937 rng(41);
+  std::normal_distribution<T> normal(0., 1.);
+  std::uniform_real_distribution<T> radius(4.8, 5.2);
+  std::vector<hemo::Array<T, 3>> vertices;
+  for (int i = 0; i < 2000; i++) {
+    hemo::Array<T, 3> v = {normal(rng), normal(rng), normal(rng)};
+    const T r = radius(rng) / std::sqrt(v[0] * v[0] + v[1] * v[1] + v[2] * v[2]);
+    vertices.push_back({1 + r * v[0], 2 + r * v[1], 3 + r * v[2]});
+  }
+  T exact = 0;
+  for (unsigned int i = 0; i < vertices.size(); i++) {
+    for (unsigned int j = i + 1; j < vertices.size(); j++) {
+      const hemo::Array<T, 3> d = vertices[i] - vertices[j];
+      exact = std::max(exact, std::sqrt(d[0] * d[0] + d[1] * d[1] + d[2] * d[2]));
+    }
+  }
+  const T diameter = hemo::computeCellShape(vertices).diameter;
+  EXPECT_LE(diameter, exact + 1e-9);
+  EXPECT_GE(diameter, 0.886 * exact);
+}
@@ -0,0 +1,202 @@
+#include "commonCellConstants.h"
+#include "hemocell.h"
+#include "palabos3D.h"
+#include "palabos3D.hh"
+#include "rbcHighOrderModel.h"
+#include "gtest/gtest.h"
+
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <iomanip>
+#include <sstream>
+
+// The fixture is a friend of CommonCellConstants and forwards its private
+// members to the tests. It sets up a single RBC celltype without cells, only
+// its mesh is needed.
+class CommonCellConstantsTest : public ::testing::Test {
+protected:
+  static void SetUpTestSuite() {
+    static char *args[] = {(char *)"test", (char *)"path", NULL};
+    char *inp = (char *)"validation/stretch_cell/config_stretch_cell.xml";
+
+    hemocell = new hemo::HemoCell(inp, 0, args, hemo::HemoCell::MPIHandle::External);
+    hemo::param::lbm_base_parameters(*hemocell->cfg);
+
+    const plint n = 20;
+    hemocell->lattice = new plb::MultiBlockLattice3D<T, DESCRIPTOR>(
+        plb::defaultMultiBlockPolicy3D().getMultiBlockManagement(n, n, n, 2),
+        plb::defaultMultiBlockPolicy3D().getBlockCommunicator(),
+        plb::defaultMultiBlockPolicy3D().getCombinedStatistics(),
+        plb::defaultMultiBlockPolicy3D().getMultiCellAccess<T, DESCRIPTOR>(),
+        new plb::GuoExternalForceBGKdynamics<T, DESCRIPTOR>(1.0 / hemo::param::tau));
+    hemocell->lattice->initialize();
+
+    hemocell->initializeCellfield();
+    hemocell->addCellType<hemo::RbcHighOrderModel>("validation/stretch_cell/stretch_RBC", RBC_FROM_SPHERE);
+    cellfield = (*hemocell->cellfields)["validation/stretch_cell/stretch_RBC"];
+  }
+
+  static void TearDownTestSuite() {
+    delete hemocell;
+    hemocell = 0;
+    cellfield = 0;
+  }
+
+  static hemo::CommonCellConstants calculate(std::vector<hemo::Array<plint, 2>> const &innerEdges = {}) {
+    return hemo::CommonCellConstants::calculate(*cellfield, innerEdges);
+  }
+  static uint64_t meshHash(std::vector<hemo::Array<plint, 2>> const &innerEdges = {}) {
+    return hemo::CommonCellConstants::meshHash(*cellfield, innerEdges);
+  }
+  static std::vector<char> serialize(hemo::CommonCellConstants const &constants) {
+    return constants.serialize();
+  }
+  static hemo::CommonCellConstants deserialize(std::vector<char> const &buffer, bool &complete) {
+    return hemo::CommonCellConstants::deserialize(*cellfield, buffer, complete);
+  }
+  static bool complete(std::vector<char> const &buffer) {
+    bool complete;
+    deserialize(buffer, complete);
+    return complete;
+  }
+  // As CommonCellConstantsConstructor reads it, the celltype has no inner edges
+  static hemo::CommonCellConstants construct() {
+    return hemo::CommonCellConstants::CommonCellConstantsConstructor(*cellfield, *cellfield->materialCfg);
+  }
+  // Name of the cache file for the current mesh
+  static std::string cacheFile() {
+    std::stringstream name;
+    name << hemo::global.cellConstantsCache << "/" << cellfield->name << "." << std::hex
+         << std::setw(16) << std::setfill('0') << meshHash() << ".constants";
+    return name.str();
+  }
+  static long fileSize(std::string const &fileName) {
+    std::ifstream file(fileName, std::ios::binary | std::ios::ate);
+    return file ? long(file.tellg()) : -1;
+  }
+
+  static hemo::HemoCell *hemocell;
+  static hemo::HemoCellField *cellfield;
+};
+
+hemo::HemoCell *CommonCellConstantsTest::hemocell = 0;
+hemo::HemoCellField *CommonCellConstantsTest::cellfield = 0;
+
+TEST_F(CommonCellConstantsTest, SerializeRoundTrip) {
+  hemo::CommonCellConstants constants = calculate({{0, 1}, {2, 3}});
+  std::vector<char> buffer = serialize(constants);
+  bool complete = false;
+  hemo::CommonCellConstants restored = deserialize(buffer, complete);
+
+  EXPECT_TRUE(complete);
+  EXPECT_EQ(serialize(restored), buffer);
+  EXPECT_EQ(&restored.cellField, cellfield);
+  EXPECT_EQ(restored.triangle_list.size(), cellfield->triangle_list.size());
+  EXPECT_EQ(restored.edge_list.size(), constants.edge_list.size());
+  EXPECT_EQ(restored.edge_length_eq_list, constants.edge_length_eq_list);
+  EXPECT_EQ(restored.vertex_n_vertexes, constants.vertex_n_vertexes);
+  EXPECT_EQ(restored.inner_edge_length_eq_list, constants.inner_edge_length_eq_list);
+  EXPECT_EQ(restored.inner_edge_list.size(), 2u);
+  EXPECT_EQ(restored.volume_eq, constants.volume_eq);
+  EXPECT_EQ(restored.area_mean_eq, constants.area_mean_eq);
+  EXPECT_EQ(restored.edge_mean_eq, constants.edge_mean_eq);
+  EXPECT_EQ(restored.angle_mean_eq, constants.angle_mean_eq);
+}
+
+TEST_F(CommonCellConstantsTest, DeserializeChecksTheBuffer) {
+  const std::vector<char> buffer = serialize(calculate());
+  ASSERT_TRUE(complete(buffer));
+
+  // Every truncation falls in or after some list or value
+  for (size_t size : {size_t(0), size_t(4), size_t(8), buffer.size() / 2, buffer.size() - 1}) {
+    EXPECT_FALSE(complete(std::vector<char>(buffer.begin(), buffer.begin() + size))) << size;
+  }
+  std::vector<char> longer = buffer;
+  longer.push_back(0);
+  EXPECT_FALSE(complete(longer));
+
+  // A list length that points past the end, the first list is the triangles
+  std::vector<char> corrupt = buffer;
+  const uint64_t length = uint64_t(1) << 40;
+  memcpy(corrupt.data(), &length, sizeof(length));
+  EXPECT_FALSE(complete(corrupt));
+}
+
+TEST_F(CommonCellConstantsTest, MeshHashCoversTheMesh) {
+  const uint64_t hash = meshHash();
+  EXPECT_EQ(meshHash(), hash);
+  EXPECT_NE(meshHash({{0, 1}}), hash);
+
+  plb::Array<T, 3> &vertex = cellfield->meshElement->getVertex(0);
+  const T x = vertex[0];
+  vertex[0] += 1e-3;
+  EXPECT_NE(meshHash(), hash);
+  vertex[0] = x;
+  EXPECT_EQ(meshHash(), hash);
+
+  std::swap(cellfield->triangle_list[0], cellfield->triangle_list[1]);
+  EXPECT_NE(meshHash(), hash);
+  std::swap(cellfield->triangle_list[0], cellfield->triangle_list[1]);
+  EXPECT_EQ(meshHash(), hash);
+}
+
+TEST_F(CommonCellConstantsTest, CacheHitAndMiss) {
+  hemo::global.cellConstantsCache = ".";
+  const std::string file = cacheFile();
+  std::remove(file.c_str());
+  const std::vector<char> expected = serialize(calculate());
+  // Format version and payload size precede the payload
+  const long size = 2 * sizeof(uint64_t) + expected.size();
+
+  // Miss, the constants are derived and written
+  EXPECT_EQ(serialize(construct()), expected);
+  ASSERT_EQ(fileSize(file), size);
+
+  // Bytes after the payload are not read, but are gone when the file is
+  // written again, so they tell a hit from a miss
+  {
+    std::ofstream out(file, std::ios::binary | std::ios::app);
+    out << 'x';
+  }
+  EXPECT_EQ(serialize(construct()), expected);
+  EXPECT_EQ(fileSize(file), size + 1);
+
+  // A file of another format version is a miss
+  {
+    std::fstream out(file, std::ios::binary | std::ios::in | std::ios::out);
+    const uint64_t version = 0;
+    out.write((const char *)&version, sizeof(version));
+  }
+  EXPECT_EQ(serialize(construct()), expected);
+  EXPECT_EQ(fileSize(file), size);
+
+  // A truncated payload with a matching size is a miss as well
+  {
+    uint64_t version = 0;
+    std::ifstream(file, std::ios::binary).read((char *)&version, sizeof(version));
+    const uint64_t truncated = expected.size() / 2;
+    std::ofstream out(file, std::ios::binary | std::ios::trunc);
+    out.write((const char *)&version, sizeof(version));
+    out.write((const char *)&truncated, sizeof(truncated));
+    out.write(expected.data(), truncated);
+  }
+  EXPECT_EQ(serialize(construct()), expected);
+  EXPECT_EQ(fileSize(file), size);
+
+  // A changed mesh is a miss on another file
+  plb::Array<T, 3> &vertex = cellfield->meshElement->getVertex(0);
+  const T x = vertex[0];
+  vertex[0] += 1e-3;
+  const std::string changedFile = cacheFile();
+  EXPECT_NE(changedFile, file);
+  construct();
+  EXPECT_GT(fileSize(changedFile), 0);
+  EXPECT_EQ(fileSize(file), size);
+  vertex[0] = x;
+
+  std::remove(file.c_str());
+  std::remove(changedFile.c_str());
+  hemo::global.cellConstantsCache = "";
+}
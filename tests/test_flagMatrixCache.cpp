@@ -0,0 +1,150 @@
+#include "palabos3D.h"
+#include "helper/voxelizeDomain.h"
+#include "gtest/gtest.h"
+
+#include <cstdio>
+#include <fstream>
+#include <iterator>
+#include <memory>
+#include <string>
+
+static const std::string cacheFile = "test_flagMatrixCache.flags";
+static const uint64_t cacheKey = 0x1234;
+
+static int flagAt(plint x, plint y, plint z) { return (x * 7 + y * 3 + z * 5) % 4 == 0; }
+
+static plb::MultiScalarField3D<int> *flagMatrix() {
+  plb::MultiScalarField3D<int> *field = new plb::MultiScalarField3D<int>(24, 16, 12, 0);
+  plb::SparseBlockStructure3D const &structure = field->getMultiBlockManagement().getSparseBlockStructure();
+  for (plint id : field->getLocalInfo().getBlocks()) {
+    plb::Box3D bulk;
+    structure.getBulk(id, bulk);
+    plb::ScalarField3D<int> &component = field->getComponent(id);
+    const plb::Dot3D location = component.getLocation();
+    for (plint x = bulk.x0; x <= bulk.x1; x++) {
+      for (plint y = bulk.y0; y <= bulk.y1; y++) {
+        for (plint z = bulk.z0; z <= bulk.z1; z++) {
+          component.get(x - location.x, y - location.y, z - location.z) = flagAt(x, y, z);
+        }
+      }
+    }
+  }
+  return field;
+}
+
+// Nodes of the bulks that differ from flagAt, summed over the processors
+static long mismatches(plb::MultiScalarField3D<int> &field) {
+  long wrong = 0;
+  plb::SparseBlockStructure3D const &structure = field.getMultiBlockManagement().getSparseBlockStructure();
+  for (plint id : field.getLocalInfo().getBlocks()) {
+    plb::Box3D bulk;
+    structure.getBulk(id, bulk);
+    plb::ScalarField3D<int> &component = field.getComponent(id);
+    const plb::Dot3D location = component.getLocation();
+    for (plint x = bulk.x0; x <= bulk.x1; x++) {
+      for (plint y = bulk.y0; y <= bulk.y1; y++) {
+        for (plint z = bulk.z0; z <= bulk.z1; z++) {
+          wrong += component.get(x - location.x, y - location.y, z - location.z) != flagAt(x, y, z);
+        }
+      }
+    }
+  }
+  long total = 0;
+  MPI_Allreduce(&wrong, &total, 1, MPI_LONG, MPI_SUM, MPI_COMM_WORLD);
+  return total;
+}
+
+static long fileSize(std::string const &fileName) {
+  std::ifstream file(fileName, std::ios::binary | std::ios::ate);
+  return file ? long(file.tellg()) : -1;
+}
+
+// Changes the file on the root only, the others wait for it
+template <class Change> static void onRoot(Change change) {
+  if (plb::global::mpi().getRank() == 0) {
+    change();
+  }
+  plb::global::mpi().barrier();
+}
+
+TEST(FlagMatrixCache, WriteAndReadBack) {
+  std::unique_ptr<plb::MultiScalarField3D<int>> original(flagMatrix());
+  // A longer temporary file of an aborted run does not end up in the cache
+  onRoot([] {
+    std::remove(cacheFile.c_str());
+    std::ofstream stale(cacheFile + ".tmp", std::ios::binary);
+    stale << std::string(100000, 'x');
+  });
+  ASSERT_TRUE(hemo::writeFlagCache(cacheFile, cacheKey, *original));
+  EXPECT_LT(fileSize(cacheFile), 100000);
+  EXPECT_EQ(fileSize(cacheFile + ".tmp"), -1);
+
+  std::unique_ptr<plb::MultiScalarField3D<int>> read(hemo::readFlagCache(cacheFile, cacheKey, 2));
+  ASSERT_TRUE(read.get());
+  EXPECT_EQ(read->getBoundingBox().x1, original->getBoundingBox().x1);
+  EXPECT_EQ(read->getBoundingBox().y1, original->getBoundingBox().y1);
+  EXPECT_EQ(read->getBoundingBox().z1, original->getBoundingBox().z1);
+  EXPECT_EQ(read->getMultiBlockManagement().getSparseBlockStructure().getNumBlocks(),
+            original->getMultiBlockManagement().getSparseBlockStructure().getNumBlocks());
+  EXPECT_EQ(mismatches(*read), 0);
+
+  onRoot([] { std::remove(cacheFile.c_str()); });
+}
+
+TEST(FlagMatrixCache, MissesOtherKeyAndMissingFile) {
+  std::unique_ptr<plb::MultiScalarField3D<int>> original(flagMatrix());
+  onRoot([] { std::remove(cacheFile.c_str()); });
+  EXPECT_EQ(hemo::readFlagCache(cacheFile, cacheKey, 2), nullptr);
+
+  ASSERT_TRUE(hemo::writeFlagCache(cacheFile, cacheKey, *original));
+  EXPECT_EQ(hemo::readFlagCache(cacheFile, cacheKey + 1, 2), nullptr);
+
+  onRoot([] { std::remove(cacheFile.c_str()); });
+}
+
+TEST(FlagMatrixCache, RejectsDamagedFiles) {
+  std::unique_ptr<plb::MultiScalarField3D<int>> original(flagMatrix());
+  ASSERT_TRUE(hemo::writeFlagCache(cacheFile, cacheKey, *original));
+  std::string contents;
+  onRoot([&contents] {
+    std::ifstream in(cacheFile, std::ios::binary);
+    contents.assign(std::istreambuf_iterator<char>(in), std::istreambuf_iterator<char>());
+  });
+
+  // Truncated
+  onRoot([&contents] {
+    std::ofstream out(cacheFile, std::ios::binary | std::ios::trunc);
+    out.write(contents.data(), contents.size() - 1);
+  });
+  EXPECT_EQ(hemo::readFlagCache(cacheFile, cacheKey, 2), nullptr);
+
+  // Longer than the block table says
+  onRoot([&contents] {
+    std::ofstream out(cacheFile, std::ios::binary | std::ios::trunc);
+    out.write(contents.data(), contents.size());
+    out << 'x';
+  });
+  EXPECT_EQ(hemo::readFlagCache(cacheFile, cacheKey, 2), nullptr);
+
+  // More blocks in the header than the file can hold; the block count follows
+  // the magic, key and bounding box
+  onRoot([&contents] {
+    std::string damaged = contents;
+    const int64_t nBlocks = 1 << 30;
+    damaged.replace(8 + 8 + 6 * 8, sizeof(nBlocks), (const char *)&nBlocks, sizeof(nBlocks));
+    std::ofstream out(cacheFile, std::ios::binary | std::ios::trunc);
+    out.write(damaged.data(), damaged.size());
+  });
+  EXPECT_EQ(hemo::readFlagCache(cacheFile, cacheKey, 2), nullptr);
+
+  // The intact file is still a hit
+  onRoot([&contents] {
+    std::ofstream out(cacheFile, std::ios::binary | std::ios::trunc);
+    out.write(contents.data(), contents.size());
+  });
+  std::unique_ptr<plb::MultiScalarField3D<int>> read(hemo::readFlagCache(cacheFile, cacheKey, 2));
+  ASSERT_TRUE(read.get());
+  EXPECT_EQ(mismatches(*read), 0);
+
+  onRoot([] { std::remove(cacheFile.c_str()); });
+}
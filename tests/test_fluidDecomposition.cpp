@@ -0,0 +1,145 @@
+#include "palabos3D.h"
+#include "helper/fluidDecomposition.h"
+#include "gtest/gtest.h"
+
+#include <algorithm>
+#include <map>
+#include <memory>
+#include <set>
+#include <vector>
+
+// A pipe of radius 8 along x through a 40x32x32 domain. The corner blocks of a
+// 4x4 grid in y and z have no fluid node in them or next to them.
+static int flagAt(plint, plint y, plint z) { return (y - 15.5) * (y - 15.5) + (z - 15.5) * (z - 15.5) <= 64.; }
+
+static plb::MultiScalarField3D<int> *flagMatrix() {
+  plb::MultiScalarField3D<int> *field = new plb::MultiScalarField3D<int>(40, 32, 32, 0);
+  plb::SparseBlockStructure3D const &structure = field->getMultiBlockManagement().getSparseBlockStructure();
+  for (plint id : field->getLocalInfo().getBlocks()) {
+    plb::Box3D bulk;
+    structure.getBulk(id, bulk);
+    plb::ScalarField3D<int> &component = field->getComponent(id);
+    const plb::Dot3D location = component.getLocation();
+    for (plint x = bulk.x0; x <= bulk.x1; x++) {
+      for (plint y = bulk.y0; y <= bulk.y1; y++) {
+        for (plint z = bulk.z0; z <= bulk.z1; z++) {
+          component.get(x - location.x, y - location.y, z - location.z) = flagAt(x, y, z);
+        }
+      }
+    }
+  }
+  return field;
+}
+
+// Fluid nodes in a box, clipped to the domain
+static long fluidNodes(plb::Box3D const &box, plb::Box3D const &domain) {
+  plb::Box3D clipped;
+  if (!plb::intersect(box, domain, clipped)) {
+    return 0;
+  }
+  long count = 0;
+  for (plint x = clipped.x0; x <= clipped.x1; x++) {
+    for (plint y = clipped.y0; y <= clipped.y1; y++) {
+      for (plint z = clipped.z0; z <= clipped.z1; z++) {
+        count += flagAt(x, y, z);
+      }
+    }
+  }
+  return count;
+}
+
+// CountFluidNodesInBoxes summed over the processors
+static void countFluidNodes(plb::MultiScalarField3D<int> &field, std::vector<plb::Box3D> const &boxes,
+                            std::vector<long> &inside, std::vector<long> &enlarged) {
+  inside.assign(boxes.size(), 0);
+  enlarged.assign(boxes.size(), 0);
+  plb::applyProcessingFunctional(new hemo::CountFluidNodesInBoxes(boxes, inside, enlarged), field.getBoundingBox(),
+                                 field);
+  MPI_Allreduce(MPI_IN_PLACE, &inside[0], inside.size(), MPI_LONG, MPI_SUM, MPI_COMM_WORLD);
+  MPI_Allreduce(MPI_IN_PLACE, &enlarged[0], enlarged.size(), MPI_LONG, MPI_SUM, MPI_COMM_WORLD);
+}
+
+TEST(FluidDecomposition, CountFluidNodesInBoxes) {
+  std::unique_ptr<plb::MultiScalarField3D<int>> field(flagMatrix());
+  const plb::Box3D domain = field->getBoundingBox();
+  // Inside the pipe, across its wall, outside of it, touching the domain
+  // border, and overlapping each other
+  std::vector<plb::Box3D> boxes = {plb::Box3D(10, 17, 12, 19, 12, 19), plb::Box3D(0, 39, 0, 31, 14, 17),
+                                   plb::Box3D(20, 27, 0, 6, 0, 6),     plb::Box3D(0, 7, 24, 31, 24, 31),
+                                   plb::Box3D(5, 30, 8, 23, 8, 23),    plb::Box3D(36, 39, 0, 31, 0, 31)};
+  std::vector<long> inside, enlarged;
+  countFluidNodes(*field, boxes, inside, enlarged);
+  for (unsigned int b = 0; b < boxes.size(); b++) {
+    EXPECT_EQ(inside[b], fluidNodes(boxes[b], domain)) << "box " << b;
+    EXPECT_EQ(enlarged[b], fluidNodes(boxes[b].enlarge(1), domain)) << "box " << b;
+  }
+  EXPECT_EQ(inside[2], 0);
+  EXPECT_EQ(enlarged[2], 0);
+}
+
+TEST(FluidDecomposition, AssignsEveryFluidBlockOnceAndBalanced) {
+  std::unique_ptr<plb::MultiScalarField3D<int>> field(flagMatrix());
+  const plb::Box3D domain = field->getBoundingBox();
+  const plb::SparseBlockStructure3D candidates = plb::createRegularDistribution3D(domain, 5, 4, 4);
+  const long totalFluid = fluidNodes(domain, domain);
+
+  // Fewer parts than candidate blocks, and so many that blocks must be split
+  for (plb::plint nParts : {6, 100}) {
+    std::map<plb::plint, plb::plint> blockToPart;
+    const plb::SparseBlockStructure3D result =
+        hemo::fluidWeightedDecomposition(*field, candidates, nParts, 2, blockToPart);
+
+    std::vector<plb::Box3D> boxes;
+    std::vector<plb::plint> ids;
+    for (auto const &pair : result.getBulks()) {
+      ids.push_back(pair.first);
+      boxes.push_back(pair.second);
+    }
+    ASSERT_GE((plb::plint)boxes.size(), nParts);
+    // The 20 candidates at the corners are removed without splitting
+    if (nParts == 6) {
+      EXPECT_EQ((plb::plint)boxes.size(), candidates.getNumBlocks() - 20);
+    }
+
+    // Every block is assigned exactly once to a part in [0,nParts)
+    ASSERT_EQ(blockToPart.size(), boxes.size());
+    std::set<plb::plint> usedParts;
+    for (plb::plint id : ids) {
+      ASSERT_EQ(blockToPart.count(id), 1u) << "block " << id;
+      ASSERT_GE(blockToPart[id], 0);
+      ASSERT_LT(blockToPart[id], nParts);
+      usedParts.insert(blockToPart[id]);
+    }
+    EXPECT_EQ((plb::plint)usedParts.size(), nParts);
+
+    // The blocks do not overlap and hold all fluid nodes, each block holds or
+    // touches fluid
+    for (unsigned int i = 0; i < boxes.size(); i++) {
+      for (unsigned int j = i + 1; j < boxes.size(); j++) {
+        plb::Box3D overlap;
+        EXPECT_FALSE(plb::intersect(boxes[i], boxes[j], overlap)) << "blocks " << ids[i] << " and " << ids[j];
+      }
+    }
+    std::vector<long> inside, enlarged;
+    countFluidNodes(*field, boxes, inside, enlarged);
+    long covered = 0, heaviest = 0;
+    std::vector<long> partWeights(nParts, 0);
+    for (unsigned int i = 0; i < boxes.size(); i++) {
+      EXPECT_GT(enlarged[i], 0) << "block " << ids[i];
+      covered += inside[i];
+      heaviest = std::max(heaviest, inside[i]);
+      partWeights[blockToPart[ids[i]]] += inside[i];
+    }
+    EXPECT_EQ(covered, totalFluid);
+
+    // No part has more fluid nodes than its share plus the heaviest block
+    for (plb::plint p = 0; p < nParts; p++) {
+      EXPECT_LE(partWeights[p], double(totalFluid) / nParts + heaviest) << "part " << p;
+    }
+
+    // The decomposition is the same on a second call
+    std::map<plb::plint, plb::plint> again;
+    hemo::fluidWeightedDecomposition(*field, candidates, nParts, 2, again);
+    EXPECT_EQ(again, blockToPart);
+  }
+}
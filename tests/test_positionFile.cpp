@@ -0,0 +1,106 @@
+#include "tools/packCells/positionFile.h"
+#include "gtest/gtest.h"
+
+#include <cstdio>
+#include <fstream>
+#include <random>
+#include <vector>
+
+TEST(PositionFile, MortonKeyRoundTrip) {
+  std::mt19937 rng(47);
+  std::uniform_int_distribution<uint32_t> coordinate(0, (1u << 21) - 1);
+  for (int i = 0; i < 1000; i++) {
+    const uint32_t x = coordinate(rng), y = coordinate(rng), z = coordinate(rng);
+    uint32_t bin[3];
+    posfile::binOfKey(posfile::mortonKey(x, y, z), bin);
+    EXPECT_EQ(bin[0], x);
+    EXPECT_EQ(bin[1], y);
+    EXPECT_EQ(bin[2], z);
+  }
+  EXPECT_EQ(posfile::mortonKey(1, 0, 0), 1u);
+  EXPECT_EQ(posfile::mortonKey(0, 1, 0), 2u);
+  EXPECT_EQ(posfile::mortonKey(0, 0, 1), 4u);
+  EXPECT_EQ(posfile::mortonKey(1, 1, 1), 7u);
+  EXPECT_EQ(posfile::mortonKey(2, 0, 0), 8u);
+}
+
+TEST(PositionFile, WriteReadRoundTrip) {
+  std::mt19937 rng(7);
+  std::uniform_real_distribution<double> position(-15., 95.), angle(0., 360.);
+  std::vector<posfile::Record> records(500);
+  for (uint64_t i = 0; i < records.size(); i++) {
+    for (int d = 0; d < 3; d++) {
+      records[i].position[d] = position(rng);
+      records[i].angles[d] = angle(rng);
+    }
+    records[i].index = i;
+  }
+
+  const std::string fileName = "test_positionFile.pos";
+  const double binSize = posfile::defaultBinSize;
+  ASSERT_TRUE(posfile::write(fileName, records, binSize));
+  ASSERT_TRUE(posfile::isBinary(fileName));
+
+  std::ifstream file(fileName, std::ios::binary);
+  posfile::Header header;
+  file.read((char *)&header, sizeof(header));
+  ASSERT_TRUE(bool(file));
+  EXPECT_EQ(header.version, posfile::version);
+  EXPECT_EQ(header.recordSize, sizeof(posfile::Record));
+  EXPECT_EQ(header.cells, records.size());
+  EXPECT_EQ(header.binSize, binSize);
+  std::vector<posfile::TableEntry> table(header.tableEntries);
+  std::vector<posfile::Record> stored(header.cells);
+  file.read((char *)table.data(), table.size() * sizeof(posfile::TableEntry));
+  file.read((char *)stored.data(), stored.size() * sizeof(posfile::Record));
+  ASSERT_TRUE(bool(file));
+  file.close();
+  std::remove(fileName.c_str());
+
+  // The table covers the records in order of increasing key, every record
+  // lies in the bin of its table entry
+  uint64_t next = 0;
+  for (unsigned int t = 0; t < table.size(); t++) {
+    if (t) {
+      EXPECT_LT(table[t - 1].key, table[t].key);
+    }
+    EXPECT_EQ(table[t].first, next);
+    next += table[t].count;
+    uint32_t bin[3];
+    posfile::binOfKey(table[t].key, bin);
+    for (uint64_t r = table[t].first; r < table[t].first + table[t].count; r++) {
+      for (int d = 0; d < 3; d++) {
+        ASSERT_LT(bin[d], header.bins[d]);
+        const double lower = header.lower[d] + bin[d] * binSize;
+        EXPECT_GE(stored[r].position[d], lower);
+        // The last bin also takes the upper boundary
+        if (bin[d] + 1 < header.bins[d]) {
+          EXPECT_LT(stored[r].position[d], lower + binSize);
+        }
+      }
+    }
+  }
+  EXPECT_EQ(next, records.size());
+
+  // Every record is stored exactly once and unchanged
+  std::vector<bool> seen(records.size(), false);
+  for (posfile::Record const &record : stored) {
+    ASSERT_LT(record.index, records.size());
+    EXPECT_FALSE(seen[record.index]);
+    seen[record.index] = true;
+    for (int d = 0; d < 3; d++) {
+      EXPECT_EQ(record.position[d], records[record.index].position[d]);
+      EXPECT_EQ(record.angles[d], records[record.index].angles[d]);
+    }
+  }
+}
+
+TEST(PositionFile, TextIsNotBinary) {
+  const std::string fileName = "test_positionFile.txt";
+  {
+    std::ofstream file(fileName);
+    file << "1\n10.0 10.0 10.0 0.0 0.0 0.0\n";
+  }
+  EXPECT_FALSE(posfile::isBinary(fileName));
+  std::remove(fileName.c_str());
+}
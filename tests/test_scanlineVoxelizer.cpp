@@ -0,0 +1,145 @@
+#include "helper/mollerTrumbore.h"
+#include "helper/scanlineVoxelizer.h"
+#include "gtest/gtest.h"
+
+#include <cmath>
+#include <map>
+#include <set>
+#include <tuple>
+#include <vector>
+
+typedef std::tuple<plint, plint, plint> Node;
+
+// Unit icosphere, every level splits each triangle in four.
+static void icosphere(int levels, std::vector<hemo::Array<T, 3>> &vertices,
+                      std::vector<hemo::Array<plint, 3>> &triangles) {
+  const T t = (1 + std::sqrt(5.)) / 2;
+  const T corners[12][3] = {{-1, t, 0}, {1, t, 0},  {-1, -t, 0}, {1, -t, 0},
+                            {0, -1, t}, {0, 1, t},  {0, -1, -t}, {0, 1, -t},
+                            {t, 0, -1}, {t, 0, 1},  {-t, 0, -1}, {-t, 0, 1}};
+  const plint faces[20][3] = {{0, 11, 5}, {0, 5, 1},  {0, 1, 7},   {0, 7, 10},
+                              {0, 10, 11}, {1, 5, 9}, {5, 11, 4},  {11, 10, 2},
+                              {10, 7, 6}, {7, 1, 8},  {3, 9, 4},   {3, 4, 2},
+                              {3, 2, 6},  {3, 6, 8},  {3, 8, 9},   {4, 9, 5},
+                              {2, 4, 11}, {6, 2, 10}, {8, 6, 7},   {9, 8, 1}};
+  auto normalize = [](hemo::Array<T, 3> p) {
+    return p / std::sqrt(p[0] * p[0] + p[1] * p[1] + p[2] * p[2]);
+  };
+  vertices.clear();
+  triangles.clear();
+  for (auto const &c : corners) {
+    vertices.push_back(normalize({c[0], c[1], c[2]}));
+  }
+  for (auto const &f : faces) {
+    triangles.push_back({f[0], f[1], f[2]});
+  }
+  for (int level = 0; level < levels; level++) {
+    std::map<std::pair<plint, plint>, plint> midpoints;
+    auto midpoint = [&](plint a, plint b) {
+      const std::pair<plint, plint> key(std::min(a, b), std::max(a, b));
+      auto found = midpoints.find(key);
+      if (found != midpoints.end()) {
+        return found->second;
+      }
+      vertices.push_back(normalize((vertices[a] + vertices[b]) * 0.5));
+      return midpoints[key] = vertices.size() - 1;
+    };
+    std::vector<hemo::Array<plint, 3>> refined;
+    for (auto const &tr : triangles) {
+      const plint a = midpoint(tr[0], tr[1]), b = midpoint(tr[1], tr[2]),
+                  c = midpoint(tr[2], tr[0]);
+      refined.push_back({tr[0], a, c});
+      refined.push_back({tr[1], b, a});
+      refined.push_back({tr[2], c, b});
+      refined.push_back({a, b, c});
+    }
+    triangles = refined;
+  }
+}
+
+// Nodes of domain inside the mesh by counting the crossings of a ray from
+// every node, as the cell interior was found before the scanline voxelizer.
+static std::set<Node> bruteForce(std::vector<hemo::Array<T, 3>> const &vertices,
+                                 std::vector<hemo::Array<plint, 3>> const &triangles,
+                                 plb::Box3D const &domain) {
+  std::set<Node> inside;
+  for (plint x = domain.x0; x <= domain.x1; x++) {
+    for (plint y = domain.y0; y <= domain.y1; y++) {
+      for (plint z = domain.z0; z <= domain.z1; z++) {
+        hemo::Array<plint, 3> node = {x, y, z};
+        int crossings = 0;
+        for (auto const &tr : triangles) {
+          crossings += hemo::MollerTrumbore(vertices[tr[0]], vertices[tr[1]],
+                                            vertices[tr[2]], node);
+        }
+        if (crossings % 2) {
+          inside.insert(Node(x, y, z));
+        }
+      }
+    }
+  }
+  return inside;
+}
+
+static std::set<Node> scanline(std::vector<hemo::Array<T, 3>> const &vertices,
+                               std::vector<hemo::Array<plint, 3>> const &triangles,
+                               plb::Box3D const &domain) {
+  std::set<Node> inside;
+  hemo::ScanlineVoxelizer voxelizer;
+  voxelizer.forEachInnerNode(
+      vertices.size(), triangles,
+      [&](plint i) -> const hemo::Array<T, 3> & { return vertices[i]; }, domain,
+      [&](plint x, plint y, plint z) { inside.insert(Node(x, y, z)); });
+  return inside;
+}
+
+// Ellipsoid with semi-axes (a, b, c), sheared in the (x,y) plane, around a
+// center that is not on the lattice.
+static std::vector<hemo::Array<T, 3>> ellipsoid(std::vector<hemo::Array<T, 3>> const &sphere,
+                                                T a, T b, T c, hemo::Array<T, 3> center,
+                                                T shear = 0.3) {
+  std::vector<hemo::Array<T, 3>> vertices;
+  for (auto const &p : sphere) {
+    vertices.push_back({center[0] + a * p[0], center[1] + b * p[1] + shear * a * p[0],
+                        center[2] + c * p[2]});
+  }
+  return vertices;
+}
+
+TEST(ScanlineVoxelizer, SphereMatchesRayCasting) {
+  std::vector<hemo::Array<T, 3>> sphere;
+  std::vector<hemo::Array<plint, 3>> triangles;
+  icosphere(3, sphere, triangles);
+  const plb::Box3D domain(7, 23, 7, 23, 7, 23);
+
+  std::vector<hemo::Array<T, 3>> vertices = ellipsoid(sphere, 7.3, 7.3, 7.3, {15.21, 14.87, 15.43}, 0.);
+  std::set<Node> expected = bruteForce(vertices, triangles, domain);
+  EXPECT_GT(expected.size(), 1000u);
+  EXPECT_EQ(scanline(vertices, triangles, domain), expected);
+}
+
+TEST(ScanlineVoxelizer, EllipsoidMatchesRayCasting) {
+  std::vector<hemo::Array<T, 3>> sphere;
+  std::vector<hemo::Array<plint, 3>> triangles;
+  icosphere(2, sphere, triangles);
+  const plb::Box3D domain(3, 27, 3, 27, 10, 20);
+
+  for (int i = 0; i < 3; i++) {
+    const hemo::Array<T, 3> center = {14.13 + 0.37 * i, 15.71 - 0.29 * i, 14.59 + 0.17 * i};
+    std::vector<hemo::Array<T, 3>> vertices = ellipsoid(sphere, 9.1, 4.3, 2.7, center);
+    EXPECT_EQ(scanline(vertices, triangles, domain), bruteForce(vertices, triangles, domain));
+  }
+}
+
+TEST(ScanlineVoxelizer, ClipsToTheDomain) {
+  std::vector<hemo::Array<T, 3>> sphere;
+  std::vector<hemo::Array<plint, 3>> triangles;
+  icosphere(3, sphere, triangles);
+  std::vector<hemo::Array<T, 3>> vertices = ellipsoid(sphere, 6.2, 5.1, 4.4, {10.33, 10.41, 10.27});
+
+  // Only a corner of the cell lies in the domain
+  const plb::Box3D domain(10, 20, 8, 20, 11, 20);
+  std::set<Node> clipped = scanline(vertices, triangles, domain);
+  EXPECT_FALSE(clipped.empty());
+  EXPECT_EQ(clipped, bruteForce(vertices, triangles, domain));
+}
@@ -0,0 +1,114 @@
+#include "helper/spaceFillingCurve.h"
+#include "gtest/gtest.h"
+
+#include <algorithm>
+#include <cstdlib>
+#include <map>
+#include <set>
+#include <vector>
+
+typedef std::map<plb::plint, plb::plint> Partition;
+
+// A 6x5x4 grid of 8^3 blocks with ids in scrambled order and weights that vary
+// over an order of magnitude, as the fluid-node counts of a vessel do.
+static void blockGrid(std::map<plb::plint, plb::Box3D> &bulks, std::map<plb::plint, double> &weights) {
+  plb::plint i = 0;
+  for (plb::plint x = 0; x < 6; x++) {
+    for (plb::plint y = 0; y < 5; y++) {
+      for (plb::plint z = 0; z < 4; z++, i++) {
+        const plb::plint id = (i * 37) % 120;
+        bulks[id] = plb::Box3D(8 * x, 8 * x + 7, 8 * y, 8 * y + 7, 8 * z, 8 * z + 7);
+        weights[id] = 50 + (i * 7919) % 451;
+      }
+    }
+  }
+}
+
+// Every block is assigned exactly once to a part in [0,nparts), every part gets
+// a block, and no part is heavier than the average by more than `blocks`
+// times the heaviest block.
+static void checkPartition(Partition const &partition, std::map<plb::plint, plb::Box3D> const &bulks,
+                           std::map<plb::plint, double> const &weights, plb::plint nparts, double blocks) {
+  ASSERT_EQ(partition.size(), bulks.size());
+  std::vector<double> partWeights(nparts, 0.);
+  for (auto const &pair : partition) {
+    ASSERT_TRUE(bulks.count(pair.first));
+    ASSERT_GE(pair.second, 0);
+    ASSERT_LT(pair.second, nparts);
+    partWeights[pair.second] += weights.at(pair.first);
+  }
+  double total = 0., heaviest = 0.;
+  for (auto const &pair : weights) {
+    total += pair.second;
+    heaviest = std::max(heaviest, pair.second);
+  }
+  for (plb::plint p = 0; p < nparts; p++) {
+    EXPECT_GT(partWeights[p], 0.) << "part " << p;
+    EXPECT_LE(partWeights[p], total / nparts + blocks * heaviest) << "part " << p;
+  }
+}
+
+TEST(SpaceFillingCurve, HilbertIndexVisitsNeighbours) {
+  // On a 8^3 grid the index is a bijection and consecutive points are neighbours
+  const unsigned int bits = 3;
+  std::vector<std::pair<uint64_t, std::vector<int>>> points;
+  for (int x = 0; x < 8; x++) {
+    for (int y = 0; y < 8; y++) {
+      for (int z = 0; z < 8; z++) {
+        points.push_back({hemo::hilbertIndex3D(x, y, z, bits), {x, y, z}});
+      }
+    }
+  }
+  std::sort(points.begin(), points.end());
+  for (unsigned int i = 0; i < points.size(); i++) {
+    ASSERT_EQ(points[i].first, i);
+    if (i) {
+      int steps = 0;
+      for (int d = 0; d < 3; d++) {
+        steps += std::abs(points[i].second[d] - points[i - 1].second[d]);
+      }
+      EXPECT_EQ(steps, 1) << "index " << i;
+    }
+  }
+}
+
+TEST(SpaceFillingCurve, HilbertPartitionIsBalanced) {
+  std::map<plb::plint, plb::Box3D> bulks;
+  std::map<plb::plint, double> weights;
+  blockGrid(bulks, weights);
+  for (plb::plint nparts : {1, 7, 16, 33}) {
+    Partition partition = hemo::partitionBlocksHilbert(bulks, weights, nparts);
+    checkPartition(partition, bulks, weights, nparts, 1.);
+    EXPECT_EQ(partition, hemo::partitionBlocksHilbert(bulks, weights, nparts));
+  }
+}
+
+TEST(SpaceFillingCurve, RCBPartitionIsBalanced) {
+  std::map<plb::plint, plb::Box3D> bulks;
+  std::map<plb::plint, double> weights;
+  blockGrid(bulks, weights);
+  for (plb::plint nparts : {1, 7, 16, 33}) {
+    Partition partition = hemo::partitionBlocksRCB(bulks, weights, nparts);
+    // The weight is rounded to whole blocks at every bisection level
+    checkPartition(partition, bulks, weights, nparts, 2.);
+    EXPECT_EQ(partition, hemo::partitionBlocksRCB(bulks, weights, nparts));
+  }
+}
+
+TEST(SpaceFillingCurve, MorePartsThanBlocks) {
+  std::map<plb::plint, plb::Box3D> bulks;
+  std::map<plb::plint, double> weights;
+  for (plb::plint id = 0; id < 3; id++) {
+    bulks[id] = plb::Box3D(8 * id, 8 * id + 7, 0, 7, 0, 7);
+    weights[id] = 1. + id;
+  }
+  for (Partition const &partition :
+       {hemo::partitionBlocksHilbert(bulks, weights, 5), hemo::partitionBlocksRCB(bulks, weights, 5)}) {
+    ASSERT_EQ(partition.size(), 3u);
+    std::set<plb::plint> parts;
+    for (auto const &pair : partition) {
+      parts.insert(pair.second);
+    }
+    EXPECT_EQ(parts.size(), 3u);
+  }
+}
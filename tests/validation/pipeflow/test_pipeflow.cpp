@@ -31,13 +31,13 @@ TEST(Validation, Pipeflow) {
                        (*cfg)["domain"]["refDir"].read<int>(),
                        voxelizedDomain, flagMatrix,
                        (*cfg)["domain"]["blockSize"].read<int>(),
-                       (*cfg)["domain"]["particleEnvelope"].read<int>());
+                       hemo::global.particleEnvelope);
 
   hemo::param::lbm_pipe_parameters((*cfg), flagMatrix.get());
   hemo::param::printParameters();
 
   hemocell.lattice = new plb::MultiBlockLattice3D<T, DESCRIPTOR>(
-            voxelizedDomain.get()->getMultiBlockManagement(),
+            flagMatrix.get()->getMultiBlockManagement(),
             plb::defaultMultiBlockPolicy3D().getBlockCommunicator(),
             plb::defaultMultiBlockPolicy3D().getCombinedStatistics(),
             plb::defaultMultiBlockPolicy3D().getMultiCellAccess<T, DESCRIPTOR>(),
@@ -46,11 +46,15 @@ void PrintHelp() {
           "  --noRotate                              Disallow rotation of ellipsoids\n"
           "  --scale <ratio>                      -s Scales the neighbourhood grid (only change this if you know what you are doing!)\n"
           "  --maxiter <n>                           Maximum number of iterations\n"
+          "  --binary                                Write the binary, spatially indexed position format\n"
           "  --help                                  Print this"
           "\n"
           "OUTPUT:\n"
           "  <Cell>.pos for every celltype. The first line contains the number of cells.\n"
-          "  The rest of the lines are the cells in \"Location<X Y Z> Rotation<X Y Z>\" format."
+          "  The rest of the lines are the cells in \"Location<X Y Z> Rotation<X Y Z>\" format.\n"
+          "  With --binary the same data is written in binary, sorted into bins, so that\n"
+          "  HemoCell only reads the cells near each atomic block (see positionFile.h).\n"
+          "  posToBinary converts existing text files."
           "\n"
           "  Cells.pov is a tool for visualization in povray\n"
           "\n"
@@ -80,6 +84,7 @@ const option long_opts[] = {
             {"noRotate",   0, nullptr, 6},
             {"scale",      1, nullptr, 7},
             {"maxiter",    1, nullptr, 8},
+            {"binary",     0, nullptr, 15},
             {"help",       0, nullptr, 9},
             {NULL, 0, 0, 0}
 };
@@ -108,6 +113,7 @@ int main(int argc, char *argv[])
   bool hematocrit_set = false;
   bool RBC_PLT_set = false;
   bool doRotate = true;
+  bool binary = false;
   vector<CellType> cellTypes;
   
   
@@ -178,6 +184,9 @@ int main(int argc, char *argv[])
       case(8):
         maxIter = atoi(optarg);
         break;
+      case(15):
+        binary = true;
+        break;
       case(9):
       case('?'):
       default:
@@ -266,7 +275,7 @@ int main(int argc, char *argv[])
 
   pack.execute();
 
-  pack.saveBloodCellPositions();
+  pack.saveBloodCellPositions(binary);
   
   //pack.savePov(povFileName.c_str(), sX, sY, sZ, wbcNumber);
 
@@ -41,6 +41,7 @@ along with this program.  If not, see <http://www.gnu.org/licenses/>.
 #include "geometry.h"
 #include "ellipsoid.h"
 #include "rnd_utils.h"
+#include "positionFile.h"
 
 
 using namespace std;
@@ -98,7 +99,7 @@ public:
   void initBlood(float sizeX, float sizeY, float sizeZ, int maxSteps, double sizing, vector<CellType> & ctypes);
   // void initSuspension(vector<int> nPartsPerComponent, vector<vector3> diametersPerComponent, vector<int> domainSize, double nominalPackingDensity, int maxSteps, double sizing);
   void savePov(const char * fileName, int wbcNumber);
-  void saveBloodCellPositions();
+  void saveBloodCellPositions(bool binary = false);
   void getOutput(vector<vector<vector3> > &positions, vector<vector<vector3> > &angles);
   void setRndRotation(bool rndRotation_) {rndRotation = rndRotation_;}
 };
@@ -614,12 +615,32 @@ void Packing::savePov(const char *fileName, int wbcNumber)
     povf.close();
 }
 
-void Packing::saveBloodCellPositions()
+void Packing::saveBloodCellPositions(bool binary)
 {
 	int speciesCounter = 0;
 
 	for (int j = 0; j < NumSpecies; j++){
 
+		if (binary) {
+			vector<posfile::Record> records;
+			for(int i = speciesCounter; i < (speciesCounter+species[j]->getNum() ); i++)
+			{
+				Ellipsoid *pi = particles[i];
+
+				vector3 pos = pi->get_pos() * (1./Sizing);
+				matrix33 Q = pi->get_q().countQ();
+				vector3 euler(atan2(Q(1,2),Q(2,2)), -asin(Q(0,2)), atan2(Q(0,1),Q(0,0)));
+				euler *= 180 / PI; //Rad to Deg
+
+				records.push_back({{pos[0],pos[1],pos[2]},{euler[0],euler[1],euler[2]},uint64_t(i-speciesCounter)});
+			}
+			if (!posfile::write(species[j]->name + ".pos", records, posfile::defaultBinSize)) {
+				cerr << "Could not write " << species[j]->name << ".pos" << endl;
+			}
+			speciesCounter += species[j]->getNum();
+			continue;
+		}
+
 		ofstream cellsFile (species[j]->name + ".pos");
 
 		//cellsFile << No_cells_x << " " << No_cells_y << " " << No_cells_z << endl; // Dimensions
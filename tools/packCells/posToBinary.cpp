@@ -0,0 +1,77 @@
+/*
+This file is part of the HemoCell library
+
+HemoCell is developed and maintained by the Computational Science Lab 
+in the University of Amsterdam. Any questions or remarks regarding this library 
+can be sent to: info@hemocell.eu
+
+When using the HemoCell library in scientific work please cite the
+corresponding paper: https://doi.org/10.3389/fphys.2017.00563
+
+The HemoCell library is free software: you can redistribute it and/or
+modify it under the terms of the GNU Affero General Public License as
+published by the Free Software Foundation, either version 3 of the
+License, or (at your option) any later version.
+
+The library is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU Affero General Public License for more details.
+
+You should have received a copy of the GNU Affero General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+/*
+ * Converts text <Cell>.pos files into the binary, spatially indexed format
+ * of positionFile.h. The output keeps the cell order, so the cell ids in
+ * HemoCell stay the same.
+ */
+
+#include <cstdlib>
+#include <iostream>
+
+#include "positionFile.h"
+
+using namespace std;
+
+int main(int argc, char *argv[])
+{
+  if (argc < 3) {
+    cerr << "USAGE: posToBinary <input.pos> <output.pos> [bin size in µm, default " << posfile::defaultBinSize << "]" << endl;
+    return 1;
+  }
+  double binSize = argc > 3 ? atof(argv[3]) : posfile::defaultBinSize;
+  if (binSize <= 0.) {
+    cerr << "The bin size must be positive, exiting..." << endl;
+    return 1;
+  }
+  if (posfile::isBinary(argv[1])) {
+    cerr << argv[1] << " is already binary, exiting..." << endl;
+    return 1;
+  }
+
+  ifstream in(argv[1]);
+  uint64_t nCells = 0;
+  if (!(in >> nCells)) {
+    cerr << "Could not read " << argv[1] << ", exiting..." << endl;
+    return 1;
+  }
+  vector<posfile::Record> records(nCells);
+  for (uint64_t i = 0 ; i < nCells ; i++) {
+    posfile::Record & record = records[i];
+    if (!(in >> record.position[0] >> record.position[1] >> record.position[2]
+             >> record.angles[0] >> record.angles[1] >> record.angles[2])) {
+      cerr << argv[1] << " contains " << i << " cells instead of " << nCells << ", exiting..." << endl;
+      return 1;
+    }
+    record.index = i;
+  }
+
+  if (!posfile::write(argv[2], records, binSize)) {
+    cerr << "Could not write " << argv[2] << ", exiting..." << endl;
+    return 1;
+  }
+  cout << "Wrote " << nCells << " cells to " << argv[2] << endl;
+  return 0;
+}
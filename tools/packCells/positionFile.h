@@ -0,0 +1,160 @@
+/*
+This file is part of the HemoCell library
+
+HemoCell is developed and maintained by the Computational Science Lab 
+in the University of Amsterdam. Any questions or remarks regarding this library 
+can be sent to: info@hemocell.eu
+
+When using the HemoCell library in scientific work please cite the
+corresponding paper: https://doi.org/10.3389/fphys.2017.00563
+
+The HemoCell library is free software: you can redistribute it and/or
+modify it under the terms of the GNU Affero General Public License as
+published by the Free Software Foundation, either version 3 of the
+License, or (at your option) any later version.
+
+The library is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU Affero General Public License for more details.
+
+You should have received a copy of the GNU Affero General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef POSITION_FILE_H
+#define POSITION_FILE_H
+
+/*
+ * Binary, spatially indexed cell position file, an alternative to the text
+ * <Cell>.pos format. It is shared by packCells (writing) and HemoCell
+ * (reading), and is recognised by its magic, so it can keep the .pos name.
+ *
+ * Layout (native endianness):
+ *   Header
+ *   TableEntry[tableEntries]  occupied bins sorted by Morton key
+ *   Record[cells]             sorted by Morton key of their bin
+ *
+ * Bins are cubes of binSize [µm] starting at lower. A reader looks up the
+ * bins overlapping its domain in the table and only touches those records.
+ */
+
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+#include <fstream>
+#include <string>
+#include <vector>
+
+namespace posfile {
+
+  static const char magic[8] = {'H','C','P','O','S','B','I','N'};
+  static const uint32_t version = 1;
+  /// Default bin edge [µm], a few cells per bin
+  static const double defaultBinSize = 10.;
+
+  struct Header {
+    char magic[8];
+    uint32_t version;
+    uint32_t recordSize;
+    uint64_t cells;
+    uint64_t tableEntries;
+    double binSize;
+    double lower[3];
+    uint32_t bins[3];
+    uint32_t padding;
+  };
+
+  /// Position and rotation in the units of the text format ([µm], degrees)
+  struct Record {
+    double position[3];
+    double angles[3];
+    /// Line of the cell in the text format, HemoCell derives the cell id from it
+    uint64_t index;
+  };
+
+  struct TableEntry {
+    uint64_t key;
+    uint64_t first;
+    uint64_t count;
+  };
+
+  /// Interleave the lower 21 bits of the bin coordinates
+  inline uint64_t mortonKey(uint32_t x, uint32_t y, uint32_t z) {
+    uint64_t key = 0;
+    for (int b = 0 ; b < 21 ; b++) {
+      key |= (uint64_t((x >> b) & 1) << (3*b)) | (uint64_t((y >> b) & 1) << (3*b+1)) | (uint64_t((z >> b) & 1) << (3*b+2));
+    }
+    return key;
+  }
+
+  inline void binOfKey(uint64_t key, uint32_t bin[3]) {
+    bin[0] = bin[1] = bin[2] = 0;
+    for (int b = 0 ; b < 21 ; b++) {
+      for (int d = 0 ; d < 3 ; d++) {
+        bin[d] |= uint32_t((key >> (3*b+d)) & 1) << b;
+      }
+    }
+  }
+
+  inline bool isBinary(const std::string & fileName) {
+    std::ifstream file(fileName, std::ios::binary);
+    char start[8] = {0};
+    file.read(start,8);
+    return file && !std::memcmp(start,magic,8);
+  }
+
+  /// Write the records (index set by the caller) sorted into bins of binSize [µm]
+  inline bool write(const std::string & fileName, std::vector<Record> records, double binSize) {
+    Header header;
+    std::memcpy(header.magic,magic,8);
+    header.version = version;
+    header.recordSize = sizeof(Record);
+    header.cells = records.size();
+    header.binSize = binSize;
+    header.padding = 0;
+    for (int d = 0 ; d < 3 ; d++) {
+      header.lower[d] = 0.;
+      double upper = 0.;
+      if (!records.empty()) {
+        header.lower[d] = upper = records[0].position[d];
+      }
+      for (const Record & record : records) {
+        header.lower[d] = std::min(header.lower[d],record.position[d]);
+        upper = std::max(upper,record.position[d]);
+      }
+      header.bins[d] = std::min(uint32_t(1) << 21, uint32_t((upper-header.lower[d])/binSize) + 1);
+    }
+
+    std::vector<std::pair<uint64_t,uint64_t>> keys(records.size());
+    for (uint64_t i = 0 ; i < records.size() ; i++) {
+      uint32_t bin[3];
+      for (int d = 0 ; d < 3 ; d++) {
+        bin[d] = std::min(header.bins[d]-1, uint32_t((records[i].position[d]-header.lower[d])/binSize));
+      }
+      keys[i] = {mortonKey(bin[0],bin[1],bin[2]),i};
+    }
+    std::sort(keys.begin(),keys.end());
+
+    std::vector<Record> sorted(records.size());
+    std::vector<TableEntry> table;
+    for (uint64_t i = 0 ; i < keys.size() ; i++) {
+      sorted[i] = records[keys[i].second];
+      if (table.empty() || table.back().key != keys[i].first) {
+        table.push_back({keys[i].first,i,0});
+      }
+      table.back().count++;
+    }
+    header.tableEntries = table.size();
+
+    std::ofstream file(fileName, std::ios::binary);
+    file.write((const char *)&header,sizeof(Header));
+    file.write((const char *)table.data(),table.size()*sizeof(TableEntry));
+    file.write((const char *)sorted.data(),sorted.size()*sizeof(Record));
+    return bool(file);
+  }
+}
+
+#endif